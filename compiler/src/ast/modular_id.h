@@ -60,6 +60,15 @@ namespace gal::ast {
       }
     }
 
+    /// Gets the module in the form that `FullyQualifiedID::module_string` uses, i.e `::foo::bar::`
+    /// for `foo::bar`. Every module is found from the root, so `foo::bar` and `::foo::bar` are
+    /// the same module
+    ///
+    /// \return The module string
+    [[nodiscard]] std::string module_string() const noexcept {
+      return absl::StrCat("::", absl::StrJoin(parts_, "::"), parts_.empty() ? "" : "::");
+    }
+
     /// Compares two ModuleIDs for equality
     ///
     /// \param lhs The first module id to compare
@@ -10,12 +10,22 @@
 
 #pragma once
 
+#include "../../utility/arena.h"
 #include "../../utility/misc.h"
 #include "../modular_id.h"
 #include "../source_loc.h"
 #include "absl/types/span.h"
+#include <cstddef>
+#include <new>
 
 namespace gal::ast {
+  namespace internal {
+    /// Sits directly in front of every node in memory, records where the node came from
+    struct alignas(std::max_align_t) NodeHeader {
+      gal::Arena* arena;
+    };
+  } // namespace internal
+
   /// Base class for all AST nodes, contains source mapping information
   class Node {
   public:
@@ -28,6 +38,31 @@ namespace gal::ast {
       return loc_;
     }
 
+    /// Allocates memory for a node. If an arena is active on the current thread
+    /// (see `gal::ArenaScope`) the node is put into it, otherwise it goes on the heap.
+    ///
+    /// \param size The size of the node
+    /// \return Memory for the node
+    [[nodiscard]] static void* operator new(std::size_t size) {
+      auto* arena = gal::Arena::current();
+      auto total = sizeof(internal::NodeHeader) + size;
+      auto* memory = (arena != nullptr) ? arena->allocate(total, alignof(internal::NodeHeader)) : ::operator new(total);
+
+      return new (memory) internal::NodeHeader{arena} + 1;
+    }
+
+    /// Frees the memory of a node. Nodes in an arena are left alone, their
+    /// memory is released all at once when the arena itself is destroyed.
+    ///
+    /// \param ptr The node to free
+    static void operator delete(void* ptr) noexcept {
+      auto* header = static_cast<internal::NodeHeader*>(ptr) - 1;
+
+      if (header->arena == nullptr) {
+        ::operator delete(header);
+      }
+    }
+
   protected:
     /// Initializes the Node
     ///
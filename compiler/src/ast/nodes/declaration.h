@@ -309,6 +309,7 @@ namespace gal::ast {
     builtin_noreturn,      // __noreturn
     builtin_stdlib,        // __stdlib
     builtin_varargs,       // __varargs
+    builtin_may_alias,     // __mayalias
   };
 
   /// An attribute can have other arguments given to it
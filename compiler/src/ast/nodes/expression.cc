@@ -549,7 +549,8 @@ namespace gal::ast {
     auto& result = gal::as<ForExpression>(other);
 
     return loop_variable() == result.loop_variable() && loop_direction() == result.loop_direction()
-           && init() == result.init() && last() == result.last() && body() == result.body();
+           && init() == result.init() && last() == result.last() && attributes_ == result.attributes_
+           && body() == result.body();
   }
 
   std::unique_ptr<Expression> ForExpression::internal_clone() const noexcept {
@@ -558,6 +559,7 @@ namespace gal::ast {
         loop_direction(),
         init().clone(),
         last().clone(),
+        attributes_,
         gal::static_unique_cast<BlockExpression>(body().clone()));
   }
 
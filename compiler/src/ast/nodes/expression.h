@@ -2000,6 +2000,24 @@ namespace gal::ast {
     down_to,
   };
 
+  /// The different hints that can be put on a for-loop
+  enum class LoopAttributeType {
+    builtin_vectorize,    // __vectorize(width)
+    builtin_unroll,       // __unroll(count)
+    builtin_no_vectorize, // __novectorize
+  };
+
+  /// A loop attribute, along with the integer argument it was given (if any).
+  /// These only change how the loop is optimized, never what it does
+  struct LoopAttribute {
+    LoopAttributeType type;
+    std::uint64_t value;
+
+    [[nodiscard]] friend bool operator==(const LoopAttribute& lhs, const LoopAttribute& rhs) noexcept {
+      return lhs.type == rhs.type && lhs.value == rhs.value;
+    }
+  };
+
   /// Models a for loop
   class ForExpression final : public Expression {
   public:
@@ -2010,18 +2028,21 @@ namespace gal::ast {
     /// \param direction The direction of the loop
     /// \param init The initial value of the loop iterator
     /// \param last The value to stop at
+    /// \param attributes Any optimization hints given to the loop
     /// \param body The body of the loop
     explicit ForExpression(SourceLoc loc,
         std::string loop_variable,
         ForDirection direction,
         std::unique_ptr<Expression> init,
         std::unique_ptr<Expression> last,
+        std::vector<LoopAttribute> attributes,
         std::unique_ptr<BlockExpression> body) noexcept
         : Expression(std::move(loc), ExprType::for_loop),
           loop_variable_{std::move(loop_variable)},
           direction_{direction},
           init_{std::move(init)},
           last_{std::move(last)},
+          attributes_{std::move(attributes)},
           body_{std::move(body)} {}
 
     /// Gets the name of the loop variable
@@ -2080,6 +2101,13 @@ namespace gal::ast {
       return &last_;
     }
 
+    /// Gets the optimization hints given to the loop
+    ///
+    /// \return The loop's attributes
+    [[nodiscard]] absl::Span<const LoopAttribute> attributes() const noexcept {
+      return attributes_;
+    }
+
     /// Gets the body of the loop
     ///
     /// \return The body of the loop
@@ -2115,6 +2143,7 @@ namespace gal::ast {
     ForDirection direction_;
     std::unique_ptr<Expression> init_;
     std::unique_ptr<Expression> last_;
+    std::vector<LoopAttribute> attributes_;
     std::unique_ptr<Expression> body_;
   };
 
@@ -339,6 +339,24 @@ namespace gal::ast {
     return std::make_unique<ArrayType>(loc(), size(), element_type().clone());
   }
 
+  void VectorType::internal_accept(TypeVisitorBase* visitor) {
+    visitor->visit(this);
+  }
+
+  void VectorType::internal_accept(ConstTypeVisitorBase* visitor) const {
+    visitor->visit(*this);
+  }
+
+  bool VectorType::internal_equals(const Type& other) const noexcept {
+    auto& result = gal::as<VectorType>(other);
+
+    return lanes() == result.lanes() && element_type() == result.element_type();
+  }
+
+  std::unique_ptr<Type> VectorType::internal_clone() const noexcept {
+    return std::make_unique<VectorType>(loc(), lanes(), element_type().clone());
+  }
+
   void IndirectionType::internal_accept(TypeVisitorBase* visitor) {
     visitor->visit(this);
   }
@@ -44,6 +44,7 @@ namespace gal::ast {
     unsized_integer,
     array,
     indirection,
+    vector,
   };
 
   /// Abstract base type for all "Type" AST nodes
@@ -1006,6 +1007,62 @@ namespace gal::ast {
     std::unique_ptr<Type> type_;
   };
 
+  /// Models a fixed-width SIMD vector type, i.e `f32x4` or `boolx8`. Every lane
+  /// has the same builtin integral, float or `bool` type
+  class VectorType final : public Type {
+  public:
+    /// Creates a vector type
+    ///
+    /// \param loc The location of the type
+    /// \param lanes The number of lanes in the vector
+    /// \param type The type of each lane
+    explicit VectorType(SourceLoc loc, std::uint64_t lanes, std::unique_ptr<Type> type) noexcept
+        : Type(std::move(loc), TypeType::vector),
+          lanes_{lanes},
+          type_{std::move(type)} {}
+
+    /// Gets the number of lanes in the vector
+    ///
+    /// \return The number of lanes
+    [[nodiscard]] std::uint64_t lanes() const noexcept {
+      return lanes_;
+    }
+
+    /// Gets the type of each lane
+    ///
+    /// \return The lane type
+    [[nodiscard]] const Type& element_type() const noexcept {
+      return *type_;
+    }
+
+    /// Gets the type of each lane
+    ///
+    /// \return The lane type
+    [[nodiscard]] Type* element_type_mut() noexcept {
+      return type_.get();
+    }
+
+    /// Gets the type of each lane
+    ///
+    /// \return The lane type
+    [[nodiscard]] std::unique_ptr<Type>* element_type_owner() noexcept {
+      return &type_;
+    }
+
+  protected:
+    void internal_accept(TypeVisitorBase* visitor) final;
+
+    void internal_accept(ConstTypeVisitorBase* visitor) const final;
+
+    [[nodiscard]] bool internal_equals(const Type& other) const noexcept final;
+
+    [[nodiscard]] std::unique_ptr<Type> internal_clone() const noexcept final;
+
+  private:
+    std::uint64_t lanes_;
+    std::unique_ptr<Type> type_;
+  };
+
   /// Models the magical type produced by `*` that can be assigned to / loaded from
   class IndirectionType final : public Type {
   public:
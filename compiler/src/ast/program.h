@@ -10,15 +10,26 @@
 
 #pragma once
 
+#include "../utility/arena.h"
 #include "./nodes.h"
 #include "absl/types/span.h"
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace gal::ast {
   class Program {
   public:
-    explicit Program(std::vector<std::unique_ptr<Declaration>> decls) noexcept : declarations_{std::move(decls)} {}
+    /// Creates a program out of a list of declarations
+    ///
+    /// \param decls The declarations in the program
+    /// \param arena The arena that the program's nodes were allocated in, if there was one.
+    ///        The program takes ownership of it and it lives as long as the program does
+    explicit Program(std::vector<std::unique_ptr<Declaration>> decls,
+        std::unique_ptr<gal::Arena> arena = nullptr) noexcept
+        : arena_{std::move(arena)},
+          declarations_{std::move(decls)} {}
 
     [[nodiscard]] absl::Span<const std::unique_ptr<Declaration>> decls() const noexcept {
       return declarations_;
@@ -32,7 +43,80 @@ namespace gal::ast {
       declarations_.push_back(std::move(node));
     }
 
+    /// Gets the module that the program's declarations belong to, in the form that
+    /// `FullyQualifiedID::module_string` uses. This is the root module (`::`) unless it's set
+    ///
+    /// \return The program's module
+    [[nodiscard]] std::string_view module_string() const noexcept {
+      return module_;
+    }
+
+    /// Sets the module that the program's declarations belong to, see `module_string`
+    ///
+    /// \param module The module, i.e `::foo::bar::`
+    void set_module(std::string module) noexcept {
+      module_ = std::move(module);
+    }
+
+    /// Checks whether the program is the one an executable starts in. When several files are
+    /// compiled together, that's any file that no other file imports
+    ///
+    /// \return Whether the program is an entry program
+    [[nodiscard]] bool entry() const noexcept {
+      return entry_;
+    }
+
+    /// Sets whether the program is an entry program, see `entry`
+    ///
+    /// \param entry Whether the program is an entry program
+    void set_entry(bool entry) noexcept {
+      entry_ = entry;
+    }
+
+    /// Checks if a function is the entry point, which is only the `main` declared at the
+    /// top level of an entry program. Any other `main` is a normal function
+    ///
+    /// \param fn The function to check
+    /// \return Whether `fn` is the entry point
+    [[nodiscard]] bool is_entry_point(const FnDeclaration& fn) const noexcept {
+      return entry_ && fn.id().name() == "main" && fn.id().module_string() == module_;
+    }
+
+    /// Gets every module that the program imports (directly or not). These are read from
+    /// module interfaces, and only contain declarations: functions are `ExternalFnDeclaration`s
+    /// and constants don't have initializers
+    ///
+    /// \return The imported modules
+    [[nodiscard]] absl::Span<const std::unique_ptr<Program>> imports() const noexcept {
+      return imports_;
+    }
+
+    /// Adds an imported module, see `imports`. Anything referring to the module's declarations
+    /// is able to for as long as the program is alive
+    ///
+    /// \param module The module to add
+    /// \return A pointer to the module
+    Program* add_import(std::unique_ptr<Program> module) noexcept {
+      imports_.push_back(std::move(module));
+
+      return imports_.back().get();
+    }
+
+    /// Gets the arena that the program's nodes live in. Any nodes created while
+    /// working on the program (e.g. by the type checker) should go in here as well,
+    /// see `gal::ArenaScope`.
+    ///
+    /// \return The program's arena, or `nullptr` if it doesn't have one
+    [[nodiscard]] gal::Arena* arena() noexcept {
+      return arena_.get();
+    }
+
   private:
+    // must be declared first, every node needs to be destroyed before the memory goes away
+    std::unique_ptr<gal::Arena> arena_;
     std::vector<std::unique_ptr<Declaration>> declarations_;
+    std::vector<std::unique_ptr<Program>> imports_;
+    std::string module_ = "::";
+    bool entry_ = true;
   };
 } // namespace gal::ast
@@ -10,69 +10,85 @@
 
 #pragma once
 
+#include "../utility/source_manager.h"
 #include <cstdint>
 #include <filesystem>
-#include <string>
 #include <string_view>
 
 namespace gal::ast {
   /// Represents an exact location in the source code, showing
   /// exactly where an AST node came from.
+  ///
+  /// This is only a handle (a file and a byte range in that file), everything
+  /// else is looked up in `gal::sources()` when it's actually asked for. Every
+  /// node and type holds one of these, so it needs to stay small.
   class SourceLoc {
   public:
     /// Creates a SourceLoc object
     ///
-    /// \param raw The full raw text for a given node
-    /// \param line The line that the node starts at
-    /// \param column The column in that line the node starts at
     /// \param file The file that the node came from
-    explicit SourceLoc(std::string raw, std::uint64_t line, std::uint64_t column, std::filesystem::path file) noexcept
-        : raw_{std::move(raw)},
-          line_{line},
-          col_{column + 1}, // ANTLR gives you 0-based columns, editors do 1-based
-          file_{std::move(file)} {}
+    /// \param offset The byte offset into the file that the node starts at
+    /// \param length The number of bytes of source the node spans
+    explicit SourceLoc(gal::FileID file, std::uint32_t offset, std::uint32_t length) noexcept
+        : file_{file},
+          offset_{offset},
+          length_{length} {}
 
     /// Explicitly returns a nonexistent and **meaningless** source
     /// location without allowing default construction
     ///
     /// \return A meaningless source location
     static SourceLoc nonexistent() noexcept {
-      return SourceLoc{"", 0, 0, ""};
+      return SourceLoc{0, 0, 0};
     }
 
     /// The full raw text of the node
     ///
-    /// \return Raw text
+    /// \return Raw text, a view into the loaded source file
     [[nodiscard]] std::string_view raw_text() const noexcept {
-      return raw_;
+      return gal::sources().contents(file_).substr(offset_, length_);
     }
 
     /// The line number of the node
     ///
     /// \return The line number
     [[nodiscard]] std::uint64_t line() const noexcept {
-      return line_;
+      return gal::sources().line_of(file_, offset_);
     }
 
     /// Gets the column that the node is on
     ///
     /// \return The column of the node
     [[nodiscard]] std::uint64_t column() const noexcept {
-      return col_;
+      return gal::sources().column_of(file_, offset_);
     }
 
     /// Gets the number of characters in the source being pointed to
     ///
     /// \return The length of the portion of source code
     [[nodiscard]] std::size_t length() const noexcept {
-      return raw_.size();
+      return length_;
+    }
+
+    /// Gets the byte offset into the file that the node starts at
+    ///
+    /// \return The offset of the node
+    [[nodiscard]] std::uint32_t offset() const noexcept {
+      return offset_;
+    }
+
+    /// Gets the ID of the file that the node was parsed from
+    ///
+    /// \return The ID of the file
+    [[nodiscard]] gal::FileID file_id() const noexcept {
+      return file_;
     }
 
     /// Gets the path of the file that the node was parsed from
     ///
     /// \return The file that the node came from
     [[nodiscard]] const std::filesystem::path& file() const noexcept {
-      return file_;
+      return gal::sources().path(file_);
     }
 
     /// Compares two source locations for equality
@@ -80,14 +96,14 @@ namespace gal::ast {
     /// \param other The other location to compare
     /// \return True if they are equivalent, false otherwise
     [[nodiscard]] bool operator==(const SourceLoc& other) const noexcept {
-      return raw_text() == other.raw_text() && line() == other.line() && column() == other.column()
-             && file() == other.file();
+      return file_ == other.file_ && offset_ == other.offset_ && length_ == other.length_;
     }
 
   private:
-    std::string raw_;
-    std::uint64_t line_;
-    std::uint64_t col_;
-    std::filesystem::path file_;
+    gal::FileID file_;
+    std::uint32_t offset_;
+    std::uint32_t length_;
   };
+
+  static_assert(sizeof(SourceLoc) == 12, "SourceLoc is copied into every node, it needs to stay small");
 } // namespace gal::ast
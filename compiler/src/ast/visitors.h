@@ -98,6 +98,10 @@ namespace gal::ast {
       accept(type->produced_owner());
     }
 
+    void visit(VectorType* type) override {
+      accept(type->element_type_owner());
+    }
+
     void visit(ImportDeclaration*) override {}
 
     void visit(ImportFromDeclaration*) override {}
@@ -497,6 +501,10 @@ namespace gal::ast {
       accept(type.produced());
     }
 
+    void visit(const VectorType& type) override {
+      accept(type.element_type());
+    }
+
     void visit(const ImportDeclaration&) override {}
 
     void visit(const ImportFromDeclaration&) override {}
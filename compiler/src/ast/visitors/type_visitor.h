@@ -32,6 +32,7 @@ namespace gal::ast {
   class UnsizedIntegerType;
   class ArrayType;
   class IndirectionType;
+  class VectorType;
 
   class TypeVisitorBase {
   public:
@@ -73,6 +74,8 @@ namespace gal::ast {
 
     virtual void visit(IndirectionType*) = 0;
 
+    virtual void visit(VectorType*) = 0;
+
     virtual ~TypeVisitorBase() = default;
   };
 
@@ -116,6 +119,8 @@ namespace gal::ast {
 
     virtual void visit(const IndirectionType&) = 0;
 
+    virtual void visit(const VectorType&) = 0;
+
     virtual ~ConstTypeVisitorBase() = default;
   };
 
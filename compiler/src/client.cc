@@ -0,0 +1,107 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+// A thin client for `gallium --serve`. It forwards its arguments, working directory, environment
+// and standard streams to the server and exits with whatever code the compile finished with.
+//
+// This is deliberately tiny (no LLVM, no abseil) so that starting it is nearly free. If no
+// server is running, it falls back to running `$GALLIUM` (or `gallium` from `$PATH`) itself.
+//
+// usage: gallium-client <anything gallium accepts>
+
+#include "utility/serve_protocol.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+  int connect_to(const std::string& path) noexcept {
+    auto address = sockaddr_un{};
+
+    if (path.size() >= sizeof address.sun_path) {
+      return -1;
+    }
+
+    auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0) {
+      return -1;
+    }
+
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.data(), path.size());
+
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) < 0) {
+      ::close(fd);
+
+      return -1;
+    }
+
+    return fd;
+  }
+
+  [[noreturn]] void run_locally(char** argv) noexcept {
+    auto* compiler = std::getenv("GALLIUM");
+    auto* program = (compiler != nullptr && *compiler != '\0') ? compiler : const_cast<char*>("gallium");
+
+    argv[0] = program;
+    ::execvp(program, argv);
+
+    std::cerr << "gallium-client: no server is running and `" << program << "` couldn't be run: " << std::strerror(errno)
+              << '\n';
+    std::exit(1);
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  auto socket = connect_to(gal::default_socket_path());
+
+  if (socket < 0) {
+    run_locally(argv);
+  }
+
+  auto request = gal::ServeRequest{};
+  auto cwd = std::string(PATH_MAX, '\0');
+
+  if (::getcwd(cwd.data(), cwd.size()) == nullptr) {
+    std::cerr << "gallium-client: unable to get the working directory: " << std::strerror(errno) << '\n';
+
+    return 1;
+  }
+
+  request.cwd = cwd.c_str();
+  request.args.assign(argv, argv + argc);
+
+  for (auto** variable = environ; *variable != nullptr; ++variable) {
+    request.env.emplace_back(*variable);
+  }
+
+  if (!gal::send_request(socket, request)) {
+    std::cerr << "gallium-client: unable to send request: " << std::strerror(errno) << '\n';
+
+    return 1;
+  }
+
+  if (auto code = gal::receive_exit_code(socket)) {
+    return *code;
+  }
+
+  std::cerr << "gallium-client: the server closed the connection without finishing\n";
+
+  return 1;
+}
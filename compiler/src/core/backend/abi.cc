@@ -0,0 +1,381 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./abi.h"
+#include "./constant_pool.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/IR/DataLayout.h"
+#include <algorithm>
+#include <array>
+#include <optional>
+
+namespace ast = gal::ast;
+
+namespace {
+  // anything larger than this is passed in memory instead of in registers,
+  // it's the size of two general-purpose registers on every 64-bit target
+  constexpr auto max_register_aggregate = std::uint64_t{16};
+
+  // the number of registers that System V passes integer and floating-point args in
+  constexpr auto sysv_int_registers = 6;
+  constexpr auto sysv_sse_registers = 8;
+
+  // the System V classes that types Gallium can produce may end up in,
+  // Gallium has no `long double` so there's no need for X87 and friends
+  enum class EightbyteClass { none, integer, sse, memory };
+
+  struct Eightbyte {
+    EightbyteClass cls = EightbyteClass::none;
+    llvm::SmallVector<llvm::Type*, 2> leaves; // every scalar that overlaps the eightbyte
+  };
+
+  struct Coercion {
+    llvm::Type* type;
+    int ints;
+    int sses;
+  };
+
+  bool is_aggregate(llvm::Type* type) noexcept {
+    return type->isStructTy() || type->isArrayTy();
+  }
+
+  bool contains_vector(llvm::Type* type) noexcept {
+    if (type->isVectorTy()) {
+      return true;
+    }
+
+    return is_aggregate(type) && std::any_of(type->subtype_begin(), type->subtype_end(), contains_vector);
+  }
+
+  EightbyteClass merge(EightbyteClass lhs, EightbyteClass rhs) noexcept {
+    if (lhs == rhs || rhs == EightbyteClass::none) {
+      return lhs;
+    }
+
+    if (lhs == EightbyteClass::none) {
+      return rhs;
+    }
+
+    if (lhs == EightbyteClass::memory || rhs == EightbyteClass::memory) {
+      return EightbyteClass::memory;
+    }
+
+    return EightbyteClass::integer;
+  }
+
+  // the classification algorithm from section 3.2.3 of the x86-64 System V psABI, only
+  // ever called for aggregates that fit in two eightbytes and don't contain any vectors
+  void classify(const llvm::DataLayout& layout,
+      llvm::Type* type,
+      std::uint64_t offset,
+      std::array<Eightbyte, 2>* eightbytes) noexcept {
+    if (auto* structure = llvm::dyn_cast<llvm::StructType>(type)) {
+      auto* info = layout.getStructLayout(structure);
+
+      for (auto i = 0u; i < structure->getNumElements(); ++i) {
+        classify(layout, structure->getElementType(i), offset + info->getElementOffset(i), eightbytes);
+      }
+
+      return;
+    }
+
+    if (auto* array = llvm::dyn_cast<llvm::ArrayType>(type)) {
+      auto stride = layout.getTypeAllocSize(array->getElementType()).getFixedSize();
+
+      for (auto i = std::uint64_t{0}; i < array->getNumElements(); ++i) {
+        classify(layout, array->getElementType(), offset + i * stride, eightbytes);
+      }
+
+      return;
+    }
+
+    auto size = layout.getTypeStoreSize(type).getFixedSize();
+    auto cls = (type->isFloatingPointTy()) ? EightbyteClass::sse : EightbyteClass::integer;
+
+    // unaligned fields force the entire thing into memory
+    if (offset % layout.getABITypeAlignment(type) != 0) {
+      cls = EightbyteClass::memory;
+    }
+
+    for (auto i = offset / 8; i <= (offset + size - 1) / 8; ++i) {
+      auto& eightbyte = (*eightbytes)[i];
+
+      eightbyte.cls = merge(eightbyte.cls, cls);
+      eightbyte.leaves.push_back(type);
+    }
+  }
+
+  llvm::Type* eightbyte_type(llvm::LLVMContext& context, const Eightbyte& eightbyte, std::uint64_t size) noexcept {
+    if (eightbyte.cls == EightbyteClass::integer) {
+      return llvm::IntegerType::get(context, static_cast<unsigned>(size * 8));
+    }
+
+    // two floats get packed into the low 8 bytes of a single SSE register
+    if (eightbyte.leaves.size() == 2) {
+      return llvm::FixedVectorType::get(llvm::Type::getFloatTy(context), 2);
+    }
+
+    return eightbyte.leaves.front();
+  }
+
+  // figures out the one or two scalars that a small aggregate gets passed as, or
+  // returns an empty optional if System V says that it needs to be passed in memory
+  std::optional<Coercion> sysv_coerce(llvm::LLVMContext& context,
+      const llvm::DataLayout& layout,
+      llvm::Type* type) noexcept {
+    auto size = layout.getTypeAllocSize(type).getFixedSize();
+
+    if (size == 0 || size > max_register_aggregate) {
+      return std::nullopt;
+    }
+
+    auto eightbytes = std::array<Eightbyte, 2>{};
+    auto pieces = llvm::SmallVector<llvm::Type*, 2>{};
+    auto result = Coercion{nullptr, 0, 0};
+
+    classify(layout, type, 0, &eightbytes);
+
+    for (auto i = std::uint64_t{0}; i * 8 < size; ++i) {
+      switch (eightbytes[i].cls) {
+        case EightbyteClass::integer: ++result.ints; break;
+        case EightbyteClass::sse: ++result.sses; break;
+        case EightbyteClass::memory: return std::nullopt;
+        case EightbyteClass::none:
+          // trailing padding doesn't get a register, but a hole at the start can't be expressed
+          if (i == 0) {
+            return std::nullopt;
+          }
+
+          continue;
+      }
+
+      pieces.push_back(eightbyte_type(context, eightbytes[i], std::min(std::uint64_t{8}, size - i * 8)));
+    }
+
+    result.type = (pieces.size() == 1) ? pieces.front() : llvm::StructType::get(context, pieces);
+
+    return result;
+  }
+
+  // accounts for the registers that a scalar uses up, so we know when aggregates stop fitting
+  void sysv_consume(const llvm::DataLayout& layout, llvm::Type* type, int* ints, int* sses) noexcept {
+    if (type->isFloatingPointTy() || type->isVectorTy()) {
+      --*sses;
+    } else if (type->isIntegerTy() || type->isPointerTy()) {
+      *ints -= (layout.getTypeStoreSize(type).getFixedSize() > 8) ? 2 : 1;
+    }
+  }
+
+  // attributes for a pointer that's always valid for reading `type` from
+  llvm::SmallVector<llvm::Attribute, 4> pointer_attributes(llvm::LLVMContext& context,
+      const llvm::DataLayout& layout,
+      llvm::Type* type) noexcept {
+    return {llvm::Attribute::get(context, llvm::Attribute::NonNull),
+        llvm::Attribute::getWithDereferenceableBytes(context, layout.getTypeAllocSize(type).getFixedSize()),
+        llvm::Attribute::getWithAlignment(context, layout.getABITypeAlign(type))};
+  }
+} // namespace
+
+namespace gal::backend {
+  FnABI::FnABI(llvm::FunctionType* type,
+      PassInfo ret,
+      std::vector<PassInfo> args,
+      std::vector<llvm::SmallVector<llvm::Attribute, 4>> params) noexcept
+      : type_{type},
+        ret_{ret},
+        args_{std::move(args)},
+        params_{std::move(params)} {
+    auto index = (ret_.kind == PassKind::sret) ? 1u : 0u;
+
+    for (auto& arg : args_) {
+      indices_.push_back(index);
+
+      if (arg.kind == PassKind::expand) {
+        index += arg.type->getStructNumElements();
+      } else {
+        index += (arg.kind == PassKind::coerced && arg.coerced->isStructTy()) ? 2 : 1;
+      }
+    }
+  }
+
+  void FnABI::apply(llvm::Function* fn) const noexcept {
+    for (auto i = 0u; i < params_.size(); ++i) {
+      for (auto attribute : params_[i]) {
+        fn->addParamAttr(i, attribute);
+      }
+    }
+  }
+
+  void FnABI::apply(llvm::CallBase* call) const noexcept {
+    for (auto i = 0u; i < params_.size(); ++i) {
+      for (auto attribute : params_[i]) {
+        call->addParamAttr(i, attribute);
+      }
+    }
+  }
+
+  bool FnABI::compatible_with(const FnABI& other) const noexcept {
+    return type_ == other.type_ && params_ == other.params_;
+  }
+
+  FnABI lower_signature(ConstantPool* pool,
+      LLVMState* state,
+      absl::Span<const ast::Type* const> args,
+      const ast::Type& ret,
+      CallingConv conv,
+      bool varargs,
+      bool exclusive) noexcept {
+    auto& context = state->context();
+    auto& layout = state->layout();
+    auto& triple = state->triple();
+    auto sysv = conv == CallingConv::c && triple.getArch() == llvm::Triple::x86_64 && !triple.isOSWindows();
+    auto by_pointer = conv == CallingConv::gallium || sysv;
+    auto ints = sysv_int_registers;
+    auto sses = sysv_sse_registers;
+    auto params = std::vector<llvm::Type*>{};
+    auto attributes = std::vector<llvm::SmallVector<llvm::Attribute, 4>>{};
+    auto infos = std::vector<PassInfo>{};
+
+    auto* ret_type = pool->map_type(ret);
+    auto ret_info = PassInfo{PassKind::direct, ret_type};
+    auto* ir_ret_type = ret_type;
+
+    if (ret.is(ast::TypeType::builtin_void)) {
+      ret_info.kind = PassKind::ignore;
+    } else if (by_pointer && is_aggregate(ret_type) && pool->size_of(ret_type) > max_register_aggregate) {
+      auto list = pointer_attributes(context, layout, ret_type);
+      list.push_back(llvm::Attribute::getWithStructRetType(context, ret_type));
+      list.push_back(llvm::Attribute::get(context, llvm::Attribute::NoAlias));
+
+      ret_info.kind = PassKind::sret;
+      ir_ret_type = llvm::Type::getVoidTy(context);
+      params.push_back(pool->pointer_to(ret_type));
+      attributes.push_back(std::move(list));
+      --ints;
+    } else if (sysv && is_aggregate(ret_type) && !contains_vector(ret_type)) {
+      // the return registers are separate from the argument ones, don't need to count anything
+      if (auto coercion = sysv_coerce(context, layout, ret_type)) {
+        ret_info = PassInfo{PassKind::coerced, ret_type, coercion->type};
+        ir_ret_type = coercion->type;
+      }
+    }
+
+    for (auto* arg : args) {
+      auto* type = pool->map_type(*arg);
+      auto info = PassInfo{PassKind::direct, type};
+      auto coercion = (sysv && is_aggregate(type) && !contains_vector(type))
+                          ? sysv_coerce(context, layout, type)
+                          : std::nullopt;
+
+      if (conv == CallingConv::gallium && arg->is(ast::TypeType::slice)) {
+        auto* slice = llvm::cast<llvm::StructType>(type);
+
+        // a `[mut T]` is the only way to get at the memory it views while the call is running, in the same
+        // way that `&mut T` is. LLVM turns this into scoped `noalias` metadata for us when the call is inlined
+        info.kind = PassKind::expand;
+        params.insert(params.end(), slice->element_begin(), slice->element_end());
+        attributes.resize(params.size());
+
+        if (exclusive && gal::as<ast::SliceType>(*arg).mut()) {
+          attributes[attributes.size() - 2].push_back(llvm::Attribute::get(context, llvm::Attribute::NoAlias));
+        }
+      } else if (coercion && coercion->ints <= ints && coercion->sses <= sses) {
+        info.coerced = coercion->type;
+        info.kind = PassKind::coerced;
+        ints -= coercion->ints;
+        sses -= coercion->sses;
+
+        if (auto* pair = llvm::dyn_cast<llvm::StructType>(coercion->type)) {
+          params.insert(params.end(), pair->element_begin(), pair->element_end());
+        } else {
+          params.push_back(coercion->type);
+        }
+
+        attributes.resize(params.size());
+      } else if ((sysv && is_aggregate(type) && !contains_vector(type))
+                 || (by_pointer && is_aggregate(type) && pool->size_of(type) > max_register_aggregate)) {
+        auto list = llvm::SmallVector<llvm::Attribute, 4>{};
+
+        // C copies into the argument area, Gallium args are immutable so the caller's copy
+        // is only ever read, and nothing else can write to it until the callee returns
+        if (sysv) {
+          list.push_back(llvm::Attribute::getWithByValType(context, type));
+          list.push_back(llvm::Attribute::getWithAlignment(context, layout.getABITypeAlign(type)));
+        } else {
+          list = pointer_attributes(context, layout, type);
+          list.push_back(llvm::Attribute::get(context, llvm::Attribute::NoAlias));
+          list.push_back(llvm::Attribute::get(context, llvm::Attribute::NoCapture));
+          list.push_back(llvm::Attribute::get(context, llvm::Attribute::ReadOnly));
+        }
+
+        info.kind = PassKind::indirect;
+        info.copied = sysv;
+        params.push_back(pool->pointer_to(type));
+        attributes.push_back(std::move(list));
+      } else {
+        auto list = llvm::SmallVector<llvm::Attribute, 4>{};
+
+        // references can only be (legally) made from valid objects,
+        // these are valid. it's UB to have a null/invalid reference
+        if (arg->is(ast::TypeType::reference)) {
+          auto& reference = gal::as<ast::ReferenceType>(*arg);
+          auto* referenced = pool->map_type(reference.referenced());
+
+          list.push_back(llvm::Attribute::get(context, llvm::Attribute::NonNull));
+          list.push_back(llvm::Attribute::getWithDereferenceableBytes(context, pool->size_of(referenced)));
+
+          // nothing else can touch what a `&mut T` refers to until the call returns
+          if (exclusive && reference.mut()) {
+            list.push_back(llvm::Attribute::get(context, llvm::Attribute::NoAlias));
+          }
+        }
+
+        if (sysv) {
+          sysv_consume(layout, type, &ints, &sses);
+        }
+
+        params.push_back(type);
+        attributes.push_back(std::move(list));
+      }
+
+      infos.push_back(info);
+    }
+
+    return FnABI{llvm::FunctionType::get(ir_ret_type, params, varargs),
+        ret_info,
+        std::move(infos),
+        std::move(attributes)};
+  }
+
+  FnABI lower_signature(ConstantPool* pool,
+      LLVMState* state,
+      const ast::FnPrototype& proto,
+      CallingConv conv) noexcept {
+    auto args = std::vector<const ast::Type*>{};
+    auto attributes = proto.attributes();
+    auto has_attribute = [attributes](ast::AttributeType type) {
+      return std::any_of(attributes.begin(), attributes.end(), [type](const ast::Attribute& attribute) {
+        return attribute.type == type;
+      });
+    };
+
+    for (auto& arg : proto.args()) {
+      args.push_back(&arg.type());
+    }
+
+    return lower_signature(pool,
+        state,
+        args,
+        proto.return_type(),
+        conv,
+        has_attribute(ast::AttributeType::builtin_varargs),
+        !has_attribute(ast::AttributeType::builtin_may_alias));
+  }
+} // namespace gal::backend
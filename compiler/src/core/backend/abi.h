@@ -0,0 +1,155 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../ast/program.h"
+#include "./llvm_state.h"
+#include "absl/types/span.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstrTypes.h"
+#include <cstddef>
+#include <vector>
+
+namespace gal::backend {
+  class ConstantPool;
+
+  /// The calling convention that a function is lowered with
+  enum class CallingConv {
+    gallium, ///< Gallium's own convention, only ever seen by other Gallium code
+    c,       ///< The platform's C convention, for `external` functions and `extern fn`s
+  };
+
+  /// How a single argument or return value actually gets passed at the IR level
+  enum class PassKind {
+    direct,   ///< As the first-class IR value of its type
+    coerced,  ///< As one or two integer/float "eightbytes" that alias the value's memory
+    expand,   ///< As each field of a first-class struct, in its own parameter
+    indirect, ///< As a pointer to memory the caller owns. `byval` for the C convention
+    sret,     ///< (returns only) Through a hidden first parameter pointing at caller-owned memory
+    ignore,   ///< (returns only) Nothing at all, the function returns `void`
+  };
+
+  /// The lowered form of a single argument or return value
+  struct PassInfo {
+    PassKind kind;
+    llvm::Type* type;              // the type of the value, as the rest of the code generator sees it
+    llvm::Type* coerced = nullptr; // for `coerced`: either one scalar or a literal struct of two
+    bool copied = false;           // for `indirect`: whether the callee gets its own copy (`byval`)
+  };
+
+  /// The IR-level signature of a function, and the mapping from each
+  /// argument in the source signature to the IR parameter(s) it's passed in
+  class FnABI {
+  public:
+    /// Creates an ABI description, should only be called by `lower_signature`
+    ///
+    /// \param type The IR function type
+    /// \param ret How the return value is passed
+    /// \param args How each argument is passed
+    /// \param params The attributes of every IR parameter
+    explicit FnABI(llvm::FunctionType* type,
+        PassInfo ret,
+        std::vector<PassInfo> args,
+        std::vector<llvm::SmallVector<llvm::Attribute, 4>> params) noexcept;
+
+    /// Gets the IR type of the function
+    ///
+    /// \return The function type
+    [[nodiscard]] llvm::FunctionType* type() const noexcept {
+      return type_;
+    }
+
+    /// Gets how the return value is passed
+    ///
+    /// \return The return value's lowering
+    [[nodiscard]] const PassInfo& ret() const noexcept {
+      return ret_;
+    }
+
+    /// Gets how each (non-variadic) argument is passed
+    ///
+    /// \return The lowering of each argument
+    [[nodiscard]] absl::Span<const PassInfo> args() const noexcept {
+      return args_;
+    }
+
+    /// Gets the index of the first IR parameter that argument `i` is passed in
+    ///
+    /// \param i The index of the argument in the source signature
+    /// \return The index of its first IR parameter
+    [[nodiscard]] unsigned param_index(std::size_t i) const noexcept {
+      return indices_[i];
+    }
+
+    /// Adds the parameter attributes the lowering relies on to a function
+    ///
+    /// \param fn The function to add them to
+    void apply(llvm::Function* fn) const noexcept;
+
+    /// Adds the parameter attributes the lowering relies on to a call
+    ///
+    /// \param call The call to add them to
+    void apply(llvm::CallBase* call) const noexcept;
+
+    /// Checks if a function lowered with `other` can be called through a pointer to `*this`
+    ///
+    /// \param other The other lowering
+    /// \return Whether or not the two are interchangeable
+    [[nodiscard]] bool compatible_with(const FnABI& other) const noexcept;
+
+  private:
+    llvm::FunctionType* type_;
+    PassInfo ret_;
+    std::vector<PassInfo> args_;
+    std::vector<unsigned> indices_;
+    std::vector<llvm::SmallVector<llvm::Attribute, 4>> params_;
+  };
+
+  /// Lowers a signature from the source language into one at the IR level.
+  ///
+  /// Under the Gallium convention, aggregates larger than two registers are passed as
+  /// `noalias readonly` pointers and returned through `sret`, and slices are split into their
+  /// data pointer and size so that the pointer can carry attributes. Under the C convention
+  /// the platform's rules are followed, which are only modeled for x86-64 System V,
+  /// on other targets everything is passed directly like it always has been.
+  ///
+  /// \param pool The constant pool to map types with
+  /// \param state The LLVM state to get the data layout and target from
+  /// \param args The type of every argument
+  /// \param ret The return type
+  /// \param conv The calling convention to use
+  /// \param varargs Whether or not the function is variadic
+  /// \param exclusive Whether `&mut T` and `[mut T]` args can be assumed to not alias anything else
+  /// \return The lowered signature
+  [[nodiscard]] FnABI lower_signature(ConstantPool* pool,
+      LLVMState* state,
+      absl::Span<const ast::Type* const> args,
+      const ast::Type& ret,
+      CallingConv conv,
+      bool varargs,
+      bool exclusive) noexcept;
+
+  /// Lowers the signature of a function prototype. Mutable references and slices are
+  /// exclusive unless the function is marked `__mayalias`
+  ///
+  /// \param pool The constant pool to map types with
+  /// \param state The LLVM state to get the data layout and target from
+  /// \param proto The prototype to lower
+  /// \param conv The calling convention to use
+  /// \return The lowered signature
+  [[nodiscard]] FnABI lower_signature(ConstantPool* pool,
+      LLVMState* state,
+      const ast::FnPrototype& proto,
+      CallingConv conv) noexcept;
+} // namespace gal::backend
@@ -33,6 +33,7 @@ namespace gal {
       fn->setDoesNotThrow();
       fn->setDoesNotRecurse();
       fn->setDoesNotReturn();
+      fn->addFnAttr(llvm::Attribute::Cold); // with `--panic=abort` this is where every failed check goes
     }
 
     void generate_panic_assert(backend::LLVMState* state) noexcept {
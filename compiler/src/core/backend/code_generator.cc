@@ -10,6 +10,8 @@
 
 #include "./code_generator.h"
 #include "../../utility/flags.h"
+#include "../../utility/timing.h"
+#include "../mangler.h"
 #include "../name_resolver.h"
 #include "../type_checker.h"
 #include "absl/strings/match.h"
@@ -25,10 +27,13 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
 #include <algorithm>
+#include <array>
+#include <utility>
 
 namespace ast = gal::ast;
 
@@ -39,7 +44,7 @@ namespace {
   };
 
   bool should_generate_panics() noexcept {
-    return gal::flags().opt() == gal::OptLevel::none && !gal::flags().no_checking();
+    return !gal::flags().no_checking();
   }
 
   IntegralInfo integral_info(gal::backend::ConstantPool* pool, const ast::Type& type) noexcept {
@@ -62,6 +67,62 @@ namespace {
     return IntegralInfo{};
   }
 
+  gal::backend::CallingConv calling_conv(const ast::Declaration& decl) noexcept {
+    // `extern fn`s are meant to be called from C, and everything in an `external` block is C
+    if (decl.is(ast::DeclType::fn_decl) && !gal::as<ast::FnDeclaration>(decl).external()) {
+      return gal::backend::CallingConv::gallium;
+    }
+
+    return gal::backend::CallingConv::c;
+  }
+
+  // temporaries are only ever visible to whatever they're immediately used by
+  bool is_temporary(const ast::Expression& expr) noexcept {
+    return expr.is_one_of(ast::ExprType::call,
+        ast::ExprType::static_call,
+        ast::ExprType::struct_expr,
+        ast::ExprType::array);
+  }
+
+  // the type of whatever is actually in memory at an lvalue
+  const ast::Type& stored_type(const ast::Expression& lvalue) noexcept {
+    auto& type = lvalue.result();
+
+    return type.is(ast::TypeType::indirection) ? gal::as<ast::IndirectionType>(type).produced() : type;
+  }
+
+  bool is_load_from(llvm::Value* value, llvm::Value* ptr) noexcept {
+    auto* load = llvm::dyn_cast<llvm::LoadInst>(value);
+
+    return load != nullptr && load->getPointerOperand() == ptr;
+  }
+
+  // finds the binding that a function body ends by evaluating, so it can be
+  // constructed directly in the `sret` slot instead of being copied into it at the end
+  const ast::BindingStatement* nrvo_candidate(const ast::BlockExpression& body) noexcept {
+    auto statements = body.statements();
+
+    if (statements.empty() || !statements.back()->is(ast::StmtType::expr)) {
+      return nullptr;
+    }
+
+    auto& last = gal::as<ast::ExpressionStatement>(*statements.back()).expr();
+
+    if (!last.is(ast::ExprType::identifier_local)) {
+      return nullptr;
+    }
+
+    auto name = gal::as<ast::LocalIdentifierExpression>(last).name();
+
+    for (auto& stmt : gal::reverse(statements)) {
+      if (stmt->is(ast::StmtType::binding) && gal::as<ast::BindingStatement>(*stmt).name() == name) {
+        return &gal::as<ast::BindingStatement>(*stmt);
+      }
+    }
+
+    return nullptr;
+  }
+
 #if !defined(NDEBUG) && defined(__GNUC__)
   // can't actually just print IR from gdb, need this to exist to call from GDB
   __attribute__((unused)) void print_ir(gal::backend::LLVMState* state) {
@@ -79,14 +140,22 @@ namespace gal::backend {
         pool_{&state_},
         variables_{state_.builder(), state_.layout()} {}
 
-  std::unique_ptr<llvm::Module> CodeGenerator::codegen() noexcept {
+  std::unique_ptr<llvm::Module> CodeGenerator::codegen(
+      const absl::flat_hash_set<const ast::FnDeclaration*>& skip) noexcept {
+    // imported modules are defined somewhere else, all we need is their symbols
+    for (auto& module : program_.imports()) {
+      for (auto& decl : module->decls()) {
+        declare_import(*decl);
+      }
+    }
+
     // everything besides functions can be defined right now,
     // but functions are just declared, so we can call them later
     for (auto& decl : program_.decls()) {
       if (decl->is(ast::DeclType::fn_decl)) {
         auto& fn = gal::as<ast::FnDeclaration>(*decl);
 
-        (void)codegen_proto(fn.proto(), fn.mangled_name());
+        (void)codegen_proto(fn.proto(), fn.mangled_name(), calling_conv(fn));
       } else {
         decl->accept(this);
       }
@@ -102,6 +171,14 @@ namespace gal::backend {
         // micro-optimize for no reason!
         auto& fn = gal::as<ast::FnDeclaration>(*decl);
 
+        if (skip.contains(&fn)) {
+          continue;
+        }
+
+        auto timer = gal::TimeScope("codegen fn", gal::TimeCategory::trace_only, [&fn] {
+          return gal::demangle(fn.mangled_name());
+        });
+
         fn.accept(this);
 
         // why is it *true* on error instead of false on error? the verbiage is completely backwards
@@ -113,48 +190,23 @@ namespace gal::backend {
       }
     }
 
+    pool_.finalize_panic_sites();
+
     return state_.take_module();
   }
 
-  llvm::Function* CodeGenerator::codegen_proto(const ast::FnPrototype& proto, std::string_view name) noexcept {
+  llvm::Function* CodeGenerator::codegen_proto(const ast::FnPrototype& proto,
+      std::string_view name,
+      CallingConv conv) noexcept {
     if (auto* ptr = state_.module()->getFunction(name); ptr != nullptr) {
       return ptr;
     }
 
-    auto arg_types = std::vector<llvm::Type*>{};
-
-    for (auto& arg : proto.args()) {
-      arg_types.push_back(pool_.map_type(arg.type()));
-    }
-
-    auto attributes = proto.attributes();
-    auto is_varargs = std::find_if(attributes.begin(), attributes.end(), [](const ast::Attribute& attribute) {
-      return attribute.type == ast::AttributeType::builtin_varargs;
-    });
-
-    auto* function_type = llvm::FunctionType::get(pool_.map_type(proto.return_type()), arg_types, is_varargs);
-    auto* fn =
-        llvm::Function::Create(function_type, llvm::Function::ExternalLinkage, llvm::Twine(name), state_.module());
+    auto& abi = abi_of(proto, name, conv);
+    auto* fn = llvm::Function::Create(abi.type(), llvm::Function::ExternalLinkage, llvm::Twine(name), state_.module());
 
     fn->setDSOLocal(true);
-
-    auto i = 0u;
-    for (auto& arg : proto.args()) {
-      // references can only be (legally) made from valid objects,
-      // these are valid. it's UB to have a null/invalid reference
-      if (arg.type().is(ast::TypeType::reference)) {
-        auto& ref = gal::as<ast::ReferenceType>(arg.type());
-        auto list = llvm::AttrBuilder();
-
-        list.addDereferenceableAttr(state_.layout().getTypeAllocSize(pool_.map_type(ref.referenced())));
-        list.addAttribute(llvm::Attribute::NonNull);
-
-        // 0th index = *function* attributes, 1 is first param
-        fn->addAttributes(i + 1, list);
-      }
-
-      ++i;
-    }
+    abi.apply(fn);
 
     // no Gallium functions unwind, and if any external functions
     // try to unwind into Gallium code it's UB anyway
@@ -162,7 +214,13 @@ namespace gal::backend {
 
     for (auto& attribute : proto.attributes()) {
       switch (attribute.type) {
-        case ast::AttributeType::builtin_pure: fn->addFnAttr(llvm::Attribute::ReadOnly); break;
+        case ast::AttributeType::builtin_pure:
+          // an `sret` function writes its result through memory, it can't be `readonly`
+          if (abi.ret().kind != PassKind::sret) {
+            fn->addFnAttr(llvm::Attribute::ReadOnly);
+          }
+
+          break;
         case ast::AttributeType::builtin_throws: assert(false); break;
         case ast::AttributeType::builtin_always_inline: fn->addFnAttr(llvm::Attribute::AlwaysInline); break;
         case ast::AttributeType::builtin_inline: fn->addFnAttr(llvm::Attribute::InlineHint); break;
@@ -176,20 +234,117 @@ namespace gal::backend {
         case ast::AttributeType::builtin_noreturn: fn->setDoesNotReturn(); break;
         case ast::AttributeType::builtin_stdlib: fn->setLinkage(llvm::Function::LinkOnceODRLinkage); break;
         case ast::AttributeType::builtin_varargs: break;
+        case ast::AttributeType::builtin_may_alias: break;
       }
     }
 
     return fn;
   }
 
+  const FnABI& CodeGenerator::abi_of(const ast::FnPrototype& proto,
+      std::string_view name,
+      CallingConv conv) noexcept {
+    auto& abi = abis_[name];
+
+    if (abi == nullptr) {
+      abi = std::make_unique<FnABI>(lower_signature(&pool_, &state_, proto, conv));
+    }
+
+    return *abi;
+  }
+
+  llvm::Value* CodeGenerator::function_address(const ast::Declaration& decl) noexcept {
+    auto& proto = (decl.is(ast::DeclType::fn_decl)) ? gal::as<ast::FnDeclaration>(decl).proto()
+                                                     : gal::as<ast::ExternalFnDeclaration>(decl).proto();
+    auto name = (decl.is(ast::DeclType::fn_decl)) ? gal::as<ast::FnDeclaration>(decl).mangled_name()
+                                                  : gal::as<ast::ExternalFnDeclaration>(decl).mangled_name();
+    auto conv = calling_conv(decl);
+    auto* fn = state_.module()->getFunction(name);
+
+    if (conv == CallingConv::gallium) {
+      return fn;
+    }
+
+    // function pointers always use the Gallium convention, C functions that are
+    // lowered differently need a thunk that translates from one to the other
+    auto thunk_name = absl::StrCat(name, ".thunk");
+    auto& abi = abi_of(proto, name, conv);
+    auto& thunk_abi = abi_of(proto, thunk_name, CallingConv::gallium);
+
+    if (thunk_abi.compatible_with(abi)) {
+      return fn;
+    }
+
+    if (auto* thunk = state_.module()->getFunction(thunk_name)) {
+      return thunk;
+    }
+
+    auto guard = llvm::IRBuilderBase::InsertPointGuard(*builder());
+    auto* thunk = llvm::Function::Create(thunk_abi.type(),
+        llvm::Function::InternalLinkage,
+        llvm::Twine(thunk_name),
+        state_.module());
+
+    thunk->setDoesNotThrow();
+    thunk_abi.apply(thunk);
+    builder()->SetInsertPoint(llvm::BasicBlock::Create(state_.context(), "entry", thunk));
+
+    auto& ret = thunk_abi.ret();
+    auto* slot = static_cast<llvm::Value*>(nullptr);
+    auto args = llvm::SmallVector<llvm::Value*, 8>{};
+
+    if (abi.ret().kind == PassKind::sret) {
+      slot = (ret.kind == PassKind::sret) ? thunk->getArg(0) : static_cast<llvm::Value*>(create_entry_alloca(ret.type));
+      args.push_back(slot);
+    }
+
+    for (auto i = std::size_t{0}; i < abi.args().size(); ++i) {
+      lower_arg(abi.args()[i], incoming_arg(thunk, thunk_abi, i), true, &args);
+    }
+
+    auto* call = builder()->CreateCall(fn->getFunctionType(), fn, args);
+    abi.apply(call);
+
+    auto result = lower_result(abi, call, slot);
+
+    switch (ret.kind) {
+      case PassKind::ignore: builder()->CreateRetVoid(); break;
+      case PassKind::sret:
+        if (result.value() != thunk->getArg(0)) {
+          builder()->CreateStore(promote(result, ret.type), thunk->getArg(0));
+        }
+
+        builder()->CreateRetVoid();
+        break;
+      default: builder()->CreateRet(promote(result, ret.type)); break;
+    }
+
+    return thunk;
+  }
+
+  void CodeGenerator::declare_import(const ast::Declaration& decl) noexcept {
+    if (decl.is(ast::DeclType::external_fn_decl)) {
+      auto& fn = gal::as<ast::ExternalFnDeclaration>(decl);
+
+      (void)codegen_proto(fn.proto(), fn.mangled_name(), CallingConv::c);
+    } else if (decl.is(ast::DeclType::constant_decl)) {
+      auto& constant = gal::as<ast::ConstantDeclaration>(decl);
+      auto* global = state_.module()->getOrInsertGlobal(constant.mangled_name(), pool_.map_type(constant.hint()));
+
+      llvm::cast<llvm::GlobalVariable>(global)->setConstant(true);
+    }
+  }
+
   void CodeGenerator::visit(const ast::ImportDeclaration&) {}
 
   void CodeGenerator::visit(const ast::ImportFromDeclaration&) {}
 
   void CodeGenerator::visit(const ast::FnDeclaration& declaration) {
     reset_fn_state();
-    auto is_void = declaration.proto().return_type().is(ast::TypeType::builtin_void);
-    auto* fn = codegen_proto(declaration.proto(), declaration.mangled_name());
+    auto conv = calling_conv(declaration);
+    auto* fn = codegen_proto(declaration.proto(), declaration.mangled_name(), conv);
+    auto& abi = abi_of(declaration.proto(), declaration.mangled_name(), conv);
+    auto& ret = abi.ret();
 
     // need to update current_fn() before we can use `create_block` anywhere else
     auto* entry = llvm::BasicBlock::Create(state_.context(), "entry", fn);
@@ -199,14 +354,30 @@ namespace gal::backend {
     exit_block_ = create_block("exit", true);
     dead_block_ = create_block("__to_delete", true);
 
-    if (!is_void) {
-      auto* type = pool_.map_type(declaration.proto().return_type());
-      return_value_ = builder()->CreateAlloca(type);
-      builder()->SetInsertPoint(exit_block_);
-      builder()->CreateRet(builder()->CreateLoad(type, return_value_));
-    } else {
-      builder()->SetInsertPoint(exit_block_);
-      builder()->CreateRetVoid();
+    switch (ret.kind) {
+      case PassKind::ignore:
+        builder()->SetInsertPoint(exit_block_);
+        builder()->CreateRetVoid();
+        break;
+      case PassKind::sret:
+        // the caller owns the return slot, so there's nothing left to do once we're done writing to it
+        return_value_ = fn->getArg(0);
+        nrvo_binding_ = nrvo_candidate(declaration.body());
+        builder()->SetInsertPoint(exit_block_);
+        builder()->CreateRetVoid();
+        break;
+      case PassKind::coerced: {
+        auto* slot = create_coerced_slot(ret);
+        return_value_ = builder()->CreateBitCast(slot, pool_.pointer_to(ret.type));
+        builder()->SetInsertPoint(exit_block_);
+        builder()->CreateRet(builder()->CreateLoad(ret.coerced, slot));
+        break;
+      }
+      default:
+        return_value_ = builder()->CreateAlloca(ret.type);
+        builder()->SetInsertPoint(exit_block_);
+        builder()->CreateRet(builder()->CreateLoad(ret.type, return_value_));
+        break;
     }
 
     builder()->SetInsertPoint(entry);
@@ -215,19 +386,26 @@ namespace gal::backend {
 
     {
       auto fn_args = declaration.proto().args();
-      auto it = fn_args.begin();
 
-      // copy all args onto stack, so we don't have to special-case when trying to extract from params or whatever
-      for (auto& arg : fn->args()) {
-        auto* alloca = builder()->CreateAlloca(arg.getType());
-        variables_.set((it++)->name(), alloca);
-        builder()->CreateStore(&arg, alloca);
+      // everything gets a stack slot, so we don't have to special-case when trying to extract from params or whatever
+      for (auto i = std::size_t{0}; i < fn_args.size(); ++i) {
+        auto value = incoming_arg(fn, abi, i);
+        auto* storage = value.value();
+
+        if (value.loc() == StorageLoc::reg) {
+          storage = builder()->CreateAlloca(value.type());
+          builder()->CreateStore(value, storage);
+        }
+
+        read_only_.insert(storage);
+        variables_.set(fn_args[i].name(), storage);
       }
     }
 
     auto last_expr = codegen(declaration.body());
 
-    if (!is_void && last_expr != nullptr) { // returns and similar will give `nullptr`, ignore them
+    // returns and similar will give `nullptr`, ignore them. with NRVO the value is already in the slot
+    if (ret.kind != PassKind::ignore && last_expr != nullptr && !is_load_from(last_expr, return_value_)) {
       builder()->CreateStore(last_expr, return_value_);
     }
 
@@ -247,7 +425,7 @@ namespace gal::backend {
   void CodeGenerator::visit(const ast::ExternalFnDeclaration& declaration) {
     // `__builtin` functions may or may not exist at the IR level
     if (!absl::StartsWith(declaration.mangled_name(), "__builtin")) {
-      (void)codegen_proto(declaration.proto(), declaration.mangled_name());
+      (void)codegen_proto(declaration.proto(), declaration.mangled_name(), CallingConv::c);
     }
   }
 
@@ -333,10 +511,8 @@ namespace gal::backend {
   }
 
   void CodeGenerator::visit(const ast::StaticGlobalExpression& expression) {
-    if (expression.decl().is(ast::DeclType::fn_decl)) {
-      auto& decl = gal::as<ast::FnDeclaration>(expression.decl());
-
-      Expr::return_value(state_.module()->getFunction(decl.mangled_name()));
+    if (expression.decl().is_one_of(ast::DeclType::fn_decl, ast::DeclType::external_fn_decl)) {
+      Expr::return_value(function_address(expression.decl()));
     } else {
       auto& decl = gal::as<ast::ConstantDeclaration>(expression.decl());
       auto* type = pool_.map_type(decl.hint());
@@ -369,63 +545,55 @@ namespace gal::backend {
   }
 
   void CodeGenerator::visit(const ast::CallExpression& expression) {
-    auto* return_type = pool_.map_type(expression.result());
-    auto* fn_type = pool_.map_type(expression.callee().result());
-    auto callee = codegen_promoting(expression.callee(), fn_type);
-    auto args = llvm::SmallVector<llvm::Value*, 8>{};
+    // has to be taken before anything else gets generated, any calls in there would see it otherwise
+    auto* dest = std::exchange(sret_dest_, nullptr);
 
-    for (auto& arg : expression.args()) {
-      args.push_back(codegen_promoting(*arg));
-    }
+    // the SIMD builtins are generic, they never get a real callee
+    if (expression.callee().is(ast::ExprType::identifier_local)) {
+      auto& id = gal::as<ast::LocalIdentifierExpression>(expression.callee());
 
-    if (fn_type->isPointerTy()) {
-      fn_type = fn_type->getPointerElementType();
+      if (auto builtin = gal::simd_builtin(id.name())) {
+        return Expr::return_value(generate_simd_builtin(expression, *builtin));
+      }
     }
 
-    auto* call = builder()->CreateCall(llvm::cast<llvm::FunctionType>(fn_type), callee, args);
-
-    if (expression.result().need_address()) {
-      auto* alloca = builder()->CreateAlloca(return_type);
-      builder()->CreateStore(call, alloca);
+    auto& fn_ptr = gal::as<ast::FnPointerType>(expression.callee().result());
+    auto arg_types = llvm::SmallVector<const ast::Type*, 8>{};
 
-      return Expr::return_value(StoredValue{alloca, StorageLoc::mem});
+    for (auto& arg : fn_ptr.args()) {
+      arg_types.push_back(arg.get());
     }
 
-    return Expr::return_value(call);
+    auto abi = lower_signature(&pool_, &state_, arg_types, fn_ptr.return_type(), CallingConv::gallium, false, false);
+    auto callee = codegen_promoting(expression.callee(), pool_.map_type(fn_ptr));
+
+    Expr::return_value(generate_call({abi.type(), callee}, abi, expression.args(), dest, expression.result()));
   }
 
   void CodeGenerator::visit(const ast::StaticCallExpression& expression) {
-    auto args_types = llvm::SmallVector<llvm::Type*, 8>{};
-    auto args = llvm::SmallVector<llvm::Value*, 8>{};
-
-    for (auto& expr : expression.args()) {
-      auto* type = pool_.map_type(expr->result());
-      args_types.push_back(type);
-      args.push_back(codegen_promoting(*expr, type));
-    }
-
+    auto* dest = std::exchange(sret_dest_, nullptr);
+    auto& callee = expression.callee();
     auto name = std::visit(
         [](auto* decl) {
           return decl->mangled_name();
         },
-        expression.callee().decl());
+        callee.decl());
 
     // need to handle builtins, they will all be static-call exprs
     if (absl::StartsWith(name, "__builtin")) {
+      auto args = llvm::SmallVector<llvm::Value*, 8>{};
+
+      for (auto& expr : expression.args()) {
+        args.push_back(codegen_promoting(*expr, pool_.map_type(expr->result())));
+      }
+
       return Expr::return_value(backend::call_builtin(name, &state_, args));
     }
 
+    auto& abi = abi_of(callee.proto(), name, calling_conv(callee.decl_base()));
     auto* fn = state_.module()->getFunction(name);
-    auto* call = builder()->CreateCall(fn, args);
-
-    if (expression.result().need_address()) {
-      auto* alloca = builder()->CreateAlloca(pool_.map_type(expression.result()));
-      builder()->CreateStore(call, alloca);
-
-      return Expr::return_value(StoredValue{alloca, StorageLoc::mem});
-    }
 
-    Expr::return_value(call);
+    Expr::return_value(generate_call(fn, abi, expression.args(), dest, expression.result()));
   }
 
   void CodeGenerator::visit(const ast::MethodCallExpression&) {}
@@ -443,7 +611,8 @@ namespace gal::backend {
       auto array = codegen_promoting(expression.callee());
       array_ptr = builder()->CreateExtractValue(array, {0});
       auto* size = builder()->CreateExtractValue(array, {1});
-      auto* out_of_bounds = builder()->CreateICmpSGE(offset, size);
+      // unsigned so negative indices get caught by the same check, `gallium-eliminate-checks` looks for this form
+      auto* out_of_bounds = builder()->CreateICmpUGE(offset, size);
 
       panic_if(expression.loc(), out_of_bounds, "tried to access out-of-bounds on slice");
     } else {
@@ -499,6 +668,19 @@ namespace gal::backend {
 
     auto value = codegen_promoting(expr.expr());
 
+    // vector arithmetic wraps, lanes are never checked for overflow
+    if (expr.result().is(ast::TypeType::vector)) {
+      auto& vector = gal::as<ast::VectorType>(expr.result());
+
+      if (expr.op() == ast::UnaryOp::negate) {
+        auto is_float = vector.element_type().is(ast::TypeType::builtin_float);
+
+        return Expr::return_value(is_float ? builder()->CreateFNeg(value) : builder()->CreateNeg(value));
+      }
+
+      return Expr::return_value(builder()->CreateNot(value));
+    }
+
     switch (expr.op()) {
       case ast::UnaryOp::bitwise_not:
         // apparently LLVM just made a helper for `xor %thing, -1`, im not complaining
@@ -650,13 +832,227 @@ namespace gal::backend {
     return builder()->CreateXor(lhs, rhs);
   }
 
+  llvm::Value* CodeGenerator::generate_vector_op(const ast::BinaryExpression& expr,
+      llvm::Value* lhs,
+      llvm::Value* rhs) noexcept {
+    auto& vector = gal::as<ast::VectorType>(expr.lhs().result().accessed_type());
+    auto& element = vector.element_type();
+    auto is_float = element.is(ast::TypeType::builtin_float);
+    auto is_signed = element.is(ast::TypeType::builtin_integral) && integral_info(&pool_, element).is_signed;
+
+    // unlike scalars these wrap, there's no cheap way to check every lane for overflow
+    switch (expr.op()) {
+      case ast::BinaryOp::add:
+      case ast::BinaryOp::add_eq: return is_float ? builder()->CreateFAdd(lhs, rhs) : builder()->CreateAdd(lhs, rhs);
+      case ast::BinaryOp::sub:
+      case ast::BinaryOp::sub_eq: return is_float ? builder()->CreateFSub(lhs, rhs) : builder()->CreateSub(lhs, rhs);
+      case ast::BinaryOp::mul:
+      case ast::BinaryOp::mul_eq: return is_float ? builder()->CreateFMul(lhs, rhs) : builder()->CreateMul(lhs, rhs);
+      case ast::BinaryOp::div:
+      case ast::BinaryOp::div_eq: return builder()->CreateFDiv(lhs, rhs);
+      case ast::BinaryOp::logical_and:
+      case ast::BinaryOp::bitwise_and:
+      case ast::BinaryOp::bitwise_and_eq: return builder()->CreateAnd(lhs, rhs);
+      case ast::BinaryOp::logical_or:
+      case ast::BinaryOp::bitwise_or:
+      case ast::BinaryOp::bitwise_or_eq: return builder()->CreateOr(lhs, rhs);
+      case ast::BinaryOp::logical_xor:
+      case ast::BinaryOp::bitwise_xor:
+      case ast::BinaryOp::bitwise_xor_eq: return builder()->CreateXor(lhs, rhs);
+      case ast::BinaryOp::lt: {
+        return is_float    ? builder()->CreateFCmpOLT(lhs, rhs)
+               : is_signed ? builder()->CreateICmpSLT(lhs, rhs)
+                           : builder()->CreateICmpULT(lhs, rhs);
+      }
+      case ast::BinaryOp::gt: {
+        return is_float    ? builder()->CreateFCmpOGT(lhs, rhs)
+               : is_signed ? builder()->CreateICmpSGT(lhs, rhs)
+                           : builder()->CreateICmpUGT(lhs, rhs);
+      }
+      case ast::BinaryOp::lt_eq: {
+        return is_float    ? builder()->CreateFCmpOLE(lhs, rhs)
+               : is_signed ? builder()->CreateICmpSLE(lhs, rhs)
+                           : builder()->CreateICmpULE(lhs, rhs);
+      }
+      case ast::BinaryOp::gt_eq: {
+        return is_float    ? builder()->CreateFCmpOGE(lhs, rhs)
+               : is_signed ? builder()->CreateICmpSGE(lhs, rhs)
+                           : builder()->CreateICmpUGE(lhs, rhs);
+      }
+      case ast::BinaryOp::equals: {
+        return is_float ? builder()->CreateFCmpOEQ(lhs, rhs) : builder()->CreateICmpEQ(lhs, rhs);
+      }
+      case ast::BinaryOp::not_equal: {
+        return is_float ? builder()->CreateFCmpONE(lhs, rhs) : builder()->CreateICmpNE(lhs, rhs);
+      }
+      default: assert(false); return nullptr;
+    }
+  }
+
+  llvm::Value* CodeGenerator::convert_lanes(const ast::Type& to,
+      const ast::Type& from,
+      llvm::Value* value,
+      llvm::Type* type) noexcept {
+    auto from_signed = from.is(ast::TypeType::builtin_integral) && integral_info(&pool_, from).is_signed;
+    auto to_signed = to.is(ast::TypeType::builtin_integral) && integral_info(&pool_, to).is_signed;
+
+    auto from_float = from.is(ast::TypeType::builtin_float);
+    auto to_float = to.is(ast::TypeType::builtin_float);
+
+    // works the same for scalars and vectors, the IR casts all apply lane-by-lane
+    if (from_float && to_float) {
+      return builder()->CreateFPCast(value, type);
+    }
+
+    if (to_float) {
+      return from_signed ? builder()->CreateSIToFP(value, type) : builder()->CreateUIToFP(value, type);
+    }
+
+    if (from_float) {
+      return to_signed ? builder()->CreateFPToSI(value, type) : builder()->CreateFPToUI(value, type);
+    }
+
+    return builder()->CreateIntCast(value, type, from_signed);
+  }
+
+  llvm::Value* CodeGenerator::vector_pointer(const ast::SourceLoc& loc,
+      llvm::Value* slice,
+      llvm::Type* vector,
+      std::uint64_t lanes) noexcept {
+    if (should_generate_panics()) {
+      auto* size = builder()->CreateExtractValue(slice, {1});
+      auto* too_short = builder()->CreateICmpULT(size, pool_.constant_unative(lanes));
+
+      panic_if(loc, too_short, "slice was shorter than the vector");
+    }
+
+    return builder()->CreateBitCast(builder()->CreateExtractValue(slice, {0}), pool_.pointer_to(vector));
+  }
+
+  llvm::Value* CodeGenerator::generate_vector_cast(const ast::CastExpression& expr) noexcept {
+    auto& vector = gal::as<ast::VectorType>(expr.cast_to());
+    auto& castee = expr.castee().result().accessed_type();
+    auto* type = pool_.map_type(vector);
+    auto lanes = static_cast<unsigned>(vector.lanes());
+
+    switch (castee.type()) {
+      case ast::TypeType::array: {
+        auto& array = gal::as<ast::ArrayType>(castee);
+        auto* element = pool_.map_type(array.element_type());
+        auto* loaded = llvm::FixedVectorType::get(element, lanes);
+        auto* ptr = builder()->CreateBitCast(codegen(expr.castee()), pool_.pointer_to(loaded));
+
+        // arrays are only aligned to their element, not to the size of the whole vector
+        auto* load = builder()->CreateAlignedLoad(loaded, ptr, state_.layout().getABITypeAlign(element));
+
+        return convert_lanes(vector.element_type(), array.element_type(), load, type);
+      }
+      case ast::TypeType::slice: {
+        auto slice = codegen_promoting(expr.castee());
+        auto* ptr = vector_pointer(expr.loc(), slice, type, vector.lanes());
+        auto* element = pool_.map_type(vector.element_type());
+
+        return builder()->CreateAlignedLoad(type, ptr, state_.layout().getABITypeAlign(element));
+      }
+      case ast::TypeType::vector: {
+        auto& from = gal::as<ast::VectorType>(castee);
+
+        return convert_lanes(vector.element_type(), from.element_type(), codegen_promoting(expr.castee()), type);
+      }
+      default: {
+        auto* element = pool_.map_type(vector.element_type());
+        auto* scalar = convert_lanes(vector.element_type(), castee, codegen_promoting(expr.castee()), element);
+
+        return builder()->CreateVectorSplat(lanes, scalar);
+      }
+    }
+  }
+
+  llvm::Value* CodeGenerator::generate_simd_builtin(const ast::CallExpression& expr, SIMDBuiltin builtin) noexcept {
+    using SB = gal::SIMDBuiltin;
+
+    auto args = expr.args();
+    auto& vector = gal::as<ast::VectorType>(args[(builtin == SB::store) ? 1 : 0]->result());
+    auto& element = vector.element_type();
+    auto is_float = element.is(ast::TypeType::builtin_float);
+    auto is_signed = element.is(ast::TypeType::builtin_integral) && integral_info(&pool_, element).is_signed;
+
+    switch (builtin) {
+      case SB::extract:
+      case SB::insert: {
+        auto value = codegen_promoting(*args[0]);
+        auto lane = codegen_promoting(*args[1]);
+
+        // constant lanes were already range-checked by the type checker
+        if (should_generate_panics() && !llvm::isa<llvm::ConstantInt>(lane.value())) {
+          auto* out_of_range = builder()->CreateICmpUGE(lane, pool_.constant_unative(vector.lanes()));
+
+          panic_if(expr.loc(), out_of_range, "vector lane index was out of range");
+        }
+
+        return (builtin == SB::extract) ? builder()->CreateExtractElement(value, lane)
+                                        : builder()->CreateInsertElement(value, codegen_promoting(*args[2]), lane);
+      }
+      case SB::shuffle: {
+        auto mask = gal::simd_shuffle_mask(*args[2]);
+        auto lanes = llvm::SmallVector<int, 16>(mask->begin(), mask->end());
+
+        return builder()->CreateShuffleVector(codegen_promoting(*args[0]), codegen_promoting(*args[1]), lanes);
+      }
+      case SB::select: {
+        auto mask = codegen_promoting(*args[0]);
+
+        return builder()->CreateSelect(mask, codegen_promoting(*args[1]), codegen_promoting(*args[2]));
+      }
+      case SB::sum: {
+        auto value = codegen_promoting(*args[0]);
+
+        if (!is_float) {
+          return builder()->CreateAddReduce(value);
+        }
+
+        // a strictly in-order float reduction can't be done as a tree, which is the entire point
+        auto* start = llvm::ConstantFP::getNegativeZero(pool_.map_type(element));
+        auto* reduce = builder()->CreateFAddReduce(start, value);
+        reduce->setHasAllowReassoc(true);
+
+        return reduce;
+      }
+      case SB::min: {
+        auto value = codegen_promoting(*args[0]);
+
+        return is_float ? builder()->CreateFPMinReduce(value) : builder()->CreateIntMinReduce(value, is_signed);
+      }
+      case SB::max: {
+        auto value = codegen_promoting(*args[0]);
+
+        return is_float ? builder()->CreateFPMaxReduce(value) : builder()->CreateIntMaxReduce(value, is_signed);
+      }
+      case SB::any: return builder()->CreateOrReduce(codegen_promoting(*args[0]));
+      case SB::all: return builder()->CreateAndReduce(codegen_promoting(*args[0]));
+      case SB::store: {
+        auto slice = codegen_promoting(*args[0]);
+        auto value = codegen_promoting(*args[1]);
+        auto* ptr = vector_pointer(expr.loc(), slice, value.type(), vector.lanes());
+
+        builder()->CreateAlignedStore(value, ptr, state_.layout().getABITypeAlign(pool_.map_type(element)));
+
+        return nullptr;
+      }
+    }
+
+    assert(false);
+
+    return nullptr;
+  }
+
   void CodeGenerator::visit(const ast::BinaryExpression& expr) {
     if (expr.op() == ast::BinaryOp::assignment || expr.is_compound_assignment()) {
       auto dest = codegen(expr.lhs());
       auto rhs = codegen_promoting(expr.rhs());
 
       if (expr.op() == ast::BinaryOp::assignment) {
-        builder()->CreateStore(rhs, dest);
+        annotate_tbaa(builder()->CreateStore(rhs, dest), stored_type(expr.lhs()), &expr.lhs());
 
         return Expr::return_value(nullptr);
       }
@@ -666,6 +1062,14 @@ namespace gal::backend {
       auto* lhs = builder()->CreateLoad(pool_.map_type(lhs_type), dest);
       auto* final_value = static_cast<llvm::Value*>(nullptr);
 
+      annotate_tbaa(lhs, lhs_type, &expr.lhs());
+
+      if (lhs_type.is(ast::TypeType::vector)) {
+        builder()->CreateStore(generate_vector_op(expr, lhs, rhs), dest);
+
+        return Expr::return_value(nullptr);
+      }
+
       switch (expr.op()) {
         case ast::BinaryOp::add_eq: final_value = generate_add(expr.rhs(), lhs, rhs); break;
         case ast::BinaryOp::sub_eq: final_value = generate_sub(expr.rhs(), lhs, rhs); break;
@@ -680,7 +1084,7 @@ namespace gal::backend {
         default: assert(false);
       }
 
-      builder()->CreateStore(final_value, dest);
+      annotate_tbaa(builder()->CreateStore(final_value, dest), lhs_type, &expr.lhs());
 
       return Expr::return_value(nullptr);
     }
@@ -688,6 +1092,10 @@ namespace gal::backend {
     auto lhs = codegen_promoting(expr.lhs());
     auto rhs = codegen_promoting(expr.rhs());
 
+    if (expr.lhs().result().is(ast::TypeType::vector)) {
+      return Expr::return_value(generate_vector_op(expr, lhs, rhs));
+    }
+
     if (expr.is_ordering()) {
       auto info = integral_info(&pool_, expr.lhs().result());
 
@@ -743,6 +1151,10 @@ namespace gal::backend {
   }
 
   void CodeGenerator::visit(const ast::CastExpression& expr) {
+    if (!expr.unsafe() && expr.cast_to().is(ast::TypeType::vector)) {
+      return Expr::return_value(generate_vector_cast(expr));
+    }
+
     auto value = codegen_promoting(expr.castee());
 
     if (expr.cast_to().is_integral() && expr.castee().result().is_integral()) {
@@ -774,6 +1186,10 @@ namespace gal::backend {
       return Expr::return_value(cast);
     }
 
+    if (expr.cast_to().is(ast::TypeType::builtin_float) && expr.castee().result().is(ast::TypeType::builtin_float)) {
+      return Expr::return_value(builder()->CreateFPCast(value, pool_.map_type(expr.cast_to())));
+    }
+
     // other casts are just bitcasts effectively, the only real concerns are with types
     auto* cast = builder()->CreateBitCast(value, pool_.map_type(expr.cast_to()));
 
@@ -836,15 +1252,16 @@ namespace gal::backend {
       size = builder()->CreateExtractValue(slice, {1});
     }
 
+    // `0 <= begin <= end` has already been checked, so `end` can be compared unsigned
     if (should_generate_panics()) {
       if (expression.range() == ast::Range::inclusive) {
         // if (last_idx >= array.len)
-        auto out_of_bounds_end = builder()->CreateICmpSGE(end, size);
+        auto out_of_bounds_end = builder()->CreateICmpUGE(end, size);
 
         panic_if(expression.loc(), out_of_bounds_end, "tried to create out-of-bounds slice");
       } else {
         // if (last_idx + 1 >= array.len)
-        auto out_of_bounds_end = builder()->CreateICmpSGT(end, size);
+        auto out_of_bounds_end = builder()->CreateICmpUGT(end, size);
 
         panic_if(expression.loc(), out_of_bounds_end, "tried to create out-of-bounds slice");
       }
@@ -1002,47 +1419,100 @@ namespace gal::backend {
 
   void CodeGenerator::visit(const ast::ForExpression& expr) {
     auto* loop_header = create_block();
-    loop_start_ = create_block();
     auto* loop_body = create_block();
-    loop_merge_ = create_block();
+    auto* loop_latch = create_block();
+    auto* outer_start = std::exchange(loop_start_, loop_latch);
+    auto* outer_merge = std::exchange(loop_merge_, create_block());
+    auto* loop_exit = loop_merge_;
 
     auto start = codegen_promoting(expr.init());
     auto last = codegen_promoting(expr.last());
+    auto info = integral_info(&pool_, expr.init().result());
+    auto up = expr.loop_direction() == ast::ForDirection::up_to;
 
+    // the variable itself is a phi, but identifiers need an object in memory to resolve to.
+    // the variable is immutable, so this copy just gets promoted back into the phi
+    auto* value = builder()->CreateAlloca(start.type());
+    auto* preheader = builder()->GetInsertBlock();
+    variables_.enter_scope();
+    variables_.set(expr.loop_variable(), value);
     builder()->CreateBr(loop_header);
     builder()->SetInsertPoint(loop_header);
 
-    // we don't want to allocate every loop iteration
-    // while we could use a phi here, the object needs to be in memory
-    // for the variable resolver to work correctly
-    auto value = builder()->CreateAlloca(start.type());
-    builder()->CreateStore(start, value);
-    variables_.enter_scope();
-    variables_.set(expr.loop_variable(), value);
-    builder()->CreateBr(loop_start_);
-    builder()->SetInsertPoint(loop_start_);
-
-    // actual loop header, just loads current value and compares it
-    auto* load = builder()->CreateLoad(start.type(), value);
-    auto* cond = builder()->CreateICmpNE(load, last);
-    builder()->CreateCondBr(cond, loop_body, loop_merge_);
+    // the loop runs while the variable is strictly below (or above) `last` rather than
+    // until it equals it, that's the shape SCEV can compute a trip count for
+    auto* phi = builder()->CreatePHI(start.type(), 2);
+    auto* cond = up ? (info.is_signed ? builder()->CreateICmpSLT(phi, last) : builder()->CreateICmpULT(phi, last))
+                    : (info.is_signed ? builder()->CreateICmpSGT(phi, last) : builder()->CreateICmpUGT(phi, last));
+    builder()->CreateCondBr(cond, loop_body, loop_exit);
 
     builder()->SetInsertPoint(loop_body);
+    builder()->CreateStore(phi, value);
     expr.body().accept(this);
+    builder()->CreateBr(loop_latch);
+
+    // the step can never overflow, the body only ran because the variable was
+    // strictly below (or above) another value of the same type
+    builder()->SetInsertPoint(loop_latch);
+    auto* one = pool_.constant_of(info.width, 1);
+    auto* next = up ? builder()->CreateAdd(phi, one, "", !info.is_signed, info.is_signed)
+                    : builder()->CreateSub(phi, one, "", !info.is_signed, info.is_signed);
+    auto* backedge = builder()->CreateBr(loop_header);
+
+    if (auto* hints = loop_metadata(expr.attributes())) {
+      backedge->setMetadata(llvm::LLVMContext::MD_loop, hints);
+    }
 
-    auto width = start.type()->getIntegerBitWidth();
-    auto next = (expr.loop_direction() == ast::ForDirection::up_to)
-                    ? generate_add(expr.init(), load, pool_.constant_of(width, 1))
-                    : generate_sub(expr.init(), load, pool_.constant_of(width, 1));
-
-    builder()->CreateStore(next, value);
-    builder()->CreateBr(loop_start_);
+    phi->addIncoming(start, preheader);
+    phi->addIncoming(next, loop_latch);
     variables_.leave_scope();
 
-    merge_with(loop_merge_);
+    loop_start_ = outer_start;
+    loop_merge_ = outer_merge;
+
+    merge_with(loop_exit);
     Expr::return_value(nullptr);
   }
 
+  llvm::MDNode* CodeGenerator::loop_metadata(absl::Span<const ast::LoopAttribute> attributes) noexcept {
+    if (attributes.empty()) {
+      return nullptr;
+    }
+
+    auto& context = state_.context();
+    auto hint = [&](std::string_view name, llvm::Constant* value) {
+      auto operands = std::array<llvm::Metadata*, 2>{llvm::MDString::get(context, name),
+          llvm::ConstantAsMetadata::get(value)};
+
+      return llvm::MDNode::get(context, operands);
+    };
+
+    // the first operand is the loop ID itself, it gets filled in once the node exists
+    auto operands = std::vector<llvm::Metadata*>{nullptr};
+
+    for (auto& attribute : attributes) {
+      auto* count = builder()->getInt32(static_cast<std::uint32_t>(attribute.value));
+
+      switch (attribute.type) {
+        case ast::LoopAttributeType::builtin_vectorize:
+          operands.push_back(hint("llvm.loop.vectorize.width", count));
+          operands.push_back(hint("llvm.loop.vectorize.enable", builder()->getTrue()));
+          break;
+        case ast::LoopAttributeType::builtin_unroll:
+          operands.push_back(hint("llvm.loop.unroll.count", count));
+          break;
+        case ast::LoopAttributeType::builtin_no_vectorize:
+          operands.push_back(hint("llvm.loop.vectorize.enable", builder()->getFalse()));
+          break;
+      }
+    }
+
+    auto* loop_id = llvm::MDNode::getDistinct(context, operands);
+    loop_id->replaceOperandWith(0, loop_id);
+
+    return loop_id;
+  }
+
   void CodeGenerator::visit(const ast::ReturnExpression& expression) {
     if (auto ptr = expression.value()) {
       auto value = codegen_promoting(**ptr);
@@ -1110,26 +1580,55 @@ namespace gal::backend {
   void CodeGenerator::visit(const ast::LoadExpression& expr) {
     // don't care what it is, front-end says we should load, so it's fine
     auto ptr = codegen_promoting(expr.expr());
-    auto* type = pool_.map_type(expr.result());
+    auto* load = builder()->CreateLoad(pool_.map_type(expr.result()), ptr);
+    annotate_tbaa(load, expr.result(), &expr.expr());
 
-    Expr::return_value(builder()->CreateLoad(type, ptr));
+    Expr::return_value(load);
   }
 
   void CodeGenerator::visit(const ast::AddressOfExpression& expr) {
     auto value = codegen(expr.expr());
 
-    Expr::return_value(value); // anything we take & of will have an address
+    // anything we take & of will have an address, and that address is the value of `&expr`. it's a
+    // register value, it'd get loaded through otherwise if it's passed or stored
+    Expr::return_value(value.value());
   }
 
   void CodeGenerator::visit(const ast::BindingStatement& statement) {
-    auto value = (statement.initializer().result().is_one_of(ast::TypeType::pointer, ast::TypeType::reference))
-                     ? codegen(statement.initializer())
-                     : codegen_promoting(statement.initializer());
+    auto& initializer = statement.initializer();
+    auto is_nrvo = &statement == nrvo_binding_;
+
+    // a call that returns through `sret` can construct its result directly in our own return slot
+    if (is_nrvo && initializer.is_one_of(ast::ExprType::call, ast::ExprType::static_call)) {
+      sret_dest_ = return_value_;
+    }
 
-    auto* alloca = builder()->CreateAlloca(value.type());
-    builder()->CreateStore(value, alloca);
+    auto value = codegen(initializer);
+    auto* storage = static_cast<llvm::Value*>(nullptr);
 
-    variables_.set(statement.name(), alloca);
+    if (initializer.result().is_one_of(ast::TypeType::pointer, ast::TypeType::reference)) {
+      storage = builder()->CreateAlloca(value.type());
+      annotate_tbaa(builder()->CreateStore(value, storage), initializer.result());
+    } else if (value.loc() == StorageLoc::mem && is_temporary(initializer)) {
+      // nothing else can see a temporary, so it can just become the variable
+      storage = value;
+    } else {
+      value = promote(value, pool_.map_type(initializer.result()));
+      storage = (is_nrvo) ? return_value_ : builder()->CreateAlloca(value.type());
+      annotate_tbaa(builder()->CreateStore(value, storage), initializer.result());
+    }
+
+    if (is_nrvo && storage != return_value_) {
+      builder()->CreateStore(promote(StoredValue{storage, StorageLoc::mem}, pool_.map_type(initializer.result())),
+          return_value_);
+      storage = return_value_;
+    }
+
+    if (!statement.mut()) {
+      read_only_.insert(storage);
+    }
+
+    variables_.set(statement.name(), storage);
 
     Stmt::return_value(nullptr);
   }
@@ -1145,7 +1644,7 @@ namespace gal::backend {
       auto* merge = create_block();
       auto* assert_fail = assert_block();
 
-      assert_phi_->addIncoming(source_loc(statement.loc(), statement.message().text_unquoted()),
+      assert_phi_->addIncoming(site_index(statement.loc(), statement.message().text_unquoted()),
           builder()->GetInsertBlock());
 
       builder()->CreateCondBr(cond, merge, assert_fail);
@@ -1165,12 +1664,222 @@ namespace gal::backend {
     // if it's not a register value, create a load to it and return that
     if (inst != nullptr && inst.loc() == StorageLoc::mem) {
       // allow lazy generation if we don't already have the type
-      return builder()->CreateLoad((type == nullptr) ? pool_.map_type(expr.result()) : type, inst);
+      auto* load = builder()->CreateLoad((type == nullptr) ? pool_.map_type(expr.result()) : type, inst);
+
+      if (expr.is(ast::ExprType::identifier_local)) {
+        annotate_tbaa(load, expr.result());
+      }
+
+      return load;
     }
 
     return inst;
   }
 
+  backend::StoredValue CodeGenerator::generate_call(llvm::FunctionCallee callee,
+      const FnABI& abi,
+      absl::Span<const std::unique_ptr<ast::Expression>> args,
+      llvm::Value* dest,
+      const ast::Type& result) noexcept {
+    auto* slot = static_cast<llvm::Value*>(nullptr);
+    auto lowered = llvm::SmallVector<llvm::Value*, 8>{};
+
+    if (abi.ret().kind == PassKind::sret) {
+      slot = (dest != nullptr) ? dest : create_entry_alloca(abi.ret().type);
+      lowered.push_back(slot);
+    }
+
+    for (auto i = std::size_t{0}; i < args.size(); ++i) {
+      auto& arg = *args[i];
+
+      // variadic args don't have a lowering, they're passed as-is
+      if (i >= abi.args().size()) {
+        lowered.push_back(codegen_promoting(arg));
+
+        continue;
+      }
+
+      auto& info = abi.args()[i];
+      auto value = (info.kind == PassKind::direct) ? codegen_promoting(arg, info.type) : codegen(arg);
+
+      lower_arg(info, value, is_reusable(arg, value), &lowered);
+    }
+
+    auto* call = builder()->CreateCall(callee, lowered);
+    abi.apply(call);
+
+    auto value = lower_result(abi, call, slot);
+
+    // aggregates are expected to be in memory by everything else
+    if (value.loc() == StorageLoc::reg && result.need_address()) {
+      auto* temporary = create_entry_alloca(value.type());
+      builder()->CreateStore(value, temporary);
+
+      return StoredValue{temporary, StorageLoc::mem};
+    }
+
+    return value;
+  }
+
+  void CodeGenerator::lower_arg(const PassInfo& info,
+      backend::StoredValue value,
+      bool reusable,
+      llvm::SmallVectorImpl<llvm::Value*>* args) noexcept {
+    switch (info.kind) {
+      case PassKind::direct: args->push_back(promote(value, info.type)); break;
+      case PassKind::expand: {
+        auto* aggregate = promote(value, info.type).value();
+
+        for (auto i = 0u; i < info.type->getStructNumElements(); ++i) {
+          args->push_back(builder()->CreateExtractValue(aggregate, {i}));
+        }
+
+        break;
+      }
+      case PassKind::indirect: {
+        // `byval` makes its own copy, otherwise we need one unless nothing else can write to `value`
+        if (value.loc() == StorageLoc::mem && (reusable || info.copied)) {
+          args->push_back(value);
+
+          break;
+        }
+
+        auto* copy = create_entry_alloca(info.type);
+        builder()->CreateStore(promote(value, info.type), copy);
+        args->push_back(copy);
+        break;
+      }
+      case PassKind::coerced: {
+        auto* slot = create_coerced_slot(info);
+        builder()->CreateStore(promote(value, info.type), builder()->CreateBitCast(slot, pool_.pointer_to(info.type)));
+
+        if (auto* pair = llvm::dyn_cast<llvm::StructType>(info.coerced)) {
+          for (auto i = 0u; i < pair->getNumElements(); ++i) {
+            args->push_back(builder()->CreateLoad(pair->getElementType(i), builder()->CreateStructGEP(pair, slot, i)));
+          }
+        } else {
+          args->push_back(builder()->CreateLoad(info.coerced, slot));
+        }
+
+        break;
+      }
+      case PassKind::sret:
+      case PassKind::ignore: assert(false); break;
+    }
+  }
+
+  backend::StoredValue CodeGenerator::incoming_arg(llvm::Function* fn, const FnABI& abi, std::size_t i) noexcept {
+    auto& info = abi.args()[i];
+    auto index = abi.param_index(i);
+
+    switch (info.kind) {
+      case PassKind::indirect:
+        // the caller already gave us memory that nothing else is going to write to
+        return StoredValue{fn->getArg(index), StorageLoc::mem};
+      case PassKind::coerced: {
+        auto* slot = create_coerced_slot(info);
+
+        if (auto* pair = llvm::dyn_cast<llvm::StructType>(info.coerced)) {
+          builder()->CreateStore(fn->getArg(index), builder()->CreateStructGEP(pair, slot, 0));
+          builder()->CreateStore(fn->getArg(index + 1), builder()->CreateStructGEP(pair, slot, 1));
+        } else {
+          builder()->CreateStore(fn->getArg(index), slot);
+        }
+
+        return StoredValue{builder()->CreateBitCast(slot, pool_.pointer_to(info.type)), StorageLoc::mem};
+      }
+      case PassKind::expand: {
+        auto* value = static_cast<llvm::Value*>(llvm::UndefValue::get(info.type));
+
+        for (auto j = 0u; j < info.type->getStructNumElements(); ++j) {
+          value = builder()->CreateInsertValue(value, fn->getArg(index + j), {j});
+        }
+
+        return value;
+      }
+      default: return fn->getArg(index);
+    }
+  }
+
+  backend::StoredValue CodeGenerator::lower_result(const FnABI& abi, llvm::CallInst* call, llvm::Value* slot) noexcept {
+    auto& ret = abi.ret();
+
+    switch (ret.kind) {
+      case PassKind::sret: return StoredValue{slot, StorageLoc::mem};
+      case PassKind::coerced: {
+        auto* coerced = create_coerced_slot(ret);
+        builder()->CreateStore(call, coerced);
+
+        return StoredValue{builder()->CreateBitCast(coerced, pool_.pointer_to(ret.type)), StorageLoc::mem};
+      }
+      default: return call;
+    }
+  }
+
+  bool CodeGenerator::is_reusable(const ast::Expression& expr, backend::StoredValue value) noexcept {
+    return is_temporary(expr) || read_only_.contains(value.value());
+  }
+
+  llvm::AllocaInst* CodeGenerator::create_entry_alloca(llvm::Type* type) noexcept {
+    auto& entry = current_fn()->getEntryBlock();
+    auto builder = llvm::IRBuilder<>(&entry, entry.getFirstInsertionPt());
+
+    // these get reused every time the code runs, they can't end up being allocated again on every loop iteration
+    return builder.CreateAlloca(type);
+  }
+
+  llvm::AllocaInst* CodeGenerator::create_coerced_slot(const PassInfo& info) noexcept {
+    auto& layout = state_.layout();
+    auto* slot = create_entry_alloca(info.coerced);
+
+    // the coerced type is never smaller than the real one, but either one can be more aligned than the other
+    slot->setAlignment(std::max(layout.getABITypeAlign(info.type), layout.getABITypeAlign(info.coerced)));
+
+    return slot;
+  }
+
+  backend::StoredValue CodeGenerator::promote(backend::StoredValue value, llvm::Type* type) noexcept {
+    return (value.loc() == StorageLoc::mem) ? builder()->CreateLoad(type, value) : value.value();
+  }
+
+  void CodeGenerator::annotate_tbaa(llvm::Instruction* access,
+      const ast::Type& type,
+      const ast::Expression* place) noexcept {
+    // nothing at -O0 would ever look at it
+    if (gal::flags().opt() == gal::OptLevel::none) {
+      return;
+    }
+
+    while (place != nullptr && place->is(ast::ExprType::group)) {
+      place = &gal::as<ast::GroupExpression>(*place).expr();
+    }
+
+    auto* accessed = llvm::isa<llvm::StoreInst>(access)
+                         ? llvm::cast<llvm::StoreInst>(access)->getValueOperand()->getType()
+                         : access->getType();
+
+    // the tag has to describe exactly what's being accessed, anything else (e.g. a promoted
+    // value of a different type) is safer left untagged than tagged wrong
+    if (accessed != pool_.map_type(type)) {
+      return;
+    }
+
+    auto* tag = static_cast<llvm::MDNode*>(nullptr);
+
+    if (place != nullptr && place->is(ast::ExprType::field_access)
+        && !gal::as<ast::FieldAccessExpression>(*place).slice_access()) {
+      auto& field = gal::as<ast::FieldAccessExpression>(*place);
+
+      tag = pool_.tbaa_field(gal::as<ast::UserDefinedType>(field.user_type()), field.field_name());
+    } else {
+      tag = pool_.tbaa_access(type);
+    }
+
+    if (tag != nullptr) {
+      access->setMetadata(llvm::LLVMContext::MD_tbaa, tag);
+    }
+  }
+
   llvm::IRBuilder<>* CodeGenerator::builder() noexcept {
     return state_.builder();
   }
@@ -1195,6 +1904,9 @@ namespace gal::backend {
     assert_phi_ = nullptr;
     return_value_ = nullptr;
     loop_break_value_ = nullptr;
+    sret_dest_ = nullptr;
+    nrvo_binding_ = nullptr;
+    read_only_.clear();
   }
 
   void CodeGenerator::emit_terminator() noexcept {
@@ -1202,21 +1914,18 @@ namespace gal::backend {
   }
 
   llvm::BasicBlock* CodeGenerator::panic_block() noexcept {
-    if (panic_block_ == nullptr) {
+    if (panic_block_ == nullptr && gal::flags().panic() == gal::PanicMode::abort) {
       auto* current_bb = builder()->GetInsertBlock();
 
+      // no sites and no messages, every check in the function just traps
       panic_block_ = llvm::BasicBlock::Create(state_.context(), "panic", current_fn());
       builder()->SetInsertPoint(panic_block_);
-      panic_phi_ = builder()->CreatePHI(pool_.source_info_type(), 0);
-
-      auto* file = builder()->CreateExtractValue(panic_phi_, {0});
-      auto* line = builder()->CreateExtractValue(panic_phi_, {1});
-      auto* msg = builder()->CreateExtractValue(panic_phi_, {2});
-
-      builder()->CreateCall(state_.module()->getFunction("__gallium_panic"), {file, line, msg});
+      builder()->CreateCall(state_.module()->getFunction("__gallium_trap"));
       builder()->CreateUnreachable();
 
       builder()->SetInsertPoint(current_bb);
+    } else if (panic_block_ == nullptr) {
+      panic_block_ = site_block("panic", "__gallium_panic", &panic_phi_);
     }
 
     return panic_block_;
@@ -1224,23 +1933,39 @@ namespace gal::backend {
 
   llvm::BasicBlock* CodeGenerator::assert_block() noexcept {
     if (assert_block_ == nullptr) {
-      auto* current_bb = builder()->GetInsertBlock();
+      assert_block_ = site_block("assert_fail", "__gallium_assert_fail", &assert_phi_);
+    }
 
-      assert_block_ = llvm::BasicBlock::Create(state_.context(), "assert_fail", current_fn());
-      builder()->SetInsertPoint(assert_block_);
-      assert_phi_ = builder()->CreatePHI(pool_.source_info_type(), 0);
+    return assert_block_;
+  }
 
-      auto* file = builder()->CreateExtractValue(assert_phi_, {0});
-      auto* line = builder()->CreateExtractValue(assert_phi_, {1});
-      auto* msg = builder()->CreateExtractValue(assert_phi_, {2});
+  llvm::BasicBlock* CodeGenerator::site_block(std::string_view name,
+      std::string_view callee,
+      llvm::PHINode** site) noexcept {
+    auto* current_bb = builder()->GetInsertBlock();
+    auto* block = llvm::BasicBlock::Create(state_.context(), llvm::Twine{name}, current_fn());
+    auto* type = pool_.source_info_type();
 
-      builder()->CreateCall(state_.module()->getFunction("__gallium_assert_fail"), {file, line, msg});
-      builder()->CreateUnreachable();
+    // each edge in only carries an index, the location and message are only loaded once we're failing
+    builder()->SetInsertPoint(block);
+    *site = builder()->CreatePHI(pool_.integer_of_width(32), 0);
 
-      builder()->SetInsertPoint(current_bb);
-    }
+    auto* entry = builder()->CreateInBoundsGEP(pool_.array_of(type, 0),
+        pool_.panic_sites(),
+        std::initializer_list<llvm::Value*>{pool_.constant64(0), *site});
+    auto* info = builder()->CreateLoad(type, entry);
+    auto* file = builder()->CreateExtractValue(info, {0});
+    auto* line = builder()->CreateExtractValue(info, {1});
+    auto* msg = builder()->CreateExtractValue(info, {2});
 
-    return assert_block_;
+    auto* fn = state_.module()->getFunction(llvm::StringRef{callee.data(), callee.size()});
+
+    builder()->CreateCall(fn, {file, line, msg});
+    builder()->CreateUnreachable();
+
+    builder()->SetInsertPoint(current_bb);
+
+    return block;
   }
 
   llvm::Value* CodeGenerator::integer_cast(std::uint32_t to, std::uint32_t from, bool sign, llvm::Value* val) noexcept {
@@ -1280,24 +2005,19 @@ namespace gal::backend {
       auto* merge = create_block();
       auto* panic = panic_block();
 
-      panic_phi_->addIncoming(source_loc(loc, message), builder()->GetInsertBlock());
+      if (panic_phi_ != nullptr) {
+        panic_phi_->addIncoming(site_index(loc, message), builder()->GetInsertBlock());
+      }
 
       builder()->CreateCondBr(cond, panic, merge);
       builder()->SetInsertPoint(merge);
     }
   }
 
-  llvm::Value* CodeGenerator::source_loc(const ast::SourceLoc& loc, std::string_view message) noexcept {
-    auto* file = pool_.c_string_literal(loc.file().string());
-    auto* line = pool_.constant64(static_cast<std::int64_t>(loc.line()));
-    auto* msg = pool_.c_string_literal(message);
-    auto* type = pool_.source_info_type();
-
-    auto* insert_1 = builder()->CreateInsertValue(llvm::UndefValue::get(type), file, {0});
-    auto* insert_2 = builder()->CreateInsertValue(insert_1, line, {1});
-    auto* insert_3 = builder()->CreateInsertValue(insert_2, msg, {2});
+  llvm::Constant* CodeGenerator::site_index(const ast::SourceLoc& loc, std::string_view message) noexcept {
+    auto id = pool_.panic_site(loc.file().string(), static_cast<std::uint64_t>(loc.line()), message);
 
-    return insert_3;
+    return llvm::ConstantInt::get(pool_.integer_of_width(32), id);
   }
 
   llvm::BasicBlock* CodeGenerator::create_block(std::string_view name, bool true_end) noexcept {
@@ -12,11 +12,14 @@
 
 #include "../../ast/program.h"
 #include "../../ast/visitors.h"
+#include "../predefined.h"
+#include "./abi.h"
 #include "./constant_pool.h"
 #include "./llvm_state.h"
 #include "./stored_value.h"
 #include "./variable_resolver.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -37,7 +40,12 @@ namespace gal::backend {
         const ast::Program& program,
         const llvm::TargetMachine& machine) noexcept;
 
-    std::unique_ptr<llvm::Module> codegen() noexcept;
+    /// Generates the module for the entire program
+    ///
+    /// \param skip Functions to only declare rather than define, because
+    ///        their definitions are coming from somewhere else (i.e. the incremental cache)
+    /// \return The generated module
+    std::unique_ptr<llvm::Module> codegen(const absl::flat_hash_set<const ast::FnDeclaration*>& skip = {}) noexcept;
 
   protected:
     void visit(const ast::ImportDeclaration& declaration) final;
@@ -171,7 +179,62 @@ namespace gal::backend {
         llvm::Value* lhs,
         llvm::Value* rhs) noexcept;
 
-    [[nodiscard]] llvm::Function* codegen_proto(const ast::FnPrototype& proto, std::string_view name) noexcept;
+    [[nodiscard]] llvm::Value* generate_vector_op(const ast::BinaryExpression& expr,
+        llvm::Value* lhs,
+        llvm::Value* rhs) noexcept;
+
+    [[nodiscard]] llvm::Value* generate_vector_cast(const ast::CastExpression& expr) noexcept;
+
+    [[nodiscard]] llvm::Value* generate_simd_builtin(const ast::CallExpression& expr, SIMDBuiltin builtin) noexcept;
+
+    [[nodiscard]] llvm::Value* convert_lanes(const ast::Type& to,
+        const ast::Type& from,
+        llvm::Value* value,
+        llvm::Type* type) noexcept;
+
+    [[nodiscard]] llvm::Value* vector_pointer(const ast::SourceLoc& loc,
+        llvm::Value* slice,
+        llvm::Type* vector,
+        std::uint64_t lanes) noexcept;
+
+    [[nodiscard]] llvm::Function* codegen_proto(const ast::FnPrototype& proto,
+        std::string_view name,
+        CallingConv conv) noexcept;
+
+    [[nodiscard]] const FnABI& abi_of(const ast::FnPrototype& proto, std::string_view name, CallingConv conv) noexcept;
+
+    [[nodiscard]] llvm::Value* function_address(const ast::Declaration& decl) noexcept;
+
+    [[nodiscard]] backend::StoredValue generate_call(llvm::FunctionCallee callee,
+        const FnABI& abi,
+        absl::Span<const std::unique_ptr<ast::Expression>> args,
+        llvm::Value* dest,
+        const ast::Type& result) noexcept;
+
+    void lower_arg(const PassInfo& info,
+        backend::StoredValue value,
+        bool reusable,
+        llvm::SmallVectorImpl<llvm::Value*>* args) noexcept;
+
+    [[nodiscard]] backend::StoredValue incoming_arg(llvm::Function* fn, const FnABI& abi, std::size_t i) noexcept;
+
+    [[nodiscard]] backend::StoredValue lower_result(const FnABI& abi, llvm::CallInst* call, llvm::Value* slot) noexcept;
+
+    [[nodiscard]] bool is_reusable(const ast::Expression& expr, backend::StoredValue value) noexcept;
+
+    [[nodiscard]] llvm::AllocaInst* create_entry_alloca(llvm::Type* type) noexcept;
+
+    [[nodiscard]] llvm::AllocaInst* create_coerced_slot(const PassInfo& info) noexcept;
+
+    [[nodiscard]] backend::StoredValue promote(backend::StoredValue value, llvm::Type* type) noexcept;
+
+    // tags a load/store of a `type` with TBAA. `place` is the lvalue being accessed if it's known,
+    // accesses to struct fields get tagged with their full path
+    void annotate_tbaa(llvm::Instruction* access,
+        const ast::Type& type,
+        const ast::Expression* place = nullptr) noexcept;
+
+    void declare_import(const ast::Declaration& decl) noexcept;
 
     [[nodiscard]] backend::StoredValue codegen(const ast::Expression& expr) noexcept;
 
@@ -186,6 +249,10 @@ namespace gal::backend {
 
     [[nodiscard]] llvm::BasicBlock* assert_block() noexcept;
 
+    [[nodiscard]] llvm::BasicBlock* site_block(std::string_view name,
+        std::string_view callee,
+        llvm::PHINode** site) noexcept;
+
     [[nodiscard]] llvm::Value* integer_cast(std::uint32_t to_width,
         std::uint32_t from_width,
         bool is_signed,
@@ -199,7 +266,9 @@ namespace gal::backend {
 
     void panic_if(const ast::SourceLoc& loc, llvm::Value* cond, std::string_view message) noexcept;
 
-    [[nodiscard]] llvm::Value* source_loc(const ast::SourceLoc& loc, std::string_view message) noexcept;
+    [[nodiscard]] llvm::Constant* site_index(const ast::SourceLoc& loc, std::string_view message) noexcept;
+
+    [[nodiscard]] llvm::MDNode* loop_metadata(absl::Span<const ast::LoopAttribute> attributes) noexcept;
 
     [[nodiscard]] llvm::BasicBlock* create_block(std::string_view name = "", bool true_end = false) noexcept;
 
@@ -215,16 +284,26 @@ namespace gal::backend {
     LLVMState state_;
     ConstantPool pool_;
     VariableResolver variables_;
-    llvm::BasicBlock* loop_start_ = nullptr;       // loop header, e.g the "check loop conditions and jump to body"
+    llvm::BasicBlock* loop_start_ = nullptr;       // where `continue` goes, the loop header or a for-loop's step
     llvm::BasicBlock* loop_merge_ = nullptr;       // loop merge point, used for breaks
     llvm::BasicBlock* exit_block_ = nullptr;       // the block that loads the return value and returns
     llvm::BasicBlock* dead_block_ = nullptr;       // the block that instructions generated after a terminator go
     llvm::BasicBlock* panic_block_ = nullptr;      // the block that panics with a message
     llvm::BasicBlock* assert_block_ = nullptr;     // the block that panics with a message
-    llvm::PHINode* panic_phi_ = nullptr;           // the phi node that gets the panic message
-    llvm::PHINode* assert_phi_ = nullptr;          // the phi node that gets the panic message
-    llvm::AllocaInst* return_value_ = nullptr;     // the return value to be stored into
+    llvm::PHINode* panic_phi_ = nullptr;           // the phi node that gets the panic site index
+    llvm::PHINode* assert_phi_ = nullptr;          // the phi node that gets the assertion site index
+    llvm::Value* return_value_ = nullptr;          // the return value to be stored into
     llvm::AllocaInst* loop_break_value_ = nullptr; // the value of a loop to store into
+    llvm::Value* sret_dest_ = nullptr;             // where the next call should put an `sret` result, if anywhere
     std::size_t curr_label_ = 1;
+
+    // the binding that the function ends by returning, it's constructed directly in the `sret` slot
+    const ast::BindingStatement* nrvo_binding_ = nullptr;
+
+    // storage of `let`s and args, these are never written to after being initialized
+    absl::flat_hash_set<const llvm::Value*> read_only_;
+
+    // the lowered signature of every function that's been declared, by mangled name
+    absl::flat_hash_map<std::string, std::unique_ptr<FnABI>> abis_;
   };
 } // namespace gal::backend
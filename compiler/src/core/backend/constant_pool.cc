@@ -9,7 +9,10 @@
 //======---------------------------------------------------------------======//
 
 #include "./constant_pool.h"
+#include "./abi.h"
 #include "absl/strings/str_replace.h"
+#include "llvm/IR/MDBuilder.h"
+#include <array>
 
 namespace ast = gal::ast;
 
@@ -179,12 +182,23 @@ namespace {
     llvm::Type* type_;
     gal::backend::ConstantPool* gen_;
   };
+
+  // aggregates still get TBAA type nodes so they can be used as the base of a field access,
+  // but they're never accessed as a whole with a tag
+  bool is_aggregate(const ast::Type& type) noexcept {
+    return type.is_one_of(ast::TypeType::slice, ast::TypeType::array, ast::TypeType::user_defined);
+  }
 } // namespace
 
 namespace gal::backend {
   using TypeNamePair = std::pair<llvm::Type*, std::string_view>;
 
-  ConstantPool::ConstantPool(LLVMState* state) noexcept : state_{state} {}
+  ConstantPool::ConstantPool(LLVMState* state) noexcept : state_{state} {
+    auto builder = llvm::MDBuilder{state_->context()};
+
+    tbaa_root_ = builder.createTBAARoot("Gallium TBAA");
+    tbaa_char_ = builder.createTBAAScalarTypeNode("omnipotent char", tbaa_root_);
+  }
 
   llvm::Constant* ConstantPool::string_literal(std::string_view data) noexcept {
     if (auto it = string_literals_.find(data); it != string_literals_.end()) {
@@ -347,13 +361,17 @@ namespace gal::backend {
   }
 
   void ConstantPool::visit(const ast::FnPointerType& type) {
-    auto vec = llvm::SmallVector<llvm::Type*, 8>{};
+    auto args = llvm::SmallVector<const ast::Type*, 8>{};
 
     for (auto& arg : type.args()) {
-      vec.push_back(map_type(*arg));
+      args.push_back(arg.get());
     }
 
-    return_value(pointer_to(llvm::FunctionType::get(map_type(type.return_type()), vec, false)));
+    // anything that can be pointed to is either a Gallium function or a thunk that makes an external
+    // function look like one, see `CodeGenerator::function_address`. the pointee might be `__mayalias`
+    auto abi = lower_signature(this, state_, args, type.return_type(), CallingConv::gallium, false, false);
+
+    return_value(pointer_to(abi.type()));
   }
 
   void ConstantPool::visit(const ast::UnqualifiedDynInterfaceType&) {
@@ -388,6 +406,11 @@ namespace gal::backend {
     return_value(pointer_to(map_type(type.produced())));
   }
 
+  void ConstantPool::visit(const ast::VectorType& type) {
+    // masks end up as `<N x i1>`, the backend picks whatever the target's compare instructions produce
+    return_value(llvm::FixedVectorType::get(map_type(type.element_type()), static_cast<unsigned>(type.lanes())));
+  }
+
   llvm::Type* ConstantPool::pointer_to(llvm::Type* type) noexcept {
     return llvm::PointerType::get(type, state_->layout().getProgramAddressSpace());
   }
@@ -423,6 +446,67 @@ namespace gal::backend {
     return llvm::StructType::create(state_->context(), {msg_type, line_type, msg_type}, "__GalliumSourceInfo");
   }
 
+  std::uint32_t ConstantPool::panic_site(std::string_view file, std::uint64_t line, std::string_view message) noexcept {
+    auto key = std::tuple{std::string{file}, line, std::string{message}};
+
+    if (auto it = panic_site_ids_.find(key); it != panic_site_ids_.end()) {
+      return it->second;
+    }
+
+    auto c_string = [this](std::string_view data) {
+      auto* type = array_of(integer_of_width(8), data.size() + 1);
+      auto indices = std::array{constant64(0), constant64(0)};
+
+      return llvm::ConstantExpr::getInBoundsGetElementPtr(type, string_literal(data), indices);
+    };
+
+    auto* type = llvm::cast<llvm::StructType>(source_info_type());
+    auto fields = std::array{c_string(file), constant64(static_cast<std::int64_t>(line)), c_string(message)};
+    auto* entry = llvm::ConstantStruct::get(type, fields);
+    auto id = static_cast<std::uint32_t>(panic_site_entries_.size());
+
+    panic_site_entries_.push_back(entry);
+    panic_site_ids_.emplace(std::move(key), id);
+
+    return id;
+  }
+
+  llvm::Constant* ConstantPool::panic_sites() noexcept {
+    if (panic_sites_ == nullptr) {
+      auto* type = array_of(source_info_type(), 0);
+
+      panic_sites_ = new llvm::GlobalVariable(*state_->module(),
+          type,
+          true,
+          llvm::GlobalValue::InternalLinkage,
+          llvm::Constant::getNullValue(type),
+          "__gallium_panic_sites");
+    }
+
+    return panic_sites_;
+  }
+
+  void ConstantPool::finalize_panic_sites() noexcept {
+    if (panic_sites_ == nullptr) {
+      return;
+    }
+
+    auto* type = llvm::ArrayType::get(source_info_type(), panic_site_entries_.size());
+    auto* table = new llvm::GlobalVariable(*state_->module(),
+        type,
+        true,
+        llvm::GlobalValue::InternalLinkage,
+        llvm::ConstantArray::get(type, panic_site_entries_),
+        "");
+
+    // the table's address is never compared against anything, identical tables can be merged
+    table->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    table->takeName(panic_sites_);
+    panic_sites_->replaceAllUsesWith(llvm::ConstantExpr::getBitCast(table, panic_sites_->getType()));
+    panic_sites_->eraseFromParent();
+    panic_sites_ = nullptr;
+  }
+
   llvm::Constant* ConstantPool::zero(llvm::Type* type) noexcept {
     return llvm::Constant::getNullValue(type);
   }
@@ -439,6 +523,96 @@ namespace gal::backend {
     return static_cast<std::uint64_t>(state_->layout().getTypeAllocSize(type));
   }
 
+  llvm::MDNode* ConstantPool::tbaa_type(const ast::Type& type) noexcept {
+    switch (type.type()) {
+      // signedness doesn't matter, an `i32` can be read as a `u32` just like in C
+      case ast::TypeType::builtin_integral:
+        return tbaa_scalar(absl::StrCat("i", map_type(type)->getIntegerBitWidth()));
+      case ast::TypeType::builtin_float:
+        return tbaa_scalar(absl::StrCat("f", map_type(type)->getPrimitiveSizeInBits().getFixedSize()));
+      case ast::TypeType::builtin_bool: return tbaa_scalar("bool");
+      // `byte` is how raw memory gets accessed, and `char` is what C strings are made of
+      case ast::TypeType::builtin_byte:
+      case ast::TypeType::builtin_char: return tbaa_char_;
+      case ast::TypeType::pointer:
+      case ast::TypeType::reference:
+      case ast::TypeType::fn_pointer: return tbaa_scalar("any pointer");
+      case ast::TypeType::slice: {
+        auto* layout = state_->layout().getStructLayout(llvm::cast<llvm::StructType>(map_type(type)));
+        auto fields = llvm::SmallVector<std::pair<llvm::MDNode*, std::uint64_t>, 2>{
+            {tbaa_scalar("any pointer"), layout->getElementOffset(0)},
+            {tbaa_scalar(absl::StrCat("i", native_type()->getIntegerBitWidth())), layout->getElementOffset(1)}};
+
+        return llvm::MDBuilder{state_->context()}.createTBAAStructTypeNode("slice", fields);
+      }
+      // an array is described the same way as its element, like C does
+      case ast::TypeType::array: return tbaa_type(gal::as<ast::ArrayType>(type).element_type());
+      case ast::TypeType::user_defined: return tbaa_struct(gal::as<ast::UserDefinedType>(type));
+      default: return nullptr;
+    }
+  }
+
+  llvm::MDNode* ConstantPool::tbaa_access(const ast::Type& type) noexcept {
+    auto* node = is_aggregate(type) ? nullptr : tbaa_type(type);
+
+    return (node != nullptr) ? llvm::MDBuilder{state_->context()}.createTBAAStructTagNode(node, node, 0) : nullptr;
+  }
+
+  llvm::MDNode* ConstantPool::tbaa_field(const ast::UserDefinedType& type, std::string_view name) noexcept {
+    auto& field = field_type(type, name);
+    auto* node = is_aggregate(field) ? nullptr : tbaa_type(field);
+
+    if (node == nullptr) {
+      return nullptr;
+    }
+
+    auto* layout = state_->layout().getStructLayout(llvm::cast<llvm::StructType>(map_type(type)));
+    auto offset = layout->getElementOffset(field_index(type, name));
+
+    return llvm::MDBuilder{state_->context()}.createTBAAStructTagNode(tbaa_struct(type), node, offset);
+  }
+
+  llvm::MDNode* ConstantPool::tbaa_scalar(std::string_view name) noexcept {
+    // metadata is uniqued, asking for the same name twice gives back the same node. everything is
+    // a child of `omnipotent char` so that `byte` accesses can alias with anything, like Clang does
+    return llvm::MDBuilder{state_->context()}.createTBAAScalarTypeNode(name, tbaa_char_);
+  }
+
+  llvm::MDNode* ConstantPool::tbaa_struct(const ast::UserDefinedType& type) noexcept {
+    auto entity = type.id().as_string();
+
+    if (auto it = tbaa_structs_.find(entity); it != tbaa_structs_.end()) {
+      return it->second;
+    }
+
+    auto* layout = state_->layout().getStructLayout(llvm::cast<llvm::StructType>(map_type(type)));
+    auto names = field_names_[entity]; // copied, describing the fields can add more entries to `field_names_`
+    auto fields = llvm::SmallVector<std::pair<llvm::MDNode*, std::uint64_t>, 8>{};
+
+    for (auto i = 0u; i < names.size(); ++i) {
+      auto* node = tbaa_type(field_type(type, names[i]));
+
+      // anything we don't describe has to be able to alias with everything
+      fields.emplace_back((node != nullptr) ? node : tbaa_char_, layout->getElementOffset(i));
+    }
+
+    auto* node = llvm::MDBuilder{state_->context()}.createTBAAStructTypeNode(entity, fields);
+    tbaa_structs_.emplace(std::string{entity}, node);
+
+    return node;
+  }
+
+  const ast::Type& ConstantPool::field_type(const ast::UserDefinedType& type, std::string_view name) noexcept {
+    auto fields = gal::as<ast::StructDeclaration>(type.decl()).fields();
+    auto it = std::find_if(fields.begin(), fields.end(), [name](const ast::Field& field) {
+      return field.name() == name;
+    });
+
+    assert(it != fields.end());
+
+    return it->type();
+  }
+
   llvm::Constant* ConstantPool::constant_inative(std::int64_t value) noexcept {
     return llvm::ConstantInt::getSigned(native_type(), value);
   }
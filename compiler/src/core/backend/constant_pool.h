@@ -16,8 +16,11 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <vector>
 
 namespace gal::backend {
   class ConstantPool final : public ast::ConstTypeVisitor<llvm::Type*> {
@@ -59,8 +62,32 @@ namespace gal::backend {
 
     [[nodiscard]] llvm::Type* source_info_type() noexcept;
 
+    // every check in the module shares one table of `__GalliumSourceInfo`s, checks only
+    // carry their index into it. sites with the same location and message share an index
+    [[nodiscard]] std::uint32_t panic_site(std::string_view file,
+        std::uint64_t line,
+        std::string_view message) noexcept;
+
+    // the table `panic_site` indices refer to, as a `[0 x %__GalliumSourceInfo]`. it's only
+    // a placeholder until `finalize_panic_sites` is called
+    [[nodiscard]] llvm::Constant* panic_sites() noexcept;
+
+    // replaces the placeholder with the real table, after every site in the module is known
+    void finalize_panic_sites() noexcept;
+
     [[nodiscard]] std::uint64_t size_of(llvm::Type* type) noexcept;
 
+    // the TBAA type node that describes `type`. builtins and pointers get scalar nodes, structs and slices
+    // get struct nodes whose fields are in LLVM order. nullptr for anything that isn't described (vectors),
+    // memory of those types is only ever accessed without a tag
+    [[nodiscard]] llvm::MDNode* tbaa_type(const ast::Type& type) noexcept;
+
+    // the access tag for a load/store of a `type` through an arbitrary pointer, nullptr if `type` isn't scalar
+    [[nodiscard]] llvm::MDNode* tbaa_access(const ast::Type& type) noexcept;
+
+    // the access tag for a load/store of `type.name` through a pointer to a `type`, nullptr if the field isn't scalar
+    [[nodiscard]] llvm::MDNode* tbaa_field(const ast::UserDefinedType& type, std::string_view name) noexcept;
+
   protected:
     void visit(const ast::ReferenceType& type) final;
 
@@ -100,6 +127,8 @@ namespace gal::backend {
 
     void visit(const ast::IndirectionType& type) final;
 
+    void visit(const ast::VectorType& type) final;
+
   private:
     llvm::SmallVector<std::pair<llvm::Type*, std::string_view>, 8> from_structure(
         const ast::StructDeclaration& decl) noexcept;
@@ -110,14 +139,29 @@ namespace gal::backend {
     llvm::Type* struct_from(std::string_view name,
         llvm::ArrayRef<std::pair<llvm::Type*, std::string_view>> array) noexcept;
 
+    llvm::MDNode* tbaa_scalar(std::string_view name) noexcept;
+
+    llvm::MDNode* tbaa_struct(const ast::UserDefinedType& type) noexcept;
+
+    const ast::Type& field_type(const ast::UserDefinedType& type, std::string_view name) noexcept;
+
     LLVMState* state_;
     std::size_t curr_str_ = 0;
     absl::flat_hash_map<std::string, llvm::Constant*> string_literals_;
+    absl::flat_hash_map<std::tuple<std::string, std::uint64_t, std::string>, std::uint32_t> panic_site_ids_;
+    std::vector<llvm::Constant*> panic_site_entries_;
+    llvm::GlobalVariable* panic_sites_ = nullptr;
 
     // user_types_ maps `::foo::bar::Baz` -> `%foo.bar.Baz = type { ... }`
     // field_names_ maps `::foo::bar::Baz` -> List<field name>, where the index of {field} is
     // the index of that field in `%foo.bar.Baz`
     absl::flat_hash_map<std::string, llvm::Type*> user_types_;
     absl::flat_hash_map<std::string, std::vector<std::string_view>> field_names_;
+
+    // every scalar TBAA node is a child of `tbaa_char_`, which is what `byte` and `char` use since they're
+    // allowed to alias anything. struct nodes are cached by the same name as `user_types_`
+    llvm::MDNode* tbaa_root_ = nullptr;
+    llvm::MDNode* tbaa_char_ = nullptr;
+    absl::flat_hash_map<std::string, llvm::MDNode*> tbaa_structs_;
   };
 } // namespace gal::backend
\ No newline at end of file
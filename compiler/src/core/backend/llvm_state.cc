@@ -39,6 +39,10 @@ namespace gal::backend {
     return layout_;
   }
 
+  const llvm::Triple& LLVMState::triple() const noexcept {
+    return machine_.getTargetTriple();
+  }
+
   std::unique_ptr<llvm::Module> LLVMState::take_module() noexcept {
     return std::exchange(module_, {});
   }
@@ -36,6 +36,8 @@ namespace gal::backend {
 
     [[nodiscard]] const llvm::DataLayout& layout() const noexcept;
 
+    [[nodiscard]] const llvm::Triple& triple() const noexcept;
+
     [[nodiscard]] std::unique_ptr<llvm::Module> take_module() noexcept;
 
   private:
@@ -10,16 +10,89 @@
 
 #include "./optimizer.h"
 #include "../../utility/flags.h"
+#include "../../utility/timing.h"
+#include "./passes.h"
+#include "absl/strings/match.h"
+#include "llvm/ADT/Any.h"
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LazyCallGraph.h"
 #include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/Passes.h"
+#include "llvm/IR/PassInstrumentation.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Transforms/IPO/GlobalDCE.h"
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace {
+  std::string ir_name(const llvm::Any& ir) noexcept {
+    if (llvm::any_isa<const llvm::Module*>(ir)) {
+      return llvm::any_cast<const llvm::Module*>(ir)->getName().str();
+    }
+
+    if (llvm::any_isa<const llvm::Function*>(ir)) {
+      return llvm::any_cast<const llvm::Function*>(ir)->getName().str();
+    }
+
+    if (llvm::any_isa<const llvm::LazyCallGraph::SCC*>(ir)) {
+      return llvm::any_cast<const llvm::LazyCallGraph::SCC*>(ir)->getName();
+    }
+
+    if (llvm::any_isa<const llvm::Loop*>(ir)) {
+      return llvm::any_cast<const llvm::Loop*>(ir)->getName().str();
+    }
+
+    return "";
+  }
+
+  gal::TimeCategory pass_category(std::string_view pass) noexcept {
+    // these just run other passes, putting them in the report would count everything twice
+    for (auto wrapper : {"PassManager", "PassAdaptor", "AnalysisManagerProxy", "InlinerWrapper", "RepeatedPass"}) {
+      if (absl::StrContains(pass, wrapper)) {
+        return gal::TimeCategory::trace_only;
+      }
+    }
+
+    return gal::TimeCategory::pass;
+  }
+
+  // gives every LLVM pass its own span in `--time_trace`, and its own entry in `--time_report`
+  void register_pass_timers(llvm::PassInstrumentationCallbacks* callbacks,
+      std::vector<std::unique_ptr<gal::TimeScope>>* timers) noexcept {
+    callbacks->registerBeforeNonSkippedPassCallback([timers](llvm::StringRef pass, llvm::Any ir) {
+      auto name = std::string_view{pass.data(), pass.size()};
+
+      timers->push_back(std::make_unique<gal::TimeScope>(name, pass_category(name), [&ir] {
+        return ir_name(ir);
+      }));
+    });
+
+    callbacks->registerAfterPassCallback([timers](llvm::StringRef, llvm::Any, const llvm::PreservedAnalyses&) {
+      timers->pop_back();
+    });
+
+    callbacks->registerAfterPassInvalidatedCallback([timers](llvm::StringRef, const llvm::PreservedAnalyses&) {
+      timers->pop_back();
+    });
+  }
+
   std::string_view pass_name(gal::OptLevel level) {
+    // with ThinLTO the heavy lifting (inlining across files, vectorization, unrolling) happens
+    // after the thin link, the pre-link pipeline just gets each module into shape for it
+    if (gal::flags().lto() == gal::LTOKind::thin) {
+      switch (level) {
+        case gal::OptLevel::none: return "thinlto-pre-link<O0>";
+        case gal::OptLevel::some: return "thinlto-pre-link<O1>";
+        case gal::OptLevel::small: return "thinlto-pre-link<Os>";
+        case gal::OptLevel::fast: return "thinlto-pre-link<O3>";
+        default: assert(false); break;
+      }
+    }
+
     switch (level) {
       case gal::OptLevel::none: return "default<O0>";
       case gal::OptLevel::some: return "default<O1>";
@@ -30,6 +103,19 @@ namespace {
 
     return "default<O0>";
   }
+
+  llvm::Optional<llvm::PGOOptions> pgo_options() noexcept {
+    if (gal::flags().profile_generate()) {
+      // with no file given, the profile goes to `default_%m.profraw` (or `$LLVM_PROFILE_FILE`)
+      return llvm::PGOOptions("", "", "", llvm::PGOOptions::IRInstr);
+    }
+
+    if (auto profile = gal::flags().profile_use(); !profile.empty()) {
+      return llvm::PGOOptions(std::string{profile}, "", "", llvm::PGOOptions::IRUse);
+    }
+
+    return llvm::None;
+  }
 } // namespace
 
 namespace gal {
@@ -39,7 +125,16 @@ namespace gal {
     auto fam = llvm::FunctionAnalysisManager{};
     auto cgam = llvm::CGSCCAnalysisManager{};
     auto mam = llvm::ModuleAnalysisManager{};
-    auto builder = llvm::PassBuilder(machine);
+    auto callbacks = llvm::PassInstrumentationCallbacks{};
+    auto timers = std::vector<std::unique_ptr<gal::TimeScope>>{};
+
+    if (gal::flags().time_trace() || gal::flags().time_report()) {
+      register_pass_timers(&callbacks, &timers);
+    }
+
+    auto builder = llvm::PassBuilder(machine, llvm::PipelineTuningOptions{}, pgo_options(), &callbacks);
+
+    gal::backend::register_passes(&builder);
 
     builder.registerModuleAnalyses(mam);
     builder.registerCGSCCAnalyses(cgam);
@@ -47,7 +142,9 @@ namespace gal {
     builder.registerLoopAnalyses(lam);
     builder.crossRegisterProxies(lam, fam, cgam, mam);
 
-    if (level != OptLevel::none) {
+    auto custom = gal::flags().passes();
+
+    if (level != OptLevel::none || !custom.empty()) {
       fam.registerPass([&] {
         return builder.buildDefaultAAPipeline();
       });
@@ -55,20 +152,16 @@ namespace gal {
 
     auto mpm = llvm::ModulePassManager{};
 
-    (void)builder.parsePassPipeline(mpm, pass_name(level));
+    auto pipeline = custom.empty() ? pass_name(level) : custom;
+
+    // `--passes` is checked by the driver before anything is compiled, this can't fail
+    llvm::cantFail(builder.parsePassPipeline(mpm, llvm::StringRef{pipeline.data(), pipeline.size()}));
 
-    if (level == OptLevel::none) {
+    if (level == OptLevel::none && custom.empty()) {
       // remove unused stdlib code
       mpm.addPass(llvm::GlobalDCEPass());
     }
 
-    // TODO: dirty hack: I currently have no idea how to properly order phases
-    // TODO: and with bounds checking, LLVM doesn't vectorize if I only run the passes once
-    // TODO: running it again cleans up everything nicely
-    if (level != OptLevel::none) {
-      mpm.run(*module, mam);
-    }
-
     mpm.run(*module, mam);
   }
 } // namespace gal
\ No newline at end of file
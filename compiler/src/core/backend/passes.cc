@@ -0,0 +1,870 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./passes.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/ConstantRange.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Transforms/Scalar/InductiveRangeCheckElimination.h"
+#include "llvm/Transforms/Scalar/SimplifyCFG.h"
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace {
+  // the same ratio that `__builtin_expect` gives a branch
+  constexpr auto taken_weight = std::uint32_t{2000};
+  constexpr auto never_taken_weight = std::uint32_t{1};
+
+  // a panic path is a block that calls a cold, noreturn function and then ends
+  bool calls_panic(const llvm::BasicBlock& block) noexcept {
+    if (!llvm::isa<llvm::UnreachableInst>(block.getTerminator())) {
+      return false;
+    }
+
+    for (auto& inst : block) {
+      if (auto* call = llvm::dyn_cast<llvm::CallInst>(&inst)) {
+        auto* callee = call->getCalledFunction();
+
+        if (callee != nullptr && callee->doesNotReturn() && callee->hasFnAttribute(llvm::Attribute::Cold)) {
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  // checks that were coalesced go through a block that picks which of them failed first
+  bool panics(const llvm::BasicBlock& block) noexcept {
+    auto* branch = llvm::dyn_cast<llvm::BranchInst>(block.getTerminator());
+
+    if (branch != nullptr && branch->isUnconditional() && branch->getSuccessor(0) != &block) {
+      return calls_panic(*branch->getSuccessor(0));
+    }
+
+    return calls_panic(block);
+  }
+
+  // what's known about `value` compared to `bound`. `ult` and `slt` both imply `ne`
+  enum Fact : unsigned { fact_ne = 1, fact_ult = 2, fact_slt = 4 };
+
+  // slice sizes get pulled out of the slice wherever they're needed, two extracts of
+  // the same field out of the same slice are the same size
+  bool same_value(const llvm::Value* lhs, const llvm::Value* rhs) noexcept {
+    if (lhs == rhs) {
+      return true;
+    }
+
+    auto* first = llvm::dyn_cast<llvm::ExtractValueInst>(lhs);
+    auto* second = llvm::dyn_cast<llvm::ExtractValueInst>(rhs);
+
+    return first != nullptr && second != nullptr && first->getAggregateOperand() == second->getAggregateOperand()
+           && first->getIndices() == second->getIndices();
+  }
+
+  bool invariant(const llvm::Loop& loop, const llvm::Value* value) noexcept {
+    if (auto* extract = llvm::dyn_cast<llvm::ExtractValueInst>(value)) {
+      return loop.isLoopInvariant(extract) || loop.isLoopInvariant(extract->getAggregateOperand());
+    }
+
+    return loop.isLoopInvariant(value);
+  }
+
+  // what the condition of `branch` says about `value` compared to `bound` once successor `index` is taken
+  unsigned facts_from(const llvm::BranchInst& branch,
+      unsigned index,
+      const llvm::Value* value,
+      const llvm::Value* bound) noexcept {
+    auto* compare = llvm::dyn_cast<llvm::ICmpInst>(branch.getCondition());
+
+    if (compare == nullptr) {
+      return 0;
+    }
+
+    auto predicate = compare->getPredicate();
+
+    if (same_value(compare->getOperand(1), value) && same_value(compare->getOperand(0), bound)) {
+      predicate = llvm::ICmpInst::getSwappedPredicate(predicate);
+    } else if (!same_value(compare->getOperand(0), value) || !same_value(compare->getOperand(1), bound)) {
+      return 0;
+    }
+
+    if (index == 1) {
+      predicate = llvm::ICmpInst::getInversePredicate(predicate);
+    }
+
+    switch (predicate) {
+      case llvm::ICmpInst::ICMP_NE: return fact_ne;
+      case llvm::ICmpInst::ICMP_ULT: return fact_ne | fact_ult;
+      case llvm::ICmpInst::ICMP_SLT: return fact_ne | fact_slt;
+      default: return 0;
+    }
+  }
+
+  // everything the branches dominating `block` say about `value` compared to `bound`
+  unsigned facts_at(const llvm::DominatorTree& tree,
+      const llvm::BasicBlock* block,
+      const llvm::Value* value,
+      const llvm::Value* bound) noexcept {
+    auto facts = 0u;
+    auto* node = tree.getNode(block);
+
+    for (auto* dominator = (node != nullptr) ? node->getIDom() : nullptr; dominator != nullptr;
+         dominator = dominator->getIDom()) {
+      auto* branch = llvm::dyn_cast<llvm::BranchInst>(dominator->getBlock()->getTerminator());
+
+      if (branch == nullptr || !branch->isConditional()) {
+        continue;
+      }
+
+      for (auto i = 0u; i < 2; ++i) {
+        if (tree.dominates(llvm::BasicBlockEdge(dominator->getBlock(), branch->getSuccessor(i)), block)) {
+          facts |= facts_from(*branch, i, value, bound);
+        }
+      }
+    }
+
+    return facts;
+  }
+
+  // everything known about `value` compared to `bound` while going from `from` to `to`
+  unsigned facts_on_edge(const llvm::DominatorTree& tree,
+      const llvm::BasicBlock* from,
+      const llvm::BasicBlock* to,
+      const llvm::Value* value,
+      const llvm::Value* bound) noexcept {
+    auto facts = facts_at(tree, from, value, bound);
+    auto* branch = llvm::dyn_cast<llvm::BranchInst>(from->getTerminator());
+
+    if (branch != nullptr && branch->isConditional() && branch->getSuccessor(0) != branch->getSuccessor(1)) {
+      facts |= facts_from(*branch, (branch->getSuccessor(0) == to) ? 0 : 1, value, bound);
+    }
+
+    return facts;
+  }
+
+  // `value` is `phi + 1`, either plain or coming out of an overflow-checked add
+  bool increments(const llvm::Value* value, const llvm::Value* phi) noexcept {
+    namespace pm = llvm::PatternMatch;
+
+    if (pm::match(value, pm::m_c_Add(pm::m_Specific(phi), pm::m_One()))) {
+      return true;
+    }
+
+    auto* extract = llvm::dyn_cast<llvm::ExtractValueInst>(value);
+
+    if (extract == nullptr || extract->getNumIndices() != 1 || extract->getIndices()[0] != 0) {
+      return false;
+    }
+
+    auto* add = llvm::dyn_cast<llvm::IntrinsicInst>(extract->getAggregateOperand());
+
+    if (add == nullptr
+        || (add->getIntrinsicID() != llvm::Intrinsic::sadd_with_overflow
+            && add->getIntrinsicID() != llvm::Intrinsic::uadd_with_overflow)) {
+      return false;
+    }
+
+    return (add->getArgOperand(0) == phi && pm::match(add->getArgOperand(1), pm::m_One()))
+           || (add->getArgOperand(1) == phi && pm::match(add->getArgOperand(0), pm::m_One()));
+  }
+
+  // `phi` starts at or below `bound` and counts up by one, the loop only lets it get as far as `bound`.
+  // if it can be shown that it isn't `bound` itself once it's reached `block`, it's in [start, bound)
+  bool counts_to(const llvm::PHINode& phi,
+      const llvm::Loop& loop,
+      const llvm::Value* bound,
+      const llvm::BasicBlock* block,
+      const llvm::DominatorTree& tree) noexcept {
+    auto* header = phi.getParent();
+    auto* start = static_cast<const llvm::Value*>(nullptr);
+    auto start_facts = 0u;
+    auto never_reaches = true; // every latch knows `phi + 1 != bound`
+    auto never_passes = true;  // every latch knows `phi != bound`
+
+    for (auto i = 0u; i < phi.getNumIncomingValues(); ++i) {
+      auto* value = phi.getIncomingValue(i);
+      auto* from = phi.getIncomingBlock(i);
+
+      if (!loop.contains(from)) {
+        // simplified loops only have a single way in
+        if (start != nullptr) {
+          return false;
+        }
+
+        start = value;
+        start_facts = facts_on_edge(tree, from, header, value, bound);
+
+        continue;
+      }
+
+      if (!increments(value, &phi)) {
+        return false;
+      }
+
+      never_reaches = never_reaches && (facts_on_edge(tree, from, header, value, bound) & fact_ne) != 0;
+      never_passes = never_passes && (facts_on_edge(tree, from, header, &phi, bound) & fact_ne) != 0;
+
+      if (!never_reaches && !never_passes) {
+        return false;
+      }
+    }
+
+    if (start == nullptr) {
+      return false;
+    }
+
+    auto& layout = header->getModule()->getDataLayout();
+    auto* constant_start = llvm::dyn_cast<llvm::ConstantInt>(start);
+    auto* constant_bound = llvm::dyn_cast<llvm::ConstantInt>(bound);
+    auto starts_below = (start_facts & fact_ult) != 0
+                        || ((start_facts & fact_ne) != 0 && constant_start != nullptr && constant_start->isZero())
+                        || ((start_facts & fact_slt) != 0 && llvm::isKnownNonNegative(start, layout))
+                        || (constant_start != nullptr && constant_bound != nullptr
+                            && constant_start->getValue().ult(constant_bound->getValue()));
+
+    // starting below `bound` and never stepping onto it, `phi` is always in [start, bound)
+    if (starts_below && never_reaches) {
+      return true;
+    }
+
+    // `phi + 1 != bound` says nothing once `phi` is `bound` already, it can step right past it. only
+    // latches that need `phi != bound` keep it in [start, bound], and that needs a start no higher than
+    // `bound`: zero, or anything below it
+    if (!never_passes || !(starts_below || (constant_start != nullptr && constant_start->isZero()))) {
+      return false;
+    }
+
+    return (facts_at(tree, block, &phi, bound) & fact_ne) != 0;
+  }
+
+  // whether `index < size` (unsigned) always holds at the start of `block`
+  bool in_bounds(const llvm::Value* index,
+      const llvm::Value* size,
+      const llvm::BasicBlock* block,
+      const llvm::DominatorTree& tree,
+      const llvm::LoopInfo& loops) noexcept {
+    auto* constant_index = llvm::dyn_cast<llvm::ConstantInt>(index);
+    auto* constant_size = llvm::dyn_cast<llvm::ConstantInt>(size);
+
+    if (constant_index != nullptr && constant_size != nullptr) {
+      return constant_index->getValue().ult(constant_size->getValue());
+    }
+
+    if ((facts_at(tree, block, index, size) & fact_ult) != 0) {
+      return true;
+    }
+
+    auto* phi = llvm::dyn_cast<llvm::PHINode>(index);
+    auto* loop = (phi != nullptr) ? loops.getLoopFor(phi->getParent()) : nullptr;
+
+    // the bound has to be the same on every iteration for `counts_to` to mean anything
+    if (loop == nullptr || loop->getHeader() != phi->getParent() || !loop->contains(block) || !invariant(*loop, size)) {
+      return false;
+    }
+
+    return counts_to(*phi, *loop, size, block, tree);
+  }
+
+  // a `+`, `-` or `*` that codegen checked for overflow: a `*.with.overflow` call that's only
+  // used through extracts of its result and its overflow flag
+  struct CheckedOp {
+    llvm::IntrinsicInst* call = nullptr;
+    llvm::ExtractValueInst* value = nullptr;
+    llvm::ExtractValueInst* overflow = nullptr;
+    llvm::Instruction::BinaryOps opcode = llvm::Instruction::Add;
+    bool is_signed = false;
+  };
+
+  std::optional<CheckedOp> checked_op(llvm::Value* value) noexcept {
+    auto* call = llvm::dyn_cast<llvm::IntrinsicInst>(value);
+
+    if (call == nullptr) {
+      return std::nullopt;
+    }
+
+    auto op = CheckedOp{};
+    op.call = call;
+
+    switch (call->getIntrinsicID()) {
+      case llvm::Intrinsic::sadd_with_overflow: op.opcode = llvm::Instruction::Add, op.is_signed = true; break;
+      case llvm::Intrinsic::uadd_with_overflow: op.opcode = llvm::Instruction::Add, op.is_signed = false; break;
+      case llvm::Intrinsic::ssub_with_overflow: op.opcode = llvm::Instruction::Sub, op.is_signed = true; break;
+      case llvm::Intrinsic::usub_with_overflow: op.opcode = llvm::Instruction::Sub, op.is_signed = false; break;
+      case llvm::Intrinsic::smul_with_overflow: op.opcode = llvm::Instruction::Mul, op.is_signed = true; break;
+      case llvm::Intrinsic::umul_with_overflow: op.opcode = llvm::Instruction::Mul, op.is_signed = false; break;
+      default: return std::nullopt;
+    }
+
+    for (auto* user : call->users()) {
+      auto* extract = llvm::dyn_cast<llvm::ExtractValueInst>(user);
+
+      if (extract == nullptr || extract->getNumIndices() != 1) {
+        return std::nullopt;
+      }
+
+      auto*& slot = (extract->getIndices()[0] == 0) ? op.value : op.overflow;
+
+      if (slot != nullptr) {
+        return std::nullopt;
+      }
+
+      slot = extract;
+    }
+
+    return op;
+  }
+
+  // which successor of a check panics, if `branch` is a check at all
+  std::optional<unsigned> panic_edge(const llvm::BranchInst* branch) noexcept {
+    if (branch == nullptr || !branch->isConditional()) {
+      return std::nullopt;
+    }
+
+    auto first = panics(*branch->getSuccessor(0));
+
+    if (first == panics(*branch->getSuccessor(1))) {
+      return std::nullopt;
+    }
+
+    return first ? 0u : 1u;
+  }
+
+  // whether `flag` is something that says an arithmetic op overflowed: either the flag from a
+  // `*.with.overflow`, or a widened result that doesn't survive being narrowed and extended again
+  bool overflow_flag(const llvm::Value* flag) noexcept {
+    namespace pm = llvm::PatternMatch;
+
+    if (auto* extract = llvm::dyn_cast<llvm::ExtractValueInst>(flag)) {
+      auto* call = llvm::dyn_cast<llvm::Instruction>(extract->getAggregateOperand());
+
+      return extract->getNumIndices() == 1 && extract->getIndices()[0] == 1 && call != nullptr
+             && checked_op(const_cast<llvm::Instruction*>(call)) != std::nullopt;
+    }
+
+    auto* wide = static_cast<llvm::Value*>(nullptr);
+    auto predicate = llvm::ICmpInst::Predicate{};
+
+    auto narrowed = pm::m_ZExtOrSExt(pm::m_Trunc(pm::m_Value(wide)));
+
+    return pm::match(flag, pm::m_ICmp(predicate, narrowed, pm::m_Deferred(wide)))
+           && predicate == llvm::ICmpInst::ICMP_NE;
+  }
+
+  // instructions that are fine to run even if an earlier check would have panicked
+  bool speculatable(const llvm::Instruction& inst) noexcept {
+    // a poison result could end up being branched on
+    if (llvm::cast<llvm::Operator>(inst).hasPoisonGeneratingFlags()) {
+      return false;
+    }
+
+    // the `*.with.overflow` intrinsics can't trap, LLVM just doesn't mark them as speculatable
+    if (auto* call = llvm::dyn_cast<llvm::IntrinsicInst>(&inst); call != nullptr && call->getType()->isStructTy()) {
+      return checked_op(const_cast<llvm::IntrinsicInst*>(call)) != std::nullopt;
+    }
+
+    return llvm::isSafeToSpeculativelyExecute(&inst);
+  }
+
+  // whether `to` is reached from `from` through nothing but other checks and instructions that
+  // could just as well run when the check after `from` fails
+  bool only_checks_between(const llvm::Instruction* from, const llvm::Instruction* to) noexcept {
+    constexpr auto limit = 64;
+    auto* inst = from->getNextNode();
+
+    for (auto i = 0; i < limit && inst != nullptr; ++i) {
+      if (inst == to) {
+        return true;
+      }
+
+      if (auto* branch = llvm::dyn_cast<llvm::BranchInst>(inst)) {
+        auto edge = panic_edge(branch);
+        auto* next = branch->isUnconditional() ? branch->getSuccessor(0)
+                     : (edge != std::nullopt)  ? branch->getSuccessor(1 - *edge)
+                                               : nullptr;
+
+        if (next == nullptr || next->getSinglePredecessor() != branch->getParent()) {
+          return false;
+        }
+
+        inst = &next->front();
+
+        continue;
+      }
+
+      if (!llvm::isa<llvm::PHINode>(inst) && !speculatable(*inst)) {
+        return false;
+      }
+
+      inst = inst->getNextNode();
+    }
+
+    return false;
+  }
+
+  // `op` only exists to be an operand of `parent`, and can be computed as part of it
+  bool absorbable(const CheckedOp& op, const CheckedOp& parent) noexcept {
+    if (op.value == nullptr || op.overflow == nullptr || !op.value->hasOneUse() || !op.overflow->hasOneUse()) {
+      return false;
+    }
+
+    auto* check = llvm::dyn_cast<llvm::BranchInst>(op.overflow->user_back());
+
+    return op.value->user_back() == parent.call && panic_edge(check) == 0u && op.is_signed == parent.is_signed
+           && op.call->getType() == parent.call->getType() && only_checks_between(op.call, parent.call);
+  }
+
+  // the ranges are tracked in a domain wide enough that nothing small enough to widen can wrap
+  constexpr auto range_bits = 128u;
+
+  llvm::ConstantRange tree_range(const CheckedOp& op, std::vector<CheckedOp>* absorbed) noexcept;
+
+  // every value `value` could have, widening any checked ops it comes from
+  llvm::ConstantRange operand_range(llvm::Value* value,
+      const CheckedOp& parent,
+      std::vector<CheckedOp>* absorbed) noexcept {
+    if (auto* extract = llvm::dyn_cast<llvm::ExtractValueInst>(value)) {
+      if (auto op = checked_op(extract->getAggregateOperand()); op != std::nullopt && absorbable(*op, parent)) {
+        absorbed->push_back(*op);
+
+        return tree_range(*op, absorbed);
+      }
+    }
+
+    auto width = value->getType()->getIntegerBitWidth();
+    auto extend = [&parent](const llvm::APInt& bits) {
+      return parent.is_signed ? bits.sext(range_bits) : bits.zext(range_bits);
+    };
+
+    if (auto* constant = llvm::dyn_cast<llvm::ConstantInt>(value)) {
+      return llvm::ConstantRange{extend(constant->getValue())};
+    }
+
+    auto min = parent.is_signed ? llvm::APInt::getSignedMinValue(width) : llvm::APInt::getMinValue(width);
+    auto max = parent.is_signed ? llvm::APInt::getSignedMaxValue(width) : llvm::APInt::getMaxValue(width);
+
+    return llvm::ConstantRange::getNonEmpty(extend(min), extend(max) + 1);
+  }
+
+  llvm::ConstantRange tree_range(const CheckedOp& op, std::vector<CheckedOp>* absorbed) noexcept {
+    auto lhs = operand_range(op.call->getArgOperand(0), op, absorbed);
+    auto rhs = operand_range(op.call->getArgOperand(1), op, absorbed);
+
+    return lhs.binaryOp(op.opcode, rhs);
+  }
+
+  // `value` in the wide type: either the wide result of an op that's already been widened, or `value` extended
+  llvm::Value* wide_operand(llvm::IRBuilder<>* builder,
+      llvm::Value* value,
+      const CheckedOp& parent,
+      llvm::Type* type,
+      const std::vector<std::pair<llvm::Value*, llvm::Value*>>& widened) noexcept {
+    auto it = std::find_if(widened.begin(), widened.end(), [value](auto& pair) {
+      return pair.first == value;
+    });
+
+    if (it != widened.end()) {
+      return it->second;
+    }
+
+    return parent.is_signed ? builder->CreateSExt(value, type) : builder->CreateZExt(value, type);
+  }
+
+  // does `op` in `type` right where it was, and replaces its overflow flag with whether the wide result
+  // survives being narrowed back down. that's a flag that `coalesce_next` knows how to merge
+  llvm::Value* emit_wide(const CheckedOp& op,
+      llvm::Type* type,
+      std::vector<std::pair<llvm::Value*, llvm::Value*>>* widened) noexcept {
+    auto builder = llvm::IRBuilder<>(op.call);
+    auto* lhs = wide_operand(&builder, op.call->getArgOperand(0), op, type, *widened);
+    auto* rhs = wide_operand(&builder, op.call->getArgOperand(1), op, type, *widened);
+    auto* wide = builder.CreateBinOp(op.opcode, lhs, rhs);
+    auto* narrow = builder.CreateTrunc(wide, op.value->getType());
+    auto* extended = op.is_signed ? builder.CreateSExt(narrow, type) : builder.CreateZExt(narrow, type);
+
+    op.overflow->replaceAllUsesWith(builder.CreateICmpNE(extended, wide));
+    widened->emplace_back(op.value, wide);
+
+    return narrow;
+  }
+
+  // does a tree of checked ops in a type wide enough that none of them can overflow. every op still
+  // checks that its own result fits the original type, a panic has to happen at the same place (and
+  // report the same site) no matter the optimization level. what goes away are the intrinsics, and
+  // the checks are left as flags that `coalesce_next` can merge into one branch. the wide ops don't
+  // get `nsw`, instcombine can prove that on its own and it would make them look unsafe to coalesce
+  bool widen(const CheckedOp& root) noexcept {
+    auto absorbed = std::vector<CheckedOp>{};
+    auto bits = tree_range(root, &absorbed).getMinSignedBits();
+    auto width = root.value->getType()->getIntegerBitWidth();
+    auto wide_width = (bits <= 32) ? 32u : 64u;
+
+    if (absorbed.empty() || bits > 64 || width >= wide_width) {
+      return false;
+    }
+
+    auto* type = llvm::IntegerType::get(root.call->getContext(), wide_width);
+    auto widened = std::vector<std::pair<llvm::Value*, llvm::Value*>>{};
+
+    // `absorbed` has parents before children, children have to be widened first
+    for (auto it = absorbed.rbegin(); it != absorbed.rend(); ++it) {
+      (void)emit_wide(*it, type, &widened);
+    }
+
+    root.value->replaceAllUsesWith(emit_wide(root, type, &widened));
+
+    root.value->eraseFromParent();
+    root.overflow->eraseFromParent();
+    root.call->eraseFromParent();
+
+    // parents come before children, so each value is already unused by the time it's erased
+    for (auto& op : absorbed) {
+      op.value->eraseFromParent();
+      op.overflow->eraseFromParent();
+      op.call->eraseFromParent();
+    }
+
+    return true;
+  }
+
+  bool widen_all(llvm::Function& fn) noexcept {
+    auto roots = std::vector<CheckedOp>{};
+    auto changed = false;
+
+    for (auto& inst : llvm::instructions(fn)) {
+      auto op = checked_op(&inst);
+
+      if (op == std::nullopt || op->value == nullptr || op->overflow == nullptr) {
+        continue;
+      }
+
+      // anything that's absorbable gets widened along with the root of its tree
+      if (op->value->hasOneUse()) {
+        if (auto parent = checked_op(op->value->user_back()); parent != std::nullopt && absorbable(*op, *parent)) {
+          continue;
+        }
+      }
+
+      roots.push_back(*op);
+    }
+
+    for (auto& root : roots) {
+      changed = widen(root) || changed;
+    }
+
+    return changed;
+  }
+
+
+  // merges the overflow check at the end of `block` with the one right after it into one branch
+  bool coalesce_next(llvm::BasicBlock* block, llvm::MDBuilder* weights) noexcept {
+    auto* first = llvm::dyn_cast<llvm::BranchInst>(block->getTerminator());
+    auto first_edge = panic_edge(first);
+
+    if (first_edge == std::nullopt) {
+      return false;
+    }
+
+    auto* next = first->getSuccessor(1 - *first_edge);
+    auto* second = llvm::dyn_cast<llvm::BranchInst>(next->getTerminator());
+    auto second_edge = panic_edge(second);
+
+    if (next == block || next->getSinglePredecessor() != block || second_edge == std::nullopt
+        || !overflow_flag(second->getCondition())) {
+      return false;
+    }
+
+    // `failed` is either the panic block, or the block that picks the site for checks that were already coalesced
+    auto* failed = first->getSuccessor(*first_edge);
+    auto* target = second->getSuccessor(*second_edge);
+    auto coalesced = failed != target;
+
+    if (!calls_panic(*target) || (!coalesced && !overflow_flag(first->getCondition()))) {
+      return false;
+    }
+
+    if (coalesced
+        && (failed->getSinglePredecessor() != block || failed->getSingleSuccessor() != target
+            || llvm::isa<llvm::PHINode>(failed->front()))) {
+      return false;
+    }
+
+    for (auto& inst : *next) {
+      if (&inst == second) {
+        break;
+      }
+
+      if (llvm::isa<llvm::PHINode>(inst) || !speculatable(inst)) {
+        return false;
+      }
+    }
+
+    // `next` now runs even when the first check fails, nothing in it can trap or has side effects
+    block->getInstList().splice(first->getIterator(), next->getInstList(), next->begin(), second->getIterator());
+
+    auto builder = llvm::IRBuilder<>(first);
+    auto* first_failed = (*first_edge == 0) ? first->getCondition() : builder.CreateNot(first->getCondition());
+    auto* second_failed = (*second_edge == 0) ? second->getCondition() : builder.CreateNot(second->getCondition());
+
+    // a `select` rather than an `or`, the second flag may be poison when the first check failed
+    auto* either = builder.CreateLogicalOr(first_failed, second_failed);
+
+    if (!coalesced) {
+      failed = llvm::BasicBlock::Create(block->getContext(), "check_failed", block->getParent(), target);
+      llvm::BranchInst::Create(target, failed);
+      target->replacePhiUsesWith(block, failed);
+    }
+
+    // the first check to fail is the one that gets reported, just like before they were merged
+    builder.SetInsertPoint(failed->getTerminator());
+
+    for (auto& phi : target->phis()) {
+      auto* earlier = phi.getIncomingValueForBlock(failed);
+      auto* later = phi.getIncomingValueForBlock(next);
+
+      phi.setIncomingValueForBlock(failed, builder.CreateSelect(first_failed, earlier, later));
+      phi.removeIncomingValue(next);
+    }
+
+    auto* after = second->getSuccessor(1 - *second_edge);
+    auto* merged = llvm::BranchInst::Create(failed, after, either, block);
+
+    merged->setMetadata(llvm::LLVMContext::MD_prof, weights->createBranchWeights(never_taken_weight, taken_weight));
+    after->replacePhiUsesWith(next, block);
+    first->eraseFromParent();
+    next->eraseFromParent();
+
+    return true;
+  }
+} // namespace
+
+namespace gal::backend {
+  llvm::PreservedAnalyses HoistAllocasPass::run(llvm::Function& fn, llvm::FunctionAnalysisManager&) noexcept {
+    auto& entry = fn.getEntryBlock();
+    auto allocas = std::vector<llvm::AllocaInst*>{};
+
+    for (auto& block : fn) {
+      if (&block == &entry) {
+        continue;
+      }
+
+      for (auto& inst : block) {
+        auto* alloca = llvm::dyn_cast<llvm::AllocaInst>(&inst);
+
+        if (alloca != nullptr && llvm::isa<llvm::ConstantInt>(alloca->getArraySize())) {
+          allocas.push_back(alloca);
+        }
+      }
+    }
+
+    if (allocas.empty()) {
+      return llvm::PreservedAnalyses::all();
+    }
+
+    auto* position = &*entry.getFirstInsertionPt();
+
+    for (auto* alloca : allocas) {
+      alloca->moveBefore(position);
+    }
+
+    auto preserved = llvm::PreservedAnalyses{};
+    preserved.preserveSet<llvm::CFGAnalyses>();
+
+    return preserved;
+  }
+
+  llvm::PreservedAnalyses PanicPathsPass::run(llvm::Function& fn, llvm::FunctionAnalysisManager&) noexcept {
+    auto builder = llvm::MDBuilder(fn.getContext());
+    auto changed = false;
+
+    for (auto& block : fn) {
+      auto* branch = llvm::dyn_cast<llvm::BranchInst>(block.getTerminator());
+
+      if (branch == nullptr || !branch->isConditional() || branch->hasMetadata(llvm::LLVMContext::MD_prof)) {
+        continue;
+      }
+
+      auto first = panics(*branch->getSuccessor(0));
+      auto second = panics(*branch->getSuccessor(1));
+
+      if (first == second) {
+        continue;
+      }
+
+      auto weights = first ? builder.createBranchWeights(never_taken_weight, taken_weight)
+                           : builder.createBranchWeights(taken_weight, never_taken_weight);
+
+      branch->setMetadata(llvm::LLVMContext::MD_prof, weights);
+      changed = true;
+    }
+
+    if (!changed) {
+      return llvm::PreservedAnalyses::all();
+    }
+
+    // only metadata was touched, the CFG itself is the same
+    auto preserved = llvm::PreservedAnalyses{};
+    preserved.preserveSet<llvm::CFGAnalyses>();
+
+    return preserved;
+  }
+
+  llvm::PreservedAnalyses EliminateChecksPass::run(llvm::Loop& loop,
+      llvm::LoopAnalysisManager&,
+      llvm::LoopStandardAnalysisResults& results,
+      llvm::LPMUpdater&) noexcept {
+    auto changed = false;
+
+    for (auto* block : loop.blocks()) {
+      // blocks in nested loops were already looked at when the nested loop was visited
+      if (results.LI.getLoopFor(block) != &loop) {
+        continue;
+      }
+
+      auto* branch = llvm::dyn_cast<llvm::BranchInst>(block->getTerminator());
+
+      if (branch == nullptr || !branch->isConditional()) {
+        continue;
+      }
+
+      auto* compare = llvm::dyn_cast<llvm::ICmpInst>(branch->getCondition());
+      auto panics_if_true = panics(*branch->getSuccessor(0));
+
+      if (compare == nullptr || panics_if_true == panics(*branch->getSuccessor(1))) {
+        continue;
+      }
+
+      // what has to hold for the check to pass
+      auto predicate = panics_if_true ? compare->getInversePredicate() : compare->getPredicate();
+      auto* lhs = compare->getOperand(0);
+      auto* rhs = compare->getOperand(1);
+
+      if (predicate == llvm::ICmpInst::ICMP_UGT || predicate == llvm::ICmpInst::ICMP_UGE) {
+        predicate = llvm::ICmpInst::getSwappedPredicate(predicate);
+        std::swap(lhs, rhs);
+      }
+
+      // `lhs < rhs` implies `lhs <= rhs`, so proving it works for the end of a slice too
+      if (predicate != llvm::ICmpInst::ICMP_ULT && predicate != llvm::ICmpInst::ICMP_ULE) {
+        continue;
+      }
+
+      if (in_bounds(lhs, rhs, block, results.DT, results.LI)) {
+        // the panic edge is still there, but it's dead. simplifycfg deals with it later
+        branch->setCondition(llvm::ConstantInt::getBool(branch->getContext(), !panics_if_true));
+        changed = true;
+      }
+    }
+
+    return changed ? llvm::getLoopPassPreservedAnalyses() : llvm::PreservedAnalyses::all();
+  }
+
+  llvm::PreservedAnalyses CoalesceChecksPass::run(llvm::Function& fn, llvm::FunctionAnalysisManager&) noexcept {
+    auto weights = llvm::MDBuilder(fn.getContext());
+    auto changed = widen_all(fn);
+
+    for (auto& block : fn) {
+      while (coalesce_next(&block, &weights)) {
+        changed = true;
+      }
+    }
+
+    return changed ? llvm::PreservedAnalyses::none() : llvm::PreservedAnalyses::all();
+  }
+
+  void register_passes(llvm::PassBuilder* builder) noexcept {
+    using Elements = llvm::ArrayRef<llvm::PassBuilder::PipelineElement>;
+
+    builder->registerPipelineParsingCallback([](llvm::StringRef name, llvm::FunctionPassManager& manager, Elements) {
+      if (name == "gallium-hoist-allocas") {
+        manager.addPass(HoistAllocasPass{});
+
+        return true;
+      }
+
+      if (name == "gallium-panic-paths") {
+        manager.addPass(PanicPathsPass{});
+
+        return true;
+      }
+
+      if (name == "gallium-coalesce-checks") {
+        manager.addPass(CoalesceChecksPass{});
+
+        return true;
+      }
+
+      return false;
+    });
+
+    builder->registerPipelineParsingCallback([](llvm::StringRef name, llvm::LoopPassManager& manager, Elements) {
+      if (name == "gallium-eliminate-checks") {
+        manager.addPass(EliminateChecksPass{});
+
+        return true;
+      }
+
+      return false;
+    });
+
+    builder->registerPipelineStartEPCallback([](llvm::ModulePassManager& manager, auto) {
+      manager.addPass(llvm::createModuleToFunctionPassAdaptor(HoistAllocasPass{}));
+    });
+
+    builder->registerPeepholeEPCallback([](llvm::FunctionPassManager& manager, auto) {
+      manager.addPass(PanicPathsPass{});
+    });
+
+    // runs in the last loop pass manager, after rotation has put each loop's exit test where
+    // it guards the backedge. whatever checks are left get hoisted by IRCE and unswitching
+    builder->registerLoopOptimizerEndEPCallback([](llvm::LoopPassManager& manager, auto) {
+      manager.addPass(EliminateChecksPass{});
+    });
+
+    // after the last round of instcombine and GVN that simplification does, so chains of
+    // arithmetic are as short as they're going to get before the vectorizer looks at them
+    builder->registerScalarOptimizerLateEPCallback([](llvm::FunctionPassManager& manager, auto) {
+      manager.addPass(CoalesceChecksPass{});
+    });
+
+    // IRCE splits loops so that the iterations where every check is known to pass are a loop
+    // of their own, without any checks. that's the loop that then gets vectorized
+    builder->registerVectorizerStartEPCallback([](llvm::FunctionPassManager& manager, auto) {
+      manager.addPass(llvm::IRCEPass{});
+      manager.addPass(llvm::SimplifyCFGPass{});
+    });
+  }
+
+  bool valid_pipeline(std::string_view pipeline, std::string* error) noexcept {
+    auto builder = llvm::PassBuilder{};
+    auto manager = llvm::ModulePassManager{};
+
+    register_passes(&builder);
+
+    if (auto err = builder.parsePassPipeline(manager, llvm::StringRef{pipeline.data(), pipeline.size()})) {
+      *error = llvm::toString(std::move(err));
+
+      return false;
+    }
+
+    return true;
+  }
+} // namespace gal::backend
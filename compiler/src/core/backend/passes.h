@@ -0,0 +1,112 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Transforms/Scalar/LoopPassManager.h"
+#include <string>
+#include <string_view>
+
+namespace gal::backend {
+  /// Moves every fixed-size alloca into the entry block. Codegen creates temporaries
+  /// wherever it happens to be at the time (including inside of loops), but SROA and
+  /// mem2reg only promote allocas that are in the entry block.
+  ///
+  /// Available as `gallium-hoist-allocas` in `--passes`
+  class HoistAllocasPass : public llvm::PassInfoMixin<HoistAllocasPass> {
+  public:
+    /// Runs the pass over a single function
+    ///
+    /// \param fn The function to transform
+    /// \param manager The analysis manager for `fn`
+    /// \return Which analyses are still valid
+    llvm::PreservedAnalyses run(llvm::Function& fn, llvm::FunctionAnalysisManager& manager) noexcept;
+  };
+
+  /// Gives every branch that leads straight into a panic weights saying that it's never
+  /// taken. Checks then look like what they are (almost always passing) to block
+  /// placement, unrolling, the vectorizer and range-check elimination.
+  ///
+  /// Available as `gallium-panic-paths` in `--passes`
+  class PanicPathsPass : public llvm::PassInfoMixin<PanicPathsPass> {
+  public:
+    /// Runs the pass over a single function
+    ///
+    /// \param fn The function to transform
+    /// \param manager The analysis manager for `fn`
+    /// \return Which analyses are still valid
+    llvm::PreservedAnalyses run(llvm::Function& fn, llvm::FunctionAnalysisManager& manager) noexcept;
+  };
+
+  /// Cuts down on the number of branches that overflow checks take. Trees of checked `+`, `-` and `*`
+  /// whose intermediate results only feed into each other (like `a * b + c`) are done in a type
+  /// wide enough that they can't overflow, with each op checking that its own result fits the
+  /// original type. Overflow checks in straight-line code are then merged into one branch, which
+  /// still reports whichever check would have failed first.
+  ///
+  /// Every check that codegen emitted still happens, so a program panics in exactly the same
+  /// places no matter the optimization level.
+  ///
+  /// Available as `gallium-coalesce-checks` in `--passes`
+  class CoalesceChecksPass : public llvm::PassInfoMixin<CoalesceChecksPass> {
+  public:
+    /// Runs the pass over a single function
+    ///
+    /// \param fn The function to transform
+    /// \param manager The analysis manager for `fn`
+    /// \return Which analyses are still valid
+    llvm::PreservedAnalyses run(llvm::Function& fn, llvm::FunctionAnalysisManager& manager) noexcept;
+  };
+
+  /// Removes the bounds checks that can be proven to always pass, mostly checks on an index that
+  /// counts up by one towards the size it's checked against, e.g. every check in
+  /// `for i := 0 to data.size { data[i] }`. Works on checks in the form codegen emits them,
+  /// `index >= size` (unsigned) branching into a panic.
+  ///
+  /// Available as `gallium-eliminate-checks` in `--passes`, as a loop pass
+  class EliminateChecksPass : public llvm::PassInfoMixin<EliminateChecksPass> {
+  public:
+    /// Runs the pass over a single loop, ignoring any loops nested inside of it
+    ///
+    /// \param loop The loop to transform
+    /// \param manager The analysis manager for `loop`
+    /// \param results The analyses every loop pass has access to
+    /// \param updater Used to tell the loop pass manager about changes to the loop nest
+    /// \return Which analyses are still valid
+    llvm::PreservedAnalyses run(llvm::Loop& loop,
+        llvm::LoopAnalysisManager& manager,
+        llvm::LoopStandardAnalysisResults& results,
+        llvm::LPMUpdater& updater) noexcept;
+  };
+
+  /// Registers every Gallium-specific pass with a pass builder. Each one can be named in a
+  /// textual pipeline, and is added to the default pipelines at the extension point where it does
+  /// the most good:
+  ///
+  /// - pipeline start: `gallium-hoist-allocas`, so everything after it sees promotable allocas
+  /// - peephole: `gallium-panic-paths`, re-run whenever instcombine may have rewritten a check
+  /// - loop optimizer end: `gallium-eliminate-checks`, once loops have been rotated and simplified
+  /// - scalar optimizer late: `gallium-coalesce-checks`, once the arithmetic itself has been simplified
+  /// - vectorizer start: range-check elimination, so checks don't stop loops from being vectorized
+  ///
+  /// \param builder The builder to register with
+  void register_passes(llvm::PassBuilder* builder) noexcept;
+
+  /// Checks that a textual pipeline (in `opt -passes` syntax) can be parsed, Gallium's own
+  /// passes included
+  ///
+  /// \param pipeline The pipeline to check
+  /// \param error Where to put the reason it couldn't be parsed
+  /// \return Whether or not the pipeline is valid
+  [[nodiscard]] bool valid_pipeline(std::string_view pipeline, std::string* error) noexcept;
+} // namespace gal::backend
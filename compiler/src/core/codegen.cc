@@ -10,20 +10,127 @@
 
 #include "./codegen.h"
 #include "../ast/visitors.h"
+#include "../utility/flags.h"
+#include "../utility/timing.h"
 #include "./backend/code_generator.h"
 #include "./backend/optimizer.h"
+#include "./incremental.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Linker/Linker.h"
+#include <utility>
+#include <vector>
 
 namespace ast = gal::ast;
 
+namespace {
+  std::unique_ptr<llvm::Module> generate(llvm::LLVMContext* context,
+      llvm::TargetMachine* machine,
+      const ast::Program& program,
+      const absl::flat_hash_set<const ast::FnDeclaration*>& skip = {}) noexcept {
+    auto timer = gal::TimeScope("codegen");
+
+    return gal::backend::CodeGenerator(context, program, *machine).codegen(skip);
+  }
+
+  void optimize(llvm::Module* module, llvm::TargetMachine* machine) noexcept {
+    auto timer = gal::TimeScope("optimize");
+
+    gal::backend::optimize(module, machine);
+  }
+
+  // without any optimization, nothing is inlined or propagated across functions, so every
+  // function's optimized code only depends on the function itself (and the signatures of
+  // what it calls). that means unchanged functions can be pulled out of the cache one-by-one
+  std::unique_ptr<llvm::Module> generate_reusing_fns(llvm::LLVMContext* context,
+      llvm::TargetMachine* machine,
+      const ast::Program& program,
+      const gal::CacheKeys& keys) noexcept {
+    auto keyed = std::vector<std::pair<const ast::FnDeclaration*, std::uint64_t>>{};
+    auto cached = absl::flat_hash_map<const ast::FnDeclaration*, std::unique_ptr<llvm::Module>>{};
+    auto skip = absl::flat_hash_set<const ast::FnDeclaration*>{};
+
+    for (auto& decl : program.decls()) {
+      if (!decl->is(ast::DeclType::fn_decl)) {
+        continue;
+      }
+
+      auto& fn = gal::as<ast::FnDeclaration>(*decl);
+
+      if (auto key = keys.fn(fn)) {
+        keyed.emplace_back(&fn, *key);
+
+        if (auto module = gal::cache_load(gal::CacheLevel::fn, *key, context)) {
+          cached.emplace(&fn, std::move(module));
+          skip.insert(&fn);
+        }
+      }
+    }
+
+    auto module = generate(context, machine, program, skip);
+
+    if (!cached.empty()) {
+      auto timer = gal::TimeScope("link cached code");
+      auto failed = false;
+
+      for (auto& [_, code] : cached) {
+        // why is it *true* on error instead of false on error? the verbiage is completely backwards
+        failed = llvm::Linker::linkModules(*module, std::move(code)) || failed;
+      }
+
+      // an entry that doesn't fit anymore is a bug in the keys, but it shouldn't break the build. just
+      // throw away whatever got linked in and start over without the cache
+      if (failed || llvm::verifyModule(*module)) {
+        module = generate(context, machine, program);
+        skip.clear();
+      }
+    }
+
+    optimize(module.get(), machine);
+
+    for (auto [fn, key] : keyed) {
+      auto* code = module->getFunction(fn->mangled_name());
+
+      if (!skip.contains(fn) && code != nullptr && !code->isDeclaration()) {
+        gal::cache_store(key, *gal::extract_function(*code));
+      }
+    }
+
+    return module;
+  }
+} // namespace
+
 namespace gal {
   std::unique_ptr<llvm::Module> codegen(llvm::LLVMContext* context,
       llvm::TargetMachine* machine,
       const ast::Program& program) noexcept {
-    auto module = backend::CodeGenerator(context, program, *machine).codegen();
+    if (!gal::flags().incremental()) {
+      auto module = generate(context, machine, program);
+
+      optimize(module.get(), machine);
+
+      return module;
+    }
+
+    auto keys = gal::CacheKeys(program, *machine);
+
+    if (auto module = gal::cache_load(gal::CacheLevel::file, keys.file(), context)) {
+      return module;
+    }
+
+    auto module = std::unique_ptr<llvm::Module>{};
+
+    // `--passes` replaces the whole pipeline, it can inline (or anything else) even without `--opt`
+    if (gal::flags().opt() == gal::OptLevel::none && gal::flags().passes().empty()) {
+      module = generate_reusing_fns(context, machine, program, keys);
+    } else {
+      module = generate(context, machine, program);
+      optimize(module.get(), machine);
+    }
 
-    backend::optimize(module.get(), machine);
+    gal::cache_store(keys.file(), *module);
 
     return module;
   }
-} // namespace gal
\ No newline at end of file
+} // namespace gal
@@ -11,47 +11,40 @@
 #include "./emit.h"
 #include "../utility/flags.h"
 #include "../utility/log.h"
+#include "../utility/thread_pool.h"
+#include "../utility/timing.h"
+#include "./link.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
-#include "absl/strings/strip.h"
+#include "absl/strings/str_split.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/LTO/Config.h"
+#include "llvm/LTO/LTO.h"
+#include "llvm/Object/ArchiveWriter.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
-#include <cstdlib>
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include <algorithm>
 #include <filesystem>
-#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
-
-#ifdef _WIN64
-#include <windows.h>
-#else
-#include <unistd.h>
-#endif
-
-namespace fs = std::filesystem;
+#include <vector>
 
 namespace {
-  std::string path_to_runtime() {
-#ifdef _WIN64
-    auto buffer = std::string(MAX_PATH * 4, ' ');
-
-    GetModuleFileNameA(nullptr, buffer.data(), buffer.size());
-    absl::StripAsciiWhitespace(&buffer);
-    auto path = fs::path(buffer);
-
-    path.remove_filename();
-
-    return fs::absolute(path / "../../runtime").string();
-#else
-    return fs::absolute((fs::read_symlink("/proc/self/exe").remove_filename() / "../../runtime/")).string();
-#endif
-  }
-
-  std::string filename() {
-    auto name = gal::flags().out();
-
+  std::string filename(std::string_view name) {
     switch (gal::flags().emit()) {
       case gal::OutputFormat::llvm_ir: return absl::StrCat(name, ".ll");
       case gal::OutputFormat::llvm_bc: return absl::StrCat(name, ".bc");
@@ -64,54 +57,316 @@ namespace {
         return absl::StrCat(name, ".a");
 #endif
       }
-      case gal::OutputFormat::exe: {
-        return absl::StrCat(name, ".o.tmp");
-      }
       case gal::OutputFormat::ast_graphviz: return absl::StrCat(name, ".dot");
       default: assert(false); return "";
     }
   }
 
-  void compile_with_system(std::string_view path) noexcept {
-    auto* cc = std::getenv("CC");
+  std::string exe_name(std::string_view name) {
+#ifdef _WIN64
+    return absl::StrCat(name, ".exe");
+#else
+    return std::string{name};
+#endif
+  }
+
+  bool emit_object(llvm::Module* module,
+      llvm::TargetMachine* machine,
+      llvm::raw_pwrite_stream* os,
+      llvm::CodeGenFileType type) noexcept {
+    // I don't know a better way to do this for any target, and I also can't seem to
+    // find a way to hook this into the earlier pass manager
+    auto emitter = llvm::legacy::PassManager{};
 
-    if (cc == nullptr) {
-      gal::errs() << "$CC must be set to a C++ compiler!";
+    if (machine->addPassesToEmitFile(emitter, *os, nullptr, type)) {
+      gal::errs() << "LLVM is unable to emit a file of the type requested!";
 
-      std::abort();
+      return false;
     }
 
-    auto output = absl::StrCat(path.substr(0, path.find(".o"))
-    // clang-format off
-#ifdef _WIN64
-            , ".exe"); // exe suffix
+    emitter.run(*module);
+
+    return true;
+  }
+
+  // below this, splitting (cloning everything and a bitcode round-trip) costs more than
+  // generating the parts in parallel saves. the cap keeps the link from getting any slower
+  constexpr auto instructions_per_partition = std::size_t{20000};
+  constexpr auto max_partitions = std::size_t{16};
+
+  // the number of parts only depends on the module, so the output is the same no matter how many threads there are
+  std::size_t partition_count(const llvm::Module& module) noexcept {
+    auto instructions = std::size_t{0};
+
+    for (auto& fn : module) {
+      instructions += fn.getInstructionCount();
+    }
+
+    return std::clamp(instructions / instructions_per_partition, std::size_t{1}, max_partitions);
+  }
+
+  std::unique_ptr<llvm::TargetMachine> clone_machine(const llvm::TargetMachine& machine) noexcept {
+    auto* target = &machine.getTarget();
+
+    return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(machine.getTargetTriple().str(),
+        machine.getTargetCPU(),
+        machine.getTargetFeatureString(),
+        machine.Options,
+        machine.getRelocationModel(),
+        machine.getCodeModel(),
+        machine.getOptLevel()));
+  }
+
+  std::optional<std::string> emit_part(llvm::StringRef bitcode, const llvm::TargetMachine& machine) noexcept {
+    auto context = llvm::LLVMContext{};
+    auto part = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode, "<partition>"), context);
+
+    if (!part) {
+      gal::errs() << "unable to reload split module: " << llvm::toString(part.takeError());
+
+      return std::nullopt;
+    }
+
+    auto object = llvm::SmallVector<char, 0>{};
+    auto os = llvm::raw_svector_ostream{object};
+    auto copy = clone_machine(machine);
+
+    if (!emit_object(part->get(), copy.get(), &os, llvm::CGFT_ObjectFile)) {
+      return std::nullopt;
+    }
+
+    return std::string{object.data(), object.size()};
+  }
+
+  // `SplitModule` makes every internal symbol external so that parts can share them. they're renamed after
+  // a hash of the module first (like ThinLTO does when it promotes), otherwise every library emitted this
+  // way would export its own `__gallium_panic_sites`, string literals and thunks under the same names
+  void promote_locals(llvm::Module* module) noexcept {
+    auto hash = llvm::ModuleHash{};
+    auto os = llvm::raw_null_ostream{};
+    llvm::WriteBitcodeToFile(*module, os, false, nullptr, /*GenerateHash=*/true, &hash);
+
+    auto suffix = absl::StrCat(".llvm.", absl::Hex(hash[0], absl::kZeroPad8), absl::Hex(hash[1], absl::kZeroPad8));
+
+    for (auto& value : module->global_values()) {
+      if (!value.hasLocalLinkage() || value.isDeclaration()) {
+        continue;
+      }
+
+      // an unnamed local would be promoted as `__llvmsplit_unnamed` otherwise, which clashes just the same
+      value.setName(absl::StrCat(value.hasName() ? value.getName().str() : "__gallium_local", suffix));
+    }
+  }
+
+  // in the spirit of `llvm::splitCodeGen`, big modules are split up and every part is lowered
+  // on its own thread. every part is given its own context (and target machine), neither of
+  // those can be shared between threads
+  std::optional<std::vector<std::string>> emit_objects(llvm::Module* module,
+      llvm::TargetMachine* machine,
+      std::size_t threads) noexcept {
+    auto count = partition_count(*module);
+
+    if (count == 1) {
+      auto object = llvm::SmallVector<char, 0>{};
+      auto os = llvm::raw_svector_ostream{object};
+
+      if (!emit_object(module, machine, &os, llvm::CGFT_ObjectFile)) {
+        return std::nullopt;
+      }
+
+      return std::vector{std::string{object.data(), object.size()}};
+    }
+
+    auto parts = std::vector<std::string>{};
+
+    {
+      auto timer = gal::TimeScope("split module");
+
+      parts = gal::split_module(module, count);
+    }
+
+    auto objects = std::vector<std::optional<std::string>>(parts.size());
+    auto pool = gal::ThreadPool(std::clamp(threads, std::size_t{1}, parts.size()));
+
+    for (auto i = std::size_t{0}; i < parts.size(); ++i) {
+      pool.submit([&parts, &objects, machine, i] {
+        gal::time_trace_start_thread();
+        objects[i] = emit_part(parts[i], *machine);
+        gal::time_trace_finish_thread();
+      });
+    }
+
+    pool.wait();
+
+    // the parts are always in the order SplitModule gave them, not the order they finished in
+    auto result = std::vector<std::string>{};
+
+    for (auto& object : objects) {
+      if (!object) {
+        return std::nullopt;
+      }
+
+      result.push_back(std::move(*object));
+    }
+
+    return result;
+  }
+
+  bool write_archive(const std::vector<std::string>& objects, std::string_view out) noexcept {
+    auto members = std::vector<llvm::NewArchiveMember>{};
+    auto names = std::vector<std::string>{};
+
+    for (auto i = std::size_t{0}; i < objects.size(); ++i) {
+      names.push_back(absl::StrCat(std::filesystem::path(out).stem().string(), ".", i, ".o"));
+    }
+
+    for (auto i = std::size_t{0}; i < objects.size(); ++i) {
+      members.emplace_back(llvm::MemoryBufferRef(objects[i], names[i]));
+    }
+
+#ifdef __APPLE__
+    auto kind = llvm::object::Archive::K_DARWIN;
 #else
-            ); // no suffix for *nix
+    auto kind = llvm::object::Archive::K_GNU;
 #endif
-    // clang-format on
-
-    auto current = path_to_runtime();
-    auto command = absl::StrCat(std::string{cc},
-        " ",
-        path,
-        " -o ",
-        output,
-        " -L",
-        current,
-        " -lgallium_runtime",
-        " ",
-        gal::flags().args());
-
-    // TODO: find better way of doing this
-    std::cout.flush();
-    std::system(command.c_str());
-    std::filesystem::remove(path);
+
+    if (auto error = llvm::writeArchive(out, members, true, kind, true, false)) {
+      gal::errs() << "unable to write archive '" << out << "': " << llvm::toString(std::move(error));
+
+      return false;
+    }
+
+    return true;
+  }
+
+  // executables link every object together, libraries are an archive of them. anything
+  // else can only be a single object, which is written as-is
+  bool write_objects(const std::vector<std::string>& objects, std::string_view out) noexcept {
+    switch (gal::flags().emit()) {
+      case gal::OutputFormat::exe: {
+        auto views = std::vector<std::string_view>(objects.begin(), objects.end());
+
+        return gal::link_executable(views, exe_name(out));
+      }
+      case gal::OutputFormat::static_lib: return write_archive(objects, filename(out));
+      default: break;
+    }
+
+    assert(objects.size() == 1);
+
+    auto ec = std::error_code{};
+    auto file = filename(out);
+    auto fd = llvm::raw_fd_ostream(file, ec, llvm::sys::fs::OF_None);
+
+    if (ec) {
+      gal::errs() << "unable to open file '" << file << "' for writing";
+
+      return false;
+    }
+
+    fd << objects.front();
+
+    return true;
+  }
+
+  void write_bitcode(llvm::Module* module, llvm::raw_ostream* os) noexcept {
+    if (gal::flags().lto() != gal::LTOKind::thin) {
+      llvm::WriteBitcodeToFile(*module, *os);
+
+      return;
+    }
+
+    // the summary is what lets a thin link decide what to import without loading every module
+    auto profile = llvm::ProfileSummaryInfo(*module);
+    auto index = llvm::buildModuleSummaryIndex(*module, nullptr, &profile);
+
+    llvm::WriteBitcodeToFile(*module, *os, false, &index);
+  }
+
+  unsigned lto_opt_level() noexcept {
+    switch (gal::flags().opt()) {
+      case gal::OptLevel::none: return 0;
+      case gal::OptLevel::some: return 1;
+      case gal::OptLevel::small: return 2; // LTO has no size level, Os is O2 with the size attributes
+      case gal::OptLevel::fast: return 3;
+    }
+
+    return 0;
+  }
+
+  llvm::lto::Config lto_config(llvm::TargetMachine* machine) noexcept {
+    auto config = llvm::lto::Config{};
+
+    config.CPU = machine->getTargetCPU().str();
+    config.Options = machine->Options;
+    config.RelocModel = machine->getRelocationModel();
+    config.CodeModel = machine->getCodeModel();
+    config.CGOptLevel = machine->getOptLevel();
+    config.OptLevel = lto_opt_level();
+    config.UseNewPM = true;
+    config.CGFileType =
+        (gal::flags().emit() == gal::OutputFormat::assembly) ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile;
+
+    for (auto feature : absl::StrSplit(machine->getTargetFeatureString().str(), ',', absl::SkipEmpty())) {
+      config.MAttrs.emplace_back(feature);
+    }
+
+    return config;
+  }
+
+  bool add_to_link(llvm::lto::LTO* lto,
+      const gal::ThinModule& module,
+      absl::flat_hash_set<std::string>* defined) noexcept {
+    auto input = llvm::lto::InputFile::create(llvm::MemoryBufferRef(module.bitcode, module.name));
+
+    if (!input) {
+      gal::errs() << "unable to read bitcode for `" << module.name << "`: " << llvm::toString(input.takeError());
+
+      return false;
+    }
+
+    auto resolutions = std::vector<llvm::lto::SymbolResolution>{};
+    auto exe = gal::flags().emit() == gal::OutputFormat::exe;
+
+    for (auto& symbol : (*input)->symbols()) {
+      auto& resolution = resolutions.emplace_back();
+
+      if (symbol.isUndefined()) {
+        continue;
+      }
+
+      // the first definition wins, just like it would for a regular link of linkonce/weak code
+      resolution.Prevailing = defined->insert(symbol.getName().str()).second;
+      resolution.FinalDefinitionInLinkageUnit = resolution.Prevailing;
+
+      // in an executable the runtime only ever calls the user's main, so everything else can be
+      // internalized (and then inlined or thrown away). objects need to keep everything around
+      resolution.VisibleToRegularObj = !exe || symbol.getName() == "__gallium_user_main";
+    }
+
+    if (auto error = lto->add(std::move(*input), resolutions)) {
+      gal::errs() << "unable to add `" << module.name << "` to the link: " << llvm::toString(std::move(error));
+
+      return false;
+    }
+
+    return true;
   }
 } // namespace
 
-bool gal::emit(llvm::Module* module, llvm::TargetMachine* machine) noexcept {
+bool gal::emit(llvm::Module* module,
+    llvm::TargetMachine* machine,
+    std::string_view out,
+    std::size_t threads) noexcept {
+  if (gal::flags().emit() == OutputFormat::exe || gal::flags().emit() == OutputFormat::static_lib) {
+    // the objects never need to touch the disk, they get handed straight to the linker (or archiver)
+    auto objects = emit_objects(module, machine, threads);
+
+    return objects && write_objects(*objects, out);
+  }
+
   auto ec = std::error_code{};
-  auto file = filename();
+  auto file = filename(out);
   auto fd = llvm::raw_fd_ostream(file, ec, llvm::sys::fs::OF_None);
 
   if (ec) {
@@ -124,33 +379,144 @@ bool gal::emit(llvm::Module* module, llvm::TargetMachine* machine) noexcept {
 
   switch (gal::flags().emit()) {
     case OutputFormat::llvm_ir: module->print(fd, nullptr); return true;
-    case OutputFormat::llvm_bc: llvm::WriteBitcodeToFile(*module, fd); return true;
+    case OutputFormat::llvm_bc: write_bitcode(module, &fd); return true;
     case OutputFormat::assembly: {
       emit_type = llvm::CGFT_AssemblyFile;
       break;
     }
-    case OutputFormat::object_code:
-    case OutputFormat::static_lib:
-    case OutputFormat::exe: emit_type = llvm::CGFT_ObjectFile; break;
+    case OutputFormat::object_code: emit_type = llvm::CGFT_ObjectFile; break;
+    case OutputFormat::static_lib: assert(false); break;
+    case OutputFormat::exe: assert(false); break;
     case OutputFormat::ast_graphviz: assert(false); break;
   }
 
-  // I don't know a better way to do this for any target, and I also can't seem to
-  // find a way to hook this into the earlier pass manager
-  auto emitter = llvm::legacy::PassManager{};
-
-  if (machine->addPassesToEmitFile(emitter, fd, nullptr, emit_type)) {
-    gal::errs() << "LLVM is unable to emit a file of the type requested!";
-
+  if (!emit_object(module, machine, &fd, emit_type)) {
     return false;
   }
 
-  emitter.run(*module);
   fd.flush();
 
+  return true;
+}
+
+bool gal::emit_to_memory(llvm::Module* module,
+    llvm::TargetMachine* machine,
+    OutputFormat format,
+    std::string* out) noexcept {
+  auto buffer = llvm::SmallVector<char, 0>{};
+  auto os = llvm::raw_svector_ostream{buffer};
+
+  switch (format) {
+    case OutputFormat::llvm_ir: module->print(os, nullptr); break;
+    case OutputFormat::llvm_bc: write_bitcode(module, &os); break;
+    case OutputFormat::assembly: {
+      if (!emit_object(module, machine, &os, llvm::CGFT_AssemblyFile)) {
+        return false;
+      }
+
+      break;
+    }
+    case OutputFormat::object_code: {
+      if (!emit_object(module, machine, &os, llvm::CGFT_ObjectFile)) {
+        return false;
+      }
+
+      break;
+    }
+    default: assert(false && "format has no single in-memory representation"); return false;
+  }
+
+  out->assign(buffer.data(), buffer.size());
+
+  return true;
+}
+
+bool gal::emit_thin_link(absl::Span<const ThinModule> modules,
+    llvm::TargetMachine* machine,
+    std::size_t jobs) noexcept {
+  auto backend = llvm::lto::createInProcessThinBackend(llvm::heavyweight_hardware_concurrency(jobs));
+  auto lto = llvm::lto::LTO(lto_config(machine), std::move(backend));
+  auto defined = absl::flat_hash_set<std::string>{};
+
+  for (auto& module : modules) {
+    if (!add_to_link(&lto, module, &defined)) {
+      return false;
+    }
+  }
+
+  // every task writes into its own buffer, the backends for each module run on different threads
+  auto objects = std::vector<llvm::SmallVector<char, 0>>(lto.getMaxTasks());
+  auto add_stream = [&objects](unsigned task) {
+    auto os = std::make_unique<llvm::raw_svector_ostream>(objects[task]);
+
+#if LLVM_VERSION_MAJOR >= 14
+    using Stream = std::unique_ptr<llvm::CachedFileStream>;
+
+    return llvm::Expected<Stream>{std::make_unique<llvm::CachedFileStream>(std::move(os))};
+#else
+    return std::make_unique<llvm::lto::NativeObjectStream>(std::move(os));
+#endif
+  };
+
+  if (auto error = lto.run(add_stream)) {
+    gal::errs() << "thin link failed: " << llvm::toString(std::move(error));
+
+    return false;
+  }
+
   if (gal::flags().emit() == OutputFormat::exe) {
-    compile_with_system(file);
+    auto linked = std::vector<std::string>{};
+
+    for (auto& object : objects) {
+      if (!object.empty()) {
+        linked.emplace_back(object.data(), object.size());
+      }
+    }
+
+    return write_objects(linked, gal::flags().out());
+  }
+
+  // task 0 is the regular (non-thin) LTO partition, which is empty since every module has a
+  // summary. thin backends are numbered after it, in the order the modules were added
+  for (auto i = std::size_t{0}; i < modules.size(); ++i) {
+    auto& object = objects[i + 1];
+
+    if (!write_objects({std::string{object.data(), object.size()}}, modules[i].output)) {
+      return false;
+    }
   }
 
   return true;
 }
+
+void gal::initialize_targets() noexcept {
+  static auto once = std::once_flag{};
+
+  std::call_once(once, [] {
+    llvm::InitializeAllTargetInfos();
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllTargetMCs();
+    llvm::InitializeAllAsmParsers();
+    llvm::InitializeAllAsmPrinters();
+  });
+}
+
+std::vector<std::string> gal::split_module(llvm::Module* module, std::size_t count) noexcept {
+  auto parts = std::vector<std::string>{};
+
+  promote_locals(module);
+
+  // locals aren't preserved, keeping one in the same part as everything that uses it would put nearly every
+  // function in one part. anything that touches a bounds or overflow check uses the panic site table
+  llvm::SplitModule(
+      *module,
+      static_cast<unsigned>(count),
+      [&parts](std::unique_ptr<llvm::Module> part) {
+        auto os = llvm::raw_string_ostream{parts.emplace_back()};
+
+        llvm::WriteBitcodeToFile(*part, os);
+      },
+      /*PreserveLocals=*/false);
+
+  return parts;
+}
@@ -10,14 +10,83 @@
 
 #pragma once
 
+#include "../utility/flags.h"
+#include "absl/types/span.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Target/TargetMachine.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace gal {
-  /// Emits the compiler's generated code (or other format) into a file
+  /// A single file's part of a thin link
+  struct ThinModule {
+    /// Uniquely identifies the module in the link
+    std::string name;
+    /// The module as bitcode with a summary, see `emit_to_memory`
+    std::string bitcode;
+    /// The name of the file that the module is emitted to, without an extension. Only used
+    /// when the output is one file per module rather than an executable
+    std::string output;
+  };
+
+  /// Emits the compiler's generated code (or other format) into a file.
+  ///
+  /// For executables and libraries, big modules are split into parts that are lowered
+  /// to machine code in parallel and then linked (or archived) together. How a module
+  /// is split only depends on the module itself, so the output is the same for any
+  /// number of threads.
+  ///
+  /// \param module The module to output
+  /// \param machine The machine to use when outputting
+  /// \param out The name of the file to write to, without an extension
+  /// \param threads The number of threads that can generate machine code at once
+  /// \return Returns false if output could not be emitted
+  bool emit(llvm::Module* module,
+      llvm::TargetMachine* machine,
+      std::string_view out,
+      std::size_t threads = 1) noexcept;
+
+  /// Emits the compiler's generated code into a buffer instead of a file. Only the formats
+  /// that are a single artifact produced by LLVM (IR, bitcode, assembly and object code) work.
+  ///
+  /// With `--lto=thin`, bitcode (whether it's written to a file or a buffer) has a module summary
+  /// attached so that it can be given to `emit_thin_link` or any other linker that does ThinLTO
   ///
   /// \param module The module to output
   /// \param machine The machine to use when outputting
+  /// \param format The format to emit
+  /// \param out The buffer to write into
   /// \return Returns false if output could not be emitted
-  bool emit(llvm::Module* module, llvm::TargetMachine* machine) noexcept;
+  bool emit_to_memory(llvm::Module* module, llvm::TargetMachine* machine, OutputFormat format, std::string* out) noexcept;
+
+  /// Does a ThinLTO link of separately-compiled modules. The summaries are combined, functions
+  /// are imported across modules wherever the thin link thinks it's worth it, and then every
+  /// module is optimized and lowered again on up to `jobs` threads at once.
+  ///
+  /// Executables are linked together into `--out`, anything else is written out per-module
+  /// the same way `emit` would. IR, bitcode and Graphviz can't be the output of a thin link.
+  ///
+  /// \param modules Every module in the program, as bitcode with a summary
+  /// \param machine The machine to target
+  /// \param jobs The number of backends to run at once
+  /// \return Returns false if the link failed or output could not be emitted
+  bool emit_thin_link(absl::Span<const ThinModule> modules,
+      llvm::TargetMachine* machine,
+      std::size_t jobs) noexcept;
+
+  /// Splits a module into `count` parts that can be lowered to machine code on their own, which
+  /// is what `emit` does with big modules. Internal symbols that parts have to share are promoted
+  /// to symbols named after a hash of the module, so that they don't clash with any other
+  /// module's when they're linked together.
+  ///
+  /// \param module The module to split, its internal symbols are renamed
+  /// \param count The number of parts to split it into
+  /// \return Every part as bitcode, some of them may not define anything
+  std::vector<std::string> split_module(llvm::Module* module, std::size_t count) noexcept;
+
+  /// Initializes every target that LLVM was built with, this needs to happen before a target
+  /// machine can be created. Safe to call from any thread, only the first call does anything
+  void initialize_targets() noexcept;
 } // namespace gal
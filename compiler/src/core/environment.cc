@@ -23,13 +23,10 @@ namespace {
       }
     }
 
-    void visit(ast::ImportDeclaration*) final {
-      // TODO
-    }
+    // imports don't declare anything in the module itself, `NameResolver` deals with them
+    void visit(ast::ImportDeclaration*) final {}
 
-    void visit(ast::ImportFromDeclaration*) final {
-      // TODO
-    }
+    void visit(ast::ImportFromDeclaration*) final {}
 
     void visit(ast::FnDeclaration* declaration) final {
       insert(declaration->proto().name(), gal::Overload(declaration));
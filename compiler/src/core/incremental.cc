@@ -0,0 +1,529 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./incremental.h"
+#include "../ast/visitors.h"
+#include "../utility/flags.h"
+#include "../utility/source_manager.h"
+#include "./module_interface.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ast = gal::ast;
+
+namespace {
+  std::array<std::atomic<std::uint64_t>, 2> hits;
+  std::array<std::atomic<std::uint64_t>, 2> misses;
+
+  // xxHash64 in LLVM is one-shot, so each piece is hashed on its own and the key is the hash of those
+  class Hasher {
+  public:
+    void add(std::string_view data) noexcept {
+      add(llvm::xxHash64(llvm::StringRef{data.data(), data.size()}));
+    }
+
+    void add(std::uint64_t value) noexcept {
+      for (auto i = 0; i < 8; ++i) {
+        state_.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+      }
+    }
+
+    [[nodiscard]] std::uint64_t finish() const noexcept {
+      return llvm::xxHash64(state_);
+    }
+
+  private:
+    std::string state_;
+  };
+
+  // the path, size and modification time of the running compiler. a rebuilt compiler may
+  // generate different code for the same source, so it can't reuse any old entries
+  std::string compiler_identity() noexcept {
+    static const auto identity = [] {
+      static auto anchor = 0;
+      auto path = llvm::sys::fs::getMainExecutable("galliumc", &anchor);
+      auto status = llvm::sys::fs::file_status{};
+
+      if (path.empty() || llvm::sys::fs::status(path, status)) {
+        return std::string{};
+      }
+
+      auto modified = status.getLastModificationTime().time_since_epoch().count();
+
+      return absl::StrCat(path, "\n", status.getSize(), "\n", modified);
+    }();
+
+    return identity;
+  }
+
+  // a different profile means different inlining and layout decisions, so anything
+  // built with one is only reusable with exactly the same profile
+  std::uint64_t profile_identity() noexcept {
+    static const auto identity = []() -> std::uint64_t {
+      auto path = gal::flags().profile_use();
+
+      if (path.empty()) {
+        return 0;
+      }
+
+      auto buffer = llvm::MemoryBuffer::getFile(llvm::StringRef{path.data(), path.size()});
+
+      return buffer ? llvm::xxHash64((*buffer)->getBuffer()) : 0;
+    }();
+
+    return identity;
+  }
+
+  std::string cache_directory() noexcept {
+    if (!gal::flags().cache_dir().empty()) {
+      return std::string{gal::flags().cache_dir()};
+    }
+
+    auto dir = llvm::SmallString<128>{};
+
+    if (!llvm::sys::path::cache_directory(dir)) {
+      return "";
+    }
+
+    llvm::sys::path::append(dir, "gallium", "incremental");
+
+    return std::string{dir.str()};
+  }
+
+  std::string entry_path(std::uint64_t key) noexcept {
+    static const auto directory = cache_directory();
+
+    if (directory.empty()) {
+      return "";
+    }
+
+    auto path = llvm::SmallString<128>{llvm::StringRef{directory}};
+    llvm::sys::path::append(path, absl::StrCat(absl::Hex(key, absl::kZeroPad16), ".bc"));
+
+    return std::string{path.str()};
+  }
+
+  // a function's location only covers its prototype, the body is somewhere after it in the same file
+  std::string_view full_text(const ast::FnDeclaration& fn) noexcept {
+    auto& proto = fn.loc();
+    auto& body = fn.body().loc();
+    auto end = body.offset() + body.length();
+
+    if (body.file_id() != proto.file_id() || end < proto.offset()) {
+      return proto.raw_text();
+    }
+
+    return gal::sources().contents(proto.file_id()).substr(proto.offset(), end - proto.offset());
+  }
+
+  // every global that `fn` refers to, including ones hiding inside of constant expressions
+  std::vector<const llvm::GlobalValue*> referenced_globals(const llvm::Function& fn) noexcept {
+    auto globals = std::vector<const llvm::GlobalValue*>{};
+    auto seen = absl::flat_hash_set<const llvm::Value*>{};
+    auto worklist = std::vector<const llvm::Value*>{};
+
+    for (auto& inst : llvm::instructions(fn)) {
+      for (auto& operand : inst.operands()) {
+        worklist.push_back(operand.get());
+      }
+    }
+
+    while (!worklist.empty()) {
+      auto* value = worklist.back();
+      worklist.pop_back();
+
+      if (!seen.insert(value).second) {
+        continue;
+      }
+
+      if (auto* global = llvm::dyn_cast<llvm::GlobalValue>(value)) {
+        globals.push_back(global);
+
+        // module-local globals get copied, which means what their initializers refer to is needed too
+        if (auto* var = llvm::dyn_cast<llvm::GlobalVariable>(global); var != nullptr && var->hasLocalLinkage()) {
+          if (var->hasInitializer()) {
+            worklist.push_back(var->getInitializer());
+          }
+        }
+      } else if (auto* constant = llvm::dyn_cast<llvm::Constant>(value)) {
+        for (auto& operand : constant->operands()) {
+          worklist.push_back(operand.get());
+        }
+      }
+    }
+
+    return globals;
+  }
+
+  // the index that a use of the panic site table reads, if it's one of the shapes codegen emits:
+  // a GEP into the table with either a constant index or a phi of constant indices
+  llvm::Use* site_index(llvm::User* user) noexcept {
+    namespace pm = llvm::PatternMatch;
+
+    auto* gep = llvm::dyn_cast<llvm::GetElementPtrInst>(user);
+
+    if (gep == nullptr || gep->getNumIndices() != 2 || !pm::match(gep->getOperand(1), pm::m_Zero())) {
+      return nullptr;
+    }
+
+    auto* index = &gep->getOperandUse(2);
+
+    if (llvm::isa<llvm::ConstantInt>(index->get())) {
+      return index;
+    }
+
+    auto* phi = llvm::dyn_cast<llvm::PHINode>(index->get());
+
+    if (phi == nullptr || !phi->hasOneUse() || !llvm::all_of(phi->incoming_values(), [](llvm::Value* value) {
+          return llvm::isa<llvm::ConstantInt>(value);
+        })) {
+      return nullptr;
+    }
+
+    return index;
+  }
+
+  // a function only ever reports a handful of the file's panic sites, but it's extracted with
+  // the whole table. the sites it can reach are moved into a table of their own and renumbered,
+  // otherwise every cached function would carry a copy of every site in the file
+  void compact_panic_sites(llvm::Module* module) noexcept {
+    auto* table = module->getNamedGlobal("__gallium_panic_sites");
+    auto* entries = (table != nullptr) ? llvm::dyn_cast<llvm::ConstantArray>(table->getInitializer()) : nullptr;
+
+    if (entries == nullptr) {
+      return;
+    }
+
+    // codegen reads the table through a bitcast to `[0 x %__GalliumSourceInfo]*`
+    auto indices = std::vector<llvm::Use*>{};
+    auto users = std::vector<llvm::User*>(table->user_begin(), table->user_end());
+
+    while (!users.empty()) {
+      auto* user = users.back();
+      users.pop_back();
+
+      if (llvm::isa<llvm::ConstantExpr>(user) && llvm::cast<llvm::ConstantExpr>(user)->isCast()) {
+        users.insert(users.end(), user->user_begin(), user->user_end());
+      } else if (auto* index = site_index(user)) {
+        indices.push_back(index);
+      } else {
+        return;
+      }
+    }
+
+    auto used = std::vector<std::uint64_t>{};
+
+    for (auto* index : indices) {
+      if (auto* phi = llvm::dyn_cast<llvm::PHINode>(index->get())) {
+        for (auto& value : phi->incoming_values()) {
+          used.push_back(llvm::cast<llvm::ConstantInt>(value.get())->getZExtValue());
+        }
+      } else {
+        used.push_back(llvm::cast<llvm::ConstantInt>(index->get())->getZExtValue());
+      }
+    }
+
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+
+    if (used.size() == entries->getNumOperands() || (!used.empty() && used.back() >= entries->getNumOperands())) {
+      return;
+    }
+
+    auto renumber = [&used](llvm::Value* old) {
+      auto* constant = llvm::cast<llvm::ConstantInt>(old);
+      auto id = std::lower_bound(used.begin(), used.end(), constant->getZExtValue()) - used.begin();
+
+      return llvm::ConstantInt::get(constant->getType(), static_cast<std::uint64_t>(id));
+    };
+
+    for (auto* index : indices) {
+      if (auto* phi = llvm::dyn_cast<llvm::PHINode>(index->get())) {
+        for (auto i = 0u; i < phi->getNumIncomingValues(); ++i) {
+          phi->setIncomingValue(i, renumber(phi->getIncomingValue(i)));
+        }
+      } else {
+        index->set(renumber(index->get()));
+      }
+    }
+
+    auto kept = std::vector<llvm::Constant*>{};
+
+    for (auto id : used) {
+      kept.push_back(entries->getOperand(static_cast<unsigned>(id)));
+    }
+
+    auto* type = llvm::ArrayType::get(entries->getType()->getElementType(), kept.size());
+    auto* compacted = new llvm::GlobalVariable(*module,
+        type,
+        true,
+        table->getLinkage(),
+        llvm::ConstantArray::get(type, kept),
+        "");
+
+    compacted->copyAttributesFrom(table);
+    compacted->takeName(table);
+    table->replaceAllUsesWith(llvm::ConstantExpr::getBitCast(compacted, table->getType()));
+    table->eraseFromParent();
+
+    // string literals that only the dropped sites used are dead now
+    for (auto changed = true; changed;) {
+      changed = false;
+
+      for (auto it = module->global_begin(); it != module->global_end();) {
+        auto& global = *it++;
+
+        global.removeDeadConstantUsers();
+
+        if (global.hasLocalLinkage() && global.use_empty()) {
+          global.eraseFromParent();
+          changed = true;
+        }
+      }
+    }
+  }
+} // namespace
+
+namespace gal {
+  CacheKeys::CacheKeys(const ast::Program& program, const llvm::TargetMachine& machine) noexcept {
+    auto context = Hasher{};
+    auto files = absl::flat_hash_set<gal::FileID>{};
+
+    context.add(compiler_identity());
+    context.add(machine.getTargetTriple().str());
+    context.add(machine.getTargetCPU().str());
+    context.add(machine.getTargetFeatureString().str());
+    context.add(static_cast<std::uint64_t>(gal::flags().opt()));
+    context.add(static_cast<std::uint64_t>(gal::flags().lto()));
+    context.add(static_cast<std::uint64_t>(gal::flags().panic()));
+    context.add(static_cast<std::uint64_t>(gal::flags().profile_generate()));
+    context.add(profile_identity());
+    context.add(static_cast<std::uint64_t>(gal::flags().debug()));
+    context.add(static_cast<std::uint64_t>(gal::flags().no_checking()));
+    context.add(gal::flags().passes());
+
+    // imported structs and signatures change the code generated for anything using them
+    for (auto& module : program.imports()) {
+      context.add(gal::serialize_interface(*module));
+    }
+
+    for (auto& decl : program.decls()) {
+      auto& loc = decl->loc();
+
+      // builtins don't come from any file, but they're the same for every compile with the same compiler
+      if (loc.file_id() == 0) {
+        continue;
+      }
+
+      // panic messages include the path, so a file that moves can't share code with the old one
+      if (files.insert(loc.file_id()).second) {
+        context.add(gal::sources().path(loc.file_id()).string());
+      }
+
+      if (decl->is(ast::DeclType::fn_decl)) {
+        auto& fn = gal::as<ast::FnDeclaration>(*decl);
+
+        context.add(fn.loc().raw_text());
+        context.add(fn.mangled_name());
+      } else {
+        context.add(loc.raw_text());
+      }
+    }
+
+    context_ = context.finish();
+
+    // the file's key covers everything, so sort the files to get the same key no matter what order
+    // the declarations are in. the contents are hashed rather than the declarations since it's cheaper
+    auto sorted = std::vector<gal::FileID>(files.begin(), files.end());
+    auto file = Hasher{};
+
+    std::sort(sorted.begin(), sorted.end(), [](gal::FileID lhs, gal::FileID rhs) {
+      return gal::sources().path(lhs) < gal::sources().path(rhs);
+    });
+
+    file.add(context_);
+
+    for (auto id : sorted) {
+      file.add(gal::sources().contents(id));
+    }
+
+    file_ = file.finish();
+  }
+
+  std::optional<std::uint64_t> CacheKeys::fn(const ast::FnDeclaration& fn) const noexcept {
+    if (fn.loc().file_id() == 0) {
+      return std::nullopt;
+    }
+
+    auto key = Hasher{};
+
+    key.add(context_);
+    key.add(fn.mangled_name());
+    key.add(full_text(fn));
+    key.add(fn.loc().line());
+
+    return key.finish();
+  }
+
+  std::unique_ptr<llvm::Module> cache_load(CacheLevel level, std::uint64_t key, llvm::LLVMContext* context) noexcept {
+    auto index = static_cast<std::size_t>(level);
+    auto path = entry_path(key);
+    auto buffer = llvm::MemoryBuffer::getFile(path, false, false);
+
+    if (path.empty() || !buffer) {
+      misses[index].fetch_add(1, std::memory_order_relaxed);
+
+      return nullptr;
+    }
+
+    auto module = llvm::parseBitcodeFile((*buffer)->getMemBufferRef(), *context);
+
+    // a corrupt or truncated entry is treated like it isn't there, it'll get overwritten
+    if (!module) {
+      llvm::consumeError(module.takeError());
+      misses[index].fetch_add(1, std::memory_order_relaxed);
+
+      return nullptr;
+    }
+
+    hits[index].fetch_add(1, std::memory_order_relaxed);
+
+    return std::move(*module);
+  }
+
+  void cache_store(std::uint64_t key, const llvm::Module& module) noexcept {
+    auto path = entry_path(key);
+
+    if (path.empty() || llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path))) {
+      return;
+    }
+
+    auto fd = 0;
+    auto temp = llvm::SmallString<128>{};
+
+    // other threads (or other compiler processes) may be writing the same entry, so it's
+    // written somewhere unique first and then renamed into place all at once
+    if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%%%.tmp", fd, temp)) {
+      return;
+    }
+
+    {
+      auto os = llvm::raw_fd_ostream(fd, true);
+
+      llvm::WriteBitcodeToFile(module, os);
+
+      if (os.has_error()) {
+        os.clear_error();
+        (void)llvm::sys::fs::remove(temp);
+
+        return;
+      }
+    }
+
+    if (llvm::sys::fs::rename(temp, path)) {
+      (void)llvm::sys::fs::remove(temp);
+    }
+  }
+
+  std::unique_ptr<llvm::Module> extract_function(const llvm::Function& fn) noexcept {
+    auto& original = *fn.getParent();
+    auto module = std::make_unique<llvm::Module>(original.getModuleIdentifier(), original.getContext());
+    auto map = llvm::ValueToValueMapTy{};
+    auto copied = std::vector<std::pair<const llvm::GlobalVariable*, llvm::GlobalVariable*>>{};
+
+    module->setDataLayout(original.getDataLayout());
+    module->setTargetTriple(original.getTargetTriple());
+
+    for (auto* global : referenced_globals(fn)) {
+      if (auto* callee = llvm::dyn_cast<llvm::Function>(global)) {
+        auto* decl = llvm::Function::Create(callee->getFunctionType(),
+            llvm::GlobalValue::ExternalLinkage,
+            callee->getName(),
+            module.get());
+
+        decl->copyAttributesFrom(callee);
+        decl->setLinkage(llvm::GlobalValue::ExternalLinkage);
+        map[callee] = decl;
+      } else if (auto* var = llvm::dyn_cast<llvm::GlobalVariable>(global)) {
+        auto local = var->hasLocalLinkage();
+        auto* copy = new llvm::GlobalVariable(*module,
+            var->getValueType(),
+            var->isConstant(),
+            local ? var->getLinkage() : llvm::GlobalValue::ExternalLinkage,
+            nullptr,
+            var->getName());
+
+        copy->copyAttributesFrom(var);
+        copy->setLinkage(local ? var->getLinkage() : llvm::GlobalValue::ExternalLinkage);
+        map[var] = copy;
+
+        if (local && var->hasInitializer()) {
+          copied.emplace_back(var, copy);
+        }
+      }
+    }
+
+    // initializers can only be mapped once every global they could refer to exists
+    for (auto [from, to] : copied) {
+      to->setInitializer(llvm::MapValue(from->getInitializer(), map));
+    }
+
+    auto* copy = llvm::Function::Create(fn.getFunctionType(), fn.getLinkage(), fn.getName(), module.get());
+    auto returns = llvm::SmallVector<llvm::ReturnInst*, 8>{};
+
+    auto* arg = copy->arg_begin();
+
+    for (auto& original_arg : fn.args()) {
+      arg->setName(original_arg.getName());
+      map[&original_arg] = arg++;
+    }
+
+    llvm::CloneFunctionInto(copy, &fn, map, llvm::CloneFunctionChangeType::DifferentModule, returns);
+    compact_panic_sites(module.get());
+
+    return module;
+  }
+
+  void cache_statistics_print(std::ostream& os) noexcept {
+    auto print = [&os](std::string_view name, CacheLevel level) {
+      auto index = static_cast<std::size_t>(level);
+      auto hit = hits[index].load(std::memory_order_relaxed);
+      auto missed = misses[index].load(std::memory_order_relaxed);
+
+      os << "  " << name << ": " << hit << " hit, " << missed << " missed\n";
+    };
+
+    os << "===---------------------- incremental cache ----------------------===\n";
+    print("files    ", CacheLevel::file);
+    print("functions", CacheLevel::fn);
+    os << "===-------------------------------------------------------------===\n";
+  }
+} // namespace gal
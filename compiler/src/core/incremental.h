@@ -0,0 +1,96 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../ast/program.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+
+namespace gal {
+  /// What a cache entry holds
+  enum class CacheLevel {
+    /// The fully optimized module for an entire file
+    file,
+    /// The optimized code for a single function
+    fn,
+  };
+
+  /// Works out the keys that a program's code is cached under.
+  ///
+  /// Every key starts from a hash of everything that can change the code generated for
+  /// any function in the file: the compiler binary itself, the flags that affect codegen,
+  /// the target, every non-function declaration, every function's signature and the interface
+  /// of every imported module. Function
+  /// keys then add the function's own source text and the line it starts on (panic
+  /// messages have the line baked into them).
+  class CacheKeys {
+  public:
+    /// Hashes everything in `program` that isn't a function body
+    ///
+    /// \param program The program being compiled, after mangling
+    /// \param machine The machine that code is being generated for
+    explicit CacheKeys(const ast::Program& program, const llvm::TargetMachine& machine) noexcept;
+
+    /// Gets the key for the optimized module of the entire program
+    ///
+    /// \return The key for the file
+    [[nodiscard]] std::uint64_t file() const noexcept {
+      return file_;
+    }
+
+    /// Gets the key for a single function's code. Functions that don't come
+    /// from a source file (i.e. builtins) can't be cached on their own.
+    ///
+    /// \param fn The function to get the key for
+    /// \return The key for the function, if it has one
+    [[nodiscard]] std::optional<std::uint64_t> fn(const ast::FnDeclaration& fn) const noexcept;
+
+  private:
+    std::uint64_t context_;
+    std::uint64_t file_;
+  };
+
+  /// Reads a module from the incremental cache
+  ///
+  /// \param level What the entry holds, only used for the hit/miss statistics
+  /// \param key The key of the entry
+  /// \param context The context to load the module into
+  /// \return The cached module, or `nullptr` if there was no (readable) entry for `key`
+  [[nodiscard]] std::unique_ptr<llvm::Module> cache_load(CacheLevel level,
+      std::uint64_t key,
+      llvm::LLVMContext* context) noexcept;
+
+  /// Writes a module into the incremental cache. Failing to write is not an error,
+  /// the next compile just misses the cache.
+  ///
+  /// \param key The key to store the module under
+  /// \param module The module to store
+  void cache_store(std::uint64_t key, const llvm::Module& module) noexcept;
+
+  /// Copies a function into a new module by itself, with only declarations for the
+  /// other functions and globals it refers to. Any string literals (or other
+  /// module-local globals) it uses are copied along with it. The panic site table only
+  /// keeps the sites that `fn` can report, renumbered to match.
+  ///
+  /// \param fn The function to extract, must have a body
+  /// \return A module containing only `fn` and what it refers to
+  [[nodiscard]] std::unique_ptr<llvm::Module> extract_function(const llvm::Function& fn) noexcept;
+
+  /// Prints the number of cache hits and misses so far
+  ///
+  /// \param os The stream to print to
+  void cache_statistics_print(std::ostream& os) noexcept;
+} // namespace gal
@@ -0,0 +1,469 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+
+#include "./link.h"
+#include "../utility/flags.h"
+#include "../utility/log.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifdef _WIN64
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(GALLIUM_HAS_LLD) && !defined(_WIN64) && !defined(__APPLE__)
+#define GALLIUM_LINK_WITH_LLD 1
+#include "lld/Common/Driver.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <mutex>
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+  std::string path_to_runtime() noexcept {
+#ifdef _WIN64
+    auto buffer = std::string(MAX_PATH * 4, ' ');
+
+    GetModuleFileNameA(nullptr, buffer.data(), buffer.size());
+    absl::StripAsciiWhitespace(&buffer);
+    auto path = fs::path(buffer);
+
+    path.remove_filename();
+
+    return fs::absolute(path / "../../runtime").string();
+#else
+    return fs::absolute((fs::read_symlink("/proc/self/exe").remove_filename() / "../../runtime/")).string();
+#endif
+  }
+
+  // instrumented code needs LLVM's profile runtime, which only `$CC` knows where to find. this
+  // assumes `$CC` is clang, GCC's profiling runtime is a different (incompatible) one entirely
+  std::string_view profile_args() noexcept {
+    return gal::flags().profile_generate() ? " -fprofile-instr-generate" : "";
+  }
+
+  std::string system_link_command(std::string_view cc, std::string_view object, std::string_view output) noexcept {
+    return absl::StrCat(cc,
+        " ",
+        object,
+        " -o ",
+        output,
+        " -L",
+        path_to_runtime(),
+        " -lgallium_runtime",
+        profile_args(),
+        " ",
+        gal::flags().args());
+  }
+
+  bool link_with_system(absl::Span<const std::string_view> objects, std::string_view output) noexcept {
+    auto* cc = std::getenv("CC");
+
+    if (cc == nullptr) {
+      gal::errs() << "$CC must be set to a C++ compiler!";
+
+      return false;
+    }
+
+    auto paths = std::vector<std::string>{};
+    auto written = true;
+
+    for (auto i = std::size_t{0}; i < objects.size() && written; ++i) {
+      auto& path = paths.emplace_back(absl::StrCat(output, ".", i, ".o.tmp"));
+      auto file = std::ofstream(path, std::ios::binary);
+      file.write(objects[i].data(), static_cast<std::streamsize>(objects[i].size()));
+
+      if (!file) {
+        gal::errs() << "unable to write temporary object file '" << path << "'";
+
+        written = false;
+      }
+    }
+
+    // TODO: find better way of doing this
+    std::cout.flush();
+    auto status = written ? std::system(system_link_command(cc, absl::StrJoin(paths, " "), output).c_str()) : 1;
+
+    for (auto& path : paths) {
+      std::filesystem::remove(path);
+    }
+
+    return status == 0;
+  }
+
+#ifdef GALLIUM_LINK_WITH_LLD
+  // these stand in for the real paths while asking `$CC` what it would run
+  constexpr auto object_placeholder = std::string_view{"__gallium_object__.o"};
+  constexpr auto output_placeholder = std::string_view{"__gallium_output__"};
+
+  // lld keeps all of its state in globals, only one link can happen at a time
+  std::mutex lld_lock;
+
+  // splits a command line the way a POSIX shell would. `-###` only
+  // ever uses double quotes and backslashes, so that's all this handles
+  std::vector<std::string> split_command(std::string_view line) noexcept {
+    auto args = std::vector<std::string>{};
+    auto current = std::string{};
+    auto in_arg = false;
+    auto quoted = false;
+
+    for (auto i = std::size_t{0}; i < line.size(); ++i) {
+      auto c = line[i];
+
+      if (c == '\\' && i + 1 < line.size()) {
+        current += line[++i];
+        in_arg = true;
+      } else if (c == '"') {
+        quoted = !quoted;
+        in_arg = true;
+      } else if ((c == ' ' || c == '\t') && !quoted) {
+        if (in_arg) {
+          args.push_back(std::move(current));
+          current.clear();
+          in_arg = false;
+        }
+      } else {
+        current += c;
+        in_arg = true;
+      }
+    }
+
+    if (in_arg) {
+      args.push_back(std::move(current));
+    }
+
+    return args;
+  }
+
+  std::optional<std::string> run_and_capture(const std::string& command) noexcept {
+    auto* pipe = ::popen(command.c_str(), "r");
+
+    if (pipe == nullptr) {
+      return std::nullopt;
+    }
+
+    auto output = std::string{};
+    char buffer[4096];
+
+    while (auto read = std::fread(buffer, 1, sizeof buffer, pipe)) {
+      output.append(buffer, read);
+    }
+
+    return (::pclose(pipe) == 0) ? std::make_optional(std::move(output)) : std::nullopt;
+  }
+
+  // asks `$CC` to print (but not run) the command it would use to link, and
+  // then pulls the linker's arguments out of it. that way we get all the
+  // platform-specific stuff (crt files, libc, the dynamic linker) exactly right
+  std::optional<std::vector<std::string>> ask_cc_for_link_line(std::string_view cc) noexcept {
+    auto command = absl::StrCat(system_link_command(cc, object_placeholder, output_placeholder), " -### 2>&1");
+    auto output = run_and_capture(command);
+
+    if (!output) {
+      return std::nullopt;
+    }
+
+    // the driver prints every command it would run indented, linking is always the last one
+    auto line = std::optional<std::string_view>{};
+
+    for (auto candidate : absl::StrSplit(*output, '\n')) {
+      if (absl::StartsWith(candidate, " ")) {
+        line = candidate;
+      }
+    }
+
+    if (!line) {
+      return std::nullopt;
+    }
+
+    auto split = split_command(*line);
+    auto args = std::vector<std::string>{};
+
+    // the first argument is the linker (or gcc's collect2), lld takes its place
+    for (auto i = std::size_t{1}; i < split.size(); ++i) {
+      if (split[i] == "-plugin") {
+        ++i; // gcc's LTO plugin, which lld can't load
+      } else if (!absl::StartsWith(split[i], "-plugin-opt")) {
+        args.push_back(std::move(split[i]));
+      }
+    }
+
+    auto has = [&args](std::string_view arg) {
+      return std::find(args.begin(), args.end(), arg) != args.end();
+    };
+
+    return (has(object_placeholder) && has(output_placeholder)) ? std::make_optional(std::move(args)) : std::nullopt;
+  }
+
+  // everything that changes what `$CC` would link with
+  std::string link_key(std::string_view cc) noexcept {
+    return absl::StrCat(cc, "\n", path_to_runtime(), "\n", profile_args(), "\n", gal::flags().args());
+  }
+
+  std::string cache_file(std::string_view key) noexcept {
+    auto dir = llvm::SmallString<128>{};
+
+    if (!llvm::sys::path::cache_directory(dir)) {
+      return "";
+    }
+
+    llvm::sys::path::append(dir, "gallium", absl::StrCat("link-", absl::Hex(llvm::xxHash64(key)), ".txt"));
+
+    return std::string{dir.str()};
+  }
+
+  std::optional<std::vector<std::string>> read_cached(const std::string& path) noexcept {
+    auto file = std::ifstream(path);
+    auto args = std::vector<std::string>{};
+
+    if (!file.is_open()) {
+      return std::nullopt;
+    }
+
+    for (auto arg = std::string{}; std::getline(file, arg);) {
+      args.push_back(std::move(arg));
+    }
+
+    return args;
+  }
+
+  void write_cached(const std::string& path, const std::vector<std::string>& args) noexcept {
+    auto ec = llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path));
+
+    // the cache is only an optimization, if it can't be written we just ask `$CC` again next time
+    if (!ec) {
+      auto file = std::ofstream(path);
+
+      for (auto& arg : args) {
+        file << arg << '\n';
+      }
+    }
+  }
+
+  // the linker arguments for each key, only worked out once per process. a compile server can see
+  // a different `$CC` or different flags from one request to the next, so it can't just be one template
+  std::mutex templates_lock;
+  absl::flat_hash_map<std::string, std::optional<std::vector<std::string>>> templates;
+
+  // the linker arguments, with placeholders for the object and output
+  std::optional<std::vector<std::string>> link_template(std::string_view cc) noexcept {
+    auto key = link_key(cc);
+    auto guard = std::lock_guard{templates_lock};
+
+    if (auto it = templates.find(key); it != templates.end()) {
+      return it->second;
+    }
+
+    auto cache = cache_file(key);
+    auto args = read_cached(cache);
+
+    if (!args) {
+      args = ask_cc_for_link_line(cc);
+
+      if (args && !cache.empty()) {
+        write_cached(cache, *args);
+      }
+    }
+
+    templates.emplace(std::move(key), args);
+
+    return args;
+  }
+
+  // makes the next link with the same key ask `$CC` again
+  void forget_link_template(std::string_view cc) noexcept {
+    auto key = link_key(cc);
+    auto guard = std::lock_guard{templates_lock};
+
+    if (auto cache = cache_file(key); !cache.empty()) {
+      auto ec = std::error_code{};
+
+      std::filesystem::remove(cache, ec);
+    }
+
+    templates.erase(key);
+  }
+
+  // puts the object somewhere lld can read it from. on linux that's an anonymous
+  // in-memory file, everywhere else it needs to go to a real (temporary) file
+  class ObjectInput {
+  public:
+    explicit ObjectInput(std::string_view object, std::string_view output) noexcept {
+#ifdef __linux__
+      if (auto fd = ::memfd_create("gallium-object", MFD_CLOEXEC); fd >= 0) {
+        if (write_all(fd, object)) {
+          fd_ = fd;
+          path_ = absl::StrCat("/proc/self/fd/", fd);
+
+          return;
+        }
+
+        ::close(fd);
+      }
+#endif
+
+      auto path = absl::StrCat(output, ".o.tmp");
+      auto file = std::ofstream(path, std::ios::binary);
+      file.write(object.data(), static_cast<std::streamsize>(object.size()));
+
+      if (file) {
+        path_ = std::move(path);
+        remove_ = true;
+      }
+    }
+
+    ObjectInput(const ObjectInput&) = delete;
+
+    ObjectInput(ObjectInput&&) = delete;
+
+    ObjectInput& operator=(const ObjectInput&) = delete;
+
+    ObjectInput& operator=(ObjectInput&&) = delete;
+
+    ~ObjectInput() {
+      if (fd_ >= 0) {
+        ::close(fd_);
+      }
+
+      if (remove_) {
+        std::filesystem::remove(path_);
+      }
+    }
+
+    [[nodiscard]] const std::string& path() const noexcept {
+      return path_;
+    }
+
+  private:
+    [[maybe_unused]] static bool write_all(int fd, std::string_view data) noexcept {
+      while (!data.empty()) {
+        auto written = ::write(fd, data.data(), data.size());
+
+        if (written <= 0) {
+          return false;
+        }
+
+        data.remove_prefix(static_cast<std::size_t>(written));
+      }
+
+      return true;
+    }
+
+    std::string path_;
+    int fd_ = -1;
+    bool remove_ = false;
+  };
+
+  // gives back `std::nullopt` if lld couldn't be used at all, and `$CC` needs to be tried instead
+  std::optional<bool> link_with_lld(absl::Span<const std::string_view> objects, std::string_view output) noexcept {
+    auto* cc = std::getenv("CC");
+
+    if (cc == nullptr) {
+      return std::nullopt;
+    }
+
+    auto base = link_template(cc);
+    auto inputs = std::vector<std::unique_ptr<ObjectInput>>{};
+
+    for (auto i = std::size_t{0}; i < objects.size(); ++i) {
+      auto& input = inputs.emplace_back(std::make_unique<ObjectInput>(objects[i], absl::StrCat(output, ".", i)));
+
+      if (input->path().empty()) {
+        return std::nullopt;
+      }
+    }
+
+    if (!base) {
+      return std::nullopt;
+    }
+
+    auto args = std::vector<std::string>{"ld.lld"};
+
+    for (auto& arg : *base) {
+      if (arg == object_placeholder) {
+        for (auto& input : inputs) {
+          args.push_back(input->path());
+        }
+      } else if (arg == output_placeholder) {
+        args.emplace_back(output);
+      } else {
+        args.push_back(arg);
+      }
+    }
+
+    auto argv = std::vector<const char*>{};
+
+    for (auto& arg : args) {
+      argv.push_back(arg.c_str());
+    }
+
+    auto errors = std::string{};
+    auto error_stream = llvm::raw_string_ostream{errors};
+
+    {
+      auto guard = std::lock_guard{lld_lock};
+
+      if (lld::elf::link(argv, false, llvm::outs(), error_stream)) {
+        return true;
+      }
+    }
+
+    // most likely the cached command is stale (e.g. the system compiler was upgraded),
+    // `$CC` will either link successfully or give a better error than we could
+    forget_link_template(cc);
+
+    if (gal::flags().verbose()) {
+      gal::errs() << "built-in linker failed, falling back to $CC:\n" << error_stream.str();
+    }
+
+    return std::nullopt;
+  }
+#endif
+} // namespace
+
+namespace gal {
+  bool link_executable(absl::Span<const std::string_view> objects, std::string_view output) noexcept {
+#ifdef GALLIUM_LINK_WITH_LLD
+    if (!gal::flags().system_linker()) {
+      if (auto linked = link_with_lld(objects, output)) {
+        return *linked;
+      }
+    }
+#endif
+
+    return link_with_system(objects, output);
+  }
+} // namespace gal
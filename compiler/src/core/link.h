@@ -0,0 +1,29 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+
+#pragma once
+
+#include "absl/types/span.h"
+#include <string_view>
+
+namespace gal {
+  /// Links one or more object files against the Gallium runtime to produce an executable.
+  ///
+  /// When the compiler is built with lld, linking happens in-process. The command
+  /// line that `$CC` would have given the system linker is worked out once and
+  /// cached on disk, so no compiler driver needs to be spawned for every link.
+  /// If that isn't possible (or `--system_linker` is passed), `$CC` is run instead.
+  ///
+  /// \param objects The contents of every object file
+  /// \param output The path of the executable to produce
+  /// \return Whether or not linking succeeded
+  [[nodiscard]] bool link_executable(absl::Span<const std::string_view> objects, std::string_view output) noexcept;
+} // namespace gal
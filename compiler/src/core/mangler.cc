@@ -12,6 +12,7 @@
 #include "../ast/visitors.h"
 #include "../utility/misc.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
@@ -67,12 +68,7 @@ namespace {
 
       mangle(proto.return_type());
 
-      // TODO: fix dirty hack
-      if (builder_ == "_GF4mainNEl") {
-        Decl::return_value("__gallium_user_main");
-      } else {
-        Decl::return_value(std::move(builder_));
-      }
+      Decl::return_value(std::move(builder_));
     }
 
     void visit(const ast::StructDeclaration&) final {
@@ -229,6 +225,12 @@ namespace {
       assert(false);
     }
 
+    void visit(const ast::VectorType& type) final {
+      absl::StrAppend(&builder_, "V");
+      mangle(type.element_type());
+      absl::StrAppend(&builder_, type.lanes(), "_");
+    }
+
   private:
     void mangle(const ast::Type& type) noexcept {
       auto start_index = builder_.size(); // not `- 1` because chars havent been added yet
@@ -269,12 +271,21 @@ namespace {
 
   class MangleNode final : public ast::DeclarationVisitor<void> {
   public:
+    explicit MangleNode(const ast::Program& program) noexcept : program_{program} {}
+
     void visit(ast::ImportDeclaration*) final {}
 
     void visit(ast::ImportFromDeclaration*) final {}
 
     void visit(ast::FnDeclaration* declaration) final {
-      declaration->set_mangled(gal::mangle(*declaration));
+      auto mangled = Mangler().mangle_decl(*declaration);
+
+      // only the entry program's own `main` is the entry point, a `main` anywhere else is a normal function
+      if (program_.is_entry_point(*declaration) && absl::EndsWith(mangled, "F4mainNEl")) {
+        declaration->set_mangled("__gallium_user_main");
+      } else {
+        declaration->set_mangled(std::move(mangled));
+      }
     }
 
     void visit(ast::StructDeclaration*) final {}
@@ -298,6 +309,9 @@ namespace {
     void visit(ast::ConstantDeclaration* declaration) final {
       declaration->set_mangled(gal::mangle(*declaration));
     }
+
+  private:
+    const ast::Program& program_;
   };
 
   class Demangler final {
@@ -417,6 +431,11 @@ namespace {
           absl::StrAppend(&builder_, "; ", digits(), "]");
           ++pos_; // eat the _
           break;
+        case 'V':
+          type();
+          absl::StrAppend(&builder_, "x", digits());
+          ++pos_; // eat the _
+          break;
         case 'B':
           absl::StrAppend(&builder_, "[");
           type();
@@ -498,7 +517,10 @@ namespace {
 } // namespace
 
 std::string gal::mangle(const ast::Declaration& node) noexcept {
-  return Mangler().mangle_decl(node);
+  auto mangled = Mangler().mangle_decl(node);
+
+  // without a program to look at, only a root-level `fn main() -> i32` can be the entry point
+  return (mangled == "_GF4mainNEl") ? "__gallium_user_main" : mangled;
 }
 
 std::string gal::demangle(std::string_view mangled) noexcept {
@@ -508,7 +530,7 @@ std::string gal::demangle(std::string_view mangled) noexcept {
 
 void gal::mangle_program(ast::Program* program) noexcept {
   for (auto& decl : program->decls_mut()) {
-    auto mangler = MangleNode();
+    auto mangler = MangleNode(*program);
 
     decl->accept(&mangler);
   }
@@ -0,0 +1,783 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./module_interface.h"
+#include "../utility/flags.h"
+#include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ast = gal::ast;
+namespace fs = std::filesystem;
+
+namespace {
+  // bumped whenever the layout of an interface changes, old interfaces are then rejected
+  constexpr auto interface_version = std::uint32_t{1};
+  constexpr auto magic = std::string_view{"GALI"};
+
+  enum class EntryKind : std::uint8_t {
+    type_alias,
+    constant,
+    fn,
+  };
+
+  class Writer {
+  public:
+    explicit Writer(std::string_view module) noexcept : module_{module} {}
+
+    void u8(std::uint8_t value) noexcept {
+      out_.push_back(static_cast<char>(value));
+    }
+
+    void u32(std::uint32_t value) noexcept {
+      for (auto i = 0; i < 4; ++i) {
+        u8(static_cast<std::uint8_t>(value >> (i * 8)));
+      }
+    }
+
+    void u64(std::uint64_t value) noexcept {
+      for (auto i = 0; i < 8; ++i) {
+        u8(static_cast<std::uint8_t>(value >> (i * 8)));
+      }
+    }
+
+    void str(std::string_view value) noexcept {
+      u32(static_cast<std::uint32_t>(value.size()));
+      out_.append(value);
+    }
+
+    void type(const ast::Type& type) noexcept {
+      u8(static_cast<std::uint8_t>(type.type()));
+
+      switch (type.type()) {
+        case ast::TypeType::reference: {
+          auto& ref = gal::as<ast::ReferenceType>(type);
+
+          u8(ref.mut());
+          this->type(ref.referenced());
+          break;
+        }
+        case ast::TypeType::slice: {
+          auto& slice = gal::as<ast::SliceType>(type);
+
+          u8(slice.mut());
+          this->type(slice.sliced());
+          break;
+        }
+        case ast::TypeType::pointer: {
+          auto& ptr = gal::as<ast::PointerType>(type);
+
+          u8(ptr.mut());
+          this->type(ptr.pointed());
+          break;
+        }
+        case ast::TypeType::builtin_integral: {
+          auto& integral = gal::as<ast::BuiltinIntegralType>(type);
+
+          u8(integral.has_sign());
+          u64(static_cast<std::uint64_t>(integral.width()));
+          break;
+        }
+        case ast::TypeType::builtin_float: {
+          u8(static_cast<std::uint8_t>(gal::as<ast::BuiltinFloatType>(type).width()));
+          break;
+        }
+        case ast::TypeType::user_defined: {
+          auto& id = gal::as<ast::UserDefinedType>(type).id();
+
+          // structs from other modules are found through that module's interface
+          if (id.module_string() != module_) {
+            dependencies_.emplace(id.module_string());
+          }
+
+          str(id.module_string());
+          str(id.name());
+          break;
+        }
+        case ast::TypeType::fn_pointer: {
+          auto& fn = gal::as<ast::FnPointerType>(type);
+
+          u32(static_cast<std::uint32_t>(fn.args().size()));
+
+          for (auto& arg : fn.args()) {
+            this->type(*arg);
+          }
+
+          this->type(fn.return_type());
+          break;
+        }
+        case ast::TypeType::array: {
+          auto& array = gal::as<ast::ArrayType>(type);
+
+          u64(array.size());
+          this->type(array.element_type());
+          break;
+        }
+        case ast::TypeType::vector: {
+          auto& vector = gal::as<ast::VectorType>(type);
+
+          u64(vector.lanes());
+          this->type(vector.element_type());
+          break;
+        }
+        case ast::TypeType::builtin_bool:
+        case ast::TypeType::builtin_byte:
+        case ast::TypeType::builtin_char:
+        case ast::TypeType::builtin_void: break;
+        default: assert(false && "only resolved types can appear in a declaration"); break;
+      }
+    }
+
+    [[nodiscard]] const absl::btree_set<std::string>& dependencies() const noexcept {
+      return dependencies_;
+    }
+
+    [[nodiscard]] std::string take() noexcept {
+      return std::move(out_);
+    }
+
+  private:
+    std::string_view module_;
+    std::string out_;
+    absl::btree_set<std::string> dependencies_;
+  };
+
+  class Reader {
+  public:
+    explicit Reader(std::string_view data, std::string_view module, const ast::Program* importer) noexcept
+        : data_{data},
+          module_{module},
+          importer_{importer} {}
+
+    [[nodiscard]] std::uint8_t u8() noexcept {
+      if (pos_ >= data_.size()) {
+        failed_ = true;
+
+        return 0;
+      }
+
+      return static_cast<std::uint8_t>(data_[pos_++]);
+    }
+
+    [[nodiscard]] std::uint32_t u32() noexcept {
+      auto value = std::uint32_t{0};
+
+      for (auto i = 0; i < 4; ++i) {
+        value |= static_cast<std::uint32_t>(u8()) << (i * 8);
+      }
+
+      return value;
+    }
+
+    [[nodiscard]] std::uint64_t u64() noexcept {
+      auto value = std::uint64_t{0};
+
+      for (auto i = 0; i < 8; ++i) {
+        value |= static_cast<std::uint64_t>(u8()) << (i * 8);
+      }
+
+      return value;
+    }
+
+    [[nodiscard]] std::string str() noexcept {
+      auto size = u32();
+
+      if (failed_ || size > data_.size() - pos_) {
+        failed_ = true;
+
+        return "";
+      }
+
+      auto value = std::string{data_.substr(pos_, size)};
+      pos_ += size;
+
+      return value;
+    }
+
+    // counts are checked against what's left so that a corrupt count can't make us reserve gigabytes
+    [[nodiscard]] std::uint32_t count() noexcept {
+      auto value = u32();
+
+      if (value > data_.size() - std::min(pos_, data_.size())) {
+        failed_ = true;
+
+        return 0;
+      }
+
+      return value;
+    }
+
+    [[nodiscard]] std::unique_ptr<ast::Type> type() noexcept {
+      auto loc = ast::SourceLoc::nonexistent();
+      auto tag = u8();
+
+      // `u8` gives 0 at the end of the data, which is the tag for `&T`. without stopping here a truncated
+      // interface would keep reading references until the stack ran out. real types are nowhere near as deep
+      // as `max_type_depth`, but a corrupt file could still nest valid tags that deep
+      if (failed_ || depth_ >= max_type_depth) {
+        failed_ = true;
+
+        return std::make_unique<ast::VoidType>(loc);
+      }
+
+      auto nested = Nested{&depth_};
+
+      switch (static_cast<ast::TypeType>(tag)) {
+        case ast::TypeType::reference: {
+          auto mut = u8() != 0;
+
+          return std::make_unique<ast::ReferenceType>(loc, mut, type());
+        }
+        case ast::TypeType::slice: {
+          auto mut = u8() != 0;
+
+          return std::make_unique<ast::SliceType>(loc, mut, type());
+        }
+        case ast::TypeType::pointer: {
+          auto mut = u8() != 0;
+
+          return std::make_unique<ast::PointerType>(loc, mut, type());
+        }
+        case ast::TypeType::builtin_integral: {
+          auto has_sign = u8() != 0;
+          auto width = static_cast<ast::IntegerWidth>(u64());
+
+          return std::make_unique<ast::BuiltinIntegralType>(loc, has_sign, width);
+        }
+        case ast::TypeType::builtin_float: {
+          auto width = static_cast<ast::FloatWidth>(u8());
+
+          return std::make_unique<ast::BuiltinFloatType>(loc, width);
+        }
+        case ast::TypeType::user_defined: {
+          auto module = str();
+          auto name = str();
+
+          if (auto* decl = find_struct(module, name)) {
+            return std::make_unique<ast::UserDefinedType>(loc, decl, ast::FullyQualifiedID(module, name));
+          }
+
+          break;
+        }
+        case ast::TypeType::fn_pointer: {
+          auto args = std::vector<std::unique_ptr<ast::Type>>{};
+
+          for (auto i = count(); i > 0 && !failed_; --i) {
+            args.push_back(type());
+          }
+
+          auto return_type = type();
+
+          return std::make_unique<ast::FnPointerType>(loc, std::move(args), std::move(return_type));
+        }
+        case ast::TypeType::array: {
+          auto size = u64();
+
+          return std::make_unique<ast::ArrayType>(loc, size, type());
+        }
+        case ast::TypeType::vector: {
+          auto lanes = u64();
+
+          return std::make_unique<ast::VectorType>(loc, lanes, type());
+        }
+        case ast::TypeType::builtin_bool: return std::make_unique<ast::BuiltinBoolType>(loc);
+        case ast::TypeType::builtin_byte: return std::make_unique<ast::BuiltinByteType>(loc);
+        case ast::TypeType::builtin_char: return std::make_unique<ast::BuiltinCharType>(loc);
+        case ast::TypeType::builtin_void: return std::make_unique<ast::VoidType>(loc);
+        default: break;
+      }
+
+      // anything after this is garbage, but callers still need a type to put in the tree
+      failed_ = true;
+
+      return std::make_unique<ast::VoidType>(loc);
+    }
+
+    void add_struct(ast::StructDeclaration* decl) noexcept {
+      structs_.emplace(decl->name(), decl);
+    }
+
+    [[nodiscard]] bool failed() const noexcept {
+      return failed_;
+    }
+
+    [[nodiscard]] bool at_end() const noexcept {
+      return pos_ == data_.size();
+    }
+
+  private:
+    [[nodiscard]] ast::Declaration* find_struct(std::string_view module, std::string_view name) noexcept {
+      if (module == module_) {
+        auto it = structs_.find(name);
+
+        return (it != structs_.end()) ? it->second : nullptr;
+      }
+
+      for (auto& imported : importer_->imports()) {
+        if (imported->module_string() != module) {
+          continue;
+        }
+
+        for (auto& decl : imported->decls()) {
+          if (decl->is(ast::DeclType::struct_decl) && gal::as<ast::StructDeclaration>(*decl).name() == name) {
+            return decl.get();
+          }
+        }
+      }
+
+      return nullptr;
+    }
+
+    // counts how deep `type` is while it's reading the pieces of a type
+    class Nested {
+    public:
+      explicit Nested(std::size_t* depth) noexcept : depth_{depth} {
+        ++*depth_;
+      }
+
+      Nested(const Nested&) = delete;
+
+      Nested& operator=(const Nested&) = delete;
+
+      ~Nested() {
+        --*depth_;
+      }
+
+    private:
+      std::size_t* depth_;
+    };
+
+    static constexpr auto max_type_depth = std::size_t{256};
+
+    std::string_view data_;
+    std::size_t pos_ = 0;
+    std::size_t depth_ = 0;
+    std::string_view module_;
+    const ast::Program* importer_;
+    absl::flat_hash_map<std::string_view, ast::StructDeclaration*> structs_;
+    bool failed_ = false;
+  };
+
+  void write_proto(Writer* out, std::string_view symbol, const ast::FnPrototype& proto) noexcept {
+    out->u8(static_cast<std::uint8_t>(EntryKind::fn));
+    out->str(proto.name());
+    out->str(symbol);
+    out->u32(static_cast<std::uint32_t>(proto.args().size()));
+
+    for (auto& arg : proto.args()) {
+      out->str(arg.name());
+      out->type(arg.type());
+    }
+
+    out->type(proto.return_type());
+
+    auto attributes = std::vector<const ast::Attribute*>{};
+
+    // the importer only ever sees a declaration, and a declaration can't have `linkonce_odr` linkage
+    for (auto& attribute : proto.attributes()) {
+      if (attribute.type != ast::AttributeType::builtin_stdlib) {
+        attributes.push_back(&attribute);
+      }
+    }
+
+    out->u32(static_cast<std::uint32_t>(attributes.size()));
+
+    for (auto* attribute : attributes) {
+      out->u8(static_cast<std::uint8_t>(attribute->type));
+      out->u32(static_cast<std::uint32_t>(attribute->args.size()));
+
+      for (auto& arg : attribute->args) {
+        out->str(arg);
+      }
+    }
+  }
+
+  std::unique_ptr<ast::Declaration> read_proto(Reader* in) noexcept {
+    auto name = in->str();
+    auto symbol = in->str();
+    auto args = std::vector<ast::Argument>{};
+
+    for (auto i = in->count(); i > 0 && !in->failed(); --i) {
+      auto arg_name = in->str();
+
+      args.emplace_back(ast::SourceLoc::nonexistent(), std::move(arg_name), in->type());
+    }
+
+    auto return_type = in->type();
+    auto attributes = std::vector<ast::Attribute>{};
+
+    for (auto i = in->count(); i > 0 && !in->failed(); --i) {
+      auto attribute = ast::Attribute{static_cast<ast::AttributeType>(in->u8()), {}};
+
+      for (auto j = in->count(); j > 0 && !in->failed(); --j) {
+        attribute.args.push_back(in->str());
+      }
+
+      attributes.push_back(std::move(attribute));
+    }
+
+    auto proto =
+        ast::FnPrototype(std::move(name), std::nullopt, std::move(args), std::move(attributes), std::move(return_type));
+    auto fn = std::make_unique<ast::ExternalFnDeclaration>(ast::SourceLoc::nonexistent(), true, std::move(proto));
+
+    fn->set_mangled(std::move(symbol));
+
+    return fn;
+  }
+
+  void write_decl(Writer* out, const ast::Declaration& decl) noexcept {
+    switch (decl.type()) {
+      case ast::DeclType::fn_decl: {
+        auto& fn = gal::as<ast::FnDeclaration>(decl);
+
+        if (fn.exported()) {
+          write_proto(out, fn.mangled_name(), fn.proto());
+        }
+
+        break;
+      }
+      case ast::DeclType::external_decl: {
+        for (auto& external : gal::as<ast::ExternalDeclaration>(decl).externals()) {
+          write_decl(out, *external);
+        }
+
+        break;
+      }
+      case ast::DeclType::external_fn_decl: {
+        auto& fn = gal::as<ast::ExternalFnDeclaration>(decl);
+
+        if (fn.exported()) {
+          write_proto(out, fn.mangled_name(), fn.proto());
+        }
+
+        break;
+      }
+      case ast::DeclType::constant_decl: {
+        auto& constant = gal::as<ast::ConstantDeclaration>(decl);
+
+        if (constant.exported()) {
+          out->u8(static_cast<std::uint8_t>(EntryKind::constant));
+          out->str(constant.name());
+          out->str(constant.mangled_name());
+          out->type(constant.hint());
+        }
+
+        break;
+      }
+      case ast::DeclType::type_decl: {
+        auto& alias = gal::as<ast::TypeDeclaration>(decl);
+
+        if (alias.exported()) {
+          out->u8(static_cast<std::uint8_t>(EntryKind::type_alias));
+          out->str(alias.name());
+          out->type(alias.aliased());
+        }
+
+        break;
+      }
+      default: break;
+    }
+  }
+
+  [[nodiscard]] std::size_t entry_count(const ast::Declaration& decl) noexcept {
+    if (decl.is(ast::DeclType::external_decl)) {
+      auto count = std::size_t{0};
+
+      for (auto& external : gal::as<ast::ExternalDeclaration>(decl).externals()) {
+        count += entry_count(*external);
+      }
+
+      return count;
+    }
+
+    switch (decl.type()) {
+      case ast::DeclType::fn_decl:
+      case ast::DeclType::external_fn_decl:
+      case ast::DeclType::constant_decl:
+      case ast::DeclType::type_decl: return decl.exported() ? 1 : 0;
+      default: return 0;
+    }
+  }
+
+  std::variant<ast::Program*, gal::InterfaceError> load(ast::Program* program,
+      std::string_view module,
+      std::vector<std::string>* loading) noexcept {
+    for (auto& imported : program->imports()) {
+      if (imported->module_string() == module) {
+        return imported.get();
+      }
+    }
+
+    // an interface that (eventually) depends on itself can only be a stale one
+    if (std::find(loading->begin(), loading->end(), module) != loading->end()) {
+      return gal::InterfaceError::malformed;
+    }
+
+    if (gal::flags().module_dir().empty()) {
+      return gal::InterfaceError::not_found;
+    }
+
+    auto buffer = llvm::MemoryBuffer::getFile(gal::interface_path(module).string(), false, false);
+
+    if (!buffer) {
+      return gal::InterfaceError::not_found;
+    }
+
+    auto contents = std::string_view{(*buffer)->getBufferStart(), (*buffer)->getBufferSize()};
+    auto result = std::make_unique<ast::Program>(std::vector<std::unique_ptr<ast::Declaration>>{});
+    auto in = Reader{contents, module, program};
+
+    result->set_module(std::string{module});
+
+    if (contents.substr(0, magic.size()) != magic) {
+      return gal::InterfaceError::malformed;
+    }
+
+    for (auto i = std::size_t{0}; i < magic.size(); ++i) {
+      (void)in.u8();
+    }
+
+    if (in.u32() != interface_version || in.str() != module) {
+      return gal::InterfaceError::malformed;
+    }
+
+    // the types in this interface point at structs in the ones it depends on, so those go first
+    loading->emplace_back(module);
+
+    for (auto i = in.count(); i > 0 && !in.failed(); --i) {
+      auto loaded = load(program, in.str(), loading);
+
+      if (auto* error = std::get_if<gal::InterfaceError>(&loaded)) {
+        loading->pop_back();
+
+        return *error;
+      }
+    }
+
+    loading->pop_back();
+
+    // structs are created before any types are read, since fields can refer to other structs (or themselves)
+    auto structs = std::vector<ast::StructDeclaration*>{};
+
+    for (auto i = in.count(); i > 0 && !in.failed(); --i) {
+      auto name = in.str();
+      auto exported = in.u8() != 0;
+      auto field_count = in.count();
+      auto fields = std::vector<ast::Field>{};
+
+      fields.reserve(field_count);
+
+      for (auto j = field_count; j > 0 && !in.failed(); --j) {
+        auto field = in.str();
+
+        fields.emplace_back(ast::SourceLoc::nonexistent(), std::move(field), nullptr);
+      }
+
+      auto decl = std::make_unique<ast::StructDeclaration>(ast::SourceLoc::nonexistent(),
+          exported,
+          std::move(name),
+          std::move(fields));
+
+      structs.push_back(decl.get());
+      in.add_struct(decl.get());
+      result->add_decl(std::move(decl));
+    }
+
+    for (auto* decl : structs) {
+      for (auto& field : decl->fields_mut()) {
+        *field.type_owner() = in.type();
+      }
+    }
+
+    for (auto i = in.count(); i > 0 && !in.failed(); --i) {
+      switch (static_cast<EntryKind>(in.u8())) {
+        case EntryKind::type_alias: {
+          auto name = in.str();
+
+          result->add_decl(
+              std::make_unique<ast::TypeDeclaration>(ast::SourceLoc::nonexistent(), true, std::move(name), in.type()));
+          break;
+        }
+        case EntryKind::constant: {
+          auto name = in.str();
+          auto symbol = in.str();
+
+          // only the symbol is needed, the value itself lives in the module that defines it
+          auto constant = std::make_unique<ast::ConstantDeclaration>(ast::SourceLoc::nonexistent(),
+              true,
+              std::move(name),
+              in.type(),
+              nullptr);
+
+          constant->set_mangled(std::move(symbol));
+          result->add_decl(std::move(constant));
+          break;
+        }
+        case EntryKind::fn: result->add_decl(read_proto(&in)); break;
+        default: return gal::InterfaceError::malformed;
+      }
+    }
+
+    if (in.failed() || !in.at_end()) {
+      return gal::InterfaceError::malformed;
+    }
+
+    return program->add_import(std::move(result));
+  }
+} // namespace
+
+namespace gal {
+  std::string module_for(const fs::path& file) noexcept {
+    auto ec = std::error_code{};
+    auto cwd = fs::current_path(ec);
+    // `fs::relative` gives an empty path for a relative path to a file that doesn't exist, so this is lexical
+    auto relative = fs::absolute(file, ec).lexically_normal().lexically_relative(cwd);
+    auto parts = std::vector<std::string>{};
+
+    if (ec || relative.empty() || *relative.begin() == "..") {
+      parts.push_back(file.stem().string());
+    } else {
+      for (auto& part : relative.parent_path()) {
+        parts.push_back(part.string());
+      }
+
+      parts.push_back(relative.stem().string());
+    }
+
+    return absl::StrCat("::", absl::StrJoin(parts, "::"), "::");
+  }
+
+  fs::path interface_path(std::string_view module) noexcept {
+    auto path = fs::path(gal::flags().module_dir());
+
+    for (auto part : absl::StrSplit(module, "::", absl::SkipEmpty())) {
+      path /= std::string{part};
+    }
+
+    return path.replace_extension(".gali");
+  }
+
+  bool has_exports(const ast::Program& program) noexcept {
+    return std::any_of(program.decls().begin(), program.decls().end(), [](auto& decl) {
+      return entry_count(*decl) != 0;
+    });
+  }
+
+  std::string serialize_interface(const ast::Program& program) noexcept {
+    auto body = Writer{program.module_string()};
+    auto structs = std::vector<const ast::StructDeclaration*>{};
+    auto entries = std::size_t{0};
+
+    // every struct is written, an exported function can still take or return one that isn't exported
+    for (auto& decl : program.decls()) {
+      if (decl->is(ast::DeclType::struct_decl)) {
+        structs.push_back(&gal::as<ast::StructDeclaration>(*decl));
+      }
+
+      entries += entry_count(*decl);
+    }
+
+    body.u32(static_cast<std::uint32_t>(structs.size()));
+
+    for (auto* decl : structs) {
+      body.str(decl->name());
+      body.u8(decl->exported());
+      body.u32(static_cast<std::uint32_t>(decl->fields().size()));
+
+      for (auto& field : decl->fields()) {
+        body.str(field.name());
+      }
+    }
+
+    for (auto* decl : structs) {
+      for (auto& field : decl->fields()) {
+        body.type(field.type());
+      }
+    }
+
+    body.u32(static_cast<std::uint32_t>(entries));
+
+    for (auto& decl : program.decls()) {
+      write_decl(&body, *decl);
+    }
+
+    auto out = Writer{program.module_string()};
+
+    for (auto c : magic) {
+      out.u8(static_cast<std::uint8_t>(c));
+    }
+
+    out.u32(interface_version);
+    out.str(program.module_string());
+    out.u32(static_cast<std::uint32_t>(body.dependencies().size()));
+
+    for (auto& dependency : body.dependencies()) {
+      out.str(dependency);
+    }
+
+    return out.take() + body.take();
+  }
+
+  bool write_interface(const ast::Program& program) noexcept {
+    auto path = interface_path(program.module_string()).string();
+    auto contents = serialize_interface(program);
+
+    if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path))) {
+      return false;
+    }
+
+    auto fd = 0;
+    auto temp = llvm::SmallString<128>{};
+
+    // other compiler processes may be importing the module right now, so it's written
+    // somewhere unique first and then renamed into place all at once
+    if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%%%.tmp", fd, temp)) {
+      return false;
+    }
+
+    {
+      auto os = llvm::raw_fd_ostream(fd, true);
+
+      os << contents;
+
+      if (os.has_error()) {
+        os.clear_error();
+        (void)llvm::sys::fs::remove(temp);
+
+        return false;
+      }
+    }
+
+    if (llvm::sys::fs::rename(temp, path)) {
+      (void)llvm::sys::fs::remove(temp);
+
+      return false;
+    }
+
+    return true;
+  }
+
+  std::variant<ast::Program*, InterfaceError> load_interface(ast::Program* program, std::string_view module) noexcept {
+    auto loading = std::vector<std::string>{};
+
+    return load(program, module, &loading);
+  }
+} // namespace gal
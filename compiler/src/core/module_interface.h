@@ -0,0 +1,71 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../ast/program.h"
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace gal {
+  /// Why a module interface couldn't be loaded
+  enum class InterfaceError {
+    /// There's no interface for the module in the module directory
+    not_found,
+    /// The interface (or one it depends on) is corrupt or was written by a different compiler version
+    malformed,
+  };
+
+  /// Works out which module a source file is from its path relative to the current directory,
+  /// i.e. `foo/bar.gal` is `::foo::bar::`. Files outside of the current directory are named
+  /// after the file alone.
+  ///
+  /// \param file The path of the source file
+  /// \return The module, in the form that `FullyQualifiedID::module_string` uses
+  [[nodiscard]] std::string module_for(const std::filesystem::path& file) noexcept;
+
+  /// Gets the path that a module's interface is written to and read from, inside of `--module-dir`
+  ///
+  /// \param module The module, in the form that `FullyQualifiedID::module_string` uses
+  /// \return The path of the interface
+  [[nodiscard]] std::filesystem::path interface_path(std::string_view module) noexcept;
+
+  /// Checks whether a program declares anything that another module could import
+  ///
+  /// \param program The program to check
+  /// \return Whether or not anything is `export`ed
+  [[nodiscard]] bool has_exports(const ast::Program& program) noexcept;
+
+  /// Serializes the interface of a module: the prototype and symbol of every exported function,
+  /// the type and symbol of every exported constant, exported type aliases and the layout of
+  /// every struct. Nothing that would need a body to be re-checked is included.
+  ///
+  /// \param program The program to serialize, must be type-checked and mangled
+  /// \return The binary interface
+  [[nodiscard]] std::string serialize_interface(const ast::Program& program) noexcept;
+
+  /// Writes a program's interface to `interface_path(program.module_string())`. The file is
+  /// replaced all at once, so concurrent readers see either the old interface or the new one
+  ///
+  /// \param program The program to write the interface of, must be type-checked and mangled
+  /// \return Whether or not the interface was written
+  [[nodiscard]] bool write_interface(const ast::Program& program) noexcept;
+
+  /// Reads the interface for `module` (and every module that it depends on) into `program`'s
+  /// imports. Modules that `program` already imports are not read again.
+  ///
+  /// \param program The program that is importing the module
+  /// \param module The module to load, in the form that `FullyQualifiedID::module_string` uses
+  /// \return The imported module, or the reason it couldn't be loaded
+  [[nodiscard]] std::variant<ast::Program*, InterfaceError> load_interface(ast::Program* program,
+      std::string_view module) noexcept;
+} // namespace gal
@@ -14,7 +14,10 @@
 #include "../utility/misc.h"
 #include "../utility/pretty.h"
 #include "./environment.h"
+#include "./module_interface.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_split.h"
+#include <utility>
 
 namespace ast = gal::ast;
 
@@ -106,11 +109,13 @@ namespace {
   };
 
   template <typename Fn>
-  void walk_module_tree(gal::internal::ModuleTable* node, Fn f, std::string_view module = "::") noexcept {
-    f(module, &node->env);
+  void walk_module_tree(gal::internal::ModuleTable* node, Fn f) noexcept {
+    if (node->env != nullptr) {
+      f(node->module, node->env.get());
+    }
 
     for (auto& [key, value] : node->nested) {
-      walk_module_tree(value.get(), f, absl::StrCat(module, "::", key));
+      walk_module_tree(value.get(), f);
     }
   }
 
@@ -159,7 +164,12 @@ namespace gal {
   NameResolver::NameResolver(ast::Program* program, gal::DiagnosticReporter* diagnostics) noexcept
       : program_{program},
         env_{diagnostics},
-        root_{{}, GlobalEnvironment(program_, diagnostics)} {
+        root_{{}, nullptr, "::"},
+        current_{table_for(program_->module_string())} {
+    current_->env = std::make_unique<GlobalEnvironment>(program_, diagnostics);
+
+    resolve_imports(diagnostics);
+
     walk_module_tree(&root_, [this](std::string_view module_name, gal::GlobalEnvironment* env) {
       fully_qualified_.emplace(std::string{module_name}, env);
 
@@ -243,39 +253,151 @@ namespace gal {
 
   std::optional<std::pair<ast::FullyQualifiedID, gal::GlobalEnvironment*>> NameResolver::qualified_for(
       const ast::UnqualifiedID& id) noexcept {
+    auto* table = current_;
+
+    if (auto prefix = id.prefix()) {
+      table = find_table(**prefix);
+    } else if (!current_->env->contains_any(id.name())) {
+      // names from `import {...} from` can only be used if the module doesn't have its own
+      if (auto it = imported_names_.find(id.name()); it != imported_names_.end()) {
+        table = it->second;
+      }
+    }
+
+    if (table != nullptr && table->env != nullptr && visible(*table, id.name())) {
+      auto full_id = ast::FullyQualifiedID(table->module, id.name());
+
+      return std::pair{std::move(full_id), table->env.get()};
+    }
+
+    return std::nullopt;
+  }
+
+  void NameResolver::resolve_imports(gal::DiagnosticReporter* diagnostics) noexcept {
+    for (auto& decl : program_->decls()) {
+      if (decl->is(ast::DeclType::import_decl)) {
+        auto& import = gal::as<ast::ImportDeclaration>(*decl);
+
+        if (auto table = import_module(import, import.mod().module_string(), diagnostics)) {
+          auto alias = import.alias() ? std::string{*import.alias()} : import.mod().parts().back();
+
+          aliases_.insert_or_assign(std::move(alias), *table);
+        }
+      } else if (decl->is(ast::DeclType::import_from_decl)) {
+        auto& import = gal::as<ast::ImportFromDeclaration>(*decl);
+
+        for (auto& entity : import.imported_entities()) {
+          auto table = import_module(import, entity.module_string(), diagnostics);
+
+          if (!table) {
+            break;
+          }
+
+          if (!visible(**table, entity.name())) {
+            auto a = gal::point_out(import, gal::DiagnosticType::error, "imported here");
+            auto message = absl::StrCat("`", entity.name(), "` is not exported by `", (*table)->module, "`");
+            auto b = gal::single_message(std::move(message));
+
+            diagnostics->report_emplace(60, gal::into_list(std::move(a), std::move(b)));
+
+            continue;
+          }
+
+          imported_names_.insert_or_assign(std::string{entity.name()}, *table);
+        }
+      }
+    }
+  }
+
+  std::optional<internal::ModuleTable*> NameResolver::import_module(const ast::Declaration& decl,
+      std::string_view module,
+      gal::DiagnosticReporter* diagnostics) noexcept {
+    if (module == current_->module) {
+      return current_;
+    }
+
+    auto loaded = gal::load_interface(program_, module);
+
+    if (auto* error = std::get_if<gal::InterfaceError>(&loaded)) {
+      auto a = gal::point_out(decl, gal::DiagnosticType::error, "imported here");
+      auto b = gal::single_message(absl::StrCat("the interface for `", module, "` is `",
+          gal::interface_path(module).string(), "`"));
+
+      diagnostics->report_emplace((*error == gal::InterfaceError::not_found) ? 58 : 59,
+          gal::into_list(std::move(a), std::move(b)));
+
+      return std::nullopt;
+    }
+
+    // loading a module can load the modules it depends on too, every one of them goes in the tree
+    for (auto& imported : program_->imports()) {
+      auto* table = table_for(imported->module_string());
+
+      if (table->env == nullptr) {
+        table->env = std::make_unique<GlobalEnvironment>(imported.get(), diagnostics);
+      }
+    }
+
+    return table_for(std::get<ast::Program*>(loaded)->module_string());
+  }
+
+  internal::ModuleTable* NameResolver::table_for(std::string_view module) noexcept {
     auto* table = &root_;
-    auto s = std::string{"::"};
 
-    // TODO: possibly build a string version of the module name
-    // TODO: and use that instead of a tree search?
-    // TODO:
-    // TODO: current module / imported modules could add "aliases"
-    // TODO: and then current module name / the imported module could be
-    // TODO: filled in for the alias to com
+    for (auto part : absl::StrSplit(module, "::", absl::SkipEmpty())) {
+      auto& next = table->nested[part];
 
-    if (auto prefix = id.prefix()) {
-      auto& mod = **prefix;
+      if (next == nullptr) {
+        next = std::make_unique<internal::ModuleTable>();
+        next->module = absl::StrCat(table->module, part, "::");
+      }
 
-      if (!mod.parts().empty()) {
-        assert(false);
+      table = next.get();
+    }
+
+    return table;
+  }
+
+  internal::ModuleTable* NameResolver::find_table(const ast::ModuleID& module) noexcept {
+    auto parts = module.parts();
+    auto it = parts.begin();
+    auto* table = &root_;
+
+    // `::foo` has always meant "`foo` in this module"
+    if (parts.empty()) {
+      return current_;
+    }
+
+    if (!module.from_root()) {
+      if (auto alias = aliases_.find(*it); alias != aliases_.end()) {
+        table = alias->second;
+        ++it;
       }
+    }
+
+    for (; it != parts.end(); ++it) {
+      auto next = table->nested.find(*it);
 
-      // TODO: walk down the tree by each part in `mod.parts()`
-      // TODO: modify `table` so it ends up being the right table to check
-      assert(mod.from_root());
-    } else {
-      // TODO: find the actual table that models the current module
-      // TODO: right now that's always the root since there's only ever one module
+      if (next == table->nested.end()) {
+        return nullptr;
+      }
 
-      // TODO: set that current module table to `table`
+      table = next->second.get();
     }
 
-    if (table->env.contains_any(id.name())) {
-      auto full_id = ast::FullyQualifiedID(s, id.name());
+    return table;
+  }
 
-      return std::pair{std::move(full_id), &table->env};
+  bool NameResolver::visible(const internal::ModuleTable& table, std::string_view name) const noexcept {
+    if (&table == current_) {
+      return table.env->contains_any(name);
     }
 
-    return std::nullopt;
+    // every function in an interface is exported, but structs are there even when they aren't
+    if (auto entity = std::as_const(*table.env).entity(name)) {
+      return (*entity)->decl().exported();
+    }
+
+    return std::as_const(*table.env).overloads(name).has_value();
   }
-} // namespace gal
\ No newline at end of file
+} // namespace gal
@@ -21,13 +21,18 @@ namespace gal {
   namespace internal {
     struct ModuleTable final {
       absl::flat_hash_map<std::string, std::unique_ptr<ModuleTable>> nested;
-      gal::GlobalEnvironment env;
+      std::unique_ptr<gal::GlobalEnvironment> env; // null for modules that only exist to hold others
+      std::string module;                          // i.e `::foo::bar::`
     };
   } // namespace internal
 
   /// Handles resolving symbol names for locals, functions, and
   /// any global/imported symbol names.
   ///
+  /// Imported modules are read from their interfaces (see `gal::load_interface`) and put
+  /// into a tree of modules alongside the program's own. Only exported entities in an
+  /// imported module can be named.
+  ///
   /// Will modify the AST and replace nodes with qualified nodes
   /// where possible
   class NameResolver final {
@@ -105,9 +110,24 @@ namespace gal {
         const ast::UnqualifiedID& id) noexcept;
 
   private:
+    void resolve_imports(DiagnosticReporter* diagnostics) noexcept;
+
+    [[nodiscard]] std::optional<internal::ModuleTable*> import_module(const ast::Declaration& decl,
+        std::string_view module,
+        DiagnosticReporter* diagnostics) noexcept;
+
+    [[nodiscard]] internal::ModuleTable* table_for(std::string_view module) noexcept;
+
+    [[nodiscard]] internal::ModuleTable* find_table(const ast::ModuleID& module) noexcept;
+
+    [[nodiscard]] bool visible(const internal::ModuleTable& table, std::string_view name) const noexcept;
+
     ast::Program* program_;
     gal::Environment env_;
     internal::ModuleTable root_; // the global envs in the hashmap are still owned by the tree at `root_`
+    internal::ModuleTable* current_;
+    absl::flat_hash_map<std::string, internal::ModuleTable*> aliases_;        // `import foo::bar` => `bar::`
+    absl::flat_hash_map<std::string, internal::ModuleTable*> imported_names_; // `import {x} from foo` => `x`
     absl::flat_hash_map<std::string, gal::GlobalEnvironment*> fully_qualified_;
   };
 } // namespace gal
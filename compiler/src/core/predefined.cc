@@ -11,9 +11,12 @@
 #include "./predefined.h"
 #include "../ast/program.h"
 #include "absl/strings/match.h"
+#include "absl/strings/strip.h"
+#include <cassert>
 #include <memory>
 #include <optional>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace ast = gal::ast;
@@ -452,3 +455,74 @@ std::optional<std::unique_ptr<ast::Type>> gal::check_builtin(std::string_view na
   // TODO
   return {};
 }
+
+std::optional<gal::SIMDBuiltin> gal::simd_builtin(std::string_view name) noexcept {
+  if (!absl::ConsumePrefix(&name, "__builtin_simd_")) {
+    return std::nullopt;
+  }
+
+  static constexpr std::pair<std::string_view, SIMDBuiltin> builtins[] = {
+      {"extract", SIMDBuiltin::extract},
+      {"insert", SIMDBuiltin::insert},
+      {"shuffle", SIMDBuiltin::shuffle},
+      {"select", SIMDBuiltin::select},
+      {"sum", SIMDBuiltin::sum},
+      {"min", SIMDBuiltin::min},
+      {"max", SIMDBuiltin::max},
+      {"any", SIMDBuiltin::any},
+      {"all", SIMDBuiltin::all},
+      {"store", SIMDBuiltin::store},
+  };
+
+  for (auto [spelling, builtin] : builtins) {
+    if (name == spelling) {
+      return builtin;
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::size_t gal::simd_builtin_arity(SIMDBuiltin builtin) noexcept {
+  switch (builtin) {
+    case SIMDBuiltin::sum:
+    case SIMDBuiltin::min:
+    case SIMDBuiltin::max:
+    case SIMDBuiltin::any:
+    case SIMDBuiltin::all: return 1;
+    case SIMDBuiltin::extract:
+    case SIMDBuiltin::store: return 2;
+    case SIMDBuiltin::insert:
+    case SIMDBuiltin::shuffle:
+    case SIMDBuiltin::select: return 3;
+  }
+
+  assert(false);
+
+  return 0;
+}
+
+std::optional<std::vector<std::uint64_t>> gal::simd_shuffle_mask(const ast::Expression& mask) noexcept {
+  if (!mask.is(ast::ExprType::array)) {
+    return std::nullopt;
+  }
+
+  auto lanes = std::vector<std::uint64_t>{};
+
+  for (auto& element : gal::as<ast::ArrayExpression>(mask).elements()) {
+    auto* lane = static_cast<const ast::Expression*>(element.get());
+
+    // the literals have already been converted to `i64` by the type checker
+    if (lane->is(ast::ExprType::implicit)) {
+      lane = &gal::as<ast::ImplicitConversionExpression>(*lane).expr();
+    }
+
+    if (!lane->is(ast::ExprType::integer_lit)) {
+      return std::nullopt;
+    }
+
+    lanes.push_back(gal::as<ast::IntegerLiteralExpression>(*lane).value());
+  }
+
+  return lanes;
+}
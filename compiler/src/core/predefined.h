@@ -12,7 +12,11 @@
 
 #include "../ast/program.h"
 #include "absl/types/span.h"
+#include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <string_view>
+#include <vector>
 
 namespace gal {
   /// Registers any Gallium builtin functions and `__builtin`s in the AST
@@ -22,4 +26,39 @@ namespace gal {
   /// the call is valid, otherwise returns a nullopt
   std::optional<std::unique_ptr<ast::Type>> check_builtin(std::string_view name,
       absl::Span<const std::unique_ptr<ast::Expression>> args) noexcept;
+
+  /// The `__builtin_simd_*` operations on vector types. These are generic over
+  /// every vector type, so they can't be injected as normal external declarations
+  /// and are instead checked and generated directly by name
+  enum class SIMDBuiltin {
+    extract, // __builtin_simd_extract(v: TxN, lane: isize) -> T
+    insert,  // __builtin_simd_insert(v: TxN, lane: isize, x: T) -> TxN
+    shuffle, // __builtin_simd_shuffle(a: TxN, b: TxN, [constant lanes...]) -> TxM
+    select,  // __builtin_simd_select(mask: boolxN, a: TxN, b: TxN) -> TxN
+    sum,     // __builtin_simd_sum(v: TxN) -> T
+    min,     // __builtin_simd_min(v: TxN) -> T
+    max,     // __builtin_simd_max(v: TxN) -> T
+    any,     // __builtin_simd_any(mask: boolxN) -> bool
+    all,     // __builtin_simd_all(mask: boolxN) -> bool
+    store,   // __builtin_simd_store(dest: [mut T], v: TxN) -> void
+  };
+
+  /// Maps the name of a `__builtin_simd_*` function to the operation it performs
+  ///
+  /// \param name The name of the function being called
+  /// \return The operation, or an empty optional if it isn't a SIMD builtin
+  [[nodiscard]] std::optional<SIMDBuiltin> simd_builtin(std::string_view name) noexcept;
+
+  /// Gets the number of arguments a SIMD builtin takes
+  ///
+  /// \param builtin The builtin to get the arity of
+  /// \return The number of arguments
+  [[nodiscard]] std::size_t simd_builtin_arity(SIMDBuiltin builtin) noexcept;
+
+  /// Reads the lane indices out of the mask given to `__builtin_simd_shuffle`,
+  /// which must be an array literal made entirely of integer literals
+  ///
+  /// \param mask The (already type-checked) mask argument
+  /// \return The lane indices, or an empty optional if `mask` isn't a constant
+  [[nodiscard]] std::optional<std::vector<std::uint64_t>> simd_shuffle_mask(const ast::Expression& mask) noexcept;
 } // namespace gal
\ No newline at end of file
@@ -0,0 +1,136 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./session.h"
+#include "../errors/buffered_reporter.h"
+#include "../syntax/parser.h"
+#include "../utility/arena.h"
+#include "../utility/source_manager.h"
+#include "./codegen.h"
+#include "./emit.h"
+#include "./mangler.h"
+#include "./type_checker.h"
+#include "absl/strings/str_cat.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Target/TargetMachine.h"
+
+namespace {
+  bool compile_file(gal::FileID file,
+      const gal::CompilerConfig& config,
+      llvm::TargetMachine* machine,
+      gal::DiagnosticReporter* reporter,
+      std::string* out) noexcept {
+    auto program = gal::parse(file, reporter, config.parser());
+
+    if (!program) {
+      return false;
+    }
+
+    auto scope = gal::ArenaScope{program->arena()};
+
+    if (!gal::type_check(&*program, *machine, reporter)) {
+      return false;
+    }
+
+    gal::mangle_program(&*program);
+
+    // every compile gets a fresh context, a shared one would keep every type and constant that
+    // was ever created alive and start renaming structs to avoid clashing with earlier compiles
+    auto context = llvm::LLVMContext{};
+    auto module = gal::codegen(&context, machine, *program);
+
+    return gal::emit_to_memory(module.get(), machine, config.emit(), out);
+  }
+} // namespace
+
+namespace gal {
+  std::variant<std::unique_ptr<CompilerSession>, std::string> CompilerSession::create(SessionOptions options) noexcept {
+    switch (options.emit) {
+      case OutputFormat::llvm_ir:
+      case OutputFormat::llvm_bc:
+      case OutputFormat::assembly:
+      case OutputFormat::object_code: break;
+      default: return "a session can only emit LLVM IR, LLVM bitcode, assembly or object code";
+    }
+
+    gal::initialize_targets();
+
+    auto triple = options.triple.empty() ? llvm::sys::getDefaultTargetTriple() : options.triple;
+    auto err = std::string{};
+    auto* target = llvm::TargetRegistry::lookupTarget(triple, err);
+
+    if (target == nullptr) {
+      return absl::StrCat("unable to select LLVM triple '", triple, "': ", err);
+    }
+
+    auto machine = std::unique_ptr<llvm::TargetMachine>(
+        target->createTargetMachine(triple, "generic", "", llvm::TargetOptions{}, {}));
+
+    // nothing that would touch the disk (incremental caching, time traces, module interfaces, profiles) is ever enabled
+    auto config = CompilerConfig("",
+        1,
+        options.opt,
+        options.emit,
+        options.parser,
+        LTOKind::none,
+        options.panic,
+        options.debug,
+        false,
+        options.colored,
+        false,
+        options.no_checking,
+        false,
+        false,
+        false,
+        false,
+        false,
+        false,
+        "",
+        "",
+        "",
+        "",
+        "");
+
+    return std::unique_ptr<CompilerSession>(
+        new CompilerSession(std::move(config), std::move(machine)));
+  }
+
+  CompilerSession::CompilerSession(CompilerConfig config, std::unique_ptr<llvm::TargetMachine> machine) noexcept
+      : config_{std::move(config)},
+        machine_{std::move(machine)} {}
+
+  CompilerSession::~CompilerSession() = default;
+
+  CompileResult CompilerSession::compile(std::string_view source, std::string_view name) noexcept {
+    auto scope = gal::ConfigScope{&config_};
+    auto file = gal::sources().add(std::string{name}, std::string{source});
+    auto reporter = gal::BufferedReporter{gal::sources().contents(file)};
+    auto result = CompileResult{};
+
+    result.succeeded = compile_file(file, config_, machine_.get(), &reporter, &result.output);
+
+    // diagnostics refer to the file, so they need to be rendered before it goes away
+    for (auto& diagnostic : reporter.diagnostics()) {
+      result.diagnostics.push_back(diagnostic.build(reporter.source()));
+    }
+
+    result.succeeded = result.succeeded && !reporter.had_error();
+
+    if (!result.succeeded) {
+      result.output.clear();
+    }
+
+    gal::sources().release(file);
+
+    return result;
+  }
+} // namespace gal
@@ -0,0 +1,97 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../utility/flags.h"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace llvm {
+  class TargetMachine;
+} // namespace llvm
+
+namespace gal {
+  /// The options for a `CompilerSession`, these take the place of the command-line flags
+  struct SessionOptions {
+    /// The optimization level to compile at
+    OptLevel opt = OptLevel::none;
+    /// The format to produce, must be one of IR, bitcode, assembly or object code
+    OutputFormat emit = OutputFormat::object_code;
+    /// The parser to parse source code with
+    ParserKind parser = ParserKind::antlr;
+    /// Whether or not to generate debug information
+    bool debug = false;
+    /// Whether or not to leave out panic-generating checks
+    bool no_checking = false;
+    /// What a failed check does
+    PanicMode panic = PanicMode::report;
+    /// Whether or not to put ANSI color codes into diagnostics
+    bool colored = false;
+    /// The target triple to compile for, empty means the host
+    std::string triple;
+  };
+
+  /// The result of compiling a single buffer of source code
+  struct CompileResult {
+    /// Whether or not compilation succeeded
+    bool succeeded = false;
+    /// Every diagnostic that was reported, rendered the same way `gallium` would print them
+    std::vector<std::string> diagnostics;
+    /// The generated code in the format that was asked for, only meaningful when `succeeded` is true
+    std::string output;
+  };
+
+  /// Compiles source code that's held in memory into code that's held in memory, without ever
+  /// touching the filesystem or the command-line configuration.
+  ///
+  /// A session owns its own target machine, so it can only be used by one thread at a time.
+  /// Separate sessions are completely independent and can be used concurrently.
+  class CompilerSession {
+  public:
+    /// Creates a session
+    ///
+    /// \param options The options to compile with
+    /// \return A session, or an explanation of why the options can't be used
+    [[nodiscard]] static std::variant<std::unique_ptr<CompilerSession>, std::string> create(
+        SessionOptions options) noexcept;
+
+    /// CompilerSession is not copyable
+    CompilerSession(const CompilerSession&) = delete;
+
+    /// CompilerSession is not movable, the config is referred to by address while compiling
+    CompilerSession(CompilerSession&&) = delete;
+
+    /// CompilerSession is not copy-assignable
+    CompilerSession& operator=(const CompilerSession&) = delete;
+
+    /// CompilerSession is not move-assignable
+    CompilerSession& operator=(CompilerSession&&) = delete;
+
+    /// Destroys the session and everything LLVM-related that it owns
+    ~CompilerSession();
+
+    /// Compiles a buffer of source code as if it were an entire file
+    ///
+    /// \param source The source code to compile
+    /// \param name The name to give the file in diagnostics
+    /// \return The generated code and any diagnostics
+    [[nodiscard]] CompileResult compile(std::string_view source, std::string_view name = "<memory>") noexcept;
+
+  private:
+    explicit CompilerSession(CompilerConfig config, std::unique_ptr<llvm::TargetMachine> machine) noexcept;
+
+    CompilerConfig config_;
+    std::unique_ptr<llvm::TargetMachine> machine_;
+  };
+} // namespace gal
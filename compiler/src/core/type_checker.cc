@@ -11,6 +11,7 @@
 #include "./type_checker.h"
 #include "../ast/visitors.h"
 #include "../errors/reporter.h"
+#include "../syntax/lexer.h"
 #include "../utility/flags.h"
 #include "../utility/pretty.h"
 #include "./environment.h"
@@ -18,6 +19,7 @@
 #include "./predefined.h"
 #include "absl/container/flat_hash_map.h"
 #include "llvm/Target/TargetMachine.h"
+#include <limits>
 #include <stack>
 #include <vector>
 
@@ -130,7 +132,7 @@ namespace {
       visit_children(decl);
       resolver_.leave_scope();
 
-      if (decl->id().as_string() == "::main") {
+      if (program_->is_entry_point(*decl)) {
         if (!expected_->is(TT::builtin_integral)
             || ast::width_of(gal::as<ast::BuiltinIntegralType>(*expected_).width()) != 32) {
           auto a = gal::point_out(*decl, gal::DiagnosticType::error);
@@ -414,6 +416,10 @@ namespace {
       if (expr->callee().is(ET::identifier_local)) {
         auto& id = gal::as<ast::LocalIdentifierExpression>(expr->callee());
 
+        if (auto builtin = gal::simd_builtin(id.name())) {
+          return check_simd_builtin(expr, *builtin);
+        }
+
         if (auto type = gal::check_builtin(id.name(), expr->args())) {
           return update_return(expr, std::move(*type));
         }
@@ -433,6 +439,7 @@ namespace {
         if (auto overloads = resolver_.overloads(identifier.id())) {
           if (auto overload = select_overload(*expr, **overloads, expr->args_mut())) {
             *self = ast::StaticCallExpression::from_call(identifier.id(), **overload, expr);
+            check_exclusive_args(gal::as<ast::StaticCallExpression>(**self), (*overload)->proto());
 
             return update_return(self->get(), (*overload)->proto().return_type().clone());
           } else {
@@ -461,6 +468,7 @@ namespace {
             if (auto overloads = resolver_.overloads(id)) {
               if (auto overload = select_overload(*expr, **overloads, expr->args_mut())) {
                 *self = ast::StaticCallExpression::from_call(id, **overload, expr);
+                check_exclusive_args(gal::as<ast::StaticCallExpression>(**self), (*overload)->proto());
 
                 return update_return(self->get(), (*overload)->proto().return_type().clone());
               }
@@ -469,6 +477,8 @@ namespace {
             assert(false);
           }
 
+          check_exclusive_args(expr->args());
+
           return update_return(self->get(), fn_ptr_type.return_type().clone());
         }
 
@@ -617,7 +627,18 @@ namespace {
     void visit(ast::UnaryExpression* expr) final {
       visit_children(expr);
 
-      convert_intermediate(expr->expr_owner());
+      // `&arr[i]` and `&mut obj.field` take the address of the element / field, not of a loaded copy
+      auto borrows = expr->op() == ast::UnaryOp::ref_to || expr->op() == ast::UnaryOp::mut_ref_to;
+
+      if (!borrows || !expr->expr().result().is(TT::indirection)) {
+        convert_intermediate(expr->expr_owner());
+      }
+
+      // `&v` and `&mut v` don't care what `v` is
+      if (expr->expr().result().is(TT::vector) && expr->op() != ast::UnaryOp::ref_to
+          && expr->op() != ast::UnaryOp::mut_ref_to) {
+        return check_vector_unary(expr);
+      }
 
       switch (expr->op()) {
         case ast::UnaryOp::logical_not: {
@@ -691,7 +712,9 @@ namespace {
             return update_return(expr, error_type());
           }
 
-          auto type = expr->expr().result().clone();
+          auto& operand = expr->expr().result();
+          auto type = operand.is(TT::indirection) ? gal::as<ast::IndirectionType>(operand).produced().clone()
+                                                  : operand.clone();
           auto op = expr->op();
           replace_self(std::make_unique<ast::AddressOfExpression>(expr->loc(), std::move(*expr->expr_owner())));
           auto* self = self_expr();
@@ -760,6 +783,11 @@ namespace {
     void visit(ast::BinaryExpression* expr) final {
       visit_children(expr);
 
+      // plain assignment works the same for vectors as it does for everything else
+      if (expr->op() != ast::BinaryOp::assignment && (vector_operand(expr->lhs()) || vector_operand(expr->rhs()))) {
+        return check_vector_binary(expr);
+      }
+
       switch (expr->op()) {
         case ast::BinaryOp::mul:
         case ast::BinaryOp::div:
@@ -865,22 +893,7 @@ namespace {
         }
         case ast::BinaryOp::assignment: {
           convert_intermediate(expr->rhs_owner());
-
-          if (!lvalue(expr->lhs())) {
-            auto a = gal::point_out_list(type_was_err(expr->lhs()));
-            auto b =
-                gal::single_message("lvalues are identifiers, and the result of `*expr` on pointers and references");
-
-            diagnostics_->report_emplace(42, gal::into_list(std::move(a), std::move(b)));
-          }
-
-          if (!mut(expr->lhs())) {
-            auto a =
-                gal::point_out(expr->lhs(), gal::DiagnosticType::error, "left-hand side of assignment was not `mut`");
-            auto b = gal::single_message("cannot assign to immutable lvalue");
-
-            diagnostics_->report_emplace(49, gal::into_list(std::move(a), std::move(b)));
-          }
+          check_assignable(expr);
 
           if (!try_make_compatible(expr->lhs().result().accessed_type(), expr->rhs_owner())) {
             auto a = type_was_err(expr->rhs());
@@ -920,6 +933,10 @@ namespace {
         return Expr::return_value(self_expr()->result_mut());
       }
 
+      if (!expr->unsafe() && expr->cast_to().is(TT::vector)) {
+        return check_vector_cast(expr);
+      }
+
       convert_intermediate(expr->castee_owner());
 
       if (!expr->unsafe()) {
@@ -1091,6 +1108,7 @@ namespace {
 
     void visit(ast::IfThenExpression* expr) final {
       visit_children(expr);
+      convert_intermediate(expr->condition_owner());
 
       if (!boolean(expr->condition())) {
         auto a = gal::point_out_list(type_was_err(expr->condition()));
@@ -1118,6 +1136,7 @@ namespace {
 
     void visit(ast::IfElseExpression* expr) final {
       visit_children(expr);
+      convert_intermediate(expr->condition_owner());
 
       if (!boolean(expr->condition())) {
         auto a = gal::point_out_list(type_was_err(expr->condition()));
@@ -1129,6 +1148,8 @@ namespace {
       auto all_same = true;
 
       for (auto& elif : expr->elif_blocks_mut()) {
+        convert_intermediate(elif.condition_owner());
+
         if (!boolean(elif.condition())) {
           auto a = gal::point_out_list(type_was_err(elif.condition()));
 
@@ -1196,6 +1217,8 @@ namespace {
         visit_children(expr);
       }
 
+      convert_intermediate(expr->condition_owner());
+
       if (!boolean(expr->condition())) {
         auto a = gal::point_out_list(type_was_err(expr->condition()));
 
@@ -1223,6 +1246,12 @@ namespace {
         diagnostics_->report_emplace(54, gal::into_list(std::move(a)));
       }
 
+      if (!valid_loop_hints(expr->attributes())) {
+        auto a = gal::point_out(*expr, gal::DiagnosticType::error, "hints were given here");
+
+        diagnostics_->report_emplace(61, gal::into_list(std::move(a)));
+      }
+
       {
         auto _ = BeforeAfterLoop(this);
         resolver_.enter_scope();
@@ -1357,6 +1386,8 @@ namespace {
       assert(false);
     }
 
+    void visit(ast::VectorType*) final {}
+
     void visit(ast::IndirectionType*) final {
       assert(false);
     }
@@ -1573,6 +1604,30 @@ namespace {
       return integral(expr.result());
     }
 
+    [[nodiscard]] static bool valid_loop_hints(absl::Span<const ast::LoopAttribute> attributes) noexcept {
+      using Type = ast::LoopAttributeType;
+
+      auto vectorize = false;
+      auto no_vectorize = false;
+
+      for (auto& attribute : attributes) {
+        if (attribute.type == Type::builtin_no_vectorize) {
+          no_vectorize = true;
+
+          continue;
+        }
+
+        // these end up as i32s in `llvm.loop` metadata
+        if (attribute.value == 0 || attribute.value > std::numeric_limits<std::uint32_t>::max()) {
+          return false;
+        }
+
+        vectorize = vectorize || attribute.type == Type::builtin_vectorize;
+      }
+
+      return !(vectorize && no_vectorize);
+    }
+
     [[nodiscard]] static bool integral_unwrapping(const ast::Type& type) noexcept {
       return integral(type.accessed_type());
     }
@@ -1598,6 +1653,16 @@ namespace {
       return arithmetic(expr.result());
     }
 
+    [[nodiscard]] static const ast::Type& operand_type(const ast::Expression& expr) noexcept {
+      auto& type = expr.result();
+
+      return type.is(TT::indirection) ? gal::as<ast::IndirectionType>(type).produced() : type;
+    }
+
+    [[nodiscard]] static bool vector_operand(const ast::Expression& expr) noexcept {
+      return operand_type(expr).is(TT::vector);
+    }
+
     [[nodiscard]] static bool arithmetic_unwrapping(const ast::Type& type) noexcept {
       return arithmetic(type.accessed_type());
     }
@@ -1746,6 +1811,456 @@ namespace {
       return check_condition(expr, pred, code, condition_name) && check_identical(expr);
     }
 
+    void check_assignable(ast::BinaryExpression* expr) noexcept {
+      if (!lvalue(expr->lhs())) {
+        auto a = gal::point_out_list(type_was_err(expr->lhs()));
+        auto b = gal::single_message("lvalues are identifiers, and the result of `*expr` on pointers and references");
+
+        diagnostics_->report_emplace(42, gal::into_list(std::move(a), std::move(b)));
+      }
+
+      if (!mut(expr->lhs())) {
+        auto a = gal::point_out(expr->lhs(), gal::DiagnosticType::error, "left-hand side of assignment was not `mut`");
+        auto b = gal::single_message("cannot assign to immutable lvalue");
+
+        diagnostics_->report_emplace(49, gal::into_list(std::move(a), std::move(b)));
+      }
+    }
+
+    [[nodiscard]] static bool exclusive(const ast::Type& type) noexcept {
+      switch (type.type()) {
+        case TT::reference: return gal::as<ast::ReferenceType>(type).mut();
+        case TT::slice: return gal::as<ast::SliceType>(type).mut();
+        default: return false;
+      }
+    }
+
+    // finds the local that an argument borrows from, looking through anything that only picks out a piece
+    // of it (indexing, sub-slicing, fields), casts of it, or follows a reference/pointer held in it. two arguments that
+    // come from the same local may overlap, even `arr[0..4]` and `arr[4..8]` can't be told apart here
+    [[nodiscard]] static const ast::LocalIdentifierExpression* borrowed_local(const ast::Expression& expr) noexcept {
+      switch (expr.type()) {
+        case ET::identifier_local: return &gal::as<ast::LocalIdentifierExpression>(expr);
+        case ET::group: return borrowed_local(gal::as<ast::GroupExpression>(expr).expr());
+        case ET::implicit: return borrowed_local(gal::as<ast::ImplicitConversionExpression>(expr).expr());
+        case ET::address_of: return borrowed_local(gal::as<ast::AddressOfExpression>(expr).expr());
+        case ET::load: return borrowed_local(gal::as<ast::LoadExpression>(expr).expr());
+        case ET::index: return borrowed_local(gal::as<ast::IndexExpression>(expr).callee());
+        case ET::range_into: return borrowed_local(gal::as<ast::RangeExpression>(expr).array());
+        case ET::slice_of: return borrowed_local(gal::as<ast::SliceOfExpression>(expr).data());
+        case ET::field_access: return borrowed_local(gal::as<ast::FieldAccessExpression>(expr).object());
+        case ET::cast: return borrowed_local(gal::as<ast::CastExpression>(expr).castee());
+        case ET::unary: {
+          auto& unary = gal::as<ast::UnaryExpression>(expr);
+          auto op = unary.op();
+
+          return (op == ast::UnaryOp::ref_to || op == ast::UnaryOp::mut_ref_to || op == ast::UnaryOp::dereference)
+                     ? borrowed_local(unary.expr())
+                     : nullptr;
+        }
+        default: return nullptr;
+      }
+    }
+
+    // `&mut` and `[mut T]` parameters are assumed to not alias any other argument, codegen marks them
+    // `noalias`. we can't prove that in general (two references held in different locals can still
+    // point at the same thing), but two arguments borrowed from the same local are rejected
+    void check_exclusive_args(const ast::StaticCallExpression& call, const ast::FnPrototype& proto) noexcept {
+      auto may_alias = std::any_of(proto.attributes().begin(), proto.attributes().end(), [](auto& attr) {
+        return attr.type == ast::AttributeType::builtin_may_alias;
+      });
+
+      if (!may_alias) {
+        check_exclusive_args(call.args());
+      }
+    }
+
+    // a function pointer's type doesn't say whether the function is `__mayalias`, so calls through one
+    // are checked as if it isn't. the definition it points at still has `noalias` parameters
+    void check_exclusive_args(absl::Span<const std::unique_ptr<ast::Expression>> args) noexcept {
+
+      for (auto i = std::size_t{0}; i < args.size(); ++i) {
+        auto* local = exclusive(args[i]->result()) ? borrowed_local(*args[i]) : nullptr;
+
+        if (local == nullptr) {
+          continue;
+        }
+
+        for (auto j = std::size_t{0}; j < args.size(); ++j) {
+          auto& other = args[j]->result();
+
+          if (i == j || !(other.is(TT::reference) || other.is(TT::slice) || other.is(TT::pointer))) {
+            continue;
+          }
+
+          if (auto* other_local = borrowed_local(*args[j]); other_local != nullptr) {
+            if (other_local->name() != local->name()) {
+              continue;
+            }
+
+            auto a = gal::point_out_list(gal::point_out_part(*args[i], gal::DiagnosticType::error, "exclusive"),
+                gal::point_out_part(*args[j], gal::DiagnosticType::note, "overlaps with this"));
+
+            diagnostics_->report_emplace(63, gal::into_list(std::move(a)));
+
+            return;
+          }
+        }
+      }
+    }
+
+    GALLIUM_COLD void vector_error(ast::Expression* expr,
+        std::string message,
+        const ast::Expression* culprit = nullptr) noexcept {
+      auto parts = gal::into_list(gal::point_out_part(*expr, gal::DiagnosticType::error));
+
+      if (culprit != nullptr) {
+        parts.push_back(type_was_note(*culprit));
+      }
+
+      auto a = gal::point_out_list(std::move(parts));
+      auto b = gal::single_message(std::move(message));
+
+      diagnostics_->report_emplace(62, gal::into_list(std::move(a), std::move(b)));
+
+      return update_return(expr, error_type());
+    }
+
+    [[nodiscard]] bool splat_into(const ast::VectorType& vector, std::unique_ptr<ast::Expression>* expr) noexcept {
+      if (identical(vector, operand_type(**expr))) {
+        return true;
+      }
+
+      // float literals are always `f64`, but `v * 2.0` should still work for an `f32xN`
+      auto float_literal = (*expr)->is(ET::float_lit) && vector.element_type().is(TT::builtin_float);
+
+      if (vector_operand(**expr) || !(float_literal || try_make_compatible(vector.element_type(), expr))) {
+        return false;
+      }
+
+      // `v * 2.0` is `v * (2.0 as f32xN)`, codegen turns a scalar-to-vector cast into a splat
+      auto loc = (*expr)->loc();
+      auto held = std::move(*expr);
+      *expr = std::make_unique<ast::CastExpression>(loc, false, std::move(held), vector.clone());
+      (*expr)->result_update(vector.clone());
+
+      return true;
+    }
+
+    void check_vector_binary(ast::BinaryExpression* expr) noexcept {
+      auto compound = expr->is_compound_assignment();
+
+      if (!compound) {
+        convert_intermediate(expr->lhs_owner());
+      } else if (!vector_operand(expr->lhs())) {
+        return vector_error(expr, "a vector can only be assigned into another vector", &expr->lhs());
+      }
+
+      convert_intermediate(expr->rhs_owner());
+
+      // splatting may replace the vector operand, the type needs to outlive that
+      auto pinned = operand_type(vector_operand(expr->lhs()) ? expr->lhs() : expr->rhs()).clone();
+      auto& vector = gal::as<ast::VectorType>(*pinned);
+
+      if (!splat_into(vector, expr->lhs_owner()) || !splat_into(vector, expr->rhs_owner())) {
+        auto& culprit = identical(vector, operand_type(expr->lhs())) ? expr->rhs() : expr->lhs();
+
+        return vector_error(expr,
+            absl::StrCat("both operands must be `", gal::to_string(vector), "` or a scalar of its element type"),
+            &culprit);
+      }
+
+      auto& element = vector.element_type();
+      auto valid = false;
+
+      switch (expr->op()) {
+        case ast::BinaryOp::add:
+        case ast::BinaryOp::sub:
+        case ast::BinaryOp::mul:
+        case ast::BinaryOp::add_eq:
+        case ast::BinaryOp::sub_eq:
+        case ast::BinaryOp::mul_eq:
+        case ast::BinaryOp::lt:
+        case ast::BinaryOp::gt:
+        case ast::BinaryOp::lt_eq:
+        case ast::BinaryOp::gt_eq: valid = arithmetic(element); break;
+        case ast::BinaryOp::div:
+        case ast::BinaryOp::div_eq: valid = element.is(TT::builtin_float); break;
+        case ast::BinaryOp::bitwise_and:
+        case ast::BinaryOp::bitwise_or:
+        case ast::BinaryOp::bitwise_xor:
+        case ast::BinaryOp::bitwise_and_eq:
+        case ast::BinaryOp::bitwise_or_eq:
+        case ast::BinaryOp::bitwise_xor_eq: valid = integral(element) || boolean(element); break;
+        case ast::BinaryOp::logical_and:
+        case ast::BinaryOp::logical_or:
+        case ast::BinaryOp::logical_xor: valid = boolean(element); break;
+        case ast::BinaryOp::equals:
+        case ast::BinaryOp::not_equal: valid = true; break;
+        default: break; // no integer division, `%` or shifts on vectors
+      }
+
+      if (!valid) {
+        return vector_error(expr,
+            absl::StrCat("operator `",
+                gal::binary_op_string(expr->op()),
+                "` is not supported on vectors of `",
+                gal::to_string(element),
+                "`"),
+            &expr->lhs());
+      }
+
+      if (compound) {
+        check_assignable(expr);
+
+        return update_return(expr, void_type(expr->loc()));
+      }
+
+      // comparisons produce a mask, one `bool` per lane
+      if (expr->is_ordering() || expr->is_equality()) {
+        auto mask = std::make_unique<ast::VectorType>(expr->loc(), vector.lanes(), bool_type(expr->loc()));
+
+        return update_return(expr, std::move(mask));
+      }
+
+      update_return(expr, vector.clone());
+    }
+
+    void check_vector_unary(ast::UnaryExpression* expr) noexcept {
+      auto& vector = gal::as<ast::VectorType>(expr->expr().result());
+      auto& element = vector.element_type();
+      auto valid = false;
+
+      switch (expr->op()) {
+        case ast::UnaryOp::negate: {
+          valid = element.is(TT::builtin_float) || (integral(element) && !is_unsigned(element));
+          break;
+        }
+        case ast::UnaryOp::bitwise_not: valid = integral(element) || boolean(element); break;
+        case ast::UnaryOp::logical_not: valid = boolean(element); break;
+        default: break;
+      }
+
+      if (!valid) {
+        return vector_error(expr,
+            absl::StrCat("operator `",
+                gal::unary_op_string(expr->op()),
+                "` is not supported on vectors of `",
+                gal::to_string(element),
+                "`"),
+            &expr->expr());
+      }
+
+      update_return(expr, vector.clone());
+    }
+
+    [[nodiscard]] static bool lanes_convertible(const ast::Type& to, const ast::Type& from) noexcept {
+      return (arithmetic(to) && arithmetic(from)) || (boolean(to) && boolean(from));
+    }
+
+    void check_vector_cast(ast::CastExpression* expr) noexcept {
+      auto& vector = gal::as<ast::VectorType>(expr->cast_to());
+
+      // arrays are loaded from wherever they already are, they never get turned into values first
+      if (operand_type(expr->castee()).is(TT::array)) {
+        auto& array = gal::as<ast::ArrayType>(operand_type(expr->castee()));
+
+        if (array.size() != vector.lanes()) {
+          return cast_error(expr, "arrays can only be cast to vectors with the same number of lanes");
+        }
+
+        // masks are bit-packed, they can't be loaded straight out of a `[bool; N]`
+        if (!arithmetic(vector.element_type()) || !arithmetic(array.element_type())) {
+          return cast_error(expr, "only arrays of integers or floats can be loaded into a vector");
+        }
+
+        return update_return(expr, vector.clone());
+      }
+
+      convert_intermediate(expr->castee_owner());
+
+      auto& result = expr->castee().result();
+
+      switch (result.type()) {
+        case TT::slice: {
+          if (gal::as<ast::SliceType>(result).sliced() != vector.element_type() || !arithmetic(vector.element_type())) {
+            return cast_error(expr,
+                "only slices of integers or floats can be loaded, into a vector of the same element type",
+                "help: load into a vector of the slice's element type, and then cast that vector");
+          }
+
+          break;
+        }
+        case TT::vector: {
+          auto& from = gal::as<ast::VectorType>(result);
+
+          if (from.lanes() != vector.lanes() || !lanes_convertible(vector.element_type(), from.element_type())) {
+            return cast_error(expr, "vectors can only be converted lane-by-lane into vectors with the same lane count");
+          }
+
+          break;
+        }
+        default: {
+          if (!lanes_convertible(vector.element_type(), result)) {
+            return cast_error(expr, "only scalars, arrays, slices and other vectors can be cast to a vector");
+          }
+
+          break;
+        }
+      }
+
+      update_return(expr, vector.clone());
+    }
+
+    [[nodiscard]] static std::optional<std::uint64_t> constant_lane(const ast::Expression& expr) noexcept {
+      auto* lane = &expr;
+
+      if (lane->is(ET::implicit)) {
+        lane = &gal::as<ast::ImplicitConversionExpression>(*lane).expr();
+      }
+
+      if (lane->is(ET::integer_lit)) {
+        return gal::as<ast::IntegerLiteralExpression>(*lane).value();
+      }
+
+      return std::nullopt;
+    }
+
+    void check_simd_builtin(ast::CallExpression* expr, gal::SIMDBuiltin builtin) noexcept {
+      using SB = gal::SIMDBuiltin;
+
+      auto args = expr->args_mut();
+      auto arity = gal::simd_builtin_arity(builtin);
+
+      if (args.size() != arity) {
+        return vector_error(expr,
+            absl::StrCat("expected ", arity, " ", gal::make_plural(arity, "arguments"), ", got ", args.size()));
+      }
+
+      for (auto& arg : args) {
+        convert_intermediate(&arg);
+      }
+
+      // `store` takes its destination first, everything else takes the vector first
+      auto& first = *args[(builtin == SB::store) ? 1 : 0];
+
+      if (!first.result().is(TT::vector)) {
+        return vector_error(expr, "expected a vector argument", &first);
+      }
+
+      // `try_make_compatible` can replace arguments, the type needs to outlive that
+      auto pinned = first.result().clone();
+      auto& vector = gal::as<ast::VectorType>(*pinned);
+      auto& element = vector.element_type();
+
+      switch (builtin) {
+        case SB::extract:
+        case SB::insert: {
+          if (!try_make_compatible(ptr_width_int, &args[1])) {
+            return vector_error(expr, "lane indices must be `isize`", args[1].get());
+          }
+
+          if (auto lane = constant_lane(*args[1]); lane && *lane >= vector.lanes()) {
+            return vector_error(expr,
+                absl::StrCat("lane ", *lane, " is out of range for `", gal::to_string(vector), "`"),
+                args[1].get());
+          }
+
+          if (builtin == SB::extract) {
+            return update_return(expr, element.clone());
+          }
+
+          if (!try_make_compatible(element, &args[2])) {
+            return vector_error(expr, "the inserted value must have the vector's element type", args[2].get());
+          }
+
+          return update_return(expr, vector.clone());
+        }
+        case SB::shuffle: {
+          if (args[1]->result() != vector) {
+            return vector_error(expr, "both vectors given to a shuffle must have the same type", args[1].get());
+          }
+
+          auto mask = gal::simd_shuffle_mask(*args[2]);
+
+          if (!mask) {
+            return vector_error(expr, "shuffle lanes must be an array literal of integer constants", args[2].get());
+          }
+
+          // lanes `N..2N` come from the second vector
+          auto it = absl::c_find_if(*mask, [&](std::uint64_t lane) {
+            return lane >= vector.lanes() * 2;
+          });
+
+          if (it != mask->end()) {
+            return vector_error(expr,
+                absl::StrCat("lane ", *it, " is out of range, lanes must be between 0 and ", vector.lanes() * 2 - 1),
+                args[2].get());
+          }
+
+          if (!gal::is_vector_type_name(absl::StrCat(gal::to_string(element), "x", mask->size()))) {
+            return vector_error(expr,
+                absl::StrCat("a shuffle cannot produce a vector of ",
+                    mask->size(),
+                    " `",
+                    gal::to_string(element),
+                    "`s"),
+                args[2].get());
+          }
+
+          return update_return(expr, std::make_unique<ast::VectorType>(expr->loc(), mask->size(), element.clone()));
+        }
+        case SB::select: {
+          auto& lhs = args[1]->result();
+
+          if (!boolean(element)) {
+            return vector_error(expr, "the first argument of a select must be a mask", &first);
+          }
+
+          if (lhs != args[2]->result() || !lhs.is(TT::vector)
+              || gal::as<ast::VectorType>(lhs).lanes() != vector.lanes()) {
+            return vector_error(expr,
+                "both sides of a select must be vectors of the same type, with as many lanes as the mask",
+                args[2].get());
+          }
+
+          return update_return(expr, lhs.clone());
+        }
+        case SB::sum:
+        case SB::min:
+        case SB::max: {
+          if (!arithmetic(element)) {
+            return vector_error(expr, "only vectors of integers or floats can be reduced", &first);
+          }
+
+          return update_return(expr, element.clone());
+        }
+        case SB::any:
+        case SB::all: {
+          if (!boolean(element)) {
+            return vector_error(expr, "only masks can be reduced with `any` and `all`", &first);
+          }
+
+          return update_return(expr, bool_type(expr->loc()));
+        }
+        case SB::store: {
+          auto dest = slice_of(expr->loc(), element.clone(), true);
+
+          if (!arithmetic(element) || !try_make_compatible(*dest, &args[0])) {
+            return vector_error(expr,
+                absl::StrCat("`",
+                    gal::to_string(vector),
+                    "` can only be stored into a `[mut ",
+                    gal::to_string(element),
+                    "]`"),
+                args[0].get());
+          }
+
+          return update_return(expr, void_type(expr->loc()));
+        }
+      }
+    }
+
     [[nodiscard]] bool check_qualified_id(std::unique_ptr<ast::Expression>* expr,
         const ast::FullyQualifiedID& id) noexcept {
       if (!constant_only_) {
@@ -9,55 +9,54 @@
 //======---------------------------------------------------------------======//
 
 #include "./driver.h"
+#include "./core/backend/passes.h"
 #include "./core/codegen.h"
 #include "./core/emit.h"
+#include "./core/incremental.h"
 #include "./core/mangler.h"
+#include "./core/module_interface.h"
 #include "./core/type_checker.h"
 #include "./errors/console_reporter.h"
 #include "./syntax/parser.h"
+#include "./utility/arena.h"
 #include "./utility/flags.h"
 #include "./utility/log.h"
 #include "./utility/pretty.h"
+#include "./utility/source_manager.h"
+#include "./utility/thread_pool.h"
+#include "./utility/timing.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/Registry.h"
 #include "llvm/Support/TargetRegistry.h"
-#include "llvm/Support/TargetSelect.h"
 #include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
-#include <fstream>
+#include <functional>
+#include <sstream>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <variant>
 
 namespace fs = std::filesystem;
 
 using namespace std::literals;
 
 namespace {
-  std::string read_file(const fs::path& path) noexcept {
-    auto in = std::ifstream(path);
-    auto file_data = ""s;
-
-    if (!in.is_open()) {
-      gal::errs() << "unable to open file `" << path << "`!";
-      std::abort();
-    }
-
-    in.seekg(0, std::ios::end);
-    file_data.resize(in.tellg(), ' ');
-    in.seekg(0);
-    in.read(file_data.data(), static_cast<std::streamsize>(file_data.size()));
-
-    return file_data;
-  }
-
   thread_local llvm::LLVMContext context;
 
-  llvm::TargetMachine* llvm_setup(const std::string& triple) noexcept {
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmParsers();
-    llvm::InitializeAllAsmPrinters();
+  // TargetMachine isn't safe to share between threads that are emitting code, so every worker gets its own
+  thread_local std::unique_ptr<llvm::TargetMachine> machine;
+
+  llvm::TargetMachine* target_machine(const std::string& triple) noexcept {
+    if (machine != nullptr) {
+      return machine.get();
+    }
 
     auto err = std::string{};
     auto* target = llvm::TargetRegistry::lookupTarget(triple, err);
@@ -68,7 +67,131 @@ namespace {
       return nullptr;
     }
 
-    return target->createTargetMachine(triple, "generic", "", llvm::TargetOptions{}, {});
+    machine.reset(target->createTargetMachine(triple, "generic", "", llvm::TargetOptions{}, {}));
+
+    return machine.get();
+  }
+
+  // errors about a single file go into that file's buffered diagnostics, so they're
+  // printed in the same order no matter which worker finished first
+  std::ostream& file_error(std::ostream* out) noexcept {
+    return *out << gal::colors::bold_red("error: ");
+  }
+
+  std::ostream& file_note(std::ostream* out) noexcept {
+    return *out << gal::colors::bold_cyan("note: ");
+  }
+
+  std::string output_name(const fs::path& file, std::size_t file_count) noexcept {
+    // with multiple files they can't all be written to `--out`, each one gets named after its input
+    if (file_count == 1) {
+      return std::string{gal::flags().out()};
+    }
+
+    return file.stem().string();
+  }
+
+  template <typename Fn> auto timed(std::string_view phase, Fn fn) noexcept {
+    auto timer = gal::TimeScope(phase);
+
+    return fn();
+  }
+
+  std::size_t job_count() noexcept {
+    auto jobs = (gal::flags().jobs() == 0) ? std::thread::hardware_concurrency() : gal::flags().jobs();
+
+    return std::max<std::size_t>(jobs, 1);
+  }
+
+  std::size_t thread_count(std::size_t file_count) noexcept {
+    return std::max(std::min(job_count(), file_count), std::size_t{1});
+  }
+
+  // whether files are handed off to a thin link rather than being emitted on their own. IR
+  // and bitcode are still emitted per-file, ThinLTO bitcode is what a thin link takes as input
+  bool thin_link_requested() noexcept {
+    switch (gal::flags().emit()) {
+      case gal::OutputFormat::assembly:
+      case gal::OutputFormat::object_code:
+      case gal::OutputFormat::static_lib:
+      case gal::OutputFormat::exe: return gal::flags().lto() == gal::LTOKind::thin;
+      default: return false;
+    }
+  }
+
+  // which files need to be compiled before which, based on the modules that they import
+  struct ModuleGraph {
+    std::vector<std::vector<std::size_t>> dependencies;
+    std::vector<std::vector<std::size_t>> dependents;
+  };
+
+  absl::flat_hash_set<std::string> imports_of(const gal::ast::Program& program) noexcept {
+    auto modules = absl::flat_hash_set<std::string>{};
+
+    for (auto& decl : program.decls()) {
+      if (decl->is(gal::ast::DeclType::import_decl)) {
+        modules.insert(gal::as<gal::ast::ImportDeclaration>(*decl).mod().module_string());
+      } else if (decl->is(gal::ast::DeclType::import_from_decl)) {
+        for (auto& entity : gal::as<gal::ast::ImportFromDeclaration>(*decl).imported_entities()) {
+          modules.emplace(entity.module_string());
+        }
+      }
+    }
+
+    return modules;
+  }
+
+  ModuleGraph module_graph(absl::Span<std::string_view> files,
+      absl::Span<const std::optional<gal::ast::Program>> programs) noexcept {
+    auto graph = ModuleGraph{};
+    auto indices = absl::flat_hash_map<std::string, std::size_t>{};
+
+    graph.dependencies.resize(files.size());
+    graph.dependents.resize(files.size());
+
+    // files that didn't parse are still in here, anything importing them shouldn't fall back to an old interface
+    for (auto i = std::size_t{0}; i < files.size(); ++i) {
+      indices.emplace(gal::module_for(files[i]), i);
+    }
+
+    for (auto i = std::size_t{0}; i < programs.size(); ++i) {
+      if (!programs[i].has_value()) {
+        continue;
+      }
+
+      for (auto& module : imports_of(*programs[i])) {
+        if (auto it = indices.find(module); it != indices.end() && it->second != i) {
+          graph.dependencies[i].push_back(it->second);
+          graph.dependents[it->second].push_back(i);
+        }
+      }
+    }
+
+    return graph;
+  }
+
+  // a topological order of the graph, anything that's part of a cycle (or depends on one) is left out
+  std::vector<std::size_t> build_order(const ModuleGraph& graph) noexcept {
+    auto remaining = std::vector<std::size_t>{};
+    auto order = std::vector<std::size_t>{};
+
+    for (auto i = std::size_t{0}; i < graph.dependencies.size(); ++i) {
+      remaining.push_back(graph.dependencies[i].size());
+
+      if (remaining.back() == 0) {
+        order.push_back(i);
+      }
+    }
+
+    for (auto i = std::size_t{0}; i < order.size(); ++i) {
+      for (auto dependent : graph.dependents[order[i]]) {
+        if (--remaining[dependent] == 0) {
+          order.push_back(dependent);
+        }
+      }
+    }
+
+    return order;
   }
 } // namespace
 
@@ -82,47 +205,290 @@ namespace gal {
       return 0;
     }
 
-    auto triple = llvm::sys::getDefaultTargetTriple();
-    auto* machine = llvm_setup(triple);
-
-    if (machine == nullptr) {
+    // validate the triple once up-front, rather than once per worker
+    if (!prepare()) {
       return 1;
     }
 
+    // the main thread's trace is the one that every worker's trace gets merged into
+    gal::time_trace_start_thread();
+
+    auto diagnostics = std::vector<std::ostringstream>(files.size());
+    auto results = std::vector<char>(files.size(), false);
+
+    programs_.resize(files.size());
+    file_ids_.resize(files.size());
+    thin_modules_.resize(files.size());
+
     for (auto& file : files) {
-      auto path = fs::relative(file);
-      auto data = read_file(fs::absolute(file));
-      auto diagnostic = gal::ConsoleReporter(&gal::raw_outs(), data);
+      outputs_.push_back(output_name(fs::path(file), files.size()));
+    }
+
+    // any threads that aren't busy with a file of their own can help parse (and lower) a big file
+    spare_threads_ = files.empty() ? 1 : std::max(job_count() / files.size(), std::size_t{1});
+
+    // everything is parsed up-front, since the imports in each file decide what order the rest happens in
+    run_all(files.size(), [this, files, &diagnostics, &results](std::size_t i) {
+      results[i] = load_file(i, files[i], &diagnostics[i]);
+    });
+
+    auto graph = module_graph(files, programs_);
+    auto order = build_order(graph);
 
-      if (auto program = parse_file(path, data, &diagnostic)) {
-        auto valid = gal::type_check(*program, *machine, &diagnostic);
+    // a file that something else imports is a library, its `main` (if it has one) isn't the entry point
+    for (auto i = std::size_t{0}; i < files.size(); ++i) {
+      if (programs_[i].has_value()) {
+        programs_[i]->set_entry(graph.dependents[i].empty());
+      }
+    }
+
+    for (auto i = std::size_t{0}; i < files.size(); ++i) {
+      if (results[i] && std::find(order.begin(), order.end(), i) == order.end()) {
+        file_error(&diagnostics[i]) << "unable to compile `" << files[i]
+                                    << "`, it's part of (or imports) a cycle of imports\n";
+
+        results[i] = false;
+      }
+    }
+
+    // a file can only be compiled once every module it imports has been, since it needs their interfaces
+    auto compile = [this, files, &graph, &diagnostics, &results](std::size_t i) {
+      auto& dependencies = graph.dependencies[i];
+      auto failed = std::find_if(dependencies.begin(), dependencies.end(), [&results](std::size_t dependency) {
+        return !results[dependency];
+      });
+
+      // without this the file would just silently produce nothing, point at what actually went wrong
+      if (results[i] && failed != dependencies.end()) {
+        file_note(&diagnostics[i]) << "`" << files[i] << "` was not compiled because its dependency `"
+                                   << files[*failed] << "` failed\n";
+      }
 
-        if (gal::flags().verbose()) {
-          gal::raw_outs() << gal::pretty_print(**program) << '\n';
+      results[i] = results[i] && failed == dependencies.end() && compile_file(i, &diagnostics[i]);
+    };
+
+    if (thread_count(files.size()) == 1) {
+      for (auto i : order) {
+        compile(i);
+      }
+    } else {
+      auto pool = gal::ThreadPool(thread_count(files.size()));
+      auto remaining = std::vector<std::atomic<std::size_t>>(files.size());
+      auto run = std::function<void(std::size_t)>{};
+
+      for (auto i = std::size_t{0}; i < files.size(); ++i) {
+        remaining[i] = graph.dependencies[i].size();
+      }
+
+      run = [&](std::size_t i) {
+        gal::time_trace_start_thread();
+        compile(i);
+        gal::time_trace_finish_thread();
+
+        for (auto dependent : graph.dependents[i]) {
+          if (remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            pool.submit([&run, dependent] {
+              run(dependent);
+            });
+          }
         }
+      };
 
-        if (!valid) {
-          break;
+      for (auto i = std::size_t{0}; i < files.size(); ++i) {
+        if (graph.dependencies[i].empty()) {
+          pool.submit([&run, i] {
+            run(i);
+          });
         }
+      }
+
+      pool.wait();
+    }
+
+    // everything is done, now we can print diagnostics in a deterministic order
+    for (auto& stream : diagnostics) {
+      gal::raw_outs() << stream.str();
+    }
+
+    auto succeeded = std::all_of(results.begin(), results.end(), [](char result) {
+      return result;
+    });
+
+    if (succeeded && thin_link_requested()) {
+      succeeded = timed("thin link", [&] {
+        return gal::emit_thin_link(thin_modules_, target_machine(llvm::sys::getDefaultTargetTriple()), job_count());
+      });
+    }
+
+    if (gal::flags().time_report()) {
+      gal::time_report_print(gal::raw_errs());
+    }
+
+    if (gal::flags().incremental() && (gal::flags().time_report() || gal::flags().verbose())) {
+      gal::cache_statistics_print(gal::raw_errs());
+    }
 
-        gal::mangle_program(*program);
-        auto module = gal::codegen(&context, machine, **program);
-        gal::emit(module.get(), machine);
+    if (gal::flags().time_trace()) {
+      succeeded = gal::time_trace_write(absl::StrCat(gal::flags().out(), ".time-trace.json")) && succeeded;
+    }
+
+    return succeeded ? 0 : 1;
+  }
+
+  bool Driver::initialize() noexcept {
+    gal::initialize_targets();
+
+    return target_machine(llvm::sys::getDefaultTargetTriple()) != nullptr;
+  }
+
+  bool Driver::prepare() noexcept {
+    if (!initialize()) {
+      return false;
+    }
+
+    if (auto passes = gal::flags().passes(); !passes.empty()) {
+      auto error = std::string{};
+
+      if (!gal::backend::valid_pipeline(passes, &error)) {
+        gal::errs() << "invalid value '" << passes << "' for flag 'passes': " << error;
+
+        return false;
+      }
+    }
+
+    if (auto profile = gal::flags().profile_use(); !profile.empty()) {
+      if (gal::flags().profile_generate()) {
+        gal::errs() << "'profile_generate' and 'profile_use' cannot be used together";
+
+        return false;
       }
+
+      // LLVM treats an unreadable profile as a fatal error, that shouldn't happen halfway through compiling
+      if (auto ec = std::error_code{}; !fs::is_regular_file(profile, ec)) {
+        gal::errs() << "unable to read profile `" << profile << "`";
+
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  void Driver::run_all(std::size_t count, const std::function<void(std::size_t)>& fn) noexcept {
+    if (thread_count(count) == 1) {
+      // no point in spinning up a worker just to wait on it, and this thread's
+      // target machine may already exist (see `prepare`)
+      for (auto i = std::size_t{0}; i < count; ++i) {
+        fn(i);
+      }
+
+      return;
+    }
+
+    auto pool = gal::ThreadPool(thread_count(count));
+
+    for (auto i = std::size_t{0}; i < count; ++i) {
+      pool.submit([&fn, i] {
+        gal::time_trace_start_thread();
+        fn(i);
+        gal::time_trace_finish_thread();
+      });
+    }
+
+    pool.wait();
+  }
+
+  bool Driver::load_file(std::size_t index, std::string_view file, std::ostream* out) noexcept {
+    auto loaded = timed("load", [&] {
+      return gal::sources().load(fs::relative(file));
+    });
+
+    if (auto* error = std::get_if<std::error_code>(&loaded)) {
+      file_error(out) << "unable to read file `" << file << "`: " << error->message() << '\n';
+
+      return false;
+    }
+
+    auto id = std::get<gal::FileID>(loaded);
+    auto diagnostic = gal::ConsoleReporter(out, gal::sources().contents(id));
+    auto program = timed("parse", [&] {
+      return parse_file(index, id, &diagnostic);
+    });
+
+    if (!program) {
+      return false;
+    }
+
+    file_ids_[index] = id;
+    (*program)->set_module(gal::module_for(file));
+
+    return true;
+  }
+
+  bool Driver::compile_file(std::size_t index, std::ostream* out) noexcept {
+    auto* machine = target_machine(llvm::sys::getDefaultTargetTriple());
+    auto diagnostic = gal::ConsoleReporter(out, gal::sources().contents(file_ids_[index]));
+    auto* program = &*programs_[index];
+
+    // anything the later passes create (clones, implicit conversions, builtins) goes in with the rest of the AST
+    auto scope = gal::ArenaScope{program->arena()};
+    auto valid = timed("type check", [&] {
+      return gal::type_check(program, *machine, &diagnostic);
+    });
+
+    if (gal::flags().verbose()) {
+      *out << gal::pretty_print(*program) << '\n';
+    }
+
+    if (!valid) {
+      return false;
+    }
+
+    timed("mangle", [&] {
+      gal::mangle_program(program);
+    });
+
+    // only files that export something can be imported, there's no point writing an empty interface
+    if (gal::has_exports(*program) && !gal::flags().module_dir().empty()) {
+      auto written = timed("write interface", [&] {
+        return gal::write_interface(*program);
+      });
+
+      if (!written) {
+        file_error(out) << "unable to write module interface `"
+                        << gal::interface_path(program->module_string()).string() << "`\n";
+
+        return false;
+      }
+    }
+
+    auto module = gal::codegen(&context, machine, *program);
+
+    if (thin_link_requested()) {
+      auto& thin = thin_modules_[index];
+
+      thin.name = program->module_string();
+      thin.output = outputs_[index];
+
+      return timed("emit", [&] {
+        return gal::emit_to_memory(module.get(), machine, gal::OutputFormat::llvm_bc, &thin.bitcode);
+      });
     }
 
-    return 0;
+    return timed("emit", [&] {
+      return gal::emit(module.get(), machine, outputs_[index], spare_threads_);
+    });
   }
 
-  std::optional<ast::Program*> Driver::parse_file(std::filesystem::path path,
-      std::string_view source,
+  std::optional<ast::Program*> Driver::parse_file(std::size_t index,
+      gal::FileID file,
       gal::DiagnosticReporter* reporter) noexcept {
-    if (auto result = gal::parse(std::move(path), source, reporter)) {
-      programs_.push_back(std::move(*result));
+    if (auto result = gal::parse(file, reporter, gal::flags().parser(), spare_threads_)) {
+      programs_[index].emplace(std::move(*result));
 
-      return &programs_.back();
+      return &*programs_[index];
     } else {
       return std::nullopt;
     }
   }
-} // namespace gal
\ No newline at end of file
+} // namespace gal
@@ -9,9 +9,15 @@
 //======---------------------------------------------------------------======//
 
 #include "./ast/program.h"
+#include "./core/emit.h"
 #include "./errors/reporter.h"
+#include "./utility/source_manager.h"
 #include "absl/types/span.h"
+#include <cstddef>
+#include <functional>
 #include <optional>
+#include <ostream>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -22,21 +28,76 @@ namespace gal {
   public:
     /// Runs the compiler and returns an exit code for the program
     ///
+    /// Every file is put through the entire pipeline independently, on up to
+    /// `--jobs` threads at once. Files that import a module being compiled alongside
+    /// them wait for that module (and its interface) to be finished first, but
+    /// otherwise run in parallel. Diagnostics are buffered per-file and printed
+    /// in the order the files were given, no matter which finishes first.
+    ///
+    /// With `--lto=thin`, files are only compiled as far as bitcode. Once every file
+    /// is done they are thin-linked together (into a single executable, for `--emit=exe`).
+    ///
     /// \param files The file options given to the program
     [[nodiscard]] int start(absl::Span<std::string_view> files) noexcept;
 
-    /// Parses a file, if it parses successfully it is added to `programs_`
-    /// and a pointer is returned. Otherwise, nullopt is returned.
+    /// Does the process-wide setup that compiling needs, i.e. initializing every LLVM
+    /// target and creating a target machine for the host on the calling thread. `start`
+    /// does this itself, calling it early just means that work is already done by then.
+    ///
+    /// This doesn't look at any flags, so it can be done before the flags that a compile
+    /// will actually use have been parsed.
+    ///
+    /// Calling this more than once is fine, only the first call does anything.
+    ///
+    /// \return Whether or not the host is a target that LLVM supports
+    [[nodiscard]] static bool initialize() noexcept;
+
+    /// Does everything `initialize` does, and then checks the flags that can't be
+    /// checked while they're being parsed.
+    ///
+    /// \return Whether or not the host is supported and the flags are valid
+    [[nodiscard]] static bool prepare() noexcept;
+
+    /// Parses a file, if it parses successfully it is stored in slot `index`
+    /// of `programs_` and a pointer is returned. Otherwise, nullopt is returned.
     ///
-    /// \param path The path of the file
-    /// \param source The source of the file
+    /// \param index The index of the file in the list of files being compiled
+    /// \param file The file to parse, already loaded into `gal::sources()`
     /// \param reporter A diagnostic reporter
     /// \return A possible program
-    [[nodiscard]] std::optional<ast::Program*> parse_file(std::filesystem::path path,
-        std::string_view source,
+    [[nodiscard]] std::optional<ast::Program*> parse_file(std::size_t index,
+        gal::FileID file,
         gal::DiagnosticReporter* reporter) noexcept;
 
   private:
-    std::vector<ast::Program> programs_;
+    /// Calls `fn` with every index in `[0, count)`, on up to `--jobs` threads at once
+    ///
+    /// \param count The number of indices
+    /// \param fn The function to call
+    static void run_all(std::size_t count, const std::function<void(std::size_t)>& fn) noexcept;
+
+    /// Reads and parses a single file, and works out which module it is. Only touches
+    /// state belonging to `index`, so this is safe to call concurrently
+    ///
+    /// \param index The index of the file in the list of files being compiled
+    /// \param file The file to load
+    /// \param out The stream to write diagnostics into
+    /// \return Whether or not the file was parsed successfully
+    [[nodiscard]] bool load_file(std::size_t index, std::string_view file, std::ostream* out) noexcept;
+
+    /// Runs the rest of the pipeline (check, mangle, write interface, codegen, emit) over a
+    /// file that `load_file` parsed. Only touches state belonging to `index`, so this is safe
+    /// to call concurrently as long as every module the file imports is already compiled
+    ///
+    /// \param index The index of the file in the list of files being compiled
+    /// \param out The stream to write diagnostics and verbose output into
+    /// \return Whether or not the file was compiled successfully
+    [[nodiscard]] bool compile_file(std::size_t index, std::ostream* out) noexcept;
+
+    std::vector<std::string> outputs_;
+    std::vector<gal::FileID> file_ids_;
+    std::vector<gal::ThinModule> thin_modules_;
+    std::vector<std::optional<ast::Program>> programs_;
+    std::size_t spare_threads_ = 1;
   };
 } // namespace gal
\ No newline at end of file
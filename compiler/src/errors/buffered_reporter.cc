@@ -0,0 +1,32 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./buffered_reporter.h"
+
+namespace gal {
+  BufferedReporter::BufferedReporter(std::string_view source) noexcept : gal::DiagnosticReporter{source} {}
+
+  void BufferedReporter::replay(DiagnosticReporter* reporter) noexcept {
+    for (auto& diagnostic : buffered_) {
+      reporter->report(std::move(diagnostic));
+    }
+
+    buffered_.clear();
+  }
+
+  void BufferedReporter::internal_report(gal::Diagnostic diagnostic) noexcept {
+    error_count_ += 1;
+    buffered_.push_back(std::move(diagnostic));
+  }
+
+  bool BufferedReporter::internal_had_error() const noexcept {
+    return error_count_ != 0;
+  }
+} // namespace gal
@@ -0,0 +1,48 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "./diagnostics.h"
+#include "./reporter.h"
+#include <cstddef>
+#include <vector>
+
+namespace gal {
+  /// Holds onto every diagnostic it's given instead of printing them, so that
+  /// work done out of order (e.g. on other threads) can report in a deterministic
+  /// order once it's finished.
+  class BufferedReporter final : public DiagnosticReporter {
+  public:
+    explicit BufferedReporter(std::string_view source) noexcept;
+
+    /// Reports every buffered diagnostic to another reporter, in the order they were
+    /// originally reported, and then clears the buffer
+    ///
+    /// \param reporter The reporter to forward everything to
+    void replay(DiagnosticReporter* reporter) noexcept;
+
+    /// Gets every diagnostic that has been reported and not replayed yet
+    ///
+    /// \return The buffered diagnostics
+    [[nodiscard]] const std::vector<gal::Diagnostic>& diagnostics() const noexcept {
+      return buffered_;
+    }
+
+  protected:
+    void internal_report(gal::Diagnostic diagnostic) noexcept final;
+
+    [[nodiscard]] bool internal_had_error() const noexcept final;
+
+  private:
+    std::size_t error_count_ = 0;
+    std::vector<gal::Diagnostic> buffered_;
+  };
+} // namespace gal
@@ -11,6 +11,7 @@
 #include "./diagnostics.h"
 #include "../utility/flags.h"
 #include "../utility/log.h"
+#include "../utility/source_manager.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
@@ -34,32 +35,6 @@ namespace {
     }
   }
 
-  absl::Span<const std::string_view> break_into_lines(std::string_view source) noexcept {
-    // uses the **address** of the source location, since it should always be the same string
-    static absl::flat_hash_map<const void*, std::vector<std::string_view>> line_lookup;
-
-    if (auto it = line_lookup.find(source.data()); it != line_lookup.end()) {
-      return absl::MakeConstSpan((*it).second);
-    }
-
-    auto lines = std::vector<std::string_view>{absl::StrSplit(source, absl::ByAnyChar("\r\n"))};
-
-    std::transform(lines.begin(), lines.end(), lines.begin(), [](std::string_view s) {
-      // we can't use StripWhitespace just because we need to
-      // preserve any whitespace **besides** the \rs and \ns
-      s = absl::StripPrefix(s, "\n");
-      s = absl::StripPrefix(s, "\r\n");
-      s = absl::StripSuffix(s, "\n");
-      s = absl::StripSuffix(s, "\r\n");
-
-      return s;
-    });
-
-    auto [it, _] = line_lookup.emplace(source.data(), std::move(lines));
-
-    return absl::MakeConstSpan(it->second);
-  }
-
   std::string header_colored(gal::DiagnosticType type, std::int64_t code) noexcept {
     auto builder = ""s;
 
@@ -192,7 +167,6 @@ namespace gal {
 namespace {
   struct UnderlineState {
     std::uint64_t max_line;
-    std::string_view source;
     std::string_view padding;
     std::optional<std::uint64_t> previous_line;
   };
@@ -206,7 +180,7 @@ namespace {
 
   void build_list(std::string* builder, const gal::PointedOut& spot, UnderlineState* state) noexcept {
     auto& loc = spot.loc;
-    auto full_line = break_into_lines(state->source)[loc.line() - 1];
+    auto full_line = gal::sources().line(loc.file_id(), loc.line());
     auto [before_line, without_line] = line_number_padding(loc.line(), state->max_line);
     auto [start, underlined, rest] = break_up(full_line, loc);
     auto underline = absl::StrCat(std::string(start.size(), ' '),
@@ -259,13 +233,13 @@ namespace {
 } // namespace
 
 namespace gal {
-  std::string UnderlineList::internal_build(std::string_view source, std::string_view padding) const noexcept {
+  std::string UnderlineList::internal_build(std::string_view, std::string_view padding) const noexcept {
     auto builder = ""s;
     auto max_line = std::max_element(list_.begin(), list_.end(), [](const PointedOut& lhs, const PointedOut& rhs) {
       return lhs.loc.line() < rhs.loc.line();
     });
 
-    auto state = UnderlineState{max_line->loc.line(), source, padding, std::nullopt};
+    auto state = UnderlineState{max_line->loc.line(), padding, std::nullopt};
 
     append_file_info(&builder, state, *important_loc_);
 
@@ -523,6 +497,35 @@ gal::DiagnosticInfo gal::diagnostic_info(std::int64_t code) noexcept {
           {"slice-of expr must have integer as second expression",
               "you need to provide an integral size for the new slice",
               gal::DiagnosticType::error}},
+      {58,
+          {"unable to find module",
+              "modules are imported through their interface, which is written whenever a file that `export`s "
+              "something is compiled. compile the module first, or check that `--module-dir` is the same",
+              gal::DiagnosticType::error}},
+      {59,
+          {"module interface is unreadable",
+              "the interface (or one that it depends on) is corrupt, stale or from a different compiler version. "
+              "recompile the module to regenerate it",
+              gal::DiagnosticType::error}},
+      {60,
+          {"imported entity is not exported",
+              "only declarations marked `export` can be imported from another module",
+              gal::DiagnosticType::error}},
+      {61,
+          {"invalid loop hint",
+              "`__vectorize` and `__unroll` take a count between 1 and 2^32 - 1, and `__vectorize` "
+              "cannot be combined with `__novectorize`",
+              gal::DiagnosticType::error}},
+      {62,
+          {"invalid vector operation",
+              "vector operands must have the same element type and lane count, and lane indices must be in range",
+              gal::DiagnosticType::error}},
+      {63,
+          {"overlapping exclusive arguments",
+              "`&mut` and `[mut T]` arguments are assumed to not alias any other argument of the call. pass "
+              "different variables (elements or sub-slices of the same variable count as overlapping), or mark "
+              "the function `__mayalias` if it's written to handle overlap",
+              gal::DiagnosticType::error}},
   };
 
   return lookup.at(code);
@@ -9,13 +9,19 @@
 //======---------------------------------------------------------------======//
 
 #include "absl/flags/parse.h"
+#include "absl/flags/reflection.h"
 #include "absl/flags/usage.h"
 #include "absl/strings/str_cat.h"
 #include "driver.h"
 #include "utility/flags.h"
+#include "utility/log.h"
 #include <string_view>
 #include <vector>
 
+#ifdef GALLIUM_HAS_SERVE
+#include "serve.h"
+#endif
+
 #if defined(_WIN32) && defined(__MINGW32__) && defined(__GNUC__)
 #include <windows.h>
 #endif
@@ -32,6 +38,40 @@ namespace {
 
     return result;
   }
+
+  int run(std::vector<char*> args) noexcept {
+    auto files = into_positionals(absl::MakeSpan(args));
+
+    gal::delegate_flags();
+
+    // `files` includes the first positional argument (which is the exe path), need to ignore
+    // also need to ignore the final null string, it will always have a string with just \0 in it
+    return gal::Driver{}.start({files.data() + 1, files.size() - 1});
+  }
+
+  // every request is parsed on top of whatever the server was started with, so any other
+  // flags given along with `--serve` would silently apply to every single request
+  [[maybe_unused]] bool only_serve_flags(const std::vector<char*>& positionals) noexcept {
+    if (positionals.size() > 1) {
+      gal::errs() << "`--serve` does not take any files, they are given to `gallium-client` instead";
+
+      return false;
+    }
+
+    for (auto& [name, flag] : absl::GetAllFlags()) {
+      if (name != "serve" && name != "socket" && flag->CurrentValue() != flag->DefaultValue()) {
+        gal::errs() << "`--" << name << "` cannot be used with `--serve`, it is given to `gallium-client` instead";
+
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  [[maybe_unused]] int compile(int argc, char** argv) noexcept {
+    return run(absl::ParseCommandLine(argc, argv));
+  }
 } // namespace
 
 int main(int argc, char** argv) {
@@ -45,11 +85,20 @@ int main(int argc, char** argv) {
       absl::StrCat("Invokes the Gallium compiler.\n\nSample Usage:\n\n    ", argv[0], " <file>"));
 
   auto vec = absl::ParseCommandLine(argc, argv);
-  auto files = into_positionals(absl::MakeSpan(vec));
 
-  gal::delegate_flags();
+  if (gal::serve_requested()) {
+#ifdef GALLIUM_HAS_SERVE
+    if (!only_serve_flags(vec)) {
+      return 1;
+    }
+
+    return gal::serve(gal::serve_socket(), compile);
+#else
+    gal::errs() << "`--serve` is not supported on this platform";
+
+    return 1;
+#endif
+  }
 
-  // `files` includes the first positional argument (which is the exe path), need to ignore
-  // also need to ignore the final null string, it will always have a string with just \0 in it
-  return gal::Driver{}.start({files.data() + 1, files.size() - 1});
+  return run(std::move(vec));
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./serve.h"
+#include "./driver.h"
+#include "./utility/log.h"
+#include "./utility/serve_protocol.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+  int listen_on(const std::string& path) noexcept {
+    auto address = sockaddr_un{};
+
+    if (path.size() >= sizeof address.sun_path) {
+      gal::errs() << "socket path `" << path << "` is too long";
+
+      return -1;
+    }
+
+    auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0) {
+      gal::errs() << "unable to create socket: " << std::strerror(errno);
+
+      return -1;
+    }
+
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.data(), path.size());
+
+    // a server that died without cleaning up leaves its socket behind
+    ::unlink(path.c_str());
+
+    // anyone who can connect can compile (and write files) as us, so nobody else gets to. the socket
+    // has to be created with the right mode, a `chmod` afterwards leaves a window where anyone can connect.
+    // nothing else is running yet, so temporarily changing the process-wide umask is fine
+    auto old_mask = ::umask(0177);
+    auto bound = ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof address);
+    ::umask(old_mask);
+
+    if (bound < 0 || ::listen(fd, SOMAXCONN) < 0) {
+      gal::errs() << "unable to listen on `" << path << "`: " << std::strerror(errno);
+      ::close(fd);
+
+      return -1;
+    }
+
+    return fd;
+  }
+
+  // runs inside of the forked child, never returns
+  [[noreturn]] void handle(int connection, gal::CompileFn compile) noexcept {
+    int fds[3] = {-1, -1, -1};
+    auto request = gal::receive_request(connection, fds);
+
+    if (!request || request->args.empty() || ::chdir(request->cwd.c_str()) < 0) {
+      ::_exit(1);
+    }
+
+    for (auto i = 0; i < 3; ++i) {
+      ::dup2(fds[i], i);
+      ::close(fds[i]);
+    }
+
+    // the compile has to see what the client sees (`$CC`, `$PATH`, `$TMPDIR`, ...), not whatever
+    // the server happened to be started with. `putenv` keeps the pointers, `request` outlives them
+    if (::clearenv() != 0) {
+      ::_exit(1);
+    }
+
+    for (auto& variable : request->env) {
+      if (variable.find('=') != std::string::npos && ::putenv(variable.data()) != 0) {
+        ::_exit(1);
+      }
+    }
+
+    auto argv = std::vector<char*>{};
+
+    for (auto& arg : request->args) {
+      argv.push_back(arg.data());
+    }
+
+    argv.push_back(nullptr);
+
+    auto code = compile(static_cast<int>(request->args.size()), argv.data());
+
+    // `_exit` skips static destructors, so nothing else is going to flush these
+    std::cout.flush();
+    std::cerr.flush();
+    llvm::outs().flush();
+    llvm::errs().flush();
+
+    (void)gal::send_exit_code(connection, code);
+    ::_exit(code);
+  }
+} // namespace
+
+namespace gal {
+  int serve(std::string socket_path, CompileFn compile) noexcept {
+    if (socket_path.empty()) {
+      socket_path = gal::default_socket_path();
+    }
+
+    // this needs to happen before anything is forked, since the whole point is that children inherit it.
+    // nothing that reads the flags can happen here, `gal::flags()` would keep the server's values forever
+    if (!gal::Driver::initialize()) {
+      return 1;
+    }
+
+    auto listener = listen_on(socket_path);
+
+    if (listener < 0) {
+      return 1;
+    }
+
+    // children are never waited on, the kernel reaps them as soon as they exit
+    std::signal(SIGCHLD, SIG_IGN);
+
+    gal::outs() << "listening on `" << socket_path << "`";
+
+    while (true) {
+      auto connection = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+
+      if (connection < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        }
+
+        gal::errs() << "unable to accept connection: " << std::strerror(errno);
+
+        return 1;
+      }
+
+      auto pid = ::fork();
+
+      if (pid == 0) {
+        // children do need to wait on things (e.g. `$CC`), which `SIG_IGN` would break
+        std::signal(SIGCHLD, SIG_DFL);
+        ::close(listener);
+
+        handle(connection, compile);
+      }
+
+      if (pid < 0) {
+        gal::errs() << "unable to fork for a request: " << std::strerror(errno);
+      }
+
+      ::close(connection);
+    }
+  }
+} // namespace gal
@@ -0,0 +1,36 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include <string>
+
+namespace gal {
+  /// Compiles with a set of command-line arguments, exactly like `main` would
+  using CompileFn = int (*)(int argc, char** argv) noexcept;
+
+  /// Runs as a compile server, listening for requests from `gallium-client` on a Unix socket.
+  ///
+  /// The expensive process-wide setup (starting up, initializing LLVM's targets, creating a
+  /// target machine) is done once up front. Every request is then handled in a `fork`ed copy
+  /// of the server that inherits all of that, and that has the client's working directory,
+  /// environment and standard streams. That keeps requests completely isolated from each other,
+  /// and lets as many of them run at once as the build system wants to send.
+  ///
+  /// Each request's arguments are parsed on top of the flags that the server was started with,
+  /// so the server must not be started with any flags besides `--serve` and `--socket`.
+  ///
+  /// This only returns if the socket couldn't be set up.
+  ///
+  /// \param socket_path The socket to listen on, or empty to use `gal::default_socket_path()`
+  /// \param compile The function to compile with in each request's process
+  /// \return An exit code for the server
+  [[nodiscard]] int serve(std::string socket_path, CompileFn compile) noexcept;
+} // namespace gal
@@ -30,6 +30,15 @@ BUILTIN_TYPE
     | 'bool'
     | 'char'
     | 'void'
+    | VECTOR_TYPE
+    ;
+
+// vectors are capped at 512 bits, this mirrors `gal::is_vector_type_name`
+fragment VECTOR_TYPE
+    : ('i8' | 'u8' | 'bool') 'x' ('2' | '4' | '8' | '16' | '32' | '64')
+    | ('i16' | 'u16') 'x' ('2' | '4' | '8' | '16' | '32')
+    | ('i32' | 'u32' | 'f32') 'x' ('2' | '4' | '8' | '16')
+    | ('i64' | 'u64' | 'f64') 'x' ('2' | '4' | '8')
     ;
 
 fragment DECIMAL_DIGIT
@@ -368,6 +377,7 @@ fnAttribute
     | '__noreturn'
     | '__stdlib'
     | '__varargs'
+    | '__mayalias'
     ;
 
 fnArgumentList
@@ -512,7 +522,18 @@ elseBlock
 loopExpr
     : 'while' ws whileCond=expr ws blockExpression
     | 'loop' ws? blockExpression
-    | 'for' ws loopVariable=IDENTIFIER ws ':=' ws expr ws direction=(TO | DOWNTO) ws expr ws? blockExpression
+    | 'for' ws loopVariable=IDENTIFIER ws ':=' ws expr ws direction=(TO | DOWNTO) ws expr
+          (ws loopAttributeList)? ws? blockExpression
+    ;
+
+loopAttributeList
+    : loopAttribute (ws loopAttribute)*
+    ;
+
+loopAttribute
+    : '__vectorize(' DECIMAL_LITERAL ')'
+    | '__unroll(' DECIMAL_LITERAL ')'
+    | '__novectorize'
     ;
 
 expr
@@ -0,0 +1,2099 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./fast_parser.h"
+#include "../ast/nodes.h"
+#include "../errors/diagnostics.h"
+#include "../utility/arena.h"
+#include "../utility/misc.h"
+#include "./lexer.h"
+#include "./literals.h"
+#include "absl/strings/str_cat.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//
+// this follows `Gallium.g4` rule-for-rule, the comment above each parsing function
+// is the rule it implements. whitespace is significant in the grammar, so it's kept as
+// tokens and every `ws?` / `WHITESPACE+` / etc. in the grammar has an equivalent here.
+//
+// source locations are built the same way the ANTLR parser builds them, from the first
+// token a rule matched up to the last one, so the two parsers give identical ASTs.
+//
+
+namespace {
+  namespace ast = gal::ast;
+
+  using gal::Token;
+  using gal::TokenType;
+
+  // the alternatives in the grammar's `expr` rule, from loosest to tightest binding
+  enum Precedence : int {
+    lowest = 0,
+    assignment,
+    equality,
+    comparison,
+    logical_or,
+    logical_xor,
+    logical_and,
+    bitwise_or,
+    bitwise_xor,
+    bitwise_and,
+    shift,
+    additive,
+    multiplicative,
+    unsafe_cast,
+    cast,
+    mut_ref,
+    unary,
+    logical_not,
+    postfix,
+  };
+
+  struct BinaryOpInfo {
+    ast::BinaryOp op;
+    int precedence;
+    std::size_t width; // number of tokens, `>>` is two `>` tokens
+  };
+
+  bool is_ws(TokenType type) noexcept {
+    return type == TokenType::whitespace || type == TokenType::newline;
+  }
+
+  bool is_attribute(TokenType type) noexcept {
+    return type >= TokenType::attr_pure && type <= TokenType::attr_may_alias;
+  }
+
+  bool is_loop_attribute(TokenType type) noexcept {
+    return type >= TokenType::attr_vectorize && type <= TokenType::attr_no_vectorize;
+  }
+
+  bool starts_declaration(TokenType type) noexcept {
+    switch (type) {
+      case TokenType::kw_import:
+      case TokenType::kw_export:
+      case TokenType::kw_fn:
+      case TokenType::kw_extern:
+      case TokenType::kw_class:
+      case TokenType::kw_struct:
+      case TokenType::kw_type:
+      case TokenType::kw_external:
+      case TokenType::kw_const: return true;
+      default: return false;
+    }
+  }
+
+  bool starts_expression(TokenType type) noexcept {
+    switch (type) {
+      case TokenType::lbracket:
+      case TokenType::lparen:
+      case TokenType::lbrace:
+      case TokenType::identifier:
+      case TokenType::colon_colon:
+      case TokenType::decimal_literal:
+      case TokenType::hex_literal:
+      case TokenType::octal_literal:
+      case TokenType::dot:
+      case TokenType::string_literal:
+      case TokenType::char_literal:
+      case TokenType::bool_literal:
+      case TokenType::nil_literal:
+      case TokenType::kw_sizeof:
+      case TokenType::kw_if:
+      case TokenType::kw_while:
+      case TokenType::kw_loop:
+      case TokenType::kw_for:
+      case TokenType::kw_return:
+      case TokenType::kw_break:
+      case TokenType::kw_continue:
+      case TokenType::kw_not:
+      case TokenType::tilde:
+      case TokenType::amp:
+      case TokenType::amp_mut:
+      case TokenType::hyphen:
+      case TokenType::star: return true;
+      default: return false;
+    }
+  }
+
+  class FastParser {
+  public:
+    explicit FastParser(gal::FileID file, std::vector<Token> tokens, gal::DiagnosticReporter* reporter) noexcept
+        : tokens_{std::move(tokens)},
+          source_{gal::sources().contents(file)},
+          diagnostics_{reporter},
+          file_{file} {}
+
+    // parse: ws? modularizedDeclaration+ ws? EOF
+    //
+    // modularizedDeclaration: (importDeclaration | exportDeclaration) WHITESPACE* (NEWLINE+ | EOF)
+    std::optional<std::vector<std::unique_ptr<ast::Declaration>>> parse() noexcept {
+      auto decls = std::vector<std::unique_ptr<ast::Declaration>>{};
+
+      skip_ws();
+
+      do {
+        auto decl = modularized_declaration();
+
+        if (decl == nullptr) {
+          return std::nullopt;
+        }
+
+        decls.push_back(std::move(decl));
+        skip_spaces();
+
+        if (at(TokenType::eof)) {
+          break;
+        }
+
+        if (!expect(TokenType::newline)) {
+          return std::nullopt;
+        }
+
+        while (accept(TokenType::newline)) {
+          // NEWLINE+
+        }
+      } while (starts_declaration(peek().type));
+
+      skip_ws();
+
+      if (!expect(TokenType::eof)) {
+        return std::nullopt;
+      }
+
+      return decls;
+    }
+
+  private:
+    //
+    // token-level helpers
+    //
+
+    [[nodiscard]] const Token& peek(std::size_t n = 0) const noexcept {
+      return tokens_[std::min(pos_ + n, tokens_.size() - 1)];
+    }
+
+    [[nodiscard]] TokenType type_at(std::size_t index) const noexcept {
+      return tokens_[std::min(index, tokens_.size() - 1)].type;
+    }
+
+    [[nodiscard]] bool at(TokenType type) const noexcept {
+      return peek().type == type;
+    }
+
+    [[nodiscard]] std::string_view text(const Token& token) const noexcept {
+      return source_.substr(token.offset, token.length);
+    }
+
+    // index of the first non-whitespace token at or after `index`
+    [[nodiscard]] std::size_t past_ws(std::size_t index) const noexcept {
+      while (is_ws(type_at(index))) {
+        ++index;
+      }
+
+      return index;
+    }
+
+    // index of the first non-WHITESPACE token at or after `index`, newlines aren't skipped
+    [[nodiscard]] std::size_t past_spaces(std::size_t index) const noexcept {
+      while (type_at(index) == TokenType::whitespace) {
+        ++index;
+      }
+
+      return index;
+    }
+
+    // checks whether `ws <type>` comes next, i.e. at least one whitespace token followed by `type`
+    [[nodiscard]] std::optional<std::size_t> after_ws(TokenType type) const noexcept {
+      auto index = past_ws(pos_);
+
+      if (index != pos_ && type_at(index) == type) {
+        return index;
+      }
+
+      return std::nullopt;
+    }
+
+    bool accept(TokenType type) noexcept {
+      if (at(type)) {
+        ++pos_;
+
+        return true;
+      }
+
+      return false;
+    }
+
+    [[nodiscard]] bool expect(TokenType type) noexcept {
+      if (accept(type)) {
+        return true;
+      }
+
+      return fail(absl::StrCat("expected `", gal::token_spelling(type), "`"));
+    }
+
+    // ws?
+    bool skip_ws() noexcept {
+      auto start = pos_;
+      pos_ = past_ws(pos_);
+
+      return pos_ != start;
+    }
+
+    // WHITESPACE*
+    bool skip_spaces() noexcept {
+      auto start = pos_;
+      pos_ = past_spaces(pos_);
+
+      return pos_ != start;
+    }
+
+    // ws
+    [[nodiscard]] bool expect_ws() noexcept {
+      return skip_ws() || fail("expected whitespace");
+    }
+
+    // WHITESPACE+
+    [[nodiscard]] bool expect_spaces() noexcept {
+      return skip_spaces() || fail("expected a space");
+    }
+
+    [[nodiscard]] std::optional<std::string> expect_identifier() noexcept {
+      if (!at(TokenType::identifier)) {
+        fail("expected an identifier");
+
+        return std::nullopt;
+      }
+
+      return std::string{text(tokens_[pos_++])};
+    }
+
+    // the span from the token at `mark` to the last token consumed, like ANTLR's rule contexts
+    [[nodiscard]] ast::SourceLoc loc_from(std::size_t mark) const noexcept {
+      auto begin = tokens_[mark].offset;
+
+      if (pos_ <= mark) {
+        return ast::SourceLoc(file_, begin, 0);
+      }
+
+      auto& last = tokens_[pos_ - 1];
+
+      return ast::SourceLoc(file_, begin, last.offset + last.length - begin);
+    }
+
+    //
+    // error handling, any syntax error stops the parse
+    //
+
+    bool fail(std::string message) noexcept {
+      if (!failed_) {
+        auto& token = peek();
+        auto parts = std::vector<std::unique_ptr<gal::DiagnosticPart>>{};
+
+        parts.push_back(gal::point_out(ast::SourceLoc(file_, token.offset, token.length), gal::DiagnosticType::error));
+        parts.push_back(gal::single_message(std::move(message)));
+
+        diagnostics_->report_emplace(5, std::move(parts));
+        failed_ = true;
+      }
+
+      return false;
+    }
+
+    void push_error(std::int64_t code, const ast::SourceLoc& loc, absl::Span<const std::string> notes = {}) noexcept {
+      auto parts = std::vector<std::unique_ptr<gal::DiagnosticPart>>{};
+
+      parts.push_back(gal::point_out(loc, gal::DiagnosticType::error));
+
+      for (auto& note : notes) {
+        parts.push_back(gal::single_message(note));
+      }
+
+      diagnostics_->report_emplace(code, std::move(parts));
+    }
+
+    //
+    // declarations
+    //
+
+    std::unique_ptr<ast::Declaration> modularized_declaration() noexcept {
+      // exportDeclaration: (exportKeyword='export' WHITESPACE+)? declaration
+      exported_ = false;
+
+      if (at(TokenType::kw_import)) {
+        return import_declaration();
+      }
+
+      if (accept(TokenType::kw_export)) {
+        if (!expect_spaces()) {
+          return nullptr;
+        }
+
+        exported_ = true;
+      }
+
+      switch (peek().type) {
+        case TokenType::kw_fn:
+        case TokenType::kw_extern: return fn_declaration();
+        case TokenType::kw_struct: return struct_declaration();
+        case TokenType::kw_type: return type_declaration();
+        case TokenType::kw_external: return external_declaration();
+        case TokenType::kw_const: return const_declaration();
+        case TokenType::kw_class: fail("class declarations are not supported yet"); return nullptr;
+        default: fail("expected a declaration"); return nullptr;
+      }
+    }
+
+    // modularIdentifier: (isRoot='::')? IDENTIFIER ('::' IDENTIFIER)*
+    std::optional<ast::ModuleID> modular_identifier() noexcept {
+      auto from_root = accept(TokenType::colon_colon);
+      auto parts = std::vector<std::string>{};
+
+      do {
+        auto part = expect_identifier();
+
+        if (!part) {
+          return std::nullopt;
+        }
+
+        parts.push_back(std::move(*part));
+      } while (accept(TokenType::colon_colon));
+
+      return ast::ModuleID(from_root, std::move(parts));
+    }
+
+    // importDeclaration
+    //     : 'import' WHITESPACE+ modularIdentifier (WHITESPACE+ 'as' WHITESPACE+ alias=IDENTIFIER)?
+    //     | 'import' WHITESPACE+ importList WHITESPACE+ 'from' WHITESPACE+ modularIdentifier
+    std::unique_ptr<ast::Declaration> import_declaration() noexcept {
+      auto mark = pos_++;
+
+      if (!expect_spaces()) {
+        return nullptr;
+      }
+
+      if (at(TokenType::lbrace)) {
+        auto names = import_list();
+
+        if (!names || !expect_spaces() || !expect(TokenType::kw_from) || !expect_spaces()) {
+          return nullptr;
+        }
+
+        auto module_id = modular_identifier();
+
+        if (!module_id) {
+          return nullptr;
+        }
+
+        auto ids = std::vector<ast::FullyQualifiedID>{};
+
+        for (auto& name : *names) {
+          ids.emplace_back(module_id->module_string(), name);
+        }
+
+        return std::make_unique<ast::ImportFromDeclaration>(loc_from(mark), exported_, std::move(ids));
+      }
+
+      auto module_id = modular_identifier();
+
+      if (!module_id) {
+        return nullptr;
+      }
+
+      auto alias = std::optional<std::string>{};
+
+      if (auto as = past_spaces(pos_); as != pos_ && type_at(as) == TokenType::kw_as) {
+        pos_ = as + 1;
+
+        if (!expect_spaces() || !(alias = expect_identifier())) {
+          return nullptr;
+        }
+      }
+
+      return std::make_unique<ast::ImportDeclaration>(loc_from(mark),
+          exported_,
+          std::move(*module_id),
+          std::move(alias));
+    }
+
+    // importList: '{' ws? identifierList ws? '}'
+    //
+    // identifierList: IDENTIFIER (',' ws? IDENTIFIER ws?)*
+    std::optional<std::vector<std::string>> import_list() noexcept {
+      auto names = std::vector<std::string>{};
+
+      if (!expect(TokenType::lbrace)) {
+        return std::nullopt;
+      }
+
+      skip_ws();
+
+      for (auto first = true; first || accept(TokenType::comma); first = false) {
+        if (!first) {
+          skip_ws();
+        }
+
+        auto name = expect_identifier();
+
+        if (!name) {
+          return std::nullopt;
+        }
+
+        names.push_back(std::move(*name));
+
+        // there's no `ws?` between the first identifier and the first comma
+        if (!first) {
+          skip_ws();
+        }
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::rbrace)) {
+        return std::nullopt;
+      }
+
+      return names;
+    }
+
+    // constDeclaration: 'const' ws IDENTIFIER ws? ':' ws? type ws? '=' ws? constantExpr
+    std::unique_ptr<ast::Declaration> const_declaration() noexcept {
+      auto mark = pos_++;
+      auto name = std::optional<std::string>{};
+
+      if (!expect_ws() || !(name = expect_identifier())) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::colon)) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      auto hint = type();
+
+      if (hint == nullptr) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::eq)) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      auto init = literal();
+
+      if (init == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::ConstantDeclaration>(loc_from(mark),
+          exported_,
+          std::move(*name),
+          std::move(hint),
+          std::move(init));
+    }
+
+    // externalDeclaration: 'external' ws '{' ws? (fnPrototype ws)+ ws? '}'
+    std::unique_ptr<ast::Declaration> external_declaration() noexcept {
+      auto mark = pos_++;
+      auto prototypes = std::vector<std::unique_ptr<ast::Declaration>>{};
+
+      if (!expect_ws() || !expect(TokenType::lbrace)) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      do {
+        auto proto_mark = pos_;
+        auto proto = fn_prototype();
+
+        if (!proto) {
+          return nullptr;
+        }
+
+        prototypes.push_back(
+            std::make_unique<ast::ExternalFnDeclaration>(loc_from(proto_mark), exported_, std::move(*proto)));
+
+        if (!expect_ws()) {
+          return nullptr;
+        }
+      } while (at(TokenType::kw_fn));
+
+      if (!expect(TokenType::rbrace)) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::ExternalDeclaration>(loc_from(mark), exported_, std::move(prototypes));
+    }
+
+    // fnDeclaration: (isExtern='extern' ws)? fnPrototype ws? blockExpression
+    std::unique_ptr<ast::Declaration> fn_declaration() noexcept {
+      auto external = accept(TokenType::kw_extern);
+
+      if (external && !expect_ws()) {
+        return nullptr;
+      }
+
+      auto proto_mark = pos_;
+      auto proto = fn_prototype();
+
+      if (!proto) {
+        return nullptr;
+      }
+
+      // the declaration only covers the prototype, not the body
+      auto loc = loc_from(proto_mark);
+
+      skip_ws();
+
+      auto body = block();
+
+      if (body == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::FnDeclaration>(std::move(loc),
+          exported_,
+          external,
+          std::move(*proto),
+          std::move(body));
+    }
+
+    // fnPrototype: 'fn' ws IDENTIFIER ws? typeParamList? ws? '(' fnArgumentList? ')'
+    //              (ws fnAttributeList)?
+    //              (ws '->' ws type)
+    //
+    // fnArgumentList: singleFnArgument ws? (',' ws? singleFnArgument)*
+    //
+    // fnAttributeList: fnAttribute (ws fnAttribute)*
+    std::optional<ast::FnPrototype> fn_prototype() noexcept {
+      auto name = std::optional<std::string>{};
+
+      if (!expect(TokenType::kw_fn) || !expect_ws() || !(name = expect_identifier())) {
+        return std::nullopt;
+      }
+
+      skip_ws();
+
+      if (at(TokenType::lt) && !type_param_list()) {
+        return std::nullopt;
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::lparen)) {
+        return std::nullopt;
+      }
+
+      auto args = std::vector<ast::Argument>{};
+
+      if (!at(TokenType::rparen)) {
+        do {
+          if (!args.empty()) {
+            skip_ws();
+          }
+
+          auto arg = argument();
+
+          if (!arg) {
+            return std::nullopt;
+          }
+
+          args.push_back(std::move(*arg));
+
+          if (args.size() == 1) {
+            skip_ws();
+          }
+        } while (accept(TokenType::comma));
+      }
+
+      if (!expect(TokenType::rparen)) {
+        return std::nullopt;
+      }
+
+      auto attributes = std::vector<ast::Attribute>{};
+
+      while (true) {
+        auto next = past_ws(pos_);
+
+        if (next == pos_ || !is_attribute(type_at(next))) {
+          break;
+        }
+
+        pos_ = next;
+
+        auto attribute = fn_attribute();
+
+        if (!attribute) {
+          return std::nullopt;
+        }
+
+        attributes.push_back(std::move(*attribute));
+      }
+
+      if (!expect_ws() || !expect(TokenType::arrow) || !expect_ws()) {
+        return std::nullopt;
+      }
+
+      auto return_type = type();
+
+      if (return_type == nullptr) {
+        return std::nullopt;
+      }
+
+      return ast::FnPrototype(std::move(*name),
+          std::nullopt,
+          std::move(args),
+          std::move(attributes),
+          std::move(return_type));
+    }
+
+    // fnAttribute: '__pure' | '__throws' | ... | '__arch(' STRING_LITERAL ')' | ...
+    std::optional<ast::Attribute> fn_attribute() noexcept {
+      using Type = ast::AttributeType;
+
+      auto token = peek();
+      ++pos_;
+
+      switch (token.type) {
+        case TokenType::attr_pure: return ast::Attribute{Type::builtin_pure, {}};
+        case TokenType::attr_throws: return ast::Attribute{Type::builtin_throws, {}};
+        case TokenType::attr_always_inline: return ast::Attribute{Type::builtin_always_inline, {}};
+        case TokenType::attr_inline: return ast::Attribute{Type::builtin_inline, {}};
+        case TokenType::attr_no_inline: return ast::Attribute{Type::builtin_no_inline, {}};
+        case TokenType::attr_malloc: return ast::Attribute{Type::builtin_malloc, {}};
+        case TokenType::attr_hot: return ast::Attribute{Type::builtin_hot, {}};
+        case TokenType::attr_cold: return ast::Attribute{Type::builtin_cold, {}};
+        case TokenType::attr_noreturn: return ast::Attribute{Type::builtin_noreturn, {}};
+        case TokenType::attr_stdlib: return ast::Attribute{Type::builtin_stdlib, {}};
+        case TokenType::attr_varargs: return ast::Attribute{Type::builtin_varargs, {}};
+        case TokenType::attr_may_alias: return ast::Attribute{Type::builtin_may_alias, {}};
+        default: break;
+      }
+
+      assert(token.type == TokenType::attr_arch);
+
+      if (!at(TokenType::string_literal)) {
+        fail("expected a string literal");
+
+        return std::nullopt;
+      }
+
+      auto arch = std::string{text(tokens_[pos_++])};
+
+      if (!expect(TokenType::rparen)) {
+        return std::nullopt;
+      }
+
+      return ast::Attribute{Type::builtin_arch, {std::move(arch)}};
+    }
+
+    // singleFnArgument: IDENTIFIER ws? ':' ws? type | selfArgument
+    std::optional<ast::Argument> argument() noexcept {
+      auto mark = pos_;
+
+      switch (peek().type) {
+        case TokenType::amp_self:
+        case TokenType::amp_mut:
+        case TokenType::kw_self:
+        case TokenType::kw_mut: fail("`self` arguments are not supported yet"); return std::nullopt;
+        default: break;
+      }
+
+      auto name = expect_identifier();
+
+      if (!name) {
+        return std::nullopt;
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::colon)) {
+        return std::nullopt;
+      }
+
+      skip_ws();
+
+      auto arg_type = type();
+
+      if (arg_type == nullptr) {
+        return std::nullopt;
+      }
+
+      return ast::Argument{loc_from(mark), std::move(*name), std::move(arg_type)};
+    }
+
+    // typeParamList: LT ws? typeParam (ws? ',' ws? typeParam)* ws? GT
+    //
+    // typeParam: IDENTIFIER (':' ws? maybeGenericIdentifier)? (ws? '=' ws? maybeGenericIdentifier)?
+    //
+    // generics aren't part of the AST yet, so these are only checked and then thrown away
+    [[nodiscard]] bool type_param_list() noexcept {
+      if (!expect(TokenType::lt)) {
+        return false;
+      }
+
+      skip_ws();
+
+      while (true) {
+        if (!expect_identifier()) {
+          return false;
+        }
+
+        if (accept(TokenType::colon)) {
+          skip_ws();
+
+          if (!maybe_generic_identifier()) {
+            return false;
+          }
+        }
+
+        if (auto eq = past_ws(pos_); type_at(eq) == TokenType::eq) {
+          pos_ = eq + 1;
+          skip_ws();
+
+          if (!maybe_generic_identifier()) {
+            return false;
+          }
+        }
+
+        if (auto comma = past_ws(pos_); type_at(comma) == TokenType::comma) {
+          pos_ = comma + 1;
+          skip_ws();
+
+          continue;
+        }
+
+        break;
+      }
+
+      skip_ws();
+
+      return expect(TokenType::gt);
+    }
+
+    // structDeclaration: 'struct' ws IDENTIFIER (ws? typeParamList?) ws? '{'
+    //                    (ws structMember WHITESPACE* NEWLINE+)*
+    //                    ws?
+    //                    '}'
+    //
+    // structMember: IDENTIFIER ':' WHITESPACE+ type
+    std::unique_ptr<ast::Declaration> struct_declaration() noexcept {
+      auto mark = pos_++;
+      auto name = std::optional<std::string>{};
+
+      if (!expect_ws() || !(name = expect_identifier())) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      if (at(TokenType::lt) && !type_param_list()) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::lbrace)) {
+        return nullptr;
+      }
+
+      auto fields = std::vector<ast::Field>{};
+
+      // `NEWLINE+` has to leave at least one whitespace token for the next member's `ws`
+      while (auto member = after_ws(TokenType::identifier)) {
+        pos_ = *member;
+
+        auto member_mark = pos_;
+        auto member_name = expect_identifier();
+
+        if (!expect(TokenType::colon) || !expect_spaces()) {
+          return nullptr;
+        }
+
+        auto member_type = type();
+
+        if (member_type == nullptr) {
+          return nullptr;
+        }
+
+        fields.emplace_back(loc_from(member_mark), std::move(*member_name), std::move(member_type));
+        skip_spaces();
+
+        if (!expect(TokenType::newline)) {
+          return nullptr;
+        }
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::rbrace)) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::StructDeclaration>(loc_from(mark), exported_, std::move(*name), std::move(fields));
+    }
+
+    // typeDeclaration: 'type' ws? typeParamList? ws? IDENTIFIER ws? '=' ws? type
+    std::unique_ptr<ast::Declaration> type_declaration() noexcept {
+      auto mark = pos_++;
+
+      skip_ws();
+
+      if (at(TokenType::lt) && !type_param_list()) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      auto name = expect_identifier();
+
+      if (!name) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::eq)) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      auto aliased = type();
+
+      if (aliased == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::TypeDeclaration>(loc_from(mark), exported_, std::move(*name), std::move(aliased));
+    }
+
+    //
+    // statements
+    //
+
+    // statement: exprStatement | assertStatement | bindingStatement
+    std::unique_ptr<ast::Statement> statement() noexcept {
+      switch (peek().type) {
+        case TokenType::kw_assert: return assert_statement();
+        case TokenType::kw_let:
+        case TokenType::kw_mut: return binding_statement();
+        default: break;
+      }
+
+      // exprStatement: expr
+      auto mark = pos_;
+      auto e = expr(lowest);
+
+      if (e == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::ExpressionStatement>(loc_from(mark), std::move(e));
+    }
+
+    // assertStatement: 'assert' ws expr (ws? ',' ws STRING_LITERAL)?
+    std::unique_ptr<ast::Statement> assert_statement() noexcept {
+      auto mark = pos_++;
+
+      if (!expect_ws()) {
+        return nullptr;
+      }
+
+      auto condition = expr(lowest);
+
+      if (condition == nullptr) {
+        return nullptr;
+      }
+
+      if (auto comma = past_ws(pos_); type_at(comma) == TokenType::comma) {
+        pos_ = comma + 1;
+
+        if (!expect_ws()) {
+          return nullptr;
+        }
+
+        if (!at(TokenType::string_literal)) {
+          fail("expected a string literal");
+
+          return nullptr;
+        }
+
+        auto full = std::string{text(tokens_[pos_++])};
+
+        // like the ANTLR parser, the message gets the location of the whole statement
+        if (auto error = gal::validate_string_literal(full)) {
+          push_error(2, loc_from(mark), {*error});
+        }
+
+        return std::make_unique<ast::AssertStatement>(loc_from(mark),
+            std::move(condition),
+            std::make_unique<ast::StringLiteralExpression>(loc_from(mark), std::move(full)));
+      }
+
+      return std::make_unique<ast::AssertStatement>(loc_from(mark),
+          std::move(condition),
+          std::make_unique<ast::StringLiteralExpression>(loc_from(mark), "<no message given>"));
+    }
+
+    // bindingStatement
+    //     : let='let' ws IDENTIFIER (ws? ':' ws? type)? ws? '=' ws? expr
+    //     | var='mut' ws IDENTIFIER (ws? ':' ws? type)? ws? '=' ws? expr
+    std::unique_ptr<ast::Statement> binding_statement() noexcept {
+      auto mark = pos_;
+      auto mut = peek().type == TokenType::kw_mut;
+      auto name = std::optional<std::string>{};
+
+      ++pos_;
+
+      if (!expect_ws() || !(name = expect_identifier())) {
+        return nullptr;
+      }
+
+      auto hint = std::optional<std::unique_ptr<ast::Type>>{};
+
+      if (auto colon = past_ws(pos_); type_at(colon) == TokenType::colon) {
+        pos_ = colon + 1;
+        skip_ws();
+
+        auto hint_type = type();
+
+        if (hint_type == nullptr) {
+          return nullptr;
+        }
+
+        hint = std::move(hint_type);
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::eq)) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      auto initializer = expr(lowest);
+
+      if (initializer == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::BindingStatement>(loc_from(mark),
+          std::move(*name),
+          mut,
+          std::move(initializer),
+          std::move(hint));
+    }
+
+    //
+    // expressions
+    //
+
+    // blockExpression: '{' ((ws? statement WHITESPACE* NEWLINE) (ws? statement WHITESPACE* NEWLINE)*)? ws? '}'
+    std::unique_ptr<ast::BlockExpression> block() noexcept {
+      auto mark = pos_;
+      auto statements = std::vector<std::unique_ptr<ast::Statement>>{};
+
+      if (!expect(TokenType::lbrace)) {
+        return nullptr;
+      }
+
+      while (true) {
+        skip_ws();
+
+        if (accept(TokenType::rbrace)) {
+          break;
+        }
+
+        auto stmt = statement();
+
+        if (stmt == nullptr) {
+          return nullptr;
+        }
+
+        statements.push_back(std::move(stmt));
+        skip_spaces();
+
+        if (!expect(TokenType::newline)) {
+          return nullptr;
+        }
+      }
+
+      return std::make_unique<ast::BlockExpression>(loc_from(mark), std::move(statements));
+    }
+
+    // every left-recursive alternative of `expr` is handled here with precedence climbing,
+    // everything that isn't left-recursive is handled by `prefix` and `primary`
+    std::unique_ptr<ast::Expression> expr(int min) noexcept {
+      auto mark = pos_;
+      auto lhs = prefix();
+
+      while (lhs != nullptr) {
+        // expr restOfCall
+        if (at(TokenType::lparen) || at(TokenType::lbracket) || at(TokenType::dot)) {
+          lhs = rest_of_call(mark, std::move(lhs));
+
+          continue;
+        }
+
+        // everything else is `expr ws <op> ws ...`
+        auto op = past_ws(pos_);
+
+        if (op == pos_) {
+          break;
+        }
+
+        // expr ws as='as' ws type | expr ws asUnsafe='as!' ws type
+        if (type_at(op) == TokenType::kw_as || type_at(op) == TokenType::as_bang) {
+          auto unsafe = type_at(op) == TokenType::as_bang;
+
+          if ((unsafe ? unsafe_cast : cast) < min || !is_ws(type_at(op + 1))) {
+            break;
+          }
+
+          pos_ = op + 1;
+          skip_ws();
+
+          auto casting_to = type();
+
+          if (casting_to == nullptr) {
+            return nullptr;
+          }
+
+          lhs = std::make_unique<ast::CastExpression>(loc_from(mark), unsafe, std::move(lhs), std::move(casting_to));
+
+          continue;
+        }
+
+        auto info = binary_op_at(op);
+
+        if (!info || info->precedence < min || !is_ws(type_at(op + info->width))) {
+          break;
+        }
+
+        pos_ = op + info->width;
+        skip_ws();
+
+        // every binary operator is left-associative
+        auto rhs = expr(info->precedence + 1);
+
+        if (rhs == nullptr) {
+          return nullptr;
+        }
+
+        lhs = std::make_unique<ast::BinaryExpression>(loc_from(mark), info->op, std::move(lhs), std::move(rhs));
+      }
+
+      return lhs;
+    }
+
+    [[nodiscard]] std::optional<BinaryOpInfo> binary_op_at(std::size_t index) const noexcept {
+      using Op = ast::BinaryOp;
+
+      switch (type_at(index)) {
+        case TokenType::star: return BinaryOpInfo{Op::mul, multiplicative, 1};
+        case TokenType::slash: return BinaryOpInfo{Op::div, multiplicative, 1};
+        case TokenType::percent: return BinaryOpInfo{Op::mod, multiplicative, 1};
+        case TokenType::plus: return BinaryOpInfo{Op::add, additive, 1};
+        case TokenType::hyphen: return BinaryOpInfo{Op::sub, additive, 1};
+        case TokenType::lt_lt: return BinaryOpInfo{Op::left_shift, shift, 1};
+        case TokenType::amp: return BinaryOpInfo{Op::bitwise_and, bitwise_and, 1};
+        case TokenType::caret: return BinaryOpInfo{Op::bitwise_xor, bitwise_xor, 1};
+        case TokenType::pipe: return BinaryOpInfo{Op::bitwise_or, bitwise_or, 1};
+        case TokenType::kw_and: return BinaryOpInfo{Op::logical_and, logical_and, 1};
+        case TokenType::kw_xor: return BinaryOpInfo{Op::logical_xor, logical_xor, 1};
+        case TokenType::kw_or: return BinaryOpInfo{Op::logical_or, logical_or, 1};
+        case TokenType::lt: return BinaryOpInfo{Op::lt, comparison, 1};
+        case TokenType::lt_eq: return BinaryOpInfo{Op::lt_eq, comparison, 1};
+        case TokenType::gt_eq: return BinaryOpInfo{Op::gt_eq, comparison, 1};
+        case TokenType::eq_eq: return BinaryOpInfo{Op::equals, equality, 1};
+        case TokenType::bang_eq: return BinaryOpInfo{Op::not_equal, equality, 1};
+        case TokenType::walrus: return BinaryOpInfo{Op::assignment, assignment, 1};
+        case TokenType::plus_eq: return BinaryOpInfo{Op::add_eq, assignment, 1};
+        case TokenType::hyphen_eq: return BinaryOpInfo{Op::sub_eq, assignment, 1};
+        case TokenType::star_eq: return BinaryOpInfo{Op::mul_eq, assignment, 1};
+        case TokenType::slash_eq: return BinaryOpInfo{Op::div_eq, assignment, 1};
+        case TokenType::percent_eq: return BinaryOpInfo{Op::mod_eq, assignment, 1};
+        case TokenType::lt_lt_eq: return BinaryOpInfo{Op::left_shift_eq, assignment, 1};
+        case TokenType::gt_gt_eq: return BinaryOpInfo{Op::right_shift_eq, assignment, 1};
+        case TokenType::amp_eq: return BinaryOpInfo{Op::bitwise_and_eq, assignment, 1};
+        case TokenType::caret_eq: return BinaryOpInfo{Op::bitwise_xor_eq, assignment, 1};
+        case TokenType::pipe_eq: return BinaryOpInfo{Op::bitwise_or_eq, assignment, 1};
+        case TokenType::gt:
+          // `>>` is lexed as two `>`s so that it doesn't break nested generics
+          return (type_at(index + 1) == TokenType::gt) ? BinaryOpInfo{Op::right_shift, shift, 2}
+                                                       : BinaryOpInfo{Op::gt, comparison, 1};
+        default: return std::nullopt;
+      }
+    }
+
+    // op=NOT_KEYWORD ws expr | op=(TILDE | AMPERSTAND | HYPHEN | STAR) expr | op=AMPERSTAND_MUT ws expr
+    std::unique_ptr<ast::Expression> prefix() noexcept {
+      auto mark = pos_;
+      auto op = ast::UnaryOp{};
+      auto precedence = int{unary};
+      auto needs_ws = false;
+
+      switch (peek().type) {
+        case TokenType::kw_not:
+          op = ast::UnaryOp::logical_not;
+          precedence = logical_not;
+          needs_ws = true;
+          break;
+        case TokenType::tilde: op = ast::UnaryOp::bitwise_not; break;
+        case TokenType::amp: op = ast::UnaryOp::ref_to; break;
+        case TokenType::hyphen: op = ast::UnaryOp::negate; break;
+        case TokenType::star: op = ast::UnaryOp::dereference; break;
+        case TokenType::amp_mut:
+          op = ast::UnaryOp::mut_ref_to;
+          precedence = mut_ref;
+          needs_ws = true;
+          break;
+        default: return primary();
+      }
+
+      ++pos_;
+
+      if (needs_ws && !expect_ws()) {
+        return nullptr;
+      }
+
+      auto operand = expr(precedence);
+
+      if (operand == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::UnaryExpression>(loc_from(mark), op, std::move(operand));
+    }
+
+    // restOfCall
+    //     : paren='(' callArgList? ')'
+    //     | bracket='[' ws? expr ws? (exclusiveRange | inclusiveRange)? ws? ']'
+    //     | '.' IDENTIFIER
+    std::unique_ptr<ast::Expression> rest_of_call(std::size_t mark, std::unique_ptr<ast::Expression> callee) noexcept {
+      if (accept(TokenType::dot)) {
+        auto field = expect_identifier();
+
+        if (!field) {
+          return nullptr;
+        }
+
+        return std::make_unique<ast::FieldAccessExpression>(loc_from(mark), std::move(callee), std::move(*field));
+      }
+
+      if (accept(TokenType::lparen)) {
+        auto args = std::vector<std::unique_ptr<ast::Expression>>{};
+
+        // callArgList: expr ws? (',' ws? expr)*
+        if (!at(TokenType::rparen)) {
+          do {
+            if (!args.empty()) {
+              skip_ws();
+            }
+
+            auto arg = expr(lowest);
+
+            if (arg == nullptr) {
+              return nullptr;
+            }
+
+            args.push_back(std::move(arg));
+
+            if (args.size() == 1) {
+              skip_ws();
+            }
+          } while (accept(TokenType::comma));
+        }
+
+        if (!expect(TokenType::rparen)) {
+          return nullptr;
+        }
+
+        return std::make_unique<ast::CallExpression>(loc_from(mark),
+            std::move(callee),
+            std::move(args),
+            std::vector<std::unique_ptr<ast::Type>>{});
+      }
+
+      ++pos_; // the `[`
+      skip_ws();
+
+      auto begin = expr(lowest);
+
+      if (begin == nullptr) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      // exclusiveRange: '..' ws? expr ws?
+      // inclusiveRange: '..=' ws? expr
+      if (at(TokenType::dot_dot) || at(TokenType::dot_dot_eq)) {
+        auto range = at(TokenType::dot_dot) ? ast::Range::exclusive : ast::Range::inclusive;
+
+        ++pos_;
+        skip_ws();
+
+        auto end = expr(lowest);
+
+        if (end == nullptr) {
+          return nullptr;
+        }
+
+        skip_ws();
+
+        if (!expect(TokenType::rbracket)) {
+          return nullptr;
+        }
+
+        return std::make_unique<ast::RangeExpression>(loc_from(mark),
+            std::move(callee),
+            std::move(begin),
+            std::move(end),
+            range);
+      }
+
+      if (!expect(TokenType::rbracket)) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::IndexExpression>(loc_from(mark), std::move(callee), std::move(begin));
+    }
+
+    // the non-left-recursive alternatives of `expr`, and `primaryExpr`
+    std::unique_ptr<ast::Expression> primary() noexcept {
+      switch (peek().type) {
+        case TokenType::lbracket: return array_or_slice();
+        case TokenType::lparen: return group();
+        case TokenType::lbrace: return block();
+        case TokenType::kw_if: return if_expr();
+        case TokenType::kw_while: return while_expr();
+        case TokenType::kw_loop: return loop_expr();
+        case TokenType::kw_for: return for_expr();
+        case TokenType::kw_return:
+        case TokenType::kw_break: return return_or_break();
+        case TokenType::kw_continue: {
+          auto mark = pos_++;
+
+          return std::make_unique<ast::ContinueExpression>(loc_from(mark));
+        }
+        case TokenType::kw_sizeof: return sizeof_expr();
+        case TokenType::identifier:
+        case TokenType::colon_colon: return identifier_or_struct_init();
+        default: return literal();
+      }
+    }
+
+    // constantExpr: digitLiteral | floatLiteral | STRING_LITERAL | CHAR_LITERAL | BOOL_LITERAL | NIL_LITERAL
+    //
+    // floatLiteral: DECIMAL_LITERAL? '.' DECIMAL_LITERAL
+    std::unique_ptr<ast::Expression> literal() noexcept {
+      auto mark = pos_;
+      auto token = peek();
+
+      switch (token.type) {
+        case TokenType::decimal_literal:
+          if (type_at(pos_ + 1) == TokenType::dot && type_at(pos_ + 2) == TokenType::decimal_literal) {
+            pos_ += 3;
+
+            return float_literal(mark, absl::StrCat(text(token), ".", text(tokens_[pos_ - 1])));
+          }
+
+          ++pos_;
+
+          return integer_literal(mark, text(token), 10);
+        case TokenType::dot:
+          if (type_at(pos_ + 1) != TokenType::decimal_literal) {
+            break;
+          }
+
+          pos_ += 2;
+
+          return float_literal(mark, absl::StrCat("0.", text(tokens_[pos_ - 1])));
+        case TokenType::hex_literal: ++pos_; return integer_literal(mark, text(token).substr(2), 16);
+        case TokenType::octal_literal: ++pos_; return integer_literal(mark, text(token).substr(2), 8);
+        case TokenType::string_literal: {
+          auto full = std::string{text(token)};
+          ++pos_;
+
+          if (auto error = gal::validate_string_literal(full)) {
+            return error_expr(2, loc_from(mark), {*error});
+          }
+
+          return std::make_unique<ast::StringLiteralExpression>(loc_from(mark), std::move(full));
+        }
+        case TokenType::char_literal: {
+          auto full = text(token);
+          auto parsed = gal::parse_single_char(full.substr(1, full.size() - 2));
+          ++pos_;
+
+          if (auto* error = std::get_if<std::string>(&parsed)) {
+            return error_expr(2, loc_from(mark), {*error});
+          }
+
+          return std::make_unique<ast::CharLiteralExpression>(loc_from(mark), std::get<std::uint8_t>(parsed));
+        }
+        case TokenType::bool_literal:
+          ++pos_;
+
+          return std::make_unique<ast::BoolLiteralExpression>(loc_from(mark), text(token) == "true");
+        case TokenType::nil_literal: ++pos_; return std::make_unique<ast::NilLiteralExpression>(loc_from(mark));
+        default: break;
+      }
+
+      fail("expected an expression");
+
+      return nullptr;
+    }
+
+    std::unique_ptr<ast::Expression> integer_literal(std::size_t mark, std::string_view digits, int base) noexcept {
+      auto value = gal::parse_value<std::uint64_t>(digits, base, "integer literal");
+
+      if (auto* int_value = std::get_if<std::uint64_t>(&value)) {
+        return std::make_unique<ast::IntegerLiteralExpression>(loc_from(mark), *int_value);
+      }
+
+      return error_expr(3, loc_from(mark), {std::get<std::string>(value)});
+    }
+
+    std::unique_ptr<ast::Expression> float_literal(std::size_t mark, std::string as_string) noexcept {
+      auto result = gal::from_digits(as_string, std::chars_format::general);
+
+      if (auto* error = std::get_if<std::error_code>(&result)) {
+        return error_expr(4, loc_from(mark), {error->message()});
+      }
+
+      return std::make_unique<ast::FloatLiteralExpression>(loc_from(mark), std::get<double>(result), as_string.length());
+    }
+
+    std::unique_ptr<ast::Expression> error_expr(std::int64_t code,
+        const ast::SourceLoc& loc,
+        absl::Span<const std::string> notes) noexcept {
+      push_error(code, loc, notes);
+
+      return std::make_unique<ast::ErrorExpression>();
+    }
+
+    // groupExpr: '(' ws? expr ws? ')'
+    std::unique_ptr<ast::Expression> group() noexcept {
+      auto mark = pos_++;
+
+      skip_ws();
+
+      auto grouped = expr(lowest);
+
+      if (grouped == nullptr) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::rparen)) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::GroupExpression>(loc_from(mark), std::move(grouped));
+    }
+
+    // arrayExpr: '[' ws? expr ws? (',' ws? expr)* ws? ']'
+    //
+    // sliceOfExpr: '[' ws? expr ws? 'len' ws? expr ']'
+    std::unique_ptr<ast::Expression> array_or_slice() noexcept {
+      auto mark = pos_++;
+      auto elements = std::vector<std::unique_ptr<ast::Expression>>{};
+
+      skip_ws();
+
+      auto first = expr(lowest);
+
+      if (first == nullptr) {
+        return nullptr;
+      }
+
+      skip_ws();
+
+      if (accept(TokenType::kw_len)) {
+        skip_ws();
+
+        auto size = expr(lowest);
+
+        if (size == nullptr || !expect(TokenType::rbracket)) {
+          return nullptr;
+        }
+
+        return std::make_unique<ast::SliceOfExpression>(loc_from(mark), std::move(first), std::move(size));
+      }
+
+      elements.push_back(std::move(first));
+
+      while (accept(TokenType::comma)) {
+        skip_ws();
+
+        auto element = expr(lowest);
+
+        if (element == nullptr) {
+          return nullptr;
+        }
+
+        elements.push_back(std::move(element));
+      }
+
+      skip_ws();
+
+      if (!expect(TokenType::rbracket)) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::ArrayExpression>(loc_from(mark), std::move(elements));
+    }
+
+    // ifExpr
+    //     : 'if' ws expr ws 'then' ws expr ws 'else' ws expr
+    //     | 'if' ws expr ws blockExpression (ws elifBlock)* (ws elseBlock)?
+    //
+    // elifBlock: 'elif' ws expr ws blockExpression
+    //
+    // elseBlock: 'else' ws blockExpression
+    std::unique_ptr<ast::Expression> if_expr() noexcept {
+      auto mark = pos_++;
+
+      if (!expect_ws()) {
+        return nullptr;
+      }
+
+      auto condition = expr(lowest);
+
+      if (condition == nullptr || !expect_ws()) {
+        return nullptr;
+      }
+
+      if (accept(TokenType::kw_then)) {
+        if (!expect_ws()) {
+          return nullptr;
+        }
+
+        auto true_branch = expr(lowest);
+
+        if (true_branch == nullptr || !expect_ws() || !expect(TokenType::kw_else) || !expect_ws()) {
+          return nullptr;
+        }
+
+        auto false_branch = expr(lowest);
+
+        if (false_branch == nullptr) {
+          return nullptr;
+        }
+
+        return std::make_unique<ast::IfThenExpression>(loc_from(mark),
+            std::move(condition),
+            std::move(true_branch),
+            std::move(false_branch));
+      }
+
+      auto body = block();
+
+      if (body == nullptr) {
+        return nullptr;
+      }
+
+      auto elifs = std::vector<ast::ElifBlock>{};
+
+      while (auto elif = after_ws(TokenType::kw_elif)) {
+        pos_ = *elif + 1;
+
+        if (!expect_ws()) {
+          return nullptr;
+        }
+
+        auto elif_condition = expr(lowest);
+
+        if (elif_condition == nullptr || !expect_ws()) {
+          return nullptr;
+        }
+
+        auto elif_body = block();
+
+        if (elif_body == nullptr) {
+          return nullptr;
+        }
+
+        elifs.emplace_back(std::move(elif_condition), std::move(elif_body));
+      }
+
+      auto else_block = std::optional<std::unique_ptr<ast::Expression>>{};
+
+      if (auto else_keyword = after_ws(TokenType::kw_else)) {
+        pos_ = *else_keyword + 1;
+
+        auto else_body = expect_ws() ? block() : nullptr;
+
+        if (else_body == nullptr) {
+          return nullptr;
+        }
+
+        else_block = std::move(else_body);
+      }
+
+      return std::make_unique<ast::IfElseExpression>(loc_from(mark),
+          std::move(condition),
+          std::move(body),
+          std::move(elifs),
+          std::move(else_block));
+    }
+
+    // 'while' ws whileCond=expr ws blockExpression
+    std::unique_ptr<ast::Expression> while_expr() noexcept {
+      auto mark = pos_++;
+
+      if (!expect_ws()) {
+        return nullptr;
+      }
+
+      auto condition = expr(lowest);
+
+      if (condition == nullptr || !expect_ws()) {
+        return nullptr;
+      }
+
+      auto body = block();
+
+      if (body == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::WhileExpression>(loc_from(mark), std::move(condition), std::move(body));
+    }
+
+    // 'loop' ws? blockExpression
+    std::unique_ptr<ast::Expression> loop_expr() noexcept {
+      auto mark = pos_++;
+
+      skip_ws();
+
+      auto body = block();
+
+      if (body == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::LoopExpression>(loc_from(mark), std::move(body));
+    }
+
+    // 'for' ws loopVariable=IDENTIFIER ws ':=' ws expr ws direction=(TO | DOWNTO) ws expr
+    //     (ws loopAttributeList)? ws? blockExpression
+    std::unique_ptr<ast::Expression> for_expr() noexcept {
+      auto mark = pos_++;
+      auto loop_variable = std::optional<std::string>{};
+
+      if (!expect_ws() || !(loop_variable = expect_identifier()) || !expect_ws() || !expect(TokenType::walrus)
+          || !expect_ws()) {
+        return nullptr;
+      }
+
+      auto init = expr(lowest);
+
+      if (init == nullptr || !expect_ws()) {
+        return nullptr;
+      }
+
+      auto direction = ast::ForDirection::up_to;
+
+      if (accept(TokenType::kw_downto)) {
+        direction = ast::ForDirection::down_to;
+      } else if (!expect(TokenType::kw_to)) {
+        return nullptr;
+      }
+
+      if (!expect_ws()) {
+        return nullptr;
+      }
+
+      auto last = expr(lowest);
+
+      if (last == nullptr) {
+        return nullptr;
+      }
+
+      auto attributes = std::vector<ast::LoopAttribute>{};
+
+      while (true) {
+        auto next = past_ws(pos_);
+
+        if (next == pos_ || !is_loop_attribute(type_at(next))) {
+          break;
+        }
+
+        pos_ = next;
+
+        auto attribute = loop_attribute();
+
+        if (!attribute) {
+          return nullptr;
+        }
+
+        attributes.push_back(*attribute);
+      }
+
+      skip_ws();
+
+      auto body = block();
+
+      if (body == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::ForExpression>(loc_from(mark),
+          std::move(*loop_variable),
+          direction,
+          std::move(init),
+          std::move(last),
+          std::move(attributes),
+          std::move(body));
+    }
+
+    // loopAttribute: '__vectorize(' DECIMAL_LITERAL ')' | '__unroll(' DECIMAL_LITERAL ')' | '__novectorize'
+    std::optional<ast::LoopAttribute> loop_attribute() noexcept {
+      using Type = ast::LoopAttributeType;
+
+      auto token = peek();
+      ++pos_;
+
+      if (token.type == TokenType::attr_no_vectorize) {
+        return ast::LoopAttribute{Type::builtin_no_vectorize, 0};
+      }
+
+      if (!at(TokenType::decimal_literal)) {
+        fail("expected an integer literal");
+
+        return std::nullopt;
+      }
+
+      // anything too large to parse is left for the type checker to reject as out of range
+      auto parsed = gal::parse_value<std::uint64_t>(text(tokens_[pos_++]), 10, "loop hint");
+      auto* value = std::get_if<std::uint64_t>(&parsed);
+      auto type = (token.type == TokenType::attr_unroll) ? Type::builtin_unroll : Type::builtin_vectorize;
+
+      if (!expect(TokenType::rparen)) {
+        return std::nullopt;
+      }
+
+      return ast::LoopAttribute{type, (value != nullptr) ? *value : std::numeric_limits<std::uint64_t>::max()};
+    }
+
+    // returnExpr: 'return' (WHITESPACE* expr)?
+    //
+    // breakExpr: 'break' (WHITESPACE* expr)?
+    std::unique_ptr<ast::Expression> return_or_break() noexcept {
+      auto mark = pos_;
+      auto is_return = peek().type == TokenType::kw_return;
+      auto value = std::optional<std::unique_ptr<ast::Expression>>{};
+
+      ++pos_;
+
+      if (starts_expression(type_at(past_spaces(pos_)))) {
+        skip_spaces();
+
+        auto returned = expr(lowest);
+
+        if (returned == nullptr) {
+          return nullptr;
+        }
+
+        value = std::move(returned);
+      }
+
+      if (is_return) {
+        return std::make_unique<ast::ReturnExpression>(loc_from(mark), std::move(value));
+      }
+
+      return std::make_unique<ast::BreakExpression>(loc_from(mark), std::move(value));
+    }
+
+    // sizeofExpr: 'sizeof' ws type
+    std::unique_ptr<ast::Expression> sizeof_expr() noexcept {
+      auto mark = pos_++;
+
+      if (!expect_ws()) {
+        return nullptr;
+      }
+
+      auto sized = type();
+
+      if (sized == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::SizeofExpression>(loc_from(mark), std::move(sized));
+    }
+
+    // primaryExpr: maybeGenericIdentifier | structInitExpr
+    //
+    // structInitExpr: typeWithoutRef ws? '{' ws? structInitMemberList ws? '}'
+    //
+    // structInitMemberList: structInitMember (',' ws? structInitMember)*
+    //
+    // structInitMember: IDENTIFIER ws? ':' ws? expr ws?
+    std::unique_ptr<ast::Expression> identifier_or_struct_init() noexcept {
+      auto mark = pos_;
+      auto id = maybe_generic_identifier();
+
+      if (!id) {
+        return nullptr;
+      }
+
+      if (!looks_like_struct_init()) {
+        return std::make_unique<ast::UnqualifiedIdentifierExpression>(loc_from(mark),
+            std::move(*id),
+            std::vector<std::unique_ptr<ast::Type>>{},
+            std::nullopt);
+      }
+
+      auto struct_type = std::make_unique<ast::UnqualifiedUserDefinedType>(loc_from(mark),
+          std::move(*id),
+          std::vector<std::unique_ptr<ast::Type>>{});
+      auto fields = std::vector<ast::FieldInitializer>{};
+
+      skip_ws();
+      ++pos_; // the `{`
+
+      do {
+        skip_ws();
+
+        auto member_mark = pos_;
+        auto name = expect_identifier();
+
+        if (!name) {
+          return nullptr;
+        }
+
+        skip_ws();
+
+        if (!expect(TokenType::colon)) {
+          return nullptr;
+        }
+
+        skip_ws();
+
+        auto init = expr(lowest);
+
+        if (init == nullptr) {
+          return nullptr;
+        }
+
+        // the trailing `ws?` belongs to the member, and so does its location
+        skip_ws();
+        fields.emplace_back(loc_from(member_mark), std::move(*name), std::move(init));
+      } while (accept(TokenType::comma));
+
+      if (!expect(TokenType::rbrace)) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::StructExpression>(loc_from(mark), std::move(struct_type), std::move(fields));
+    }
+
+    // a struct init needs `{ <name>:` to follow the type, otherwise the identifier
+    // is just an identifier and the `{` is the body of some `if`/`while`/etc.
+    [[nodiscard]] bool looks_like_struct_init() const noexcept {
+      auto brace = past_ws(pos_);
+
+      if (type_at(brace) != TokenType::lbrace) {
+        return false;
+      }
+
+      auto name = past_ws(brace + 1);
+
+      return type_at(name) == TokenType::identifier && type_at(past_ws(name + 1)) == TokenType::colon;
+    }
+
+    // maybeGenericIdentifier: modularIdentifier typeParamList? ('::' memberGenericIdentifier)*
+    //
+    // memberGenericIdentifier: IDENTIFIER typeParamList?
+    //
+    // only the `modularIdentifier` part ends up in the AST
+    std::optional<ast::UnqualifiedID> maybe_generic_identifier() noexcept {
+      auto module_id = modular_identifier();
+
+      if (!module_id) {
+        return std::nullopt;
+      }
+
+      if (at(TokenType::lt) && !type_param_list()) {
+        return std::nullopt;
+      }
+
+      while (accept(TokenType::colon_colon)) {
+        if (!expect_identifier() || (at(TokenType::lt) && !type_param_list())) {
+          return std::nullopt;
+        }
+      }
+
+      return ast::module_into_unqualified(std::move(*module_id));
+    }
+
+    //
+    // types
+    //
+
+    // type: ref=(AMPERSTAND_MUT | AMPERSTAND)? WHITESPACE* typeWithoutRef
+    std::unique_ptr<ast::Type> type() noexcept {
+      auto mark = pos_;
+
+      if (!at(TokenType::amp) && !at(TokenType::amp_mut)) {
+        skip_spaces();
+
+        return type_without_ref();
+      }
+
+      auto mut = peek().type == TokenType::amp_mut;
+
+      ++pos_;
+      skip_spaces();
+
+      auto referenced = type_without_ref();
+
+      if (referenced == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::ReferenceType>(loc_from(mark), mut, std::move(referenced));
+    }
+
+    // typeWithoutRef
+    //     : squareBracket='[' WHITESPACE* (mut='mut' WHITESPACE+)? typeWithoutRef WHITESPACE*
+    //       (';' WHITESPACE* DECIMAL_LITERAL)? ']'
+    //     | ptr=(STAR_CONST | STAR_MUT) (WHITESPACE+) typeWithoutRef
+    //     | BUILTIN_TYPE
+    //     | userDefinedType=maybeGenericIdentifier
+    //     | fnType='fn' WHITESPACE* '(' (WHITESPACE* genericTypeList WHITESPACE*)? ')' WHITESPACE+ '->' WHITESPACE+ type
+    //     | 'dyn' ws dynType=maybeGenericIdentifier
+    std::unique_ptr<ast::Type> type_without_ref() noexcept {
+      auto mark = pos_;
+
+      switch (peek().type) {
+        case TokenType::lbracket: return array_or_slice_type();
+        case TokenType::star_const:
+        case TokenType::star_mut: {
+          auto mut = peek().type == TokenType::star_mut;
+
+          ++pos_;
+
+          if (!expect_spaces()) {
+            return nullptr;
+          }
+
+          auto pointed_to = type_without_ref();
+
+          if (pointed_to == nullptr) {
+            return nullptr;
+          }
+
+          return std::make_unique<ast::PointerType>(loc_from(mark), mut, std::move(pointed_to));
+        }
+        case TokenType::builtin_type: {
+          auto name = text(tokens_[pos_++]);
+          auto result = gal::parse_builtin_type(name, loc_from(mark));
+
+          if (auto* notes = std::get_if<std::vector<std::string>>(&result)) {
+            push_error(1, loc_from(mark), *notes);
+
+            return std::make_unique<ast::ErrorType>();
+          }
+
+          return std::move(std::get<std::unique_ptr<ast::Type>>(result));
+        }
+        case TokenType::kw_fn: return fn_pointer_type();
+        case TokenType::kw_dyn: {
+          ++pos_;
+
+          if (!expect_ws()) {
+            return nullptr;
+          }
+
+          auto id = maybe_generic_identifier();
+
+          if (!id) {
+            return nullptr;
+          }
+
+          return std::make_unique<ast::UnqualifiedDynInterfaceType>(loc_from(mark),
+              std::move(*id),
+              std::vector<std::unique_ptr<ast::Type>>{});
+        }
+        case TokenType::identifier:
+        case TokenType::colon_colon: {
+          auto id = maybe_generic_identifier();
+
+          if (!id) {
+            return nullptr;
+          }
+
+          return std::make_unique<ast::UnqualifiedUserDefinedType>(loc_from(mark),
+              std::move(*id),
+              std::vector<std::unique_ptr<ast::Type>>{});
+        }
+        default: fail("expected a type"); return nullptr;
+      }
+    }
+
+    std::unique_ptr<ast::Type> array_or_slice_type() noexcept {
+      auto mark = pos_++;
+      auto mut = false;
+
+      skip_spaces();
+
+      if (accept(TokenType::kw_mut)) {
+        if (!expect_spaces()) {
+          return nullptr;
+        }
+
+        mut = true;
+      }
+
+      auto element = type_without_ref();
+
+      if (element == nullptr) {
+        return nullptr;
+      }
+
+      skip_spaces();
+
+      if (!accept(TokenType::semicolon)) {
+        if (!expect(TokenType::rbracket)) {
+          return nullptr;
+        }
+
+        return std::make_unique<ast::SliceType>(loc_from(mark), mut, std::move(element));
+      }
+
+      skip_spaces();
+
+      if (!at(TokenType::decimal_literal)) {
+        fail("expected an array length");
+
+        return nullptr;
+      }
+
+      auto length = text(tokens_[pos_++]);
+
+      if (!expect(TokenType::rbracket)) {
+        return nullptr;
+      }
+
+      auto parsed = gal::from_digits(length);
+
+      if (auto* error = std::get_if<std::error_code>(&parsed)) {
+        push_error(33, loc_from(mark), {absl::StrCat("unable to parse array len. error: `", error->message(), "`")});
+
+        return std::make_unique<ast::ErrorType>();
+      }
+
+      return std::make_unique<ast::ArrayType>(loc_from(mark), std::get<std::uint64_t>(parsed), std::move(element));
+    }
+
+    // genericTypeList: type WHITESPACE* (',' WHITESPACE* type)*
+    std::unique_ptr<ast::Type> fn_pointer_type() noexcept {
+      auto mark = pos_++;
+      auto args = std::vector<std::unique_ptr<ast::Type>>{};
+
+      skip_spaces();
+
+      if (!expect(TokenType::lparen)) {
+        return nullptr;
+      }
+
+      if (!at(TokenType::rparen)) {
+        skip_spaces();
+
+        do {
+          auto arg = type();
+
+          if (arg == nullptr) {
+            return nullptr;
+          }
+
+          args.push_back(std::move(arg));
+
+          if (args.size() == 1) {
+            skip_spaces();
+          }
+        } while (accept(TokenType::comma));
+
+        skip_spaces();
+      }
+
+      if (!expect(TokenType::rparen) || !expect_spaces() || !expect(TokenType::arrow) || !expect_spaces()) {
+        return nullptr;
+      }
+
+      auto return_type = type();
+
+      if (return_type == nullptr) {
+        return nullptr;
+      }
+
+      return std::make_unique<ast::FnPointerType>(loc_from(mark), std::move(args), std::move(return_type));
+    }
+
+    std::vector<Token> tokens_;
+    std::string_view source_;
+    gal::DiagnosticReporter* diagnostics_;
+    gal::FileID file_;
+    std::size_t pos_ = 0;
+    bool failed_ = false;
+    bool exported_ = false;
+  };
+} // namespace
+
+namespace gal {
+  std::optional<ast::Program> parse_fast(gal::FileID file, gal::DiagnosticReporter* reporter) noexcept {
+    // the arena is only handed to the program on success, otherwise it needs to outlive
+    // any nodes that were built before an error was found
+    auto arena = std::make_unique<gal::Arena>();
+    auto scope = gal::ArenaScope{arena.get()};
+    auto lexed = gal::lex(gal::sources().contents(file));
+
+    if (auto* error = std::get_if<gal::LexError>(&lexed)) {
+      auto parts = std::vector<std::unique_ptr<gal::DiagnosticPart>>{};
+
+      parts.push_back(gal::point_out(ast::SourceLoc(file, error->offset, error->length), gal::DiagnosticType::error));
+      parts.push_back(gal::single_message(std::move(error->message)));
+      reporter->report_emplace(5, std::move(parts));
+
+      return std::nullopt;
+    }
+
+    auto parser = FastParser{file, std::move(std::get<std::vector<gal::Token>>(lexed)), reporter};
+    auto decls = parser.parse();
+
+    if (!decls || reporter->had_error()) {
+      return std::nullopt;
+    }
+
+    return ast::Program(std::move(*decls), std::move(arena));
+  }
+} // namespace gal
@@ -0,0 +1,31 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../ast/program.h"
+#include "../errors/reporter.h"
+#include "../utility/source_manager.h"
+#include <optional>
+
+namespace gal {
+  /// Parses a file with the hand-written lexer and recursive-descent parser, which
+  /// builds the AST directly instead of going through an ANTLR parse tree first.
+  ///
+  /// This accepts the same language as `Gallium.g4` and produces the same AST that the ANTLR
+  /// parser does, except that it stops at the first syntax error instead of trying to recover,
+  /// and it rejects `class` declarations and `self` arguments (which the rest of the compiler
+  /// doesn't support yet either).
+  ///
+  /// \param file The file being parsed, must already be loaded into `gal::sources()`
+  /// \param reporter The reporter to send errors to
+  /// \return A possible AST
+  std::optional<ast::Program> parse_fast(gal::FileID file, DiagnosticReporter* reporter) noexcept;
+} // namespace gal
@@ -0,0 +1,534 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./lexer.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+  using gal::Token;
+  using gal::TokenType;
+
+  struct Spelling {
+    std::string_view text;
+    TokenType type;
+  };
+
+  // every token that is spelled like an identifier, these win over `IDENTIFIER` when they match exactly
+  constexpr Spelling words[] = {
+      {"import", TokenType::kw_import},
+      {"as", TokenType::kw_as},
+      {"from", TokenType::kw_from},
+      {"export", TokenType::kw_export},
+      {"const", TokenType::kw_const},
+      {"external", TokenType::kw_external},
+      {"extern", TokenType::kw_extern},
+      {"fn", TokenType::kw_fn},
+      {"self", TokenType::kw_self},
+      {"mut", TokenType::kw_mut},
+      {"class", TokenType::kw_class},
+      {"let", TokenType::kw_let},
+      {"struct", TokenType::kw_struct},
+      {"type", TokenType::kw_type},
+      {"assert", TokenType::kw_assert},
+      {"return", TokenType::kw_return},
+      {"break", TokenType::kw_break},
+      {"continue", TokenType::kw_continue},
+      {"len", TokenType::kw_len},
+      {"if", TokenType::kw_if},
+      {"then", TokenType::kw_then},
+      {"else", TokenType::kw_else},
+      {"elif", TokenType::kw_elif},
+      {"while", TokenType::kw_while},
+      {"loop", TokenType::kw_loop},
+      {"for", TokenType::kw_for},
+      {"sizeof", TokenType::kw_sizeof},
+      {"dyn", TokenType::kw_dyn},
+      {"and", TokenType::kw_and},
+      {"or", TokenType::kw_or},
+      {"xor", TokenType::kw_xor},
+      {"not", TokenType::kw_not},
+      {"to", TokenType::kw_to},
+      {"downto", TokenType::kw_downto},
+      {"pub", TokenType::kw_pub},
+      {"prot", TokenType::kw_prot},
+      {"priv", TokenType::kw_priv},
+      {"true", TokenType::bool_literal},
+      {"false", TokenType::bool_literal},
+      {"nil", TokenType::nil_literal},
+      {"__pure", TokenType::attr_pure},
+      {"__throws", TokenType::attr_throws},
+      {"__alwaysinline", TokenType::attr_always_inline},
+      {"__inline", TokenType::attr_inline},
+      {"__noinline", TokenType::attr_no_inline},
+      {"__malloc", TokenType::attr_malloc},
+      {"__hot", TokenType::attr_hot},
+      {"__cold", TokenType::attr_cold},
+      {"__noreturn", TokenType::attr_noreturn},
+      {"__stdlib", TokenType::attr_stdlib},
+      {"__varargs", TokenType::attr_varargs},
+      {"__mayalias", TokenType::attr_may_alias},
+      {"__novectorize", TokenType::attr_no_vectorize},
+      {"i8", TokenType::builtin_type},
+      {"i16", TokenType::builtin_type},
+      {"i32", TokenType::builtin_type},
+      {"i64", TokenType::builtin_type},
+      {"i128", TokenType::builtin_type},
+      {"isize", TokenType::builtin_type},
+      {"u8", TokenType::builtin_type},
+      {"u16", TokenType::builtin_type},
+      {"u32", TokenType::builtin_type},
+      {"u64", TokenType::builtin_type},
+      {"u128", TokenType::builtin_type},
+      {"usize", TokenType::builtin_type},
+      {"f32", TokenType::builtin_type},
+      {"f64", TokenType::builtin_type},
+      {"f128", TokenType::builtin_type},
+      {"byte", TokenType::builtin_type},
+      {"bool", TokenType::builtin_type},
+      {"char", TokenType::builtin_type},
+      {"void", TokenType::builtin_type},
+  };
+
+  // every token that starts with punctuation. the longest one that matches always wins
+  constexpr Spelling symbols[] = {
+      {"::", TokenType::colon_colon},
+      {"{", TokenType::lbrace},
+      {"}", TokenType::rbrace},
+      {"(", TokenType::lparen},
+      {")", TokenType::rparen},
+      {"[", TokenType::lbracket},
+      {"]", TokenType::rbracket},
+      {",", TokenType::comma},
+      {":", TokenType::colon},
+      {";", TokenType::semicolon},
+      {".", TokenType::dot},
+      {"..", TokenType::dot_dot},
+      {"..=", TokenType::dot_dot_eq},
+      {"->", TokenType::arrow},
+      {"=", TokenType::eq},
+      {"&self", TokenType::amp_self},
+      {"&mut", TokenType::amp_mut},
+      {"*const", TokenType::star_const},
+      {"*mut", TokenType::star_mut},
+      {"<", TokenType::lt},
+      {">", TokenType::gt},
+      {"<<", TokenType::lt_lt},
+      {"<=", TokenType::lt_eq},
+      {">=", TokenType::gt_eq},
+      {"==", TokenType::eq_eq},
+      {"!=", TokenType::bang_eq},
+      {"~", TokenType::tilde},
+      {"*", TokenType::star},
+      {"&", TokenType::amp},
+      {"^", TokenType::caret},
+      {"|", TokenType::pipe},
+      {"/", TokenType::slash},
+      {"%", TokenType::percent},
+      {"+", TokenType::plus},
+      {"-", TokenType::hyphen},
+      {":=", TokenType::walrus},
+      {"+=", TokenType::plus_eq},
+      {"-=", TokenType::hyphen_eq},
+      {"*=", TokenType::star_eq},
+      {"/=", TokenType::slash_eq},
+      {"%=", TokenType::percent_eq},
+      {"<<=", TokenType::lt_lt_eq},
+      {">>=", TokenType::gt_gt_eq},
+      {"&=", TokenType::amp_eq},
+      {"^=", TokenType::caret_eq},
+      {"|=", TokenType::pipe_eq},
+  };
+
+  // symbols grouped by their first character, longest first so the first match is the right one
+  using SymbolTable = std::array<std::vector<Spelling>, 128>;
+
+  const SymbolTable& symbol_table() noexcept {
+    static const auto table = [] {
+      auto result = SymbolTable{};
+
+      for (auto symbol : symbols) {
+        result[static_cast<unsigned char>(symbol.text[0])].push_back(symbol);
+      }
+
+      for (auto& list : result) {
+        std::sort(list.begin(), list.end(), [](Spelling lhs, Spelling rhs) {
+          return lhs.text.size() > rhs.text.size();
+        });
+      }
+
+      return result;
+    }();
+
+    return table;
+  }
+
+  struct VectorElement {
+    std::string_view name;
+    std::uint64_t max_lanes;
+  };
+
+  // vectors are capped at 512 bits, the widest registers that any target has
+  constexpr VectorElement vector_elements[] = {
+      {"i8", 64},
+      {"u8", 64},
+      {"bool", 64},
+      {"i16", 32},
+      {"u16", 32},
+      {"i32", 16},
+      {"u32", 16},
+      {"f32", 16},
+      {"i64", 8},
+      {"u64", 8},
+      {"f64", 8},
+  };
+
+  const absl::flat_hash_map<std::string_view, TokenType>& word_table() noexcept {
+    static const auto table = [] {
+      auto result = absl::flat_hash_map<std::string_view, TokenType>{};
+
+      for (auto word : words) {
+        result.emplace(word.text, word.type);
+      }
+
+      return result;
+    }();
+
+    return table;
+  }
+
+  // anything non-ASCII is let into identifiers, see the comment on `gal::lex`
+  bool is_identifier_start(char c) noexcept {
+    return absl::ascii_isalpha(static_cast<unsigned char>(c)) || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+  }
+
+  bool is_identifier_continue(char c) noexcept {
+    return is_identifier_start(c) || absl::ascii_isdigit(static_cast<unsigned char>(c));
+  }
+
+  bool is_octal(char c) noexcept {
+    return c >= '0' && c <= '7';
+  }
+
+  bool is_digit(char c) noexcept {
+    return absl::ascii_isdigit(static_cast<unsigned char>(c));
+  }
+
+  bool is_hex(char c) noexcept {
+    return absl::ascii_isxdigit(static_cast<unsigned char>(c));
+  }
+
+  class Lexer {
+  public:
+    explicit Lexer(std::string_view source) noexcept : source_{source} {}
+
+    std::variant<std::vector<Token>, gal::LexError> lex() noexcept {
+      // a token every ~4 bytes is about what real code ends up with
+      tokens_.reserve(source_.size() / 4 + 1);
+
+      while (i_ < source_.size()) {
+        if (!next()) {
+          return std::move(error_);
+        }
+      }
+
+      push(TokenType::eof, 0);
+
+      return std::move(tokens_);
+    }
+
+  private:
+    [[nodiscard]] char at(std::size_t index) const noexcept {
+      return (index < source_.size()) ? source_[index] : '\0';
+    }
+
+    void push(TokenType type, std::size_t length) noexcept {
+      tokens_.push_back(Token{type, static_cast<std::uint32_t>(i_), static_cast<std::uint32_t>(length)});
+
+      i_ += length;
+    }
+
+    [[nodiscard]] bool fail(std::size_t length, std::string message) noexcept {
+      error_ = gal::LexError{static_cast<std::uint32_t>(i_), static_cast<std::uint32_t>(length), std::move(message)};
+
+      return false;
+    }
+
+    [[nodiscard]] bool next() noexcept {
+      auto c = source_[i_];
+
+      switch (c) {
+        case ' ':
+        case '\t': push(TokenType::whitespace, 1); return true;
+        case '\n': push(TokenType::newline, 1); return true;
+        case '\r':
+          if (at(i_ + 1) == '\n') {
+            push(TokenType::newline, 2);
+
+            return true;
+          }
+
+          return fail(1, "a carriage return must be followed by a newline");
+        case '"': return string_literal();
+        case '\'': return char_literal();
+        default: break;
+      }
+
+      if (c == '/' && at(i_ + 1) == '/') {
+        while (i_ < source_.size() && source_[i_] != '\n' && source_[i_] != '\r') {
+          ++i_;
+        }
+
+        return true;
+      }
+
+      // an unterminated block comment isn't an error on its own, it just lexes as `/` followed by `*`
+      if (c == '/' && at(i_ + 1) == '*') {
+        if (auto end = source_.find("*/", i_ + 2); end != std::string_view::npos) {
+          i_ = end + 2;
+
+          return true;
+        }
+      }
+
+      if (is_digit(c)) {
+        number();
+
+        return true;
+      }
+
+      if (is_identifier_start(c)) {
+        word();
+
+        return true;
+      }
+
+      return symbol();
+    }
+
+    void number() noexcept {
+      auto type = TokenType::decimal_literal;
+      auto end = i_;
+
+      if (source_[i_] == '0' && at(i_ + 1) == 'o' && is_octal(at(i_ + 2))) {
+        type = TokenType::octal_literal;
+
+        for (end = i_ + 2; is_octal(at(end)); ++end) {}
+      } else if (source_[i_] == '0' && at(i_ + 1) == 'x' && is_hex(at(i_ + 2))) {
+        type = TokenType::hex_literal;
+
+        for (end = i_ + 2; is_hex(at(end)); ++end) {}
+      } else {
+        for (; is_digit(at(end)); ++end) {}
+      }
+
+      push(type, end - i_);
+    }
+
+    void word() noexcept {
+      auto end = i_;
+
+      for (; end < source_.size() && is_identifier_continue(source_[end]); ++end) {}
+
+      auto text = source_.substr(i_, end - i_);
+
+      // the only literal tokens that start like a word but don't end like one
+      if (text == "__arch" && at(end) == '(') {
+        push(TokenType::attr_arch, text.size() + 1);
+      } else if (text == "__vectorize" && at(end) == '(') {
+        push(TokenType::attr_vectorize, text.size() + 1);
+      } else if (text == "__unroll" && at(end) == '(') {
+        push(TokenType::attr_unroll, text.size() + 1);
+      } else if (text == "as" && at(end) == '!') {
+        push(TokenType::as_bang, text.size() + 1);
+      } else if (auto it = word_table().find(text); it != word_table().end()) {
+        push(it->second, text.size());
+      } else if (gal::is_vector_type_name(text)) {
+        push(TokenType::builtin_type, text.size());
+      } else {
+        push(TokenType::identifier, text.size());
+      }
+    }
+
+    [[nodiscard]] bool symbol() noexcept {
+      auto c = static_cast<unsigned char>(source_[i_]);
+
+      if (c < 128) {
+        for (auto symbol : symbol_table()[c]) {
+          if (absl::StartsWith(source_.substr(i_), symbol.text)) {
+            push(symbol.type, symbol.text.size());
+
+            return true;
+          }
+        }
+      }
+
+      return fail(1, absl::StrCat("unexpected character `", source_.substr(i_, 1), "`"));
+    }
+
+    // checks that the escape sequence starting with the `\` at `index` is valid,
+    // and returns the length of the part that can't also be read as plain characters
+    [[nodiscard]] std::size_t escape_prefix(std::size_t index) const noexcept {
+      switch (at(index + 1)) {
+        case '0':
+        case 'n':
+        case 'r':
+        case 't':
+        case 'v':
+        case '\'':
+        case '"':
+        case '\\':
+        case 'a':
+        case 'b':
+        case 'f': return 2;
+        case 'o': return (is_octal(at(index + 2)) && is_octal(at(index + 3)) && is_octal(at(index + 4))) ? 2 : 0;
+        case 'x': return (is_hex(at(index + 2)) && is_hex(at(index + 3))) ? 2 : 0;
+        default: return (is_digit(at(index + 1)) && is_digit(at(index + 2)) && is_digit(at(index + 3))) ? 2 : 0;
+      }
+    }
+
+    [[nodiscard]] bool string_literal() noexcept {
+      for (auto end = i_ + 1; end < source_.size();) {
+        switch (source_[end]) {
+          case '"': push(TokenType::string_literal, end + 1 - i_); return true;
+          case '\n':
+          case '\r': return fail(end - i_, "unterminated string literal");
+          case '\\': {
+            auto len = escape_prefix(end);
+
+            if (len == 0) {
+              return fail(end - i_, "invalid escape sequence in string literal");
+            }
+
+            end += len;
+            break;
+          }
+          default: ++end; break;
+        }
+      }
+
+      return fail(source_.size() - i_, "unterminated string literal");
+    }
+
+    [[nodiscard]] bool char_literal() noexcept {
+      auto begin = i_ + 1;
+      auto c = at(begin);
+      auto end = begin + 1;
+
+      if (c == '\\') {
+        auto next = at(begin + 1);
+
+        if (next == 'o') {
+          for (end = begin + 2; is_octal(at(end)); ++end) {}
+
+          // the grammar's octal escape is three runs of octal digits, i.e. at least 3 of them
+          end = (end - (begin + 2) >= 3) ? end : 0;
+        } else if (next == 'x') {
+          end = escape_prefix(begin) != 0 ? begin + 4 : 0;
+        } else if (is_digit(next) && at(begin + 2) != '\'') {
+          end = (is_digit(at(begin + 2)) && is_digit(at(begin + 3))) ? begin + 4 : 0;
+        } else {
+          end = escape_prefix(begin) != 0 ? begin + 2 : 0;
+        }
+      } else if (c == '"' || c == '\n' || c == '\r' || begin >= source_.size()) {
+        end = 0;
+      } else if (static_cast<unsigned char>(c) >= 0x80) {
+        // a single code point, not a single byte
+        for (; (static_cast<unsigned char>(at(end)) & 0xC0) == 0x80; ++end) {}
+      }
+
+      if (end == 0 || at(end) != '\'') {
+        return fail(1, "invalid character literal");
+      }
+
+      push(TokenType::char_literal, end + 1 - i_);
+
+      return true;
+    }
+
+    std::string_view source_;
+    std::size_t i_ = 0;
+    std::vector<Token> tokens_;
+    gal::LexError error_;
+  };
+} // namespace
+
+namespace gal {
+  std::variant<std::vector<Token>, LexError> lex(std::string_view source) noexcept {
+    return Lexer{source}.lex();
+  }
+
+  std::string_view token_spelling(TokenType type) noexcept {
+    switch (type) {
+      case TokenType::whitespace: return "whitespace";
+      case TokenType::newline: return "newline";
+      case TokenType::eof: return "end of file";
+      case TokenType::identifier: return "identifier";
+      case TokenType::builtin_type: return "builtin type";
+      case TokenType::string_literal: return "string literal";
+      case TokenType::char_literal: return "char literal";
+      case TokenType::decimal_literal:
+      case TokenType::hex_literal:
+      case TokenType::octal_literal: return "integer literal";
+      case TokenType::bool_literal: return "bool literal";
+      default: break;
+    }
+
+    for (auto word : words) {
+      if (word.type == type) {
+        return word.text;
+      }
+    }
+
+    for (auto symbol : symbols) {
+      if (symbol.type == type) {
+        return symbol.text;
+      }
+    }
+
+    switch (type) {
+      case TokenType::attr_arch: return "__arch(";
+      case TokenType::attr_vectorize: return "__vectorize(";
+      case TokenType::attr_unroll: return "__unroll(";
+      case TokenType::as_bang: return "as!";
+      default: return "<unknown>";
+    }
+  }
+
+  bool is_vector_type_name(std::string_view name) noexcept {
+    auto x = name.rfind('x');
+
+    if (x == std::string_view::npos) {
+      return false;
+    }
+
+    auto element = name.substr(0, x);
+    auto lanes = name.substr(x + 1);
+
+    for (auto [candidate, max_lanes] : vector_elements) {
+      if (candidate != element) {
+        continue;
+      }
+
+      // lane counts are powers of two from 2 up, and have to be spelled without leading zeros
+      for (auto count = std::uint64_t{2}; count <= max_lanes; count *= 2) {
+        if (lanes == absl::StrCat(count)) {
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+} // namespace gal
@@ -0,0 +1,175 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace gal {
+  /// Every kind of token that `lex` produces. These mirror the tokens in `Gallium.g4`,
+  /// including the implicit ones that ANTLR creates for literal strings in parser rules
+  enum class TokenType : std::uint8_t {
+    whitespace, // ' ' or '\t', one token per character like the grammar
+    newline,    // '\n' or '\r\n'
+    eof,
+    identifier,
+    builtin_type,
+    string_literal,
+    char_literal,
+    decimal_literal,
+    hex_literal,
+    octal_literal,
+    bool_literal,
+    nil_literal,
+    kw_import,
+    kw_as,
+    kw_from,
+    kw_export,
+    kw_const,
+    kw_external,
+    kw_extern,
+    kw_fn,
+    kw_self,
+    kw_mut,
+    kw_class,
+    kw_let,
+    kw_struct,
+    kw_type,
+    kw_assert,
+    kw_return,
+    kw_break,
+    kw_continue,
+    kw_len,
+    kw_if,
+    kw_then,
+    kw_else,
+    kw_elif,
+    kw_while,
+    kw_loop,
+    kw_for,
+    kw_sizeof,
+    kw_dyn,
+    kw_and,
+    kw_or,
+    kw_xor,
+    kw_not,
+    kw_to,
+    kw_downto,
+    kw_pub,
+    kw_prot,
+    kw_priv,
+    attr_pure,
+    attr_throws,
+    attr_always_inline,
+    attr_inline,
+    attr_no_inline,
+    attr_malloc,
+    attr_hot,
+    attr_cold,
+    attr_arch, // `__arch(`, the paren is part of the token
+    attr_noreturn,
+    attr_stdlib,
+    attr_varargs,
+    attr_may_alias,
+    attr_vectorize, // `__vectorize(`, the paren is part of the token
+    attr_unroll,    // `__unroll(`, the paren is part of the token
+    attr_no_vectorize,
+    colon_colon,
+    lbrace,
+    rbrace,
+    lparen,
+    rparen,
+    lbracket,
+    rbracket,
+    comma,
+    colon,
+    semicolon,
+    dot,
+    dot_dot,
+    dot_dot_eq,
+    arrow,
+    eq,
+    as_bang,
+    amp_self,
+    amp_mut,
+    star_const,
+    star_mut,
+    lt,
+    gt,
+    lt_lt,
+    lt_eq,
+    gt_eq,
+    eq_eq,
+    bang_eq,
+    tilde,
+    star,
+    amp,
+    caret,
+    pipe,
+    slash,
+    percent,
+    plus,
+    hyphen,
+    walrus,
+    plus_eq,
+    hyphen_eq,
+    star_eq,
+    slash_eq,
+    percent_eq,
+    lt_lt_eq,
+    gt_gt_eq,
+    amp_eq,
+    caret_eq,
+    pipe_eq,
+  };
+
+  /// A single token. Tokens don't own their text, it's looked up
+  /// in the source code with `offset` and `length` when it's needed
+  struct Token {
+    TokenType type;
+    std::uint32_t offset;
+    std::uint32_t length;
+  };
+
+  /// Where the lexer gave up, and why
+  struct LexError {
+    std::uint32_t offset;
+    std::uint32_t length;
+    std::string message;
+  };
+
+  /// Splits source code into tokens following the lexer rules in `Gallium.g4`. Comments
+  /// are dropped, whitespace and newlines are kept since the grammar depends on them.
+  ///
+  /// Unlike the ANTLR lexer, any non-ASCII character is accepted as part of an identifier
+  /// rather than only the ones in `XID_Start`/`XID_Continue`.
+  ///
+  /// \param source The source code to split up
+  /// \return Every token in the source (ending with `TokenType::eof`), or the first error
+  [[nodiscard]] std::variant<std::vector<Token>, LexError> lex(std::string_view source) noexcept;
+
+  /// Gets the way a token type is written in source code (or a description of
+  /// it for tokens without fixed text), for use in error messages
+  ///
+  /// \param type The token type
+  /// \return A human-readable name for the token
+  [[nodiscard]] std::string_view token_spelling(TokenType type) noexcept;
+
+  /// Checks whether a word is the name of one of the builtin SIMD vector types, i.e
+  /// `f32x4` or `boolx16`. These mirror the `VECTOR_TYPE` fragment in `Gallium.g4`
+  ///
+  /// \param name The word to check
+  /// \return Whether `name` is a vector type
+  [[nodiscard]] bool is_vector_type_name(std::string_view name) noexcept;
+} // namespace gal
@@ -0,0 +1,140 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./literals.h"
+#include "./lexer.h"
+#include "absl/strings/ascii.h"
+#include <cassert>
+#include <cctype>
+
+namespace gal {
+  std::variant<std::uint8_t, std::string> parse_single_char(std::string_view full) noexcept {
+    if (full[0] != '\\') {
+      return static_cast<std::uint8_t>(full[0]);
+    }
+
+    if (full[1] == 'o' || full[1] == 'x' || std::isdigit(full[1])) {
+      auto digits = full.substr(2);
+      auto result = parse_value<std::uint8_t>(digits, full[1] == 'o' ? 8 : full[1] == 'x' ? 16 : 10, "char");
+
+      if (std::holds_alternative<std::string>(result)) {
+        return std::move(std::get<std::string>(result));
+      }
+
+      return std::get<std::uint8_t>(result);
+    }
+
+    // we can't do two implicit conversions when returning
+    // to a `std::variant`, so its either that or `return static_cast<std::uint8_t>(c)`
+    auto value = std::uint8_t{0};
+
+    switch (full[1]) {
+      case '0': value = '\0'; break;
+      case 'n': value = '\n'; break;
+      case 'r': value = '\r'; break;
+      case 't': value = '\t'; break;
+      case 'v': value = '\v'; break;
+      case '\\': value = '\\'; break;
+      case '"': value = '"'; break;
+      case '\'': value = '\''; break;
+      case 'a': value = '\a'; break;
+      case 'b': value = '\b'; break;
+      case 'f': value = '\f'; break;
+      default: assert(false); break; // should be impossible with the grammar
+    }
+
+    return value;
+  }
+
+  std::optional<std::string> validate_string_literal(std::string_view full) noexcept {
+    for (auto i = std::size_t{0}; i < full.size(); ++i) {
+      if (full[i] != '\\') {
+        continue;
+      }
+
+      auto next = full[i + 1];
+      auto len = (next == 'o')                         ? 3  // octal = 3 digits
+                 : (next == 'x')                       ? 2  // hex = 2 digits
+                 : (std::isdigit(next) && next != '0') ? 3  // decimal = 3 digits, but \0 is 1
+                                                       : 1; // all others are 1
+
+      // len + 1 because want to take the `\` as well as `len` next chars
+      auto parsed = parse_single_char(full.substr(i, len + 1));
+
+      if (auto* error = std::get_if<std::string>(&parsed)) {
+        return std::move(*error);
+      }
+
+      // ensure that we actually skip the characters we parsed
+      i += len;
+    }
+
+    return std::nullopt;
+  }
+
+  std::variant<std::unique_ptr<ast::Type>, std::vector<std::string>> parse_builtin_type(std::string_view name,
+      ast::SourceLoc loc) noexcept {
+    if (name == "bool") {
+      return std::make_unique<ast::BuiltinBoolType>(std::move(loc));
+    } else if (name == "byte") {
+      return std::make_unique<ast::BuiltinByteType>(std::move(loc));
+    } else if (name == "char") {
+      return std::make_unique<ast::BuiltinCharType>(std::move(loc));
+    } else if (name == "void") {
+      return std::make_unique<ast::VoidType>(std::move(loc));
+    } else if (gal::is_vector_type_name(name)) {
+      auto x = name.rfind('x');
+      auto element = parse_builtin_type(name.substr(0, x), loc);
+      auto lanes = std::get<std::uint64_t>(gal::from_digits(name.substr(x + 1), 10));
+
+      return std::make_unique<ast::VectorType>(std::move(loc),
+          lanes,
+          std::move(std::get<std::unique_ptr<ast::Type>>(element)));
+    }
+
+    assert(name[0] == 'i' || name[0] == 'u' || name[0] == 'f');
+
+    // split into ['', width]
+    auto rest = name.substr(1);
+
+    if (rest == "size") {
+      return std::make_unique<ast::BuiltinIntegralType>(std::move(loc), name[0] == 'i', ast::IntegerWidth::native_width);
+    }
+
+    auto result = gal::from_digits(rest, 10);
+
+    if (auto* error = std::get_if<std::error_code>(&result)) {
+      return std::vector{
+          absl::StrCat("error from integer parser: '", absl::StripAsciiWhitespace(error->message()), "'")};
+    }
+
+    auto real_width = std::get<std::uint64_t>(result);
+
+    if (name[0] == 'f') {
+      if (real_width != 32 && real_width != 64 && real_width != 128) {
+        return std::vector<std::string>{};
+      }
+
+      auto float_width = (real_width == 32)   ? ast::FloatWidth::ieee_single
+                         : (real_width == 64) ? ast::FloatWidth::ieee_double
+                                              : ast::FloatWidth::ieee_quadruple;
+
+      return std::make_unique<ast::BuiltinFloatType>(std::move(loc), float_width);
+    }
+
+    if (real_width == 8 || real_width == 16 || real_width == 32 || real_width == 64 || real_width == 128) {
+      return std::make_unique<ast::BuiltinIntegralType>(std::move(loc),
+          name[0] == 'i',
+          static_cast<ast::IntegerWidth>(real_width));
+    }
+
+    return std::vector<std::string>{};
+  }
+} // namespace gal
@@ -0,0 +1,89 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../ast/nodes.h"
+#include "../utility/misc.h"
+#include "absl/strings/str_cat.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+//
+// turning the text of literal tokens into values is shared between both parsers,
+// so that they can't disagree about what a literal means or which ones are errors
+//
+
+namespace gal {
+  /// Parses a sequence of digits into an unsigned integer, and checks that
+  /// it fits into `ResultType`
+  ///
+  /// \param digits The digits to parse, without any prefix
+  /// \param base The base that `digits` is in
+  /// \param gallium_type The name of the literal type, used in the error message
+  /// \return The value, or a human-readable error message
+  template <typename ResultType>
+  [[nodiscard]] std::variant<ResultType, std::string> parse_value(std::string_view digits,
+      int base,
+      std::string_view gallium_type) noexcept {
+    static_assert(std::is_unsigned_v<ResultType>);
+
+    auto result = gal::from_digits(digits, base);
+
+    if (auto* error = std::get_if<std::error_code>(&result)) {
+      return error->message();
+    }
+
+    auto value = std::get<std::uint64_t>(result);
+
+    if (auto converted = gal::try_narrow<ResultType>(value)) {
+      return *converted;
+    }
+
+    // while we could make `from_chars` do out-of-range checking,
+    // we want a nice error message in the normal case of "slightly out of range"
+    // it will still do out-of-range checking but will give a much worse
+    // error message when it's out of bounds for 64-bit
+    return absl::StrCat("value '",
+        digits,
+        "' parse to `",
+        value,
+        "` which is outside the range for a `",
+        gallium_type,
+        "` literal");
+  }
+
+  /// Parses a single (possibly escaped) character, i.e the inside of a character literal
+  ///
+  /// \param full The text of the character, without any quotes
+  /// \return The byte the character represents, or a human-readable error message
+  [[nodiscard]] std::variant<std::uint8_t, std::string> parse_single_char(std::string_view full) noexcept;
+
+  /// Checks that every escape sequence in a string literal is valid
+  ///
+  /// \param full The full text of the literal, quotes included
+  /// \return An error message if any of the escapes were invalid
+  [[nodiscard]] std::optional<std::string> validate_string_literal(std::string_view full) noexcept;
+
+  /// Turns the name of a builtin type (e.g. `i32`, `f64`, `bool` or `f32x4`) into the type it names
+  ///
+  /// \param name The text of the builtin type token
+  /// \param loc The location of the type
+  /// \return The type, or the notes for an error with code 1 if the type is invalid
+  [[nodiscard]] std::variant<std::unique_ptr<ast::Type>, std::vector<std::string>> parse_builtin_type(
+      std::string_view name,
+      ast::SourceLoc loc) noexcept;
+} // namespace gal
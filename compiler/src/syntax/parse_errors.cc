@@ -14,7 +14,7 @@
 #include "absl/strings/str_split.h"
 #include "antlr4-common.h"
 #include "antlr4-runtime.h"
-#include <filesystem>
+#include <algorithm>
 #include <memory>
 
 namespace ast = gal::ast;
@@ -32,20 +32,49 @@ namespace {
 } // namespace
 
 namespace gal {
-  ParserErrorListener::ParserErrorListener(std::filesystem::path file, gal::DiagnosticReporter* reporter) noexcept
+  OffsetMap::OffsetMap(std::string_view source) noexcept : size_{source.size()} {
+    auto is_ascii = std::all_of(source.begin(), source.end(), [](char c) {
+      return static_cast<unsigned char>(c) < 0x80;
+    });
+
+    if (is_ascii) {
+      return;
+    }
+
+    // every byte that isn't a UTF-8 continuation byte starts a new code point
+    for (auto i = std::size_t{0}; i < source.size(); ++i) {
+      if ((static_cast<unsigned char>(source[i]) & 0xC0) != 0x80) {
+        offsets_.push_back(static_cast<std::uint32_t>(i));
+      }
+    }
+
+    size_ = offsets_.size();
+
+    // one-past-the-end, for EOF and for exclusive ends of ranges
+    offsets_.push_back(static_cast<std::uint32_t>(source.size()));
+  }
+
+  ParserErrorListener::ParserErrorListener(gal::FileID file,
+      const gal::OffsetMap* offsets,
+      gal::DiagnosticReporter* reporter) noexcept
       : diagnostics_{reporter},
-        file_{std::move(file)} {}
+        offsets_{offsets},
+        file_{file} {}
 
   void ParserErrorListener::syntaxError(antlr4::Recognizer*,
       antlr4::Token* token,
-      size_t line,
-      size_t col,
+      size_t,
+      size_t,
       const std::string& msg,
       std::exception_ptr) {
     auto diagnostics = std::vector<std::unique_ptr<gal::DiagnosticPart>>{};
 
     if (token != nullptr) {
-      auto loc = ast::SourceLoc(token->getText(), line, col, file_);
+      auto begin = offsets_->byte_offset(token->getStartIndex());
+      auto end = (token->getStopIndex() + 1 > token->getStartIndex()) // EOF has `stop == start - 1`
+                     ? offsets_->byte_offset(token->getStopIndex() + 1)
+                     : begin;
+      auto loc = ast::SourceLoc(file_, begin, end - begin);
       diagnostics.push_back(underline_for(std::move(loc), gal::DiagnosticType::error));
     }
     if (auto idx = msg.find('{'); idx != std::string::npos) {
@@ -10,12 +10,57 @@
 #pragma once
 
 #include "../errors/diagnostics.h"
+#include <algorithm>
 #include "../errors/reporter.h"
 #include <antlr4-runtime.h>
-#include <filesystem>
+#include <cstdint>
 #include <optional>
+#include <string_view>
+#include <vector>
 
 namespace gal {
+  /// ANTLR indexes into its input by code point rather than by byte, this maps
+  /// those indices back into byte offsets into the original source text
+  class OffsetMap {
+  public:
+    /// Creates an offset map for a source file
+    ///
+    /// \param source The source text being parsed
+    explicit OffsetMap(std::string_view source) noexcept;
+
+    /// Maps a code-point index from ANTLR into a byte offset
+    ///
+    /// \param index The index that ANTLR gave
+    /// \return The byte offset into the source text
+    [[nodiscard]] std::uint32_t byte_offset(std::size_t index) const noexcept {
+      // pure ASCII files (the usual case) don't need a table at all
+      return offsets_.empty() ? static_cast<std::uint32_t>(index) : offsets_[index];
+    }
+
+    /// Maps a byte offset back into a code-point index, the inverse of `byte_offset`
+    ///
+    /// \param offset The byte offset, must be the start of a code point
+    /// \return The index that ANTLR would use for that code point
+    [[nodiscard]] std::size_t index_of(std::uint32_t offset) const noexcept {
+      if (offsets_.empty()) {
+        return offset;
+      }
+
+      return static_cast<std::size_t>(std::lower_bound(offsets_.begin(), offsets_.end(), offset) - offsets_.begin());
+    }
+
+    /// Gets the number of code points in the source text
+    ///
+    /// \return The length of the source, in code points
+    [[nodiscard]] std::size_t size() const noexcept {
+      return size_;
+    }
+
+  private:
+    std::vector<std::uint32_t> offsets_;
+    std::size_t size_;
+  };
+
   /// Helps to improve general ANTLR parse errors from the terrible default
   /// that they produce
   class ParserErrorListener final : public antlr4::BaseErrorListener {
@@ -23,7 +68,11 @@ namespace gal {
     /// Creates a ParserErrorListener.
     ///
     /// \param file The file being parsed
-    explicit ParserErrorListener(std::filesystem::path file, gal::DiagnosticReporter* reporter) noexcept;
+    /// \param offsets The offset map for the file being parsed
+    /// \param reporter The reporter to send errors to
+    explicit ParserErrorListener(gal::FileID file,
+        const gal::OffsetMap* offsets,
+        gal::DiagnosticReporter* reporter) noexcept;
 
     void syntaxError(antlr4::Recognizer* recognizer,
         antlr4::Token* token,
@@ -39,6 +88,7 @@ namespace gal {
     void push_error(std::vector<std::unique_ptr<gal::DiagnosticPart>> diagnostics) noexcept;
 
     gal::DiagnosticReporter* diagnostics_;
-    std::filesystem::path file_;
+    const gal::OffsetMap* offsets_;
+    gal::FileID file_;
   };
 } // namespace gal
@@ -11,9 +11,17 @@
 #include "./parser.h"
 #include "../ast/nodes.h"
 #include "../ast/program.h"
+#include "../errors/buffered_reporter.h"
 #include "../errors/reporter.h"
+#include "../utility/arena.h"
 #include "../utility/misc.h"
+#include "../utility/source_manager.h"
+#include "../utility/thread_pool.h"
+#include "./fast_parser.h"
+#include "./lexer.h"
+#include "./literals.h"
 #include "./parse_errors.h"
+#include "./source_stream.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/charconv.h"
 #include "absl/strings/str_split.h"
@@ -21,12 +29,15 @@
 #include "generated/GalliumBaseVisitor.h"
 #include "generated/GalliumLexer.h"
 #include "generated/GalliumParser.h"
+#include <algorithm>
 #include <charconv>
 #include <limits>
 #include <optional>
 #include <sstream>
 #include <string_view>
 #include <type_traits>
+#include <variant>
+#include <vector>
 
 /*
  * the ANTLR C++ API is absolutely terrible and doesn't actually allow
@@ -48,14 +59,27 @@ namespace {
 
   class ASTGenerator final : public GalliumBaseVisitor {
   public:
-    explicit ASTGenerator(gal::DiagnosticReporter* reporter) noexcept : diagnostics_{reporter} {}
+    explicit ASTGenerator(gal::DiagnosticReporter* reporter, const gal::OffsetMap* offsets) noexcept
+        : diagnostics_{reporter},
+          offsets_{offsets} {}
 
-    std::optional<ast::Program> into_ast(std::string_view source,
-        std::filesystem::path path,
+    std::optional<ast::Program> into_ast(gal::FileID file,
+        GalliumParser::ParseContext* parse_tree,
+        std::unique_ptr<gal::Arena>* arena) noexcept {
+      auto decls = lower(file, parse_tree);
+
+      if (diagnostics_->had_error()) {
+        return std::nullopt;
+      } else {
+        return ast::Program(std::move(decls), std::move(*arena));
+      }
+    }
+
+    std::vector<std::unique_ptr<ast::Declaration>> lower(gal::FileID file,
         GalliumParser::ParseContext* parse_tree) noexcept {
       auto decls = std::vector<std::unique_ptr<ast::Declaration>>{};
-      path_ = std::move(path);
-      original_ = source;
+      file_ = file;
+      original_ = gal::sources().contents(file);
 
       for (auto* decl : parse_tree->modularizedDeclaration()) {
         visitModularizedDeclaration(decl);
@@ -63,11 +87,7 @@ namespace {
         decls.push_back(return_value<ast::Declaration>());
       }
 
-      if (diagnostics_->had_error()) {
-        return std::nullopt;
-      } else {
-        return ast::Program(std::move(decls));
-      }
+      return decls;
     }
 
     antlrcpp::Any visitModularIdentifier(GalliumParser::ModularIdentifierContext* ctx) final {
@@ -99,7 +119,7 @@ namespace {
         std::vector<ast::FullyQualifiedID> ids;
 
         for (auto* id : list->identifierList()->IDENTIFIER()) {
-          ids.emplace_back(module_id.to_string(), id->toString());
+          ids.emplace_back(module_id.module_string(), id->toString());
         }
 
         RETURN(std::make_unique<ast::ImportFromDeclaration>(loc_from(ctx), exported_, std::move(ids)));
@@ -200,9 +220,9 @@ namespace {
     antlrcpp::Any visitFnAttribute(GalliumParser::FnAttributeContext* ctx) final {
       using Type = ast::AttributeType;
 
-      auto start = ctx->getStart()->getStartIndex();
-      auto stop = ctx->getStop()->getStopIndex();
-      auto attribute = original_.substr(start, (stop - start) + 1);
+      auto start = offsets_->byte_offset(ctx->getStart()->getStartIndex());
+      auto stop = offsets_->byte_offset(ctx->getStop()->getStopIndex() + 1);
+      auto attribute = original_.substr(start, stop - start);
 
       if (attribute.find("__arch") != std::string::npos) {
         return ast::Attribute{Type::builtin_arch, {ctx->STRING_LITERAL()->toString()}};
@@ -220,6 +240,7 @@ namespace {
           {"__noreturn", Type::builtin_noreturn},
           {"__stdlib", Type::builtin_stdlib},
           {"__varargs", Type::builtin_varargs},
+          {"__mayalias", Type::builtin_may_alias},
       };
 
       // will throw and end up crashing if one is ever not in the map
@@ -431,12 +452,18 @@ namespace {
         auto body = parse_block(ctx->blockExpression());
         auto direction =
             (ctx->direction->getType() == GalliumParser::TO) ? ast::ForDirection::up_to : ast::ForDirection::down_to;
+        auto attributes = std::vector<ast::LoopAttribute>{};
+
+        if (auto* list = ctx->loopAttributeList()) {
+          attributes = std::move(visitLoopAttributeList(list).as<std::vector<ast::LoopAttribute>>());
+        }
 
         RETURN(std::make_unique<ast::ForExpression>(loc_from(ctx),
             std::move(loop_var),
             direction,
             std::move(initializer),
             std::move(until),
+            std::move(attributes),
             std::move(body)));
       } else {
         auto body = parse_block(ctx->blockExpression());
@@ -445,6 +472,33 @@ namespace {
       }
     }
 
+    antlrcpp::Any visitLoopAttributeList(GalliumParser::LoopAttributeListContext* ctx) final {
+      auto attributes = std::vector<ast::LoopAttribute>{};
+
+      for (auto* attribute : ctx->loopAttribute()) {
+        attributes.push_back(visitLoopAttribute(attribute).as<ast::LoopAttribute>());
+      }
+
+      return {std::move(attributes)};
+    }
+
+    antlrcpp::Any visitLoopAttribute(GalliumParser::LoopAttributeContext* ctx) final {
+      using Type = ast::LoopAttributeType;
+
+      auto* count = ctx->DECIMAL_LITERAL();
+
+      if (count == nullptr) {
+        return ast::LoopAttribute{Type::builtin_no_vectorize, 0};
+      }
+
+      // anything too large to parse is left for the type checker to reject as out of range
+      auto parsed = gal::parse_value<std::uint64_t>(count->toString(), 10, "loop hint");
+      auto* value = std::get_if<std::uint64_t>(&parsed);
+      auto type = (ctx->getStart()->getText() == "__unroll(") ? Type::builtin_unroll : Type::builtin_vectorize;
+
+      return ast::LoopAttribute{type, (value != nullptr) ? *value : std::numeric_limits<std::uint64_t>::max()};
+    }
+
     antlrcpp::Any visitExpr(GalliumParser::ExprContext* ctx) final {
       if (ctx->op != nullptr || ctx->gtgtHack != nullptr) {
         RETURN(parse_binary_or_unary(ctx));
@@ -552,7 +606,7 @@ namespace {
         base = 10;
       }
 
-      auto value = parse_value<std::uint64_t>(digits, base, "integer literal");
+      auto value = gal::parse_value<std::uint64_t>(digits, base, "integer literal");
 
       if (auto* int_value = std::get_if<std::uint64_t>(&value)) {
         RETURN(std::make_unique<ast::IntegerLiteralExpression>(loc_from(ctx), *int_value));
@@ -664,58 +718,13 @@ namespace {
     }
 
     std::unique_ptr<ast::Type> parse_builtin(GalliumParser::TypeWithoutRefContext* ctx) noexcept {
-      auto as_string = ctx->BUILTIN_TYPE()->toString();
-
-      if (as_string == "bool") {
-        return std::make_unique<ast::BuiltinBoolType>(loc_from(ctx));
-      } else if (as_string == "byte") {
-        return std::make_unique<ast::BuiltinByteType>(loc_from(ctx));
-      } else if (as_string == "char") {
-        return std::make_unique<ast::BuiltinCharType>(loc_from(ctx));
-      } else if (as_string == "void") {
-        return std::make_unique<ast::VoidType>(loc_from(ctx));
-      }
-
-      assert(as_string[0] == 'i' || as_string[0] == 'u' || as_string[0] == 'f');
-
-      // split into ['', width]
-      auto [prefix, rest] = std::pair{as_string.substr(0, 1), as_string.substr(1)};
+      auto result = gal::parse_builtin_type(ctx->BUILTIN_TYPE()->toString(), loc_from(ctx));
 
-      if (rest == "size") {
-        return std::make_unique<ast::BuiltinIntegralType>(loc_from(ctx),
-            as_string[0] == 'i',
-            ast::IntegerWidth::native_width);
-      }
-
-      auto result = gal::from_digits(rest, 10);
-
-      if (auto* error = std::get_if<std::error_code>(&result)) {
-        return error_type(1,
-            loc_from(ctx),
-            {absl::StrCat("error from integer parser: '", absl::StripAsciiWhitespace(error->message()), "'")});
+      if (auto* notes = std::get_if<std::vector<std::string>>(&result)) {
+        return error_type(1, loc_from(ctx), *notes);
       }
 
-      auto real_width = std::get<std::uint64_t>(result);
-
-      if (as_string[0] == 'f') {
-        if (real_width != 32 && real_width != 64 && real_width != 128) {
-          return error_type(1, loc_from(ctx));
-        }
-
-        auto float_width = (real_width == 32)   ? ast::FloatWidth::ieee_single
-                           : (real_width == 64) ? ast::FloatWidth::ieee_double
-                                                : ast::FloatWidth::ieee_quadruple;
-
-        return std::make_unique<ast::BuiltinFloatType>(loc_from(ctx), float_width);
-      }
-
-      if (real_width == 8 || real_width == 16 || real_width == 32 || real_width == 64 || real_width == 128) {
-        return std::make_unique<ast::BuiltinIntegralType>(loc_from(ctx),
-            as_string[0] == 'i',
-            static_cast<ast::IntegerWidth>(real_width));
-      }
-
-      return error_type(1, loc_from(ctx));
+      return std::move(std::get<std::unique_ptr<ast::Type>>(result));
     }
 
     static ast::UnaryOp unary_op(antlr4::Token* op) noexcept {
@@ -890,116 +899,19 @@ namespace {
 
     std::unique_ptr<ast::Expression> parse_string_lit(antlr4::ParserRuleContext* ctx,
         antlr4::tree::TerminalNode* lit) noexcept {
-      static_assert(std::numeric_limits<char>::is_signed ? std::numeric_limits<char>::digits == 7
-                                                         : std::numeric_limits<char>::digits == 8);
       auto full = lit->toString();
-      auto result = std::string{};
-      auto curr = 0;
-
-      for (auto it = full.begin(); it != full.end(); ++it, ++curr) {
-        if (*it != '\\') {
-          result += *it;
-
-          continue;
-        }
-
-        auto next = *(it + 1);
-
-        auto len = (next == 'o')                         ? 3  // octal = 3 digits
-                   : (next == 'x')                       ? 2  // hex = 2 digits
-                   : (std::isdigit(next) && next != '0') ? 3  // decimal = 3 digits, but \0 is 1
-                                                         : 1; // all others are 1
-
-        // len + 1 because want to take current as well as `len` next chars
-        auto single_char = std::string_view{result}.substr(curr, len + 1);
-        auto parsed_single = parse_single_char(single_char);
-
-        if (auto* ptr = std::get_if<std::uint8_t>(&parsed_single)) {
-          result += static_cast<char>(*ptr);
-        } else {
-          return error_expr(2, loc_from(ctx), {std::get<std::string>(parsed_single)});
-        }
 
-        // ensure that we actually skip the characters we parsed
-        it += len;
+      if (auto error = gal::validate_string_literal(full)) {
+        return error_expr(2, loc_from(ctx), {*error});
       }
 
       return std::make_unique<ast::StringLiteralExpression>(loc_from(ctx), std::move(full));
     }
 
-    template <typename ResultType>
-    static std::variant<ResultType, std::string> parse_value(std::string_view digits,
-        int base,
-        std::string_view gallium_type) noexcept {
-      static_assert(std::is_unsigned_v<ResultType>);
-
-      auto result = gal::from_digits(digits, base);
-
-      if (auto* error = std::get_if<std::error_code>(&result)) {
-        return error->message();
-      }
-
-      auto value = std::get<std::uint64_t>(result);
-
-      if (auto converted = gal::try_narrow<ResultType>(value)) {
-        return *converted;
-      }
-
-      // while we could make `from_chars` do out-of-range checking,
-      // we want a nice error message in the normal case of "slightly out of range"
-      // it will still do out-of-range checking but will give a much worse
-      // error message when it's out of bounds for 64-bit
-      return absl::StrCat("value '",
-          digits,
-          "' parse to `",
-          value,
-          "` which is outside the range for a `",
-          gallium_type,
-          "` literal");
-    }
-
-    static std::variant<std::uint8_t, std::string> parse_single_char(std::string_view full) noexcept {
-      if (full[0] != '\\') {
-        return static_cast<std::uint8_t>(full[0]);
-      }
-
-      if (full[1] == 'o' || full[1] == 'x' || std::isdigit(full[1])) {
-        auto digits = std::string_view{full}.substr(2);
-        auto result = parse_value<std::uint8_t>(digits, full[1] == 'o' ? 8 : full[1] == 'x' ? 16 : 10, "char");
-
-        if (std::holds_alternative<std::string>(result)) {
-          return std::move(std::get<std::string>(result));
-        }
-
-        return std::get<std::uint8_t>(result);
-      }
-
-      // we can't do two implicit conversions when returning
-      // to a `std::variant`, so its either that or `return static_cast<std::uint8_t>(c)`
-      auto value = std::uint8_t{0};
-
-      switch (full[1]) {
-        case '0': value = '\0'; break;
-        case 'n': value = '\n'; break;
-        case 'r': value = '\r'; break;
-        case 't': value = '\t'; break;
-        case 'v': value = '\v'; break;
-        case '\\': value = '\\'; break;
-        case '"': value = '"'; break;
-        case '\'': value = '\''; break;
-        case 'a': value = '\a'; break;
-        case 'b': value = '\b'; break;
-        case 'f': value = '\f'; break;
-        default: assert(false); break; // should be impossible with the grammar
-      }
-
-      return value;
-    }
-
     std::unique_ptr<ast::Expression> parse_char_lit(antlr4::ParserRuleContext* ctx,
         antlr4::tree::TerminalNode* lit) noexcept {
       auto full = lit->toString();
-      auto parsed = parse_single_char(std::string_view{full}.substr(1, full.size() - 2));
+      auto parsed = gal::parse_single_char(std::string_view{full}.substr(1, full.size() - 2));
 
       if (auto* ptr = std::get_if<std::string>(&parsed)) {
         return error_expr(2, loc_from(ctx), {*ptr});
@@ -1117,9 +1029,16 @@ namespace {
     }
 
     template <typename T> ast::SourceLoc loc_from(T* node) noexcept {
-      auto* firstToken = node->getStart();
+      auto* first = node->getStart();
+      auto* last = node->getStop();
+      auto begin = offsets_->byte_offset(first->getStartIndex());
 
-      return ast::SourceLoc(node->getText(), firstToken->getLine(), firstToken->getCharPositionInLine(), path_);
+      // rules that matched nothing have their stop token *before* their start token
+      if (last == nullptr || last->getStopIndex() + 1 <= first->getStartIndex()) {
+        return ast::SourceLoc(file_, begin, 0);
+      }
+
+      return ast::SourceLoc(file_, begin, offsets_->byte_offset(last->getStopIndex() + 1) - begin);
     }
 
     std::unique_ptr<ast::Declaration> decl_ret_;
@@ -1127,31 +1046,237 @@ namespace {
     std::unique_ptr<ast::Expression> expr_ret_;
     std::unique_ptr<ast::Type> type_ret_;
     gal::DiagnosticReporter* diagnostics_;
-    std::filesystem::path path_;
+    const gal::OffsetMap* offsets_;
+    gal::FileID file_ = 0;
     std::string_view original_;
     bool exported_ = false;
   };
-} // namespace
 
-namespace gal {
-  std::optional<ast::Program> parse(std::filesystem::path path,
-      std::string_view source_code,
-      gal::DiagnosticReporter* reporter) noexcept {
-    auto input = antlr4::ANTLRInputStream(std::string{source_code});
-    auto error_handler = gal::ParserErrorListener{path, reporter};
+  // SLL prediction is much cheaper than full LL and gives the same answer for nearly every valid
+  // input. if it fails, either there's an actual syntax error or SLL couldn't resolve an ambiguity
+  // that LL can, so the parse is redone in LL mode with the normal error recovery and reporting.
+  //
+  // the DFA that prediction builds is static in the generated parser, so it's shared by every file
+  // (and every thread) in the process and gets warmer with each file that gets parsed
+  GalliumParser::ParseContext* parse_two_stage(GalliumParser* parser, antlr4::ANTLRErrorListener* listener) noexcept {
+    auto* interpreter = parser->getInterpreter<antlr4::atn::ParserATNSimulator>();
+
+    parser->removeErrorListeners();
+    parser->setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+    interpreter->setPredictionMode(antlr4::atn::PredictionMode::SLL);
+
+    try {
+      return parser->parse();
+    } catch (antlr4::ParseCancellationException&) {
+      // the token stream has already been filled, so the lexer (and its errors) aren't re-run
+      parser->reset();
+      parser->addErrorListener(listener);
+      parser->setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
+      interpreter->setPredictionMode(antlr4::atn::PredictionMode::LL);
+
+      return parser->parse();
+    }
+  }
+
+  // files smaller than this aren't worth the overhead of splitting up
+  constexpr auto min_chunk_size = std::size_t{16 * 1024};
+
+  // finds byte offsets that a file can be cut at so that every piece is still a valid
+  // `parse` on its own. a cut is made right before a declaration keyword that starts a line
+  // and isn't nested in any brackets, every declaration has to end with a newline so it's
+  // impossible for one of those to be in the middle of another declaration.
+  //
+  // the first offset is always 0. if the file doesn't lex, it's left in one piece and the
+  // normal parse deals with reporting the error
+  std::vector<std::uint32_t> chunk_starts(std::string_view source, std::size_t max_chunks) noexcept {
+    auto starts = std::vector<std::uint32_t>{0};
+    auto lexed = gal::lex(source);
+
+    if (max_chunks < 2 || std::holds_alternative<gal::LexError>(lexed)) {
+      return starts;
+    }
+
+    auto target = std::max(source.size() / max_chunks, min_chunk_size);
+    auto depth = 0;
+    auto line_start = true;
+    auto seen_declaration = false;
+
+    for (auto& token : std::get<std::vector<gal::Token>>(lexed)) {
+      switch (token.type) {
+        case gal::TokenType::whitespace: continue;
+        case gal::TokenType::newline: line_start = true; continue;
+        case gal::TokenType::lbrace:
+        case gal::TokenType::lparen:
+        case gal::TokenType::lbracket:
+        case gal::TokenType::attr_arch:
+        case gal::TokenType::attr_vectorize:
+        case gal::TokenType::attr_unroll: ++depth; break;
+        case gal::TokenType::rbrace:
+        case gal::TokenType::rparen:
+        case gal::TokenType::rbracket: --depth; break;
+        case gal::TokenType::kw_import:
+        case gal::TokenType::kw_export:
+        case gal::TokenType::kw_const:
+        case gal::TokenType::kw_external:
+        case gal::TokenType::kw_extern:
+        case gal::TokenType::kw_fn:
+        case gal::TokenType::kw_class:
+        case gal::TokenType::kw_struct:
+        case gal::TokenType::kw_type:
+          if (depth == 0 && line_start) {
+            // every piece needs at least one declaration in it, including the first
+            if (seen_declaration && token.offset - starts.back() >= target) {
+              starts.push_back(token.offset);
+            }
+
+            seen_declaration = true;
+          }
+          break;
+        default: break;
+      }
+
+      line_start = false;
+    }
+
+    return starts;
+  }
+
+  struct Chunk {
+    // declared first so that it's destroyed last, `decls` lives inside of it
+    std::unique_ptr<gal::Arena> arena = std::make_unique<gal::Arena>();
+    std::vector<std::unique_ptr<ast::Declaration>> decls;
+    std::unique_ptr<gal::BufferedReporter> diagnostics;
+    bool syntax_error = false;
+  };
+
+  void parse_chunk(gal::FileID file,
+      const gal::OffsetMap& offsets,
+      std::size_t begin,
+      std::size_t end,
+      Chunk* chunk) noexcept {
+    auto scope = gal::ArenaScope{chunk->arena.get()};
+    auto source_code = gal::sources().contents(file);
+    auto input = gal::SourceStream{source_code, &offsets, gal::sources().path(file).string(), begin, end};
+    auto error_handler = gal::ParserErrorListener{file, &offsets, chunk->diagnostics.get()};
+    auto lex = GalliumLexer(&input);
+    lex.removeErrorListeners();
+    lex.addErrorListener(&error_handler);
+    auto tokens = antlr4::CommonTokenStream(&lex);
+    auto parser = GalliumParser(&tokens);
+    auto* tree = parse_two_stage(&parser, &error_handler);
+
+    if (parser.getNumberOfSyntaxErrors() != 0 || chunk->diagnostics->had_error()) {
+      chunk->syntax_error = true;
+
+      return;
+    }
+
+    // the parse tree (along with the lexer and the token buffer) is freed as soon as this returns
+    chunk->decls = ASTGenerator(chunk->diagnostics.get(), &offsets).lower(file, tree);
+  }
+
+  std::optional<ast::Program> parse_serial(gal::FileID file, gal::DiagnosticReporter* reporter) noexcept {
+    // the arena is only handed to the program on success, otherwise it needs to outlive
+    // any nodes that were built before an error was found
+    auto arena = std::make_unique<gal::Arena>();
+    auto scope = gal::ArenaScope{arena.get()};
+    auto source_code = gal::sources().contents(file);
+    auto offsets = gal::OffsetMap{source_code};
+    auto input = gal::SourceStream{source_code, &offsets, gal::sources().path(file).string()};
+    auto error_handler = gal::ParserErrorListener{file, &offsets, reporter};
     auto lex = GalliumLexer(&input);
     lex.removeErrorListeners();
     lex.addErrorListener(&error_handler);
     auto tokens = antlr4::CommonTokenStream(&lex);
     auto parser = GalliumParser(&tokens);
-    parser.removeErrorListeners();
-    parser.addErrorListener(&error_handler);
-    auto* tree = parser.parse();
+    auto* tree = parse_two_stage(&parser, &error_handler);
 
     if (parser.getNumberOfSyntaxErrors() != 0) {
       return std::nullopt;
     }
 
-    return ASTGenerator(reporter).into_ast(source_code, std::move(path), tree);
+    return ASTGenerator(reporter, &offsets).into_ast(file, tree, &arena);
+  }
+
+  // splits the file up at top-level declarations and parses + lowers each piece on its own thread,
+  // the pieces are stitched back together in source order afterwards. if any piece has a syntax error
+  // the whole file is re-parsed serially, so diagnostics (and ANTLR's error recovery) behave exactly
+  // like they would have without splitting
+  std::optional<ast::Program> parse_parallel(gal::FileID file,
+      gal::DiagnosticReporter* reporter,
+      std::size_t threads) noexcept {
+    auto source_code = gal::sources().contents(file);
+    auto starts = chunk_starts(source_code, threads * 4);
+
+    if (starts.size() < 2) {
+      return parse_serial(file, reporter);
+    }
+
+    auto offsets = gal::OffsetMap{source_code};
+    auto chunks = std::vector<Chunk>(starts.size());
+
+    {
+      auto pool = gal::ThreadPool(std::min(threads, chunks.size()));
+
+      for (auto i = std::size_t{0}; i < chunks.size(); ++i) {
+        auto begin = offsets.index_of(starts[i]);
+        auto end = (i + 1 < starts.size()) ? offsets.index_of(starts[i + 1]) : offsets.size();
+
+        chunks[i].diagnostics = std::make_unique<gal::BufferedReporter>(source_code);
+
+        pool.submit([file, &offsets, begin, end, chunk = &chunks[i]] {
+          parse_chunk(file, offsets, begin, end, chunk);
+        });
+      }
+
+      pool.wait();
+    }
+
+    auto failed = std::any_of(chunks.begin(), chunks.end(), [](const Chunk& chunk) {
+      return chunk.syntax_error;
+    });
+
+    if (failed) {
+      return parse_serial(file, reporter);
+    }
+
+    auto arena = std::make_unique<gal::Arena>();
+    auto decls = std::vector<std::unique_ptr<ast::Declaration>>{};
+
+    for (auto& chunk : chunks) {
+      chunk.diagnostics->replay(reporter);
+      arena->adopt(chunk.arena.get());
+
+      for (auto& decl : chunk.decls) {
+        decls.push_back(std::move(decl));
+      }
+    }
+
+    if (reporter->had_error()) {
+      return std::nullopt;
+    }
+
+    return ast::Program(std::move(decls), std::move(arena));
+  }
+} // namespace
+
+namespace gal {
+  std::optional<ast::Program> parse(gal::FileID file,
+      gal::DiagnosticReporter* reporter,
+      gal::ParserKind kind,
+      std::size_t threads) noexcept {
+    if (kind == gal::ParserKind::fast) {
+      return gal::parse_fast(file, reporter);
+    }
+
+    if (threads > 1) {
+      return parse_parallel(file, reporter, threads);
+    }
+
+    return parse_serial(file, reporter);
+  }
+
+  std::optional<ast::Program> parse(gal::FileID file, gal::DiagnosticReporter* reporter) noexcept {
+    return gal::parse(file, reporter, gal::flags().parser());
   }
-} // namespace gal
\ No newline at end of file
+} // namespace gal
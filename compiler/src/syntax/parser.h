@@ -13,19 +13,35 @@
 #include "../ast/nodes.h"
 #include "../ast/program.h"
 #include "../errors/reporter.h"
+#include "../utility/flags.h"
+#include "../utility/source_manager.h"
 #include <optional>
 #include <string_view>
 #include <variant>
 #include <vector>
 
 namespace gal {
-  /// Parses `text` and returns an AST from it, if there were no errors.
+  /// Parses a file and returns an AST from it, if there were no errors.
   /// If there were errors, they will be printed and `nullopt` is returned.
   ///
-  /// \param file The file being parsed
-  /// \param text The text to parse
+  /// With more than one thread, big files are split up at top-level declarations and the
+  /// pieces are parsed concurrently. The program that comes out is exactly the same either way.
+  ///
+  /// \param file The file being parsed, must already be loaded into `gal::sources()`
+  /// \param reporter The reporter to send errors to
+  /// \param kind The front end to parse the file with
+  /// \param threads The maximum number of threads to parse the file with
+  /// \return A possible AST
+  std::optional<ast::Program> parse(gal::FileID file,
+      DiagnosticReporter* reporter,
+      ParserKind kind,
+      std::size_t threads = 1) noexcept;
+
+  /// Parses a file with whichever parser was picked by `--parser`, see the
+  /// other overload for details.
+  ///
+  /// \param file The file being parsed, must already be loaded into `gal::sources()`
+  /// \param reporter The reporter to send errors to
   /// \return A possible AST
-  std::optional<ast::Program> parse(std::filesystem::path file,
-      std::string_view text,
-      DiagnosticReporter* reporter) noexcept;
+  std::optional<ast::Program> parse(gal::FileID file, DiagnosticReporter* reporter) noexcept;
 } // namespace gal
\ No newline at end of file
@@ -0,0 +1,120 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+
+#include "./source_stream.h"
+#include <algorithm>
+
+namespace {
+  constexpr auto replacement_character = std::uint32_t{0xFFFD};
+} // namespace
+
+namespace gal {
+  SourceStream::SourceStream(std::string_view source, const OffsetMap* offsets, std::string name) noexcept
+      : SourceStream(source, offsets, std::move(name), 0, offsets->size()) {}
+
+  SourceStream::SourceStream(std::string_view source,
+      const OffsetMap* offsets,
+      std::string name,
+      std::size_t begin,
+      std::size_t end) noexcept
+      : source_{source},
+        offsets_{offsets},
+        name_{std::move(name)},
+        begin_{begin},
+        end_{end},
+        position_{begin} {}
+
+  void SourceStream::consume() {
+    if (position_ >= end_) {
+      throw antlr4::IllegalStateException("cannot consume EOF");
+    }
+
+    ++position_;
+  }
+
+  std::size_t SourceStream::LA(ssize_t i) {
+    if (i == 0) {
+      return 0; // undefined, this is what `ANTLRInputStream` does
+    }
+
+    // LA(1) is the current code point, LA(-1) is the one before it
+    auto position = static_cast<ssize_t>(position_) + ((i < 0) ? i : i - 1);
+
+    if (position < static_cast<ssize_t>(begin_) || position >= static_cast<ssize_t>(end_)) {
+      return antlr4::IntStream::EOF;
+    }
+
+    return code_point(static_cast<std::size_t>(position));
+  }
+
+  ssize_t SourceStream::mark() {
+    return -1; // the whole input is always available, no need to buffer anything
+  }
+
+  void SourceStream::release(ssize_t) {}
+
+  std::size_t SourceStream::index() {
+    return position_;
+  }
+
+  void SourceStream::seek(std::size_t index) {
+    position_ = std::clamp(index, begin_, end_);
+  }
+
+  std::size_t SourceStream::size() {
+    return end_;
+  }
+
+  std::string SourceStream::getSourceName() const {
+    return name_.empty() ? antlr4::IntStream::UNKNOWN_SOURCE_NAME : name_;
+  }
+
+  std::string SourceStream::getText(const antlr4::misc::Interval& interval) {
+    if (interval.a < 0 || interval.b < interval.a || static_cast<std::size_t>(interval.a) >= end_) {
+      return "";
+    }
+
+    auto stop = std::min(static_cast<std::size_t>(interval.b), end_ - 1);
+    auto begin = offsets_->byte_offset(static_cast<std::size_t>(interval.a));
+    auto end = offsets_->byte_offset(stop + 1);
+
+    return std::string{source_.substr(begin, end - begin)};
+  }
+
+  std::string SourceStream::toString() const {
+    return std::string{source_};
+  }
+
+  std::uint32_t SourceStream::code_point(std::size_t index) const noexcept {
+    auto begin = offsets_->byte_offset(index);
+    auto end = offsets_->byte_offset(index + 1);
+    auto lead = static_cast<unsigned char>(source_[begin]);
+    auto value = std::uint32_t{0};
+
+    if (lead < 0x80) {
+      return lead;
+    } else if ((lead & 0xE0) == 0xC0 && end - begin == 2) {
+      value = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0 && end - begin == 3) {
+      value = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0 && end - begin == 4) {
+      value = lead & 0x07;
+    } else {
+      return replacement_character; // malformed UTF-8, let the lexer complain about it
+    }
+
+    for (auto i = begin + 1; i < end; ++i) {
+      value = (value << 6) | (static_cast<unsigned char>(source_[i]) & 0x3F);
+    }
+
+    return value;
+  }
+} // namespace gal
@@ -0,0 +1,81 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+
+#pragma once
+
+#include "./parse_errors.h"
+#include <antlr4-runtime.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace gal {
+  /// An ANTLR character stream that reads directly out of a file's text in the
+  /// source manager. `antlr4::ANTLRInputStream` copies the entire input and
+  /// widens it to UTF-32, which quadruples the memory needed for big files.
+  ///
+  /// Like every other ANTLR stream, this is indexed by code point. Pure ASCII
+  /// input is read as-is, anything else is decoded on the fly.
+  class SourceStream final : public antlr4::CharStream {
+  public:
+    /// Creates a stream over some source text
+    ///
+    /// \param source The text to read, must outlive the stream
+    /// \param offsets The code-point to byte offset mapping for `source`
+    /// \param name The name of the source, used by ANTLR in error messages
+    explicit SourceStream(std::string_view source, const OffsetMap* offsets, std::string name) noexcept;
+
+    /// Creates a stream over only part of some source text. Indices are still relative to
+    /// the start of `source`, so token positions don't need any adjustment, but the stream
+    /// starts at `begin` and anything at or after `end` looks like EOF.
+    ///
+    /// \param source The text to read, must outlive the stream
+    /// \param offsets The code-point to byte offset mapping for `source`
+    /// \param name The name of the source, used by ANTLR in error messages
+    /// \param begin The code-point index to start reading at
+    /// \param end The code-point index to stop reading at
+    explicit SourceStream(std::string_view source,
+        const OffsetMap* offsets,
+        std::string name,
+        std::size_t begin,
+        std::size_t end) noexcept;
+
+    void consume() final;
+
+    std::size_t LA(ssize_t i) final;
+
+    ssize_t mark() final;
+
+    void release(ssize_t marker) final;
+
+    std::size_t index() final;
+
+    void seek(std::size_t index) final;
+
+    std::size_t size() final;
+
+    std::string getSourceName() const final;
+
+    std::string getText(const antlr4::misc::Interval& interval) final;
+
+    std::string toString() const final;
+
+  private:
+    [[nodiscard]] std::uint32_t code_point(std::size_t index) const noexcept;
+
+    std::string_view source_;
+    const OffsetMap* offsets_;
+    std::string name_;
+    std::size_t begin_;
+    std::size_t end_;
+    std::size_t position_;
+  };
+} // namespace gal
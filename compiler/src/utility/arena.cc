@@ -0,0 +1,94 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+
+#include "./arena.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace {
+  thread_local gal::Arena* active_arena = nullptr;
+
+  // chunks double in size up until this point, after that they stay the same size
+  constexpr auto max_chunk_size = std::size_t{1024 * 1024};
+
+  std::byte* align_up(std::byte* ptr, std::size_t align) noexcept {
+    auto address = reinterpret_cast<std::uintptr_t>(ptr);
+
+    return ptr + ((align - (address % align)) % align);
+  }
+} // namespace
+
+namespace gal {
+  Arena::Arena(std::size_t first_chunk) noexcept : next_chunk_{first_chunk} {}
+
+  void* Arena::allocate(std::size_t size, std::size_t align) noexcept {
+    assert(align != 0 && (align & (align - 1)) == 0 && align <= alignof(std::max_align_t));
+
+    auto* ptr = align_up(next_, align);
+
+    if (next_ == nullptr || static_cast<std::size_t>(end_ - ptr) < size) {
+      return allocate_slow(size);
+    }
+
+    next_ = ptr + size;
+
+    return ptr;
+  }
+
+  void* Arena::allocate_slow(std::size_t size) noexcept {
+    // `new std::byte[]` is always aligned to at least `alignof(std::max_align_t)`,
+    // so a fresh chunk never needs any padding at the front
+    if (size > next_chunk_ / 2) {
+      // big allocations get their own chunk so that the rest of the current chunk isn't wasted
+      auto& chunk = chunks_.emplace_back(new std::byte[size]);
+      reserved_ += size;
+
+      return chunk.get();
+    }
+
+    auto& chunk = chunks_.emplace_back(new std::byte[next_chunk_]);
+    reserved_ += next_chunk_;
+    next_ = chunk.get() + size;
+    end_ = chunk.get() + next_chunk_;
+    next_chunk_ = std::min(next_chunk_ * 2, max_chunk_size);
+
+    return chunk.get();
+  }
+
+  void Arena::adopt(Arena* other) noexcept {
+    assert(other != this);
+
+    chunks_.reserve(chunks_.size() + other->chunks_.size());
+
+    for (auto& chunk : other->chunks_) {
+      chunks_.push_back(std::move(chunk));
+    }
+
+    reserved_ += other->reserved_;
+    other->chunks_.clear();
+    other->next_ = nullptr;
+    other->end_ = nullptr;
+    other->reserved_ = 0;
+  }
+
+  Arena* Arena::current() noexcept {
+    return active_arena;
+  }
+
+  ArenaScope::ArenaScope(Arena* arena) noexcept : previous_{active_arena} {
+    active_arena = arena;
+  }
+
+  ArenaScope::~ArenaScope() {
+    active_arena = previous_;
+  }
+} // namespace gal
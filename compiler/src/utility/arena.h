@@ -0,0 +1,114 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace gal {
+  /// A simple bump allocator. Memory is handed out linearly from large chunks,
+  /// and is only ever released all at once when the arena itself is destroyed.
+  ///
+  /// Objects put into an arena still need to have their destructors run, the
+  /// arena only owns the *memory* and not the objects living in it.
+  ///
+  /// Not thread-safe, each arena is meant to be used from one thread at a time.
+  class Arena {
+  public:
+    /// Creates an empty arena, no memory is allocated until the first allocation
+    ///
+    /// \param first_chunk The size of the first chunk to allocate
+    explicit Arena(std::size_t first_chunk = 16 * 1024) noexcept;
+
+    /// Arena is not copyable
+    Arena(const Arena&) = delete;
+
+    /// Arena is not movable, every object inside it refers to it by address
+    Arena(Arena&&) = delete;
+
+    /// Arena is not copy-assignable
+    Arena& operator=(const Arena&) = delete;
+
+    /// Arena is not move-assignable
+    Arena& operator=(Arena&&) = delete;
+
+    /// Releases every chunk the arena owns
+    ~Arena() = default;
+
+    /// Allocates `size` bytes aligned to `align`
+    ///
+    /// \param size The number of bytes to allocate
+    /// \param align The alignment of the memory, must be a power of two no greater
+    ///        than `alignof(std::max_align_t)`
+    /// \return A pointer to the memory, never null
+    [[nodiscard]] void* allocate(std::size_t size, std::size_t align) noexcept;
+
+    /// Takes ownership of every chunk that another arena has allocated. Anything that
+    /// was allocated in `other` stays where it is, but now lives for as long as this
+    /// arena does. `other` is left empty and can keep being used.
+    ///
+    /// \param other The arena to take memory from
+    void adopt(Arena* other) noexcept;
+
+    /// Gets the total number of bytes the arena has requested from the system
+    ///
+    /// \return The size of every chunk added together
+    [[nodiscard]] std::size_t bytes_reserved() const noexcept {
+      return reserved_;
+    }
+
+    /// Gets the arena that is currently active on this thread, if there is one.
+    ///
+    /// \return The active arena, or `nullptr`
+    [[nodiscard]] static Arena* current() noexcept;
+
+  private:
+    friend class ArenaScope;
+
+    void* allocate_slow(std::size_t size) noexcept;
+
+    std::vector<std::unique_ptr<std::byte[]>> chunks_;
+    std::byte* next_ = nullptr;
+    std::byte* end_ = nullptr;
+    std::size_t next_chunk_;
+    std::size_t reserved_ = 0;
+  };
+
+  /// Makes an arena the active one on this thread for as long as the scope
+  /// object is alive, and then restores whatever was active before it.
+  class ArenaScope {
+  public:
+    /// Activates `arena` on the current thread
+    ///
+    /// \param arena The arena to activate, may be `nullptr` to deactivate arenas entirely
+    explicit ArenaScope(Arena* arena) noexcept;
+
+    /// ArenaScope is not copyable
+    ArenaScope(const ArenaScope&) = delete;
+
+    /// ArenaScope is not movable
+    ArenaScope(ArenaScope&&) = delete;
+
+    /// ArenaScope is not copy-assignable
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    /// ArenaScope is not move-assignable
+    ArenaScope& operator=(ArenaScope&&) = delete;
+
+    /// Restores the previously active arena
+    ~ArenaScope();
+
+  private:
+    Arena* previous_;
+  };
+} // namespace gal
@@ -21,25 +21,55 @@ ABSL_FLAG(std::string, opt, "none", "the optimization level to use (none|some|sm
 
 ABSL_FLAG(std::string, emit, "exe", "the format to emit (ir|bc|asm|obj|lib|exe|graphviz)");
 
+ABSL_FLAG(std::string, parser, "antlr", "the parser to use (antlr|fast)");
+
+ABSL_FLAG(std::string, lto, "none", "how to optimize files together (none|thin)");
+
+ABSL_FLAG(std::string, panic, "report", "what a failed safety check does (report|abort)");
+
+ABSL_FLAG(std::string, passes, "", "an LLVM pass pipeline to run instead of the default one for --opt");
+
 ABSL_FLAG(bool, verbose, false, "whether to enable verbose logging");
 
 ABSL_FLAG(bool, debug, false, "whether or not to include debug information in the binary");
 
-ABSL_FLAG(std::uint64_t, jobs, 1, "the number of threads that the compiler can create");
+ABSL_FLAG(std::uint64_t, jobs, 1, "the number of threads that the compiler can create (0 = one per core)");
 
 ABSL_FLAG(bool, colored, true, "whether or not to enable ANSI color codes in the compiler output");
 
 ABSL_FLAG(bool, demangle, false, "whether or not to treat all files as symbols to demangle");
 
-ABSL_FLAG(bool, disable_checking, false, "whether or not to disallow any debug panic-generating checks");
+ABSL_FLAG(bool, disable_checking, false, "whether or not to disallow any panic-generating checks");
 
 ABSL_FLAG(bool, debug_stdlib, false, "whether or not to include 'stdlib' in verbose logging");
 
+ABSL_FLAG(bool, time_trace, false, "whether or not to write a Chrome trace of compile time to '<out>.time-trace.json'");
+
+ABSL_FLAG(bool, time_report, false, "whether or not to print a summary of compile times to stderr");
+
+ABSL_FLAG(bool, system_linker, false, "whether or not to link executables with $CC rather than the built-in linker");
+
+ABSL_FLAG(bool, incremental, false, "whether or not to reuse cached code for functions and files that didn't change");
+
+ABSL_FLAG(bool, profile_generate, false, "whether or not to instrument code so that running it writes a profile");
+
+ABSL_FLAG(std::string, profile_use, "", "a merged profile ('.profdata') to guide optimization with");
+
+ABSL_FLAG(std::string, cache_dir, "", "where to keep the incremental cache (default = user cache directory)");
+
+ABSL_FLAG(std::string, module_dir, ".", "where module interfaces ('.gali') are written to and imported from");
+
+ABSL_FLAG(bool, serve, false, "whether or not to run as a compile server that `gallium-client` sends requests to");
+
+ABSL_FLAG(std::string, socket, "", "the Unix socket for --serve to listen on (default = $GALLIUM_SOCKET, or one per user)");
+
 ABSL_FLAG(std::string, masm, "intel", "the assembly dialect to use for x86-64 assembly");
 
 ABSL_FLAG(std::string, args, "", "arguments to pass to $CC during compilation");
 
 namespace {
+  thread_local const gal::CompilerConfig* active_config = nullptr;
+
   std::optional<gal::OptLevel> parse_opt() noexcept {
     static absl::flat_hash_map<std::string_view, gal::OptLevel> lookup{
         {"none", gal::OptLevel::none},
@@ -85,6 +115,60 @@ namespace {
     return (*it).second;
   }
 
+  std::optional<gal::ParserKind> parse_parser() noexcept {
+    static absl::flat_hash_map<std::string_view, gal::ParserKind> lookup{
+        {"antlr", gal::ParserKind::antlr},
+        {"fast", gal::ParserKind::fast},
+    };
+
+    auto parser = absl::GetFlag(FLAGS_parser);
+    auto it = lookup.find(std::string_view{parser});
+
+    if (it == lookup.end()) {
+      gal::errs() << "invalid value '" << parser << "' for flag 'parser'! valid values: 'antlr', 'fast'";
+
+      return std::nullopt;
+    }
+
+    return (*it).second;
+  }
+
+  std::optional<gal::LTOKind> parse_lto() noexcept {
+    static absl::flat_hash_map<std::string_view, gal::LTOKind> lookup{
+        {"none", gal::LTOKind::none},
+        {"thin", gal::LTOKind::thin},
+    };
+
+    auto lto = absl::GetFlag(FLAGS_lto);
+    auto it = lookup.find(std::string_view{lto});
+
+    if (it == lookup.end()) {
+      gal::errs() << "invalid value '" << lto << "' for flag 'lto'! valid values: 'none', 'thin'";
+
+      return std::nullopt;
+    }
+
+    return (*it).second;
+  }
+
+  std::optional<gal::PanicMode> parse_panic() noexcept {
+    static absl::flat_hash_map<std::string_view, gal::PanicMode> lookup{
+        {"report", gal::PanicMode::report},
+        {"abort", gal::PanicMode::abort},
+    };
+
+    auto panic = absl::GetFlag(FLAGS_panic);
+    auto it = lookup.find(std::string_view{panic});
+
+    if (it == lookup.end()) {
+      gal::errs() << "invalid value '" << panic << "' for flag 'panic'! valid values: 'report', 'abort'";
+
+      return std::nullopt;
+    }
+
+    return (*it).second;
+  }
+
   gal::CompilerConfig generate_config() noexcept {
     auto out = absl::GetFlag(FLAGS_out);
     auto jobs = absl::GetFlag(FLAGS_jobs);
@@ -94,10 +178,19 @@ namespace {
     auto demangle = absl::GetFlag(FLAGS_demangle);
     auto no_checking = absl::GetFlag(FLAGS_disable_checking);
     auto debug_stdlib = absl::GetFlag(FLAGS_debug_stdlib);
+    auto time_trace = absl::GetFlag(FLAGS_time_trace);
+    auto time_report = absl::GetFlag(FLAGS_time_report);
+    auto system_linker = absl::GetFlag(FLAGS_system_linker);
+    auto incremental = absl::GetFlag(FLAGS_incremental);
+    auto profile_generate = absl::GetFlag(FLAGS_profile_generate);
     auto emit = parse_emit();
     auto opt = parse_opt();
+    auto parser = parse_parser();
+    auto lto = parse_lto();
+    auto panic = parse_panic();
 
-    if (emit == std::nullopt || opt == std::nullopt) {
+    if (emit == std::nullopt || opt == std::nullopt || parser == std::nullopt || lto == std::nullopt
+        || panic == std::nullopt) {
       std::abort();
     }
 
@@ -105,12 +198,24 @@ namespace {
         jobs,
         *opt,
         *emit,
+        *parser,
+        *lto,
+        *panic,
         debug,
         verbose,
         colored,
         demangle,
         no_checking,
         debug_stdlib,
+        time_trace,
+        time_report,
+        system_linker,
+        incremental,
+        profile_generate,
+        absl::GetFlag(FLAGS_cache_dir),
+        absl::GetFlag(FLAGS_module_dir),
+        absl::GetFlag(FLAGS_passes),
+        absl::GetFlag(FLAGS_profile_use),
         absl::GetFlag(FLAGS_args));
   }
 } // namespace
@@ -120,31 +225,75 @@ namespace gal {
       std::uint64_t jobs,
       OptLevel opt,
       OutputFormat emit,
+      ParserKind parser,
+      LTOKind lto,
+      PanicMode panic,
       bool debug,
       bool verbose,
       bool colored,
       bool demangle,
       bool no_checking,
       bool debug_stdlib,
+      bool time_trace,
+      bool time_report,
+      bool system_linker,
+      bool incremental,
+      bool profile_generate,
+      std::string cache_dir,
+      std::string module_dir,
+      std::string passes,
+      std::string profile_use,
       std::string args) noexcept
       : out_{std::move(out)},
         args_{std::move(args)},
+        cache_dir_{std::move(cache_dir)},
+        module_dir_{std::move(module_dir)},
+        passes_{std::move(passes)},
+        profile_use_{std::move(profile_use)},
         jobs_{jobs},
         opt_level_{opt},
         format_{emit},
+        parser_{parser},
+        lto_{lto},
+        panic_{panic},
         debug_{debug},
         verbose_{verbose},
         colored_{colored},
         demangle_{demangle},
         no_checking_{no_checking},
-        debug_stdlib_verbose_{debug_stdlib} {}
+        debug_stdlib_verbose_{debug_stdlib},
+        time_trace_{time_trace},
+        time_report_{time_report},
+        system_linker_{system_linker},
+        incremental_{incremental},
+        profile_generate_{profile_generate} {}
 
   const CompilerConfig& flags() noexcept {
+    if (active_config != nullptr) {
+      return *active_config;
+    }
+
     static CompilerConfig config = generate_config();
 
     return config;
   }
 
+  ConfigScope::ConfigScope(const CompilerConfig* config) noexcept : previous_{active_config} {
+    active_config = config;
+  }
+
+  ConfigScope::~ConfigScope() {
+    active_config = previous_;
+  }
+
+  bool serve_requested() noexcept {
+    return absl::GetFlag(FLAGS_serve);
+  }
+
+  std::string serve_socket() noexcept {
+    return absl::GetFlag(FLAGS_socket);
+  }
+
   void delegate_flags() noexcept {
     auto dialect = absl::GetFlag(FLAGS_masm);
     auto args = std::vector<const char*>{"galliumc"};
@@ -8,8 +8,11 @@
 //                                                                           //
 //======---------------------------------------------------------------======//
 
+#pragma once
+
 #include <cstdint>
 #include <ostream>
+#include <string>
 
 namespace gal {
   /// The optimization level of the output, matters
@@ -44,6 +47,32 @@ namespace gal {
     ast_graphviz = -7,
   };
 
+  /// Selects which front end turns source text into an AST
+  enum class ParserKind : signed char {
+    /// The ANTLR-generated parser, this is the reference implementation of the grammar
+    antlr = -1,
+    /// The hand-written lexer and recursive-descent parser. Much faster, but
+    /// stops at the first syntax error and doesn't support everything yet
+    fast = -2,
+  };
+
+  /// Selects how (and whether) separately-compiled files are optimized together
+  enum class LTOKind : signed char {
+    /// Every file is optimized and lowered on its own, nothing is inlined across files
+    none = -1,
+    /// Files are emitted as bitcode with a summary of what's in them, and a thin link
+    /// imports functions across files before they're optimized and lowered in parallel
+    thin = -2,
+  };
+
+  /// Selects what a failed safety check does
+  enum class PanicMode : signed char {
+    /// Prints the source location and a message describing the check before trapping
+    report = -1,
+    /// Traps immediately, without any source locations or messages in the binary
+    abort = -2,
+  };
+
   /// Holds the configuration options for the
   /// entire compiler that were passed in from the
   /// command line
@@ -54,12 +83,24 @@ namespace gal {
         std::uint64_t jobs,
         OptLevel opt,
         OutputFormat emit,
+        ParserKind parser,
+        LTOKind lto,
+        PanicMode panic,
         bool debug,
         bool verbose,
         bool colored,
         bool demangle,
         bool no_checking,
         bool debug_stdlib,
+        bool time_trace,
+        bool time_report,
+        bool system_linker,
+        bool incremental,
+        bool profile_generate,
+        std::string cache_dir,
+        std::string module_dir,
+        std::string passes,
+        std::string profile_use,
         std::string compiler_args) noexcept;
 
     [[nodiscard]] std::string_view args() const noexcept {
@@ -92,6 +133,27 @@ namespace gal {
       return format_;
     }
 
+    /// Gets the front end that source files should be parsed with
+    ///
+    /// \return The parser to use
+    [[nodiscard]] constexpr ParserKind parser() const noexcept {
+      return parser_;
+    }
+
+    /// Gets how files should be optimized together, if at all
+    ///
+    /// \return The kind of LTO to do
+    [[nodiscard]] constexpr LTOKind lto() const noexcept {
+      return lto_;
+    }
+
+    /// Gets what failed safety checks should do
+    ///
+    /// \return The panic mode
+    [[nodiscard]] constexpr PanicMode panic() const noexcept {
+      return panic_;
+    }
+
     /// Checks whether the user plans to debug the generated code
     ///
     /// \return Whether or not the user wants to debug the generated code
@@ -134,28 +196,148 @@ namespace gal {
       return debug_stdlib_verbose_;
     }
 
+    /// Whether or not to write a Chrome trace (`chrome://tracing`) of where compile time was spent
+    ///
+    /// \return Whether or not to write a time trace
+    [[nodiscard]] constexpr bool time_trace() const noexcept {
+      return time_trace_;
+    }
+
+    /// Whether or not to print a summary of where compile time was spent to stderr
+    ///
+    /// \return Whether or not to print a time report
+    [[nodiscard]] constexpr bool time_report() const noexcept {
+      return time_report_;
+    }
+
+    /// Whether or not to always link executables by running `$CC`, rather than with the built-in linker
+    ///
+    /// \return Whether or not to use the system linker
+    [[nodiscard]] constexpr bool system_linker() const noexcept {
+      return system_linker_;
+    }
+
+    /// Whether or not to reuse optimized code from earlier compilations that didn't change
+    ///
+    /// \return Whether or not incremental compilation is enabled
+    [[nodiscard]] constexpr bool incremental() const noexcept {
+      return incremental_;
+    }
+
+    /// The directory that the incremental compilation cache is kept in. If this is
+    /// empty, the platform's user cache directory is used instead
+    ///
+    /// \return The cache directory
+    [[nodiscard]] std::string_view cache_dir() const noexcept {
+      return cache_dir_;
+    }
+
+    /// The directory that module interfaces are written to and imported from. If this is
+    /// empty, no interfaces are written and nothing can be imported
+    ///
+    /// \return The module directory
+    [[nodiscard]] std::string_view module_dir() const noexcept {
+      return module_dir_;
+    }
+
+    /// An LLVM pass pipeline (in `opt -passes` syntax) to run instead of the one that
+    /// `--opt` would pick. Empty if the default pipeline should be used
+    ///
+    /// \return The pass pipeline
+    [[nodiscard]] std::string_view passes() const noexcept {
+      return passes_;
+    }
+
+    /// Whether or not to instrument the generated code so that running it writes out
+    /// a profile, which can be merged with `llvm-profdata` and given to `--profile_use`
+    ///
+    /// \return Whether or not to instrument code
+    [[nodiscard]] constexpr bool profile_generate() const noexcept {
+      return profile_generate_;
+    }
+
+    /// The merged profile (a `.profdata` file) that optimization decisions should be based
+    /// on. Empty if there is no profile
+    ///
+    /// \return The path of the profile
+    [[nodiscard]] std::string_view profile_use() const noexcept {
+      return profile_use_;
+    }
+
   private:
     std::string out_;
     std::string args_;
+    std::string cache_dir_;
+    std::string module_dir_;
+    std::string passes_;
+    std::string profile_use_;
     std::uint64_t jobs_;
     OptLevel opt_level_;
     OutputFormat format_;
+    ParserKind parser_;
+    LTOKind lto_;
+    PanicMode panic_;
     bool debug_;
     bool verbose_;
     bool colored_;
     bool demangle_;
     bool no_checking_;
     bool debug_stdlib_verbose_;
+    bool time_trace_;
+    bool time_report_;
+    bool system_linker_;
+    bool incremental_;
+    bool profile_generate_;
+  };
+
+  /// Checks whether `--serve` was passed. This is read straight from the command line instead of
+  /// going through `flags()`, since the server never compiles anything itself and the processes
+  /// that do need to build their config from a request's arguments instead
+  ///
+  /// \return Whether or not to run as a compile server
+  [[nodiscard]] bool serve_requested() noexcept;
+
+  /// Gets the socket that `--serve` should listen on, see `serve_requested`
+  ///
+  /// \return The value of `--socket`, which may be empty
+  [[nodiscard]] std::string serve_socket() noexcept;
+
+  /// Makes a config the one that `gal::flags()` returns on the current thread for as long as the
+  /// scope object is alive, and then restores whatever was active before it. This is how code that
+  /// isn't driven by the command line (see `gal::CompilerSession`) gives the compiler its options.
+  class ConfigScope {
+  public:
+    /// Activates `config` on the current thread
+    ///
+    /// \param config The config to activate, must outlive the scope
+    explicit ConfigScope(const CompilerConfig* config) noexcept;
+
+    /// ConfigScope is not copyable
+    ConfigScope(const ConfigScope&) = delete;
+
+    /// ConfigScope is not movable
+    ConfigScope(ConfigScope&&) = delete;
+
+    /// ConfigScope is not copy-assignable
+    ConfigScope& operator=(const ConfigScope&) = delete;
+
+    /// ConfigScope is not move-assignable
+    ConfigScope& operator=(ConfigScope&&) = delete;
+
+    /// Restores the previously active config
+    ~ConfigScope();
+
+  private:
+    const CompilerConfig* previous_;
   };
 
   /// Handles delegating any other CLI flags that need to go
   /// into external libraries, i.e LLVM
   void delegate_flags() noexcept;
 
-  /// Parses the command line flags for the compiler and returns a config object
+  /// Parses the command line flags for the compiler and returns a config object. If a
+  /// `ConfigScope` is active on the current thread, its config is returned instead.
   ///
-  /// \param argc The number of arguments
-  /// \param argv The vector of arguments as C-strings
   /// \return A config object
   [[nodiscard]] const CompilerConfig& flags() noexcept;
 } // namespace gal
\ No newline at end of file
@@ -352,6 +352,9 @@ namespace {
       print_member("loop direction: ", node.loop_direction() == gal::ast::ForDirection::up_to ? "up-to" : "down-to");
       accept_member("loop initializer: ", node.init());
       accept_member("loop end: ", node.last());
+      print_list("attributes: ", node.attributes(), [this](const ast::LoopAttribute& attribute) {
+        print_initial(colors::cyan(loop_attribute_to_str(attribute)));
+      });
       accept_last_member("body: ", node.body());
     }
 
@@ -556,6 +559,12 @@ namespace {
           ")"));
     }
 
+    void visit(const ast::VectorType& type) final {
+      auto rest = type.element_type().accept(this);
+
+      return_value(absl::StrCat(rest, colors::blue(absl::StrCat("x", type.lanes()))));
+    }
+
   private:
     enum class PaddingMessage { spaces, bar_spaces };
 
@@ -648,6 +657,18 @@ namespace {
         case Type::builtin_throws: return "throws";
         case Type::builtin_stdlib: return "__stdlib";
         case Type::builtin_varargs: return "var-args";
+        case Type::builtin_may_alias: return "may-alias";
+        default: assert(false); return "";
+      }
+    }
+
+    static std::string loop_attribute_to_str(const ast::LoopAttribute& attribute) noexcept {
+      using Type = ast::LoopAttributeType;
+
+      switch (attribute.type) {
+        case Type::builtin_vectorize: return absl::StrCat("vectorize (", attribute.value, ")");
+        case Type::builtin_unroll: return absl::StrCat("unroll (", attribute.value, ")");
+        case Type::builtin_no_vectorize: return "no-vectorize";
         default: assert(false); return "";
       }
     }
@@ -865,6 +886,10 @@ namespace {
     void visit(const ast::IndirectionType& type) final {
       return_value(absl::StrCat("<indirection -> ", type.produced().accept(this), ">"));
     }
+
+    void visit(const ast::VectorType& type) final {
+      return_value(absl::StrCat(type.element_type().accept(this), "x", type.lanes()));
+    }
   };
 } // namespace
 
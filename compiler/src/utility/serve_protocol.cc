@@ -0,0 +1,248 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./serve_protocol.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// a request is a u32 byte count (sent along with the client's fds), then the working
+// directory, a u32 count of environment variables, those variables and finally every
+// argument. all of the strings are u32-length-prefixed. everything is native endian,
+// both ends are always on the same machine. the reply is a single i32.
+
+namespace {
+  constexpr auto max_request_size = std::uint32_t{16 * 1024 * 1024};
+
+  bool write_all(int socket, const void* data, std::size_t size) noexcept {
+    auto* bytes = static_cast<const char*>(data);
+
+    while (size != 0) {
+      auto written = ::write(socket, bytes, size);
+
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+
+      if (written <= 0) {
+        return false;
+      }
+
+      bytes += written;
+      size -= static_cast<std::size_t>(written);
+    }
+
+    return true;
+  }
+
+  bool read_all(int socket, void* data, std::size_t size) noexcept {
+    auto* bytes = static_cast<char*>(data);
+
+    while (size != 0) {
+      auto got = ::read(socket, bytes, size);
+
+      if (got < 0 && errno == EINTR) {
+        continue;
+      }
+
+      if (got <= 0) {
+        return false;
+      }
+
+      bytes += got;
+      size -= static_cast<std::size_t>(got);
+    }
+
+    return true;
+  }
+
+  void append_string(std::string* buffer, const std::string& string) noexcept {
+    auto length = static_cast<std::uint32_t>(string.size());
+
+    buffer->append(reinterpret_cast<const char*>(&length), sizeof length);
+    buffer->append(string);
+  }
+
+  std::optional<std::string> take_string(std::string_view* buffer) noexcept {
+    auto length = std::uint32_t{0};
+
+    if (buffer->size() < sizeof length) {
+      return std::nullopt;
+    }
+
+    std::memcpy(&length, buffer->data(), sizeof length);
+    buffer->remove_prefix(sizeof length);
+
+    if (buffer->size() < length) {
+      return std::nullopt;
+    }
+
+    auto string = std::string{buffer->substr(0, length)};
+    buffer->remove_prefix(length);
+
+    return string;
+  }
+} // namespace
+
+namespace gal {
+  std::string default_socket_path() noexcept {
+    if (auto* path = std::getenv("GALLIUM_SOCKET"); path != nullptr && *path != '\0') {
+      return path;
+    }
+
+    if (auto* runtime = std::getenv("XDG_RUNTIME_DIR"); runtime != nullptr && *runtime != '\0') {
+      return std::string{runtime} + "/gallium.sock";
+    }
+
+    return "/tmp/gallium-" + std::to_string(::getuid()) + ".sock";
+  }
+
+  bool send_request(int socket, const ServeRequest& request) noexcept {
+    auto payload = std::string{};
+
+    append_string(&payload, request.cwd);
+
+    auto env_count = static_cast<std::uint32_t>(request.env.size());
+    payload.append(reinterpret_cast<const char*>(&env_count), sizeof env_count);
+
+    for (auto& variable : request.env) {
+      append_string(&payload, variable);
+    }
+
+    for (auto& arg : request.args) {
+      append_string(&payload, arg);
+    }
+
+    auto size = static_cast<std::uint32_t>(payload.size());
+    int fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    char control[CMSG_SPACE(sizeof fds)] = {};
+    auto header = iovec{&size, sizeof size};
+    auto message = msghdr{};
+
+    message.msg_iov = &header;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof control;
+
+    auto* cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof fds);
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof fds);
+
+    while (::sendmsg(socket, &message, 0) < 0) {
+      if (errno != EINTR) {
+        return false;
+      }
+    }
+
+    return write_all(socket, payload.data(), payload.size());
+  }
+
+  std::optional<ServeRequest> receive_request(int socket, int (&fds)[3]) noexcept {
+    auto size = std::uint32_t{0};
+    char control[CMSG_SPACE(sizeof fds)] = {};
+    auto header = iovec{&size, sizeof size};
+    auto message = msghdr{};
+
+    message.msg_iov = &header;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof control;
+
+    auto got = ssize_t{0};
+
+    do {
+      got = ::recvmsg(socket, &message, 0);
+    } while (got < 0 && errno == EINTR);
+
+    auto* cmsg = CMSG_FIRSTHDR(&message);
+
+    if (cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof fds)) {
+      return std::nullopt;
+    }
+
+    std::memcpy(fds, CMSG_DATA(cmsg), sizeof fds);
+
+    // the header is tiny, but a stream socket is still allowed to split it up
+    if (got <= 0 || (got < static_cast<ssize_t>(sizeof size)
+                        && !read_all(socket, reinterpret_cast<char*>(&size) + got, sizeof size - got))) {
+      return std::nullopt;
+    }
+
+    if (size > max_request_size) {
+      return std::nullopt;
+    }
+
+    auto payload = std::string(size, '\0');
+
+    if (!read_all(socket, payload.data(), payload.size())) {
+      return std::nullopt;
+    }
+
+    auto request = ServeRequest{};
+    auto rest = std::string_view{payload};
+
+    if (auto cwd = take_string(&rest)) {
+      request.cwd = std::move(*cwd);
+    } else {
+      return std::nullopt;
+    }
+
+    auto env_count = std::uint32_t{0};
+
+    if (rest.size() < sizeof env_count) {
+      return std::nullopt;
+    }
+
+    std::memcpy(&env_count, rest.data(), sizeof env_count);
+    rest.remove_prefix(sizeof env_count);
+
+    for (auto i = std::uint32_t{0}; i < env_count; ++i) {
+      if (auto variable = take_string(&rest)) {
+        request.env.push_back(std::move(*variable));
+      } else {
+        return std::nullopt;
+      }
+    }
+
+    while (!rest.empty()) {
+      if (auto arg = take_string(&rest)) {
+        request.args.push_back(std::move(*arg));
+      } else {
+        return std::nullopt;
+      }
+    }
+
+    return request;
+  }
+
+  bool send_exit_code(int socket, int code) noexcept {
+    auto value = static_cast<std::int32_t>(code);
+
+    return write_all(socket, &value, sizeof value);
+  }
+
+  std::optional<int> receive_exit_code(int socket) noexcept {
+    auto value = std::int32_t{0};
+
+    if (!read_all(socket, &value, sizeof value)) {
+      return std::nullopt;
+    }
+
+    return static_cast<int>(value);
+  }
+} // namespace gal
@@ -0,0 +1,67 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// this is shared with `gallium-client`, which is meant to start as quickly as possible,
+// so it can't depend on anything besides the standard library and POSIX
+
+namespace gal {
+  /// A single compile request sent to a `--serve` server, this is
+  /// everything that a normal `gallium` invocation would have gotten
+  struct ServeRequest {
+    /// The arguments, including `argv[0]`
+    std::vector<std::string> args;
+    /// The working directory of the client
+    std::string cwd;
+    /// The client's environment, as `NAME=value` strings
+    std::vector<std::string> env;
+  };
+
+  /// Gets the socket that the server listens on and the client connects to when
+  /// nothing else is specified. This is `$GALLIUM_SOCKET` if it's set, otherwise it's
+  /// `gallium.sock` inside of `$XDG_RUNTIME_DIR` or `/tmp/gallium-<uid>.sock`.
+  ///
+  /// \return The default socket path
+  [[nodiscard]] std::string default_socket_path() noexcept;
+
+  /// Sends a request over a connected socket, along with the client's stdin, stdout and
+  /// stderr so that the server can read and write them directly.
+  ///
+  /// \param socket The socket to write to
+  /// \param request The request to send
+  /// \return Whether or not the request was sent
+  [[nodiscard]] bool send_request(int socket, const ServeRequest& request) noexcept;
+
+  /// Reads a request from a connected socket. The client's stdin, stdout and stderr
+  /// are received as new file descriptors and written into `fds`.
+  ///
+  /// \param socket The socket to read from
+  /// \param fds Where to put the client's standard streams
+  /// \return The request, if a well-formed one was read
+  [[nodiscard]] std::optional<ServeRequest> receive_request(int socket, int (&fds)[3]) noexcept;
+
+  /// Sends the exit code that the compile finished with
+  ///
+  /// \param socket The socket to write to
+  /// \param code The exit code
+  /// \return Whether or not the code was sent
+  [[nodiscard]] bool send_exit_code(int socket, int code) noexcept;
+
+  /// Waits for the server to send back an exit code
+  ///
+  /// \param socket The socket to read from
+  /// \return The exit code, or `nullopt` if the server went away before sending one
+  [[nodiscard]] std::optional<int> receive_exit_code(int socket) noexcept;
+} // namespace gal
@@ -0,0 +1,148 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./source_manager.h"
+#include "absl/strings/strip.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace gal {
+  SourceManager::SourceManager() noexcept {
+    // ID 0 is the "no file" entry, it's what `SourceLoc::nonexistent()` refers to
+    files_.push_back(std::make_unique<SourceFile>());
+  }
+
+  SourceManager::~SourceManager() = default;
+
+  std::variant<FileID, std::error_code> SourceManager::load(const std::filesystem::path& path) noexcept {
+    // LLVM already knows when mmap is worth it (and when it isn't possible, e.g. pipes),
+    // we don't need a null terminator since everything works with string_views
+    auto buffer = llvm::MemoryBuffer::getFileOrSTDIN(path.string(), false, false);
+
+    if (!buffer) {
+      return buffer.getError();
+    }
+
+    auto file = std::make_unique<SourceFile>();
+    file->path = (path == "-") ? std::filesystem::path{"<stdin>"} : path;
+    file->mapped = std::move(*buffer);
+    file->contents = file->mapped->getBuffer();
+
+    return insert(std::move(file));
+  }
+
+  FileID SourceManager::add(std::filesystem::path path, std::string contents) noexcept {
+    auto file = std::make_unique<SourceFile>();
+    file->path = std::move(path);
+    file->owned = std::move(contents);
+    file->contents = file->owned;
+
+    return insert(std::move(file));
+  }
+
+  std::string_view SourceManager::contents(FileID file) const noexcept {
+    return get(file).contents;
+  }
+
+  const std::filesystem::path& SourceManager::path(FileID file) const noexcept {
+    return get(file).path;
+  }
+
+  std::uint64_t SourceManager::line_of(FileID file, std::uint32_t offset) const noexcept {
+    if (file == 0) {
+      return 0;
+    }
+
+    auto& starts = line_starts(get(file));
+
+    // first line start that's *after* offset, the line we want is the one before that
+    auto it = std::upper_bound(starts.begin(), starts.end(), offset);
+
+    return static_cast<std::uint64_t>(std::distance(starts.begin(), it));
+  }
+
+  std::uint64_t SourceManager::column_of(FileID file, std::uint32_t offset) const noexcept {
+    if (file == 0) {
+      return 0;
+    }
+
+    auto& starts = line_starts(get(file));
+    auto line = line_of(file, offset);
+
+    return (offset - starts[line - 1]) + 1;
+  }
+
+  std::string_view SourceManager::line(FileID file, std::uint64_t line) const noexcept {
+    auto& source = get(file);
+    auto& starts = line_starts(source);
+
+    if (line == 0 || line > starts.size()) {
+      return "";
+    }
+
+    auto text = source.contents;
+    auto begin = starts[line - 1];
+    auto end = (line < starts.size()) ? starts[line] - 1 : text.size(); // - 1 for the `\n`
+
+    return absl::StripSuffix(text.substr(begin, end - begin), "\r");
+  }
+
+  FileID SourceManager::insert(std::unique_ptr<SourceFile> file) noexcept {
+    // offsets are stored as 32-bit values in every source location
+    assert(file->contents.size() < std::numeric_limits<std::uint32_t>::max());
+
+    auto guard = std::unique_lock{lock_};
+    files_.push_back(std::move(file));
+
+    return static_cast<FileID>(files_.size() - 1);
+  }
+
+  void SourceManager::release(FileID file) noexcept {
+    auto guard = std::unique_lock{lock_};
+
+    assert(file != 0 && file < files_.size());
+
+    files_[file] = nullptr;
+  }
+
+  const SourceManager::SourceFile& SourceManager::get(FileID file) const noexcept {
+    auto guard = std::shared_lock{lock_};
+
+    assert(file < files_.size());
+
+    // the file itself never moves, only the vector of pointers can. released files
+    // look exactly like the "no file" entry
+    return (files_[file] != nullptr) ? *files_[file] : *files_[0];
+  }
+
+  const std::vector<std::uint32_t>& SourceManager::line_starts(const SourceFile& file) const noexcept {
+    std::call_once(file.lines_computed, [&file] {
+      auto& text = file.contents;
+
+      file.line_starts.push_back(0);
+
+      for (auto i = std::size_t{0}; i < text.size(); ++i) {
+        if (text[i] == '\n') {
+          file.line_starts.push_back(static_cast<std::uint32_t>(i + 1));
+        }
+      }
+    });
+
+    return file.line_starts;
+  }
+
+  SourceManager& sources() noexcept {
+    static SourceManager manager;
+
+    return manager;
+  }
+} // namespace gal
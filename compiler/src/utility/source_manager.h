@@ -0,0 +1,141 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+namespace llvm {
+  class MemoryBuffer;
+} // namespace llvm
+
+namespace gal {
+  /// Identifies a single file that has been loaded into the source manager.
+  /// ID 0 is reserved for "no file", and is what nonexistent locations point into
+  using FileID = std::uint32_t;
+
+  /// Owns the text of every source file the compiler has loaded, and
+  /// maps byte offsets into those files back into line/column pairs.
+  ///
+  /// Source locations only store a file ID and a byte range, everything else
+  /// (the raw text, the path, line and column) is looked up here on demand.
+  /// Line tables are only built for a file the first time they're needed,
+  /// which is usually only when a diagnostic is being printed.
+  ///
+  /// Safe to use from multiple threads at once.
+  class SourceManager {
+  public:
+    /// Creates a source manager that only contains the "no file" entry
+    explicit SourceManager() noexcept;
+
+    /// Unmaps and frees every file
+    ~SourceManager();
+
+    /// SourceManager is not copyable
+    SourceManager(const SourceManager&) = delete;
+
+    /// SourceManager is not movable
+    SourceManager(SourceManager&&) = delete;
+
+    /// SourceManager is not copy-assignable
+    SourceManager& operator=(const SourceManager&) = delete;
+
+    /// SourceManager is not move-assignable
+    SourceManager& operator=(SourceManager&&) = delete;
+
+    /// Reads a file and registers it with the manager. Regular files are
+    /// memory-mapped and viewed in-place rather than being copied, pipes
+    /// and stdin (a path of `-`) are read into a buffer instead.
+    ///
+    /// \param path The path of the file to read
+    /// \return The ID that refers to the file from now on, or the reason it couldn't be read
+    [[nodiscard]] std::variant<FileID, std::error_code> load(const std::filesystem::path& path) noexcept;
+
+    /// Registers a file with the manager, and takes ownership of its text
+    ///
+    /// \param path The path of the file
+    /// \param contents The full text of the file
+    /// \return The ID that refers to the file from now on
+    [[nodiscard]] FileID add(std::filesystem::path path, std::string contents) noexcept;
+
+    /// Gets the full text of a file
+    ///
+    /// \param file The file to get the text of
+    /// \return The text of the file, valid for as long as the manager is
+    [[nodiscard]] std::string_view contents(FileID file) const noexcept;
+
+    /// Gets the path that a file was loaded from
+    ///
+    /// \param file The file to get the path of
+    /// \return The path of the file
+    [[nodiscard]] const std::filesystem::path& path(FileID file) const noexcept;
+
+    /// Gets the 1-based line number that a byte offset is on
+    ///
+    /// \param file The file the offset is in
+    /// \param offset The byte offset into the file
+    /// \return The line number
+    [[nodiscard]] std::uint64_t line_of(FileID file, std::uint32_t offset) const noexcept;
+
+    /// Gets the 1-based column (in bytes) that a byte offset is on
+    ///
+    /// \param file The file the offset is in
+    /// \param offset The byte offset into the file
+    /// \return The column number
+    [[nodiscard]] std::uint64_t column_of(FileID file, std::uint32_t offset) const noexcept;
+
+    /// Gets the text of a single line, without any line terminator
+    ///
+    /// \param file The file to get the line from
+    /// \param line The 1-based line number
+    /// \return The text of that line
+    [[nodiscard]] std::string_view line(FileID file, std::uint64_t line) const noexcept;
+
+    /// Frees the text and line table of a file that isn't needed anymore. The ID is never
+    /// reused, but from then on it behaves like the "no file" ID. Nothing else can be
+    /// using the file while it's being released.
+    ///
+    /// \param file The file to release
+    void release(FileID file) noexcept;
+
+  private:
+    struct SourceFile {
+      std::filesystem::path path;
+      std::string_view contents;
+      std::string owned;                          // the text, for files given to `add`
+      std::unique_ptr<llvm::MemoryBuffer> mapped; // the text, for files read by `load`
+      mutable std::once_flag lines_computed;
+      mutable std::vector<std::uint32_t> line_starts;
+    };
+
+    [[nodiscard]] FileID insert(std::unique_ptr<SourceFile> file) noexcept;
+
+    [[nodiscard]] const SourceFile& get(FileID file) const noexcept;
+
+    [[nodiscard]] const std::vector<std::uint32_t>& line_starts(const SourceFile& file) const noexcept;
+
+    mutable std::shared_mutex lock_;
+    std::vector<std::unique_ptr<SourceFile>> files_;
+  };
+
+  /// Gets the source manager that every file the compiler loads is put into
+  ///
+  /// \return The global source manager
+  [[nodiscard]] SourceManager& sources() noexcept;
+} // namespace gal
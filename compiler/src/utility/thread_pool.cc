@@ -0,0 +1,157 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "./thread_pool.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace {
+  constexpr auto not_a_worker = std::numeric_limits<std::size_t>::max();
+
+  // lets `submit` know whether it's being called from inside one of the pool's workers
+  thread_local const gal::ThreadPool* current_pool = nullptr;
+  thread_local std::size_t current_worker = not_a_worker;
+} // namespace
+
+namespace gal {
+  ThreadPool::ThreadPool(std::size_t threads) noexcept {
+    if (threads == 0) {
+      threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    queues_.reserve(threads);
+    workers_.reserve(threads);
+
+    for (auto i = std::size_t{0}; i < threads; ++i) {
+      queues_.push_back(std::make_unique<Worker>());
+    }
+
+    // every queue needs to exist before any worker can start trying to steal
+    for (auto i = std::size_t{0}; i < threads; ++i) {
+      workers_.emplace_back([this, i] {
+        work(i);
+      });
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    wait();
+
+    {
+      auto guard = std::lock_guard{lock_};
+      stopping_ = true;
+    }
+
+    has_work_.notify_all();
+
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  void ThreadPool::submit(std::function<void()> task) noexcept {
+    {
+      auto guard = std::lock_guard{lock_};
+      ++pending_;
+    }
+
+    auto index = (current_pool == this) ? current_worker : next_.fetch_add(1, std::memory_order_relaxed) % size();
+    auto& queue = *queues_[index];
+
+    // bumped before the push so a worker that grabs the task early can't underflow the count
+    queued_.fetch_add(1, std::memory_order_release);
+
+    {
+      auto guard = std::lock_guard{queue.lock};
+      queue.tasks.push_back(std::move(task));
+    }
+
+    // a worker checks `queued_` while holding `lock_` before it goes to sleep, taking
+    // the lock here means it either sees the new task or is already waiting to be notified
+    { auto guard = std::lock_guard{lock_}; }
+
+    has_work_.notify_one();
+  }
+
+  void ThreadPool::wait() noexcept {
+    assert(current_pool != this && "cannot wait on a pool from inside one of its own workers");
+
+    auto guard = std::unique_lock{lock_};
+
+    finished_.wait(guard, [this] {
+      return pending_ == 0;
+    });
+  }
+
+  void ThreadPool::work(std::size_t index) noexcept {
+    current_pool = this;
+    current_worker = index;
+
+    while (true) {
+      auto task = std::function<void()>{};
+
+      if (try_pop(index, &task) || try_steal(index, &task)) {
+        task();
+
+        auto guard = std::lock_guard{lock_};
+
+        if (--pending_ == 0) {
+          finished_.notify_all();
+        }
+
+        continue;
+      }
+
+      auto guard = std::unique_lock{lock_};
+
+      has_work_.wait(guard, [this] {
+        return stopping_ || queued_.load(std::memory_order_acquire) != 0;
+      });
+
+      if (stopping_ && queued_.load(std::memory_order_acquire) == 0) {
+        return;
+      }
+    }
+  }
+
+  bool ThreadPool::try_pop(std::size_t index, std::function<void()>* task) noexcept {
+    auto& queue = *queues_[index];
+    auto guard = std::lock_guard{queue.lock};
+
+    if (queue.tasks.empty()) {
+      return false;
+    }
+
+    *task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  bool ThreadPool::try_steal(std::size_t index, std::function<void()>* task) noexcept {
+    // start at our neighbor so that every worker doesn't hammer worker #0 at once
+    for (auto offset = std::size_t{1}; offset < size(); ++offset) {
+      auto& victim = *queues_[(index + offset) % size()];
+      auto guard = std::lock_guard{victim.lock};
+
+      if (!victim.tasks.empty()) {
+        *task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+
+        return true;
+      }
+    }
+
+    return false;
+  }
+} // namespace gal
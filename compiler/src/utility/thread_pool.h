@@ -0,0 +1,92 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gal {
+  /// A fixed-size work-stealing thread pool.
+  ///
+  /// Every worker owns a deque of tasks. Workers pop from the back of their own
+  /// deque (so recently-pushed work stays hot in cache), and when that runs dry
+  /// they steal from the front of other workers' deques.
+  class ThreadPool {
+  public:
+    /// Creates a pool with `threads` workers. If `threads` is 0,
+    /// one worker is created per hardware thread.
+    ///
+    /// \param threads The number of worker threads to create
+    explicit ThreadPool(std::size_t threads) noexcept;
+
+    /// ThreadPool is not copyable
+    ThreadPool(const ThreadPool&) = delete;
+
+    /// ThreadPool is not movable
+    ThreadPool(ThreadPool&&) = delete;
+
+    /// ThreadPool is not copy-assignable
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// ThreadPool is not move-assignable
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    /// Waits for every submitted task to finish, and then joins every worker
+    ~ThreadPool();
+
+    /// Submits a task to be run on one of the workers. When called from
+    /// inside of a worker the task goes onto that worker's own deque,
+    /// otherwise tasks are distributed round-robin.
+    ///
+    /// \param task The task to run
+    void submit(std::function<void()> task) noexcept;
+
+    /// Blocks until every task that has been submitted has finished running
+    void wait() noexcept;
+
+    /// Gets the number of worker threads in the pool
+    ///
+    /// \return The number of workers
+    [[nodiscard]] std::size_t size() const noexcept {
+      // `queues_` is filled before any worker starts, `workers_` is still growing while they run
+      return queues_.size();
+    }
+
+  private:
+    struct Worker {
+      std::mutex lock;
+      std::deque<std::function<void()>> tasks;
+    };
+
+    void work(std::size_t index) noexcept;
+
+    [[nodiscard]] bool try_pop(std::size_t index, std::function<void()>* task) noexcept;
+
+    [[nodiscard]] bool try_steal(std::size_t index, std::function<void()>* task) noexcept;
+
+    std::vector<std::unique_ptr<Worker>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<std::size_t> next_ = 0;
+    std::atomic<std::size_t> queued_ = 0;
+    std::size_t pending_ = 0;
+    bool stopping_ = false;
+    std::mutex lock_;
+    std::condition_variable has_work_;
+    std::condition_variable finished_;
+  };
+} // namespace gal
@@ -0,0 +1,152 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+
+#include "./timing.h"
+#include "./flags.h"
+#include "./log.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_format.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  struct ReportEntry {
+    std::string name;
+    gal::TimeCategory category;
+    Clock::duration total = Clock::duration::zero();
+    std::uint64_t count = 0;
+  };
+
+  // how many of the slowest LLVM passes to show in the report
+  constexpr auto passes_in_report = std::size_t{10};
+
+  std::mutex report_lock;
+  absl::flat_hash_map<std::string, ReportEntry> report;
+
+  void report_add(std::string_view name, gal::TimeCategory category, Clock::duration elapsed) noexcept {
+    auto guard = std::lock_guard{report_lock};
+    auto [it, _] = report.try_emplace(name, ReportEntry{std::string{name}, category});
+
+    (*it).second.total += elapsed;
+    (*it).second.count += 1;
+  }
+
+  void print_entries(std::ostream& os, std::string_view title, absl::Span<const ReportEntry> entries) noexcept {
+    os << absl::StrFormat("  %-40s %12s %10s\n", title, "total (ms)", "count");
+
+    for (auto& entry : entries) {
+      auto ms = std::chrono::duration<double, std::milli>(entry.total).count();
+
+      os << absl::StrFormat("  %-40s %12.3f %10d\n", entry.name, ms, entry.count);
+    }
+  }
+} // namespace
+
+namespace gal {
+  TimeScope::TimeScope(std::string_view name, TimeCategory category) noexcept
+      : TimeScope(name, category, [] {
+          return std::string{};
+        }) {}
+
+  TimeScope::TimeScope(std::string_view name, TimeCategory category, llvm::function_ref<std::string()> detail) noexcept
+      : name_{name},
+        category_{category} {
+    if (llvm::timeTraceProfilerEnabled()) {
+      llvm::timeTraceProfilerBegin(llvm::StringRef{name.data(), name.size()}, detail);
+      traced_ = true;
+    }
+
+    if (gal::flags().time_report() && category != TimeCategory::trace_only) {
+      start_ = Clock::now();
+      timed_ = true;
+    }
+  }
+
+  TimeScope::~TimeScope() {
+    if (timed_) {
+      report_add(name_, category_, Clock::now() - start_);
+    }
+
+    if (traced_) {
+      llvm::timeTraceProfilerEnd();
+    }
+  }
+
+  void time_trace_start_thread() noexcept {
+    if (gal::flags().time_trace()) {
+      llvm::timeTraceProfilerInitialize(0, "galliumc");
+    }
+  }
+
+  void time_trace_finish_thread() noexcept {
+    if (llvm::timeTraceProfilerEnabled()) {
+      llvm::timeTraceProfilerFinishThread();
+    }
+  }
+
+  bool time_trace_write(std::string_view path) noexcept {
+    if (!llvm::timeTraceProfilerEnabled()) {
+      return true;
+    }
+
+    auto ec = std::error_code{};
+    auto os = llvm::raw_fd_ostream(llvm::StringRef{path.data(), path.size()}, ec, llvm::sys::fs::OF_Text);
+
+    if (ec) {
+      gal::errs() << "unable to open time trace file `" << path << "`: " << ec.message();
+      llvm::timeTraceProfilerCleanup();
+
+      return false;
+    }
+
+    llvm::timeTraceProfilerWrite(os);
+    llvm::timeTraceProfilerCleanup();
+
+    return true;
+  }
+
+  void time_report_print(std::ostream& os) noexcept {
+    auto phases = std::vector<ReportEntry>{};
+    auto passes = std::vector<ReportEntry>{};
+
+    {
+      auto guard = std::lock_guard{report_lock};
+
+      for (auto& [_, entry] : report) {
+        (entry.category == TimeCategory::phase ? phases : passes).push_back(entry);
+      }
+    }
+
+    auto slowest_first = [](const ReportEntry& lhs, const ReportEntry& rhs) {
+      return lhs.total > rhs.total;
+    };
+
+    std::sort(phases.begin(), phases.end(), slowest_first);
+    std::sort(passes.begin(), passes.end(), slowest_first);
+    passes.resize(std::min(passes.size(), passes_in_report));
+
+    os << "===------------------------ time report ------------------------===\n";
+    print_entries(os, "phase", phases);
+
+    if (!passes.empty()) {
+      os << '\n';
+      print_entries(os, "slowest LLVM passes", passes);
+    }
+
+    os << "===-------------------------------------------------------------===\n";
+  }
+} // namespace gal
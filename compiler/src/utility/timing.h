@@ -0,0 +1,99 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+
+#pragma once
+
+#include "llvm/ADT/STLExtras.h"
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace gal {
+  /// What sort of work a `TimeScope` is measuring, decides
+  /// where (if anywhere) it shows up in `--time_report`
+  enum class TimeCategory {
+    /// One of the big phases of the compiler (parsing, type checking, etc.)
+    phase,
+    /// A single LLVM pass
+    pass,
+    /// Anything too fine-grained (or too nested) for the report, e.g. the
+    /// work for a single function. Only shows up in traces
+    trace_only,
+  };
+
+  /// Measures how long a piece of work takes. If `--time_trace` is enabled it
+  /// shows up as a span in the trace, and if `--time_report` is enabled the time
+  /// is added to the summary printed at the end.
+  ///
+  /// If neither is enabled this does nothing.
+  class TimeScope {
+  public:
+    /// Starts timing some work
+    ///
+    /// \param name The name of the work, should outlive the scope
+    /// \param category What type of work is being timed
+    explicit TimeScope(std::string_view name, TimeCategory category = TimeCategory::phase) noexcept;
+
+    /// Starts timing some work
+    ///
+    /// \param name The name of the work, should outlive the scope
+    /// \param category What type of work is being timed
+    /// \param detail Gets extra information for the trace (e.g. a function name),
+    ///        only called if tracing is actually enabled
+    explicit TimeScope(std::string_view name,
+        TimeCategory category,
+        llvm::function_ref<std::string()> detail) noexcept;
+
+    /// TimeScope is not copyable
+    TimeScope(const TimeScope&) = delete;
+
+    /// TimeScope is not movable
+    TimeScope(TimeScope&&) = delete;
+
+    /// TimeScope is not copy-assignable
+    TimeScope& operator=(const TimeScope&) = delete;
+
+    /// TimeScope is not move-assignable
+    TimeScope& operator=(TimeScope&&) = delete;
+
+    /// Stops timing the work, and records it
+    ~TimeScope();
+
+  private:
+    std::string_view name_;
+    std::chrono::steady_clock::time_point start_;
+    TimeCategory category_;
+    bool traced_ = false;
+    bool timed_ = false;
+  };
+
+  /// Sets up time tracing on the calling thread. Every thread that creates
+  /// a `TimeScope` needs to call this first, and must call `time_trace_finish_thread`
+  /// once it's done.
+  void time_trace_start_thread() noexcept;
+
+  /// Hands off the calling thread's trace so it can be written out later
+  void time_trace_finish_thread() noexcept;
+
+  /// Writes out the trace for every thread, and then tears down tracing.
+  /// Must be called on the same thread that originally called `time_trace_start_thread`,
+  /// after every other thread has called `time_trace_finish_thread`.
+  ///
+  /// \param path The file to write the trace to
+  /// \return Whether or not writing the trace succeeded
+  [[nodiscard]] bool time_trace_write(std::string_view path) noexcept;
+
+  /// Prints a summary table of where compile time was spent
+  ///
+  /// \param os The stream to print to
+  void time_report_print(std::ostream& os) noexcept;
+} // namespace gal
@@ -0,0 +1,167 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+
+// Measures how long it takes to build, clone, walk and destroy a large AST
+// with nodes on the heap versus in a `gal::Arena`.
+//
+// The AST is roughly what the parser produces for a file with `fns` functions
+// that each contain `stmts` statements of the form `let x = ((1 + 2) * (3 + 4)) ...;`,
+// and the clone step mimics the copies that the type checker makes.
+//
+// usage: gallium_bench_ast [fns] [stmts] [depth]
+
+#include "src/ast/nodes.h"
+#include "src/ast/program.h"
+#include "src/utility/arena.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ast = gal::ast;
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  struct Sizes {
+    int fns;
+    int stmts;
+    int depth;
+  };
+
+  struct Timings {
+    double build;
+    double clone;
+    double walk;
+    double destroy;
+  };
+
+  std::unique_ptr<ast::Expression> tree(int depth, std::uint64_t* counter) noexcept {
+    if (depth == 0) {
+      return std::make_unique<ast::IntegerLiteralExpression>(ast::SourceLoc::nonexistent(), (*counter)++);
+    }
+
+    return std::make_unique<ast::BinaryExpression>(ast::SourceLoc::nonexistent(),
+        (depth % 2 == 0) ? ast::BinaryOp::mul : ast::BinaryOp::add,
+        tree(depth - 1, counter),
+        tree(depth - 1, counter));
+  }
+
+  std::unique_ptr<ast::BlockExpression> body(const Sizes& sizes, std::uint64_t* counter) noexcept {
+    auto stmts = std::vector<std::unique_ptr<ast::Statement>>{};
+
+    for (auto i = 0; i < sizes.stmts; ++i) {
+      stmts.push_back(std::make_unique<ast::BindingStatement>(ast::SourceLoc::nonexistent(),
+          "x" + std::to_string(i),
+          false,
+          tree(sizes.depth, counter),
+          std::nullopt));
+    }
+
+    return std::make_unique<ast::BlockExpression>(ast::SourceLoc::nonexistent(), std::move(stmts));
+  }
+
+  ast::Program program(const Sizes& sizes, std::unique_ptr<gal::Arena> arena) noexcept {
+    auto decls = std::vector<std::unique_ptr<ast::Declaration>>{};
+    auto counter = std::uint64_t{0};
+
+    for (auto i = 0; i < sizes.fns; ++i) {
+      auto proto = ast::FnPrototype("f" + std::to_string(i),
+          std::nullopt,
+          {},
+          {},
+          std::make_unique<ast::VoidType>(ast::SourceLoc::nonexistent()));
+
+      decls.push_back(std::make_unique<ast::FnDeclaration>(ast::SourceLoc::nonexistent(),
+          false,
+          false,
+          std::move(proto),
+          body(sizes, &counter)));
+    }
+
+    return ast::Program(std::move(decls), std::move(arena));
+  }
+
+  double since(Clock::time_point start) noexcept {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  Timings run(const Sizes& sizes, bool use_arena) noexcept {
+    auto timings = Timings{};
+    auto arena = use_arena ? std::make_unique<gal::Arena>() : nullptr;
+    auto scope = gal::ArenaScope{arena.get()};
+
+    auto start = Clock::now();
+    auto prog = std::make_unique<ast::Program>(program(sizes, std::move(arena)));
+    timings.build = since(start);
+
+    start = Clock::now();
+    auto clones = std::vector<std::unique_ptr<ast::Expression>>{};
+
+    for (auto& decl : prog->decls()) {
+      clones.push_back(static_cast<ast::FnDeclaration&>(*decl).body().clone());
+    }
+
+    timings.clone = since(start);
+
+    start = Clock::now();
+    auto equal = std::size_t{0};
+
+    for (auto i = std::size_t{0}; i < clones.size(); ++i) {
+      equal += (*clones[i] == static_cast<ast::FnDeclaration&>(*prog->decls()[i]).body());
+    }
+
+    timings.walk = since(start);
+
+    if (equal != clones.size()) {
+      std::cerr << "clones did not compare equal to their originals\n";
+      std::exit(1);
+    }
+
+    start = Clock::now();
+    clones.clear();
+    prog.reset();
+    timings.destroy = since(start);
+
+    return timings;
+  }
+
+  void report(std::string_view name, const Timings& t) noexcept {
+    std::cout << name << ": build " << t.build << "ms, clone " << t.clone << "ms, walk " << t.walk << "ms, destroy "
+              << t.destroy << "ms, total " << (t.build + t.clone + t.walk + t.destroy) << "ms\n";
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  auto sizes = Sizes{2000, 50, 4};
+
+  if (argc > 1) {
+    sizes.fns = std::atoi(argv[1]);
+  }
+
+  if (argc > 2) {
+    sizes.stmts = std::atoi(argv[2]);
+  }
+
+  if (argc > 3) {
+    sizes.depth = std::atoi(argv[3]);
+  }
+
+  std::cout << sizes.fns << " fns x " << sizes.stmts << " stmts, expression depth " << sizes.depth << '\n';
+
+  // warm up the allocator so the first measurement isn't penalized
+  (void)run(sizes, false);
+
+  report("heap ", run(sizes, false));
+  report("arena", run(sizes, true));
+}
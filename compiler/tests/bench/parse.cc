@@ -0,0 +1,114 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+// Measures parser throughput (in lines/sec) with ANTLR's default full-LL
+// prediction versus SLL prediction that falls back to LL on failure.
+//
+// The prediction DFA is shared by every parser in the process, so the first
+// parse of a file (the "cold" one) is much slower than any after it. Each mode
+// should be run in its own process to get a fair cold number.
+//
+// usage: gallium_bench_parse <file.gal> [ll|sll] [runs]
+
+#include "antlr4-runtime.h"
+#include "generated/GalliumLexer.h"
+#include "generated/GalliumParser.h"
+#include "src/syntax/parse_errors.h"
+#include "src/syntax/source_stream.h"
+#include "src/utility/source_manager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  double parse_once(gal::FileID file, bool sll) noexcept {
+    auto source_code = gal::sources().contents(file);
+    auto start = Clock::now();
+    auto offsets = gal::OffsetMap{source_code};
+    auto input = gal::SourceStream{source_code, &offsets, gal::sources().path(file).string()};
+    auto lex = GalliumLexer(&input);
+    auto tokens = antlr4::CommonTokenStream(&lex);
+    auto parser = GalliumParser(&tokens);
+
+    lex.removeErrorListeners();
+    parser.removeErrorListeners();
+
+    if (sll) {
+      parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+      parser.getInterpreter<antlr4::atn::ParserATNSimulator>()->setPredictionMode(
+          antlr4::atn::PredictionMode::SLL);
+
+      try {
+        (void)parser.parse();
+      } catch (antlr4::ParseCancellationException&) {
+        parser.reset();
+        parser.setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
+        parser.getInterpreter<antlr4::atn::ParserATNSimulator>()->setPredictionMode(
+            antlr4::atn::PredictionMode::LL);
+        (void)parser.parse();
+      }
+    } else {
+      (void)parser.parse();
+    }
+
+    if (parser.getNumberOfSyntaxErrors() != 0) {
+      std::cerr << "file has syntax errors\n";
+      std::exit(1);
+    }
+
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "usage: gallium_bench_parse <file.gal> [ll|sll] [runs]\n";
+
+    return 1;
+  }
+
+  auto sll = argc <= 2 || std::string_view{argv[2]} != "ll";
+  auto runs = (argc > 3) ? std::atoi(argv[3]) : 10;
+  auto loaded = gal::sources().load(argv[1]);
+
+  if (auto* error = std::get_if<std::error_code>(&loaded)) {
+    std::cerr << "unable to read file `" << argv[1] << "`: " << error->message() << '\n';
+
+    return 1;
+  }
+
+  auto file = std::get<gal::FileID>(loaded);
+  auto text = gal::sources().contents(file);
+  auto lines = static_cast<double>(std::count(text.begin(), text.end(), '\n') + 1);
+  auto cold = parse_once(file, sll);
+  auto warm = std::vector<double>{};
+
+  for (auto i = 0; i < runs; ++i) {
+    warm.push_back(parse_once(file, sll));
+  }
+
+  std::sort(warm.begin(), warm.end());
+
+  auto median = warm.empty() ? cold : warm[warm.size() / 2];
+
+  std::cout << (sll ? "SLL, LL fallback" : "LL only") << ": " << static_cast<std::uint64_t>(lines) << " lines\n"
+            << "  cold: " << cold * 1000 << "ms, " << static_cast<std::uint64_t>(lines / cold) << " lines/sec\n"
+            << "  warm: " << median * 1000 << "ms, " << static_cast<std::uint64_t>(lines / median)
+            << " lines/sec (median of " << warm.size() << ")\n";
+}
@@ -0,0 +1,77 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+
+#include "./test_utils.h"
+#include "src/utility/arena.h"
+#include <cstdint>
+#include <memory>
+#include <gtest/gtest.h>
+
+namespace ast = gal::ast;
+using namespace tests;
+
+TEST(arena, Alignment) {
+  auto arena = gal::Arena{64};
+
+  for (auto align : {1, 2, 4, 8, 16, 1, 16}) {
+    auto* ptr = arena.allocate(3, align);
+
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % align, 0);
+  }
+}
+
+TEST(arena, LargeAllocations) {
+  auto arena = gal::Arena{64};
+  auto* small = static_cast<char*>(arena.allocate(8, 8));
+  auto* big = static_cast<char*>(arena.allocate(4096, 8));
+  auto* after = static_cast<char*>(arena.allocate(8, 8));
+
+  // the big allocation gets its own chunk, the small ones keep sharing the first
+  EXPECT_EQ(after, small + 8);
+  EXPECT_NE(big, nullptr);
+  EXPECT_EQ(arena.bytes_reserved(), 64 + 4096);
+}
+
+TEST(arena, NodesGoIntoActiveArena) {
+  auto arena = gal::Arena{};
+
+  {
+    auto scope = gal::ArenaScope{&arena};
+    auto fn = make_fn(make_proto("f"));
+
+    EXPECT_NE(arena.bytes_reserved(), 0);
+  }
+
+  auto before = arena.bytes_reserved();
+  auto heap = make_fn(make_proto("g"));
+
+  EXPECT_EQ(arena.bytes_reserved(), before);
+  EXPECT_EQ(gal::Arena::current(), nullptr);
+}
+
+TEST(arena, Adopt) {
+  auto arena = gal::Arena{64};
+  auto other = std::make_unique<gal::Arena>(64);
+  auto* mine = static_cast<char*>(arena.allocate(8, 8));
+  auto* theirs = static_cast<char*>(other->allocate(8, 8));
+
+  theirs[0] = 'x';
+  arena.adopt(other.get());
+
+  EXPECT_EQ(arena.bytes_reserved(), 128);
+  EXPECT_EQ(other->bytes_reserved(), 0);
+
+  // the adopted memory outlives the arena it came from
+  other.reset();
+
+  EXPECT_EQ(theirs[0], 'x');
+  EXPECT_EQ(static_cast<char*>(arena.allocate(8, 8)), mine + 8);
+}
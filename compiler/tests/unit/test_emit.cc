@@ -0,0 +1,104 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "src/core/emit.h"
+#include "src/core/session.h"
+#include "absl/strings/str_cat.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <variant>
+
+namespace {
+  // every function has an overflow check, so every one of them uses the module's panic site table
+  std::unique_ptr<llvm::Module> checked_module(llvm::LLVMContext* context, int functions = 8) {
+    auto source = std::string{};
+
+    for (auto i = 0; i < functions; ++i) {
+      absl::StrAppend(&source, "fn add", i, "(x: i32, y: i32) -> i32 {\n    x + y + ", i, "\n}\n\n");
+    }
+
+    auto options = gal::SessionOptions{};
+    options.emit = gal::OutputFormat::llvm_ir;
+
+    auto created = gal::CompilerSession::create(std::move(options));
+    auto result = std::get<std::unique_ptr<gal::CompilerSession>>(created)->compile(source);
+    auto error = llvm::SMDiagnostic{};
+
+    EXPECT_TRUE(result.succeeded);
+
+    return llvm::parseAssemblyString(result.output, error, *context);
+  }
+
+  // the `addN` functions, not any of the runtime functions that codegen adds
+  std::size_t checked_functions(const llvm::Module& module) {
+    return static_cast<std::size_t>(std::count_if(module.begin(), module.end(), [](auto& fn) {
+      return !fn.isDeclaration() && fn.getName().contains("add");
+    }));
+  }
+} // namespace
+
+TEST(emit, SplitsModulesWithChecks) {
+  auto context = llvm::LLVMContext{};
+  auto module = checked_module(&context);
+
+  ASSERT_NE(module, nullptr);
+  ASSERT_NE(module->getGlobalVariable("__gallium_panic_sites", true), nullptr);
+
+  auto parts = gal::split_module(module.get(), 4);
+  auto with_checks = std::size_t{0};
+
+  ASSERT_EQ(parts.size(), 4);
+
+  for (auto& bitcode : parts) {
+    auto part = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode, "<part>"), context);
+
+    ASSERT_TRUE(static_cast<bool>(part));
+
+    with_checks += (checked_functions(**part) != 0) ? 1 : 0;
+
+    // anything shared between parts is exported, but not under a name that other modules use too
+    EXPECT_EQ((*part)->getNamedValue("__gallium_panic_sites"), nullptr);
+  }
+
+  EXPECT_GT(with_checks, 1);
+}
+
+TEST(emit, PromotedNamesDependOnModule) {
+  auto context = llvm::LLVMContext{};
+  auto first = checked_module(&context, 8);
+  auto second = checked_module(&context, 9);
+
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+
+  gal::split_module(first.get(), 2);
+  gal::split_module(second.get(), 2);
+
+  auto name_in = [](const llvm::Module& module) {
+    for (auto& global : module.globals()) {
+      if (global.getName().startswith("__gallium_panic_sites.llvm.")) {
+        return global.getName().str();
+      }
+    }
+
+    return std::string{};
+  };
+
+  EXPECT_NE(name_in(*first), "");
+  EXPECT_NE(name_in(*first), name_in(*second));
+}
@@ -157,6 +157,18 @@ TEST(mangle_symbols, NestedStaticArray) {
   EXPECT_EQ(gal::demangle(mangled), "fn ::k([[[dyn ::core::traits::Fn; 3]; 6]; 12]) -> void");
 }
 
+TEST(mangle_symbols, VectorTypes) {
+  auto fn = make_fn(make_proto("dot",
+      gal::into_list(make_arg(vector_of(8, float_of(ast::FloatWidth::ieee_single))),
+          make_arg(slice_of(false, vector_of(4, integer(true, 32))))),
+      vector_of(16, bool_type())));
+  fn->set_id(ast::FullyQualifiedID{"::", "dot"});
+
+  auto mangled = gal::mangle(*fn);
+  EXPECT_EQ(mangled, "_GF3dotNVp8_BVl4_EVb16_");
+  EXPECT_EQ(gal::demangle(mangled), "fn ::dot(f32x8, [i32x4]) -> boolx16");
+}
+
 TEST(mangle_symbols, EveryBuiltinType) {
   auto fn = make_fn(make_proto("abcdefghijklmnopqr",
       gal::into_list(make_arg(byte()),
@@ -253,4 +265,36 @@ TEST(mangle_symbols, ConstantWeird) {
   auto mangled = gal::mangle(*c);
   EXPECT_EQ(mangled, "_GC5weirdFNiEQFNaER9__builtinD10__Integral");
   EXPECT_EQ(gal::demangle(mangled), "const ::weird: fn(usize) -> *mut fn(byte) -> &dyn ::__builtin::__Integral");
-}
\ No newline at end of file
+}
+namespace {
+  // an `fn main() -> i32` inside of `module`, wrapped up in a program
+  std::pair<ast::Program, ast::FnDeclaration*> program_with_main(std::string_view module, bool entry) {
+    auto fn = make_fn(make_proto("main", {}, integer(true, 32)));
+    auto* main = fn.get();
+    main->set_id(ast::FullyQualifiedID{module, "main"});
+
+    auto decls = std::vector<std::unique_ptr<ast::Declaration>>{};
+    decls.push_back(std::move(fn));
+
+    auto program = ast::Program(std::move(decls));
+    program.set_module(std::string{module});
+    program.set_entry(entry);
+
+    return {std::move(program), main};
+  }
+} // namespace
+
+TEST(mangle_symbols, EntryProgramMain) {
+  auto [program, main] = program_with_main("::app::", true);
+
+  gal::mangle_program(&program);
+  EXPECT_EQ(main->mangled_name(), "__gallium_user_main");
+}
+
+TEST(mangle_symbols, LibraryMain) {
+  auto [program, main] = program_with_main("::lib::", false);
+
+  gal::mangle_program(&program);
+  EXPECT_EQ(main->mangled_name(), "_G3libF4mainNEl");
+  EXPECT_EQ(gal::demangle(main->mangled_name()), "fn ::lib::main() -> i32");
+}
@@ -0,0 +1,278 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "src/core/module_interface.h"
+#include "src/core/emit.h"
+#include "src/core/mangler.h"
+#include "src/core/type_checker.h"
+#include "src/errors/buffered_reporter.h"
+#include "src/syntax/parser.h"
+#include "src/utility/arena.h"
+#include "src/utility/source_manager.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+TEST(module_interface, ModuleFromRelativePath) {
+  EXPECT_EQ(gal::module_for("main.gal"), "::main::");
+  EXPECT_EQ(gal::module_for("foo/bar.gal"), "::foo::bar::");
+  EXPECT_EQ(gal::module_for("./foo/../baz/qux.gal"), "::baz::qux::");
+}
+
+TEST(module_interface, ModuleFromOutsidePath) {
+  EXPECT_EQ(gal::module_for("../elsewhere/thing.gal"), "::thing::");
+}
+
+namespace {
+  struct Checked {
+    std::optional<gal::ast::Program> program;
+    std::vector<std::string> diagnostics;
+    bool valid = false;
+  };
+
+  // compiles modules against a fresh module directory, the same way the driver does for each file
+  class Modules : public testing::Test {
+  protected:
+    void SetUp() override {
+      dir_ = fs::temp_directory_path() / testing::UnitTest::GetInstance()->current_test_info()->name();
+      fs::remove_all(dir_);
+      fs::create_directories(dir_);
+
+      config_ = std::make_unique<gal::CompilerConfig>("",
+          1,
+          gal::OptLevel::none,
+          gal::OutputFormat::llvm_ir,
+          gal::ParserKind::antlr,
+          gal::LTOKind::none,
+          gal::PanicMode::report,
+          false,
+          false,
+          false,
+          false,
+          false,
+          false,
+          false,
+          false,
+          false,
+          false,
+          false,
+          "",
+          dir_.string(),
+          "",
+          "",
+          "");
+      scope_ = std::make_unique<gal::ConfigScope>(config_.get());
+
+      gal::initialize_targets();
+
+      auto triple = llvm::sys::getDefaultTargetTriple();
+      auto err = std::string{};
+      auto* target = llvm::TargetRegistry::lookupTarget(triple, err);
+
+      ASSERT_NE(target, nullptr) << err;
+      machine_.reset(target->createTargetMachine(triple, "generic", "", llvm::TargetOptions{}, {}));
+    }
+
+    void TearDown() override {
+      scope_.reset();
+      fs::remove_all(dir_);
+    }
+
+    Checked check(std::string_view module, std::string_view source) noexcept {
+      auto file = gal::sources().add(std::string{module}, std::string{source});
+      auto reporter = gal::BufferedReporter{gal::sources().contents(file)};
+      auto result = Checked{};
+
+      result.program = gal::parse(file, &reporter, gal::ParserKind::antlr);
+
+      if (result.program) {
+        auto scope = gal::ArenaScope{result.program->arena()};
+
+        result.program->set_module(std::string{module});
+        result.valid = gal::type_check(&*result.program, *machine_, &reporter) && !reporter.had_error();
+
+        if (result.valid) {
+          gal::mangle_program(&*result.program);
+        }
+      }
+
+      for (auto& diagnostic : reporter.diagnostics()) {
+        result.diagnostics.push_back(diagnostic.build(reporter.source()));
+      }
+
+      gal::sources().release(file);
+
+      return result;
+    }
+
+    // compiles a module and writes out its interface, so that later modules can import it
+    void library(std::string_view module, std::string_view source) noexcept {
+      auto checked = check(module, source);
+
+      ASSERT_TRUE(checked.valid);
+      ASSERT_TRUE(gal::write_interface(*checked.program));
+    }
+
+    fs::path dir_;
+    std::unique_ptr<gal::CompilerConfig> config_;
+    std::unique_ptr<gal::ConfigScope> scope_;
+    std::unique_ptr<llvm::TargetMachine> machine_;
+  };
+
+  constexpr auto math = "export fn add(a: i32, b: i32) -> i32 {\n    a + b\n}\n\n"
+                        "export const ANSWER: i32 = 42\n\n"
+                        "fn hidden() -> i32 {\n    0\n}\n";
+
+  bool mentions(const std::vector<std::string>& diagnostics, std::string_view text) noexcept {
+    return std::any_of(diagnostics.begin(), diagnostics.end(), [text](auto& diagnostic) {
+      return diagnostic.find(text) != std::string::npos;
+    });
+  }
+} // namespace
+
+TEST_F(Modules, InterfaceRoundTrip) {
+  auto checked = check("::math::", math);
+
+  ASSERT_TRUE(checked.valid);
+  ASSERT_TRUE(gal::write_interface(*checked.program));
+  EXPECT_TRUE(fs::exists(gal::interface_path("::math::")));
+
+  auto importer = gal::ast::Program(std::vector<std::unique_ptr<gal::ast::Declaration>>{});
+  importer.set_module("::main::");
+
+  auto loaded = gal::load_interface(&importer, "::math::");
+
+  ASSERT_TRUE(std::holds_alternative<gal::ast::Program*>(loaded));
+
+  auto* module = std::get<gal::ast::Program*>(loaded);
+  auto names = std::vector<std::string>{};
+
+  EXPECT_EQ(module->module_string(), "::math::");
+
+  for (auto& decl : module->decls()) {
+    if (decl->is(gal::ast::DeclType::external_fn_decl)) {
+      auto& fn = gal::as<gal::ast::ExternalFnDeclaration>(*decl);
+
+      names.emplace_back(fn.proto().name());
+      EXPECT_EQ(fn.mangled_name(), gal::as<gal::ast::FnDeclaration>(*checked.program->decls()[0]).mangled_name());
+      EXPECT_EQ(fn.proto().args().size(), 2);
+    } else if (decl->is(gal::ast::DeclType::constant_decl)) {
+      names.emplace_back(gal::as<gal::ast::ConstantDeclaration>(*decl).name());
+    }
+  }
+
+  // `hidden` isn't exported, so it isn't part of the interface at all
+  EXPECT_EQ(names, (std::vector<std::string>{"add", "ANSWER"}));
+
+  // loading a module that's already imported gives back the same one
+  auto again = gal::load_interface(&importer, "::math::");
+
+  ASSERT_TRUE(std::holds_alternative<gal::ast::Program*>(again));
+  EXPECT_EQ(std::get<gal::ast::Program*>(again), module);
+  EXPECT_EQ(importer.imports().size(), 1);
+}
+
+TEST_F(Modules, ResolvesImportedModule) {
+  library("::math::", math);
+
+  auto checked = check("::main::", "import math\n\nfn main() -> i32 {\n    math::add(math::ANSWER, 1)\n}\n");
+
+  EXPECT_TRUE(checked.valid);
+  EXPECT_TRUE(checked.diagnostics.empty());
+}
+
+TEST_F(Modules, ResolvesAlias) {
+  library("::math::", math);
+
+  auto checked = check("::main::", "import math as m\n\nfn main() -> i32 {\n    m::add(m::ANSWER, 1)\n}\n");
+
+  EXPECT_TRUE(checked.valid);
+  EXPECT_TRUE(checked.diagnostics.empty());
+}
+
+TEST_F(Modules, ResolvesImportedNames) {
+  library("::math::", math);
+
+  auto checked = check("::main::", "import {add, ANSWER} from math\n\nfn main() -> i32 {\n    add(ANSWER, 1)\n}\n");
+
+  EXPECT_TRUE(checked.valid);
+  EXPECT_TRUE(checked.diagnostics.empty());
+}
+
+TEST_F(Modules, MissingModule) {
+  auto checked = check("::main::", "import math\n\nfn main() -> i32 {\n    0\n}\n");
+
+  EXPECT_FALSE(checked.valid);
+  EXPECT_TRUE(mentions(checked.diagnostics, "[E#0058]"));
+}
+
+TEST_F(Modules, UnreadableInterface) {
+  library("::math::", math);
+
+  // chopping the end off leaves a valid header with a body that doesn't match it
+  auto path = gal::interface_path("::math::");
+  fs::resize_file(path, fs::file_size(path) - 1);
+
+  auto checked = check("::main::", "import math\n\nfn main() -> i32 {\n    0\n}\n");
+
+  EXPECT_FALSE(checked.valid);
+  EXPECT_TRUE(mentions(checked.diagnostics, "[E#0059]"));
+}
+
+TEST_F(Modules, InterfaceTruncatedInsideType) {
+  library("::refs::", "export fn get(value: &i32) -> i32 {\n    *value\n}\n");
+
+  auto path = gal::interface_path("::refs::");
+  auto contents = std::string{};
+
+  {
+    auto in = std::ifstream(path, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+  }
+
+  // the argument's name is followed by its type, cut it off right after the `&` tag. every byte
+  // past the end reads as 0, which is that same tag again
+  auto name = std::string{"\x05\0\0\0value", 9};
+  auto pos = contents.find(name);
+
+  ASSERT_NE(pos, std::string::npos);
+  ASSERT_EQ(contents[pos + name.size()], static_cast<char>(gal::ast::TypeType::reference));
+
+  {
+    auto out = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), static_cast<std::streamsize>(pos + name.size() + 1));
+  }
+
+  auto checked = check("::main::", "import refs\n\nfn main() -> i32 {\n    0\n}\n");
+
+  EXPECT_FALSE(checked.valid);
+  EXPECT_TRUE(mentions(checked.diagnostics, "[E#0059]"));
+}
+
+TEST_F(Modules, ImportsUnexportedName) {
+  library("::math::", math);
+
+  auto checked = check("::main::", "import {hidden} from math\n\nfn main() -> i32 {\n    0\n}\n");
+
+  EXPECT_FALSE(checked.valid);
+  EXPECT_TRUE(mentions(checked.diagnostics, "[E#0060]"));
+}
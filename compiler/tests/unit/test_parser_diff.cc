@@ -0,0 +1,130 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "src/ast/program.h"
+#include "src/errors/buffered_reporter.h"
+#include "src/errors/console_reporter.h"
+#include "src/syntax/parser.h"
+#include "src/utility/flags.h"
+#include "src/utility/pretty.h"
+#include "src/utility/source_manager.h"
+#include "absl/strings/str_cat.h"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <variant>
+
+namespace {
+  std::optional<gal::ast::Program> parse_with(gal::FileID file, gal::ParserKind kind) noexcept {
+    auto reporter = gal::ConsoleReporter(&std::cerr, gal::sources().contents(file));
+
+    return gal::parse(file, &reporter, kind);
+  }
+
+  // big enough that a parallel parse splits it into several chunks. every `apply` has a line that
+  // starts with `fn` inside its parameter list, the file must never be split there
+  std::string many_declarations() noexcept {
+    auto source = std::string{};
+
+    for (auto i = 0; i < 400; ++i) {
+      absl::StrAppend(&source,
+          "fn apply", i, "(callback:\nfn(i64) -> i64, value: i64) -> i64 {\n    callback(value)\n}\n\n",
+          "struct Pair", i, " {\n    first: i64\n    second: i64\n}\n\n",
+          "fn sum", i, "(values: [i64]) -> i64 {\n    mut total = 0\n\n",
+          "    for i := 0 to values.size {\n        total += values[i]\n    }\n\n    total\n}\n\n");
+    }
+
+    return source;
+  }
+} // namespace
+
+// the ANTLR parser is the reference, the hand-written one needs to produce
+// exactly the same tree (down to source locations) for every file we have
+TEST(parser, FastMatchesAntlr) {
+  auto files = 0;
+
+  for (auto& entry : std::filesystem::recursive_directory_iterator(GALLIUM_TESTS_DIR)) {
+    if (!entry.is_regular_file() || entry.path().extension() != ".gal") {
+      continue;
+    }
+
+    SCOPED_TRACE(entry.path().string());
+
+    auto loaded = gal::sources().load(entry.path());
+    ASSERT_TRUE(std::holds_alternative<gal::FileID>(loaded));
+
+    auto file = std::get<gal::FileID>(loaded);
+    auto reference = parse_with(file, gal::ParserKind::antlr);
+    auto fast = parse_with(file, gal::ParserKind::fast);
+
+    ++files;
+
+    ASSERT_EQ(reference.has_value(), fast.has_value());
+
+    if (!reference) {
+      continue;
+    }
+
+    EXPECT_EQ(gal::pretty_print(*reference), gal::pretty_print(*fast));
+    ASSERT_EQ(reference->decls().size(), fast->decls().size());
+
+    for (auto i = std::size_t{0}; i < reference->decls().size(); ++i) {
+      auto ref_loc = reference->decls()[i]->loc();
+      auto fast_loc = fast->decls()[i]->loc();
+
+      EXPECT_EQ(ref_loc.offset(), fast_loc.offset());
+      EXPECT_EQ(ref_loc.length(), fast_loc.length());
+    }
+  }
+
+  EXPECT_GT(files, 0);
+}
+
+TEST(parser, ParallelMatchesSerial) {
+  auto file = gal::sources().add("parallel.gal", many_declarations());
+  auto serial_errors = gal::BufferedReporter(gal::sources().contents(file));
+  auto parallel_errors = gal::BufferedReporter(gal::sources().contents(file));
+  auto serial = gal::parse(file, &serial_errors, gal::ParserKind::antlr, 1);
+  auto parallel = gal::parse(file, &parallel_errors, gal::ParserKind::antlr, 4);
+
+  ASSERT_TRUE(serial.has_value());
+  ASSERT_TRUE(parallel.has_value());
+  EXPECT_TRUE(parallel_errors.diagnostics().empty());
+  EXPECT_EQ(gal::pretty_print(*serial), gal::pretty_print(*parallel));
+  ASSERT_EQ(serial->decls().size(), parallel->decls().size());
+
+  for (auto i = std::size_t{0}; i < serial->decls().size(); ++i) {
+    EXPECT_EQ(serial->decls()[i]->loc().offset(), parallel->decls()[i]->loc().offset());
+    EXPECT_EQ(serial->decls()[i]->loc().length(), parallel->decls()[i]->loc().length());
+  }
+}
+
+// a syntax error in any chunk throws away every chunk and parses the file again in one piece,
+// the errors are the ones a serial parse gives and they're only reported once
+TEST(parser, ParallelFallsBackOnSyntaxError) {
+  auto file = gal::sources().add("broken.gal", absl::StrCat(many_declarations(), "fn broken( -> i64 {\n    0\n}\n"));
+  auto serial_errors = gal::BufferedReporter(gal::sources().contents(file));
+  auto parallel_errors = gal::BufferedReporter(gal::sources().contents(file));
+  auto serial = gal::parse(file, &serial_errors, gal::ParserKind::antlr, 1);
+  auto parallel = gal::parse(file, &parallel_errors, gal::ParserKind::antlr, 4);
+
+  EXPECT_FALSE(serial.has_value());
+  EXPECT_FALSE(parallel.has_value());
+  ASSERT_FALSE(serial_errors.diagnostics().empty());
+  ASSERT_EQ(serial_errors.diagnostics().size(), parallel_errors.diagnostics().size());
+
+  auto source = gal::sources().contents(file);
+
+  for (auto i = std::size_t{0}; i < serial_errors.diagnostics().size(); ++i) {
+    EXPECT_EQ(serial_errors.diagnostics()[i].build(source), parallel_errors.diagnostics()[i].build(source));
+  }
+}
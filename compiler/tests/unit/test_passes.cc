@@ -0,0 +1,326 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "src/core/backend/passes.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/SourceMgr.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace {
+  // `sum` walks a slice with the check codegen emits for `data[i]`. the body of the loop
+  // is pasted in, so each test only has to say what's different about its loop
+  std::string loop_over(std::string_view index, std::string_view bound) {
+    auto ir = std::string{R"(
+      declare void @panic() cold noreturn
+
+      define i64 @sum({i64*, i64} %slice, i64 %other) {
+      entry:
+        %data = extractvalue {i64*, i64} %slice, 0
+        %size = extractvalue {i64*, i64} %slice, 1
+        %empty = icmp eq i64 %size, 0
+        br i1 %empty, label %exit, label %loop
+
+      loop:
+        %i = phi i64 [0, %entry], [%next, %continue]
+        %total = phi i64 [0, %entry], [%added, %continue]
+        %oob = icmp uge i64 INDEX, BOUND
+        br i1 %oob, label %panic, label %continue
+
+      continue:
+        %ptr = getelementptr inbounds i64, i64* %data, i64 INDEX
+        %value = load i64, i64* %ptr
+        %added = add i64 %total, %value
+        %next = add i64 %i, 1
+        %done = icmp eq i64 %next, %size
+        br i1 %done, label %exit, label %loop
+
+      panic:
+        call void @panic()
+        unreachable
+
+      exit:
+        %result = phi i64 [0, %entry], [%added, %continue]
+        ret i64 %result
+      })"};
+
+    for (auto [from, to] : {std::pair{std::string_view{"INDEX"}, index}, std::pair{std::string_view{"BOUND"}, bound}}) {
+      for (auto pos = ir.find(from); pos != std::string::npos; pos = ir.find(from)) {
+        ir.replace(pos, from.size(), to);
+      }
+    }
+
+    return ir;
+  }
+
+  // parses `ir` and runs a textual pipeline over it, Gallium's passes included
+  std::unique_ptr<llvm::Module> run_passes(llvm::LLVMContext* context,
+      const std::string& ir,
+      std::string_view pipeline) {
+    auto error = llvm::SMDiagnostic{};
+    auto module = llvm::parseAssemblyString(ir, error, *context);
+
+    EXPECT_NE(module, nullptr) << error.getMessage().str();
+    EXPECT_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    auto loops = llvm::LoopAnalysisManager{};
+    auto functions = llvm::FunctionAnalysisManager{};
+    auto sccs = llvm::CGSCCAnalysisManager{};
+    auto modules = llvm::ModuleAnalysisManager{};
+    auto builder = llvm::PassBuilder{};
+    auto manager = llvm::ModulePassManager{};
+
+    gal::backend::register_passes(&builder);
+    builder.registerModuleAnalyses(modules);
+    builder.registerCGSCCAnalyses(sccs);
+    builder.registerFunctionAnalyses(functions);
+    builder.registerLoopAnalyses(loops);
+    builder.crossRegisterProxies(loops, functions, sccs, modules);
+    llvm::cantFail(builder.parsePassPipeline(manager, llvm::StringRef{pipeline.data(), pipeline.size()}));
+    manager.run(*module, modules);
+
+    EXPECT_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    return module;
+  }
+
+  // runs `gallium-eliminate-checks` over `ir`, and gets whether the check in `checked` is still there
+  bool check_survives(const std::string& ir, std::string_view checked = "loop") {
+    auto context = llvm::LLVMContext{};
+    auto module = run_passes(&context, ir, "function(loop(gallium-eliminate-checks))");
+
+    for (auto& block : *module->getFunction("sum")) {
+      if (block.getName() == llvm::StringRef{checked.data(), checked.size()}) {
+        return !llvm::isa<llvm::Constant>(llvm::cast<llvm::BranchInst>(block.getTerminator())->getCondition());
+      }
+    }
+
+    ADD_FAILURE() << "no `" << checked << "` block";
+
+    return true;
+  }
+} // namespace
+
+TEST(passes, EliminatesCheckOnInductionVariable) {
+  EXPECT_FALSE(check_survives(loop_over("%i", "%size")));
+}
+
+TEST(passes, EliminatesCheckAgainstSameSliceSize) {
+  // a second extract of the size is the same size, even though it's a different value
+  auto ir = loop_over("%i", "%size2");
+  auto pos = ir.find("%oob");
+
+  ir.insert(pos, "%size2 = extractvalue {i64*, i64} %slice, 1\n");
+
+  EXPECT_FALSE(check_survives(ir));
+}
+
+TEST(passes, EliminatesConstantCheck) {
+  EXPECT_FALSE(check_survives(loop_over("0", "2")));
+}
+
+TEST(passes, KeepsCheckAgainstOtherBound) {
+  EXPECT_TRUE(check_survives(loop_over("%i", "%other")));
+}
+
+TEST(passes, KeepsCheckOnOffsetIndex) {
+  auto ir = loop_over("%ahead", "%size");
+  auto pos = ir.find("%oob");
+
+  ir.insert(pos, "%ahead = add i64 %i, 1\n");
+
+  EXPECT_TRUE(check_survives(ir));
+}
+
+TEST(passes, KeepsCheckOnEmptySlice) {
+  // without the `size == 0` guard the first iteration would index into an empty slice
+  auto ir = loop_over("%i", "%size");
+  auto pos = ir.find("br i1 %empty");
+
+  ir.replace(pos, std::string_view{"br i1 %empty"}.size(), "br i1 false");
+
+  EXPECT_TRUE(check_survives(ir));
+}
+
+TEST(passes, KeepsFailingConstantCheck) {
+  EXPECT_TRUE(check_survives(loop_over("2", "2")));
+}
+
+TEST(passes, KeepsCheckWhenWalkStartsAtBound) {
+  // `loop { if i != data.size { data[i] } if i + 1 == data.size { break } i = i + 1 }`. the latch
+  // only knows `i + 1 != size`, so with an empty slice `i` starts at `size` and walks straight past it
+  constexpr auto ir = R"(
+    declare void @panic() cold noreturn
+
+    define i64 @sum({i64*, i64} %slice, i64 %other) {
+    entry:
+      %data = extractvalue {i64*, i64} %slice, 0
+      %size = extractvalue {i64*, i64} %slice, 1
+      br label %loop
+
+    loop:
+      %i = phi i64 [0, %entry], [%next, %tail]
+      %total = phi i64 [0, %entry], [%kept, %tail]
+      %at_end = icmp eq i64 %i, %size
+      br i1 %at_end, label %tail, label %guarded
+
+    guarded:
+      %oob = icmp uge i64 %i, %size
+      br i1 %oob, label %panic, label %read
+
+    read:
+      %ptr = getelementptr inbounds i64, i64* %data, i64 %i
+      %value = load i64, i64* %ptr
+      %added = add i64 %total, %value
+      br label %tail
+
+    tail:
+      %kept = phi i64 [%total, %loop], [%added, %read]
+      %next = add i64 %i, 1
+      %done = icmp eq i64 %next, %size
+      br i1 %done, label %exit, label %loop
+
+    panic:
+      call void @panic()
+      unreachable
+
+    exit:
+      ret i64 %kept
+    })";
+
+  EXPECT_TRUE(check_survives(ir, "guarded"));
+}
+
+namespace {
+  // `(a * b) + c`, and `d + e` on the side. each checked op is lowered the way codegen does it
+  constexpr auto arithmetic = R"(
+    declare void @panic(i32) cold noreturn
+    declare {i32, i1} @llvm.smul.with.overflow.i32(i32, i32)
+    declare {i32, i1} @llvm.sadd.with.overflow.i32(i32, i32)
+
+    define i32 @arith(i32 %a, i32 %b, i32 %c, i32 %d, i32 %e, i32* %out) {
+    entry:
+      %mul = call {i32, i1} @llvm.smul.with.overflow.i32(i32 %a, i32 %b)
+      %mul.value = extractvalue {i32, i1} %mul, 0
+      %mul.overflow = extractvalue {i32, i1} %mul, 1
+      br i1 %mul.overflow, label %panic, label %first
+
+    first:
+      %add = call {i32, i1} @llvm.sadd.with.overflow.i32(i32 %mul.value, i32 %c)
+      %add.value = extractvalue {i32, i1} %add, 0
+      %add.overflow = extractvalue {i32, i1} %add, 1
+      br i1 %add.overflow, label %panic, label %second
+
+    second:
+      STORE
+      %other = call {i32, i1} @llvm.sadd.with.overflow.i32(i32 %d, i32 %e)
+      %other.value = extractvalue {i32, i1} %other, 0
+      %other.overflow = extractvalue {i32, i1} %other, 1
+      br i1 %other.overflow, label %panic, label %done
+
+    done:
+      %result = add i32 %add.value, %other.value
+      ret i32 %result
+
+    panic:
+      %site = phi i32 [0, %entry], [1, %first], [2, %second]
+      call void @panic(i32 %site)
+      unreachable
+    })";
+
+  std::string arithmetic_with(std::string_view store) {
+    auto ir = std::string{arithmetic};
+    auto pos = ir.find("STORE");
+
+    ir.replace(pos, std::string_view{"STORE"}.size(), store);
+
+    return ir;
+  }
+
+  struct Shape {
+    int overflow_calls = 0;
+    int checks = 0;
+  };
+
+  Shape shape_of(const llvm::Function& fn) {
+    auto shape = Shape{};
+
+    for (auto& block : fn) {
+      for (auto& inst : block) {
+        if (auto* call = llvm::dyn_cast<llvm::IntrinsicInst>(&inst)) {
+          shape.overflow_calls += call->getType()->isStructTy();
+        }
+
+        if (auto* branch = llvm::dyn_cast<llvm::BranchInst>(&inst); branch != nullptr && branch->isConditional()) {
+          ++shape.checks;
+        }
+      }
+    }
+
+    return shape;
+  }
+} // namespace
+
+TEST(passes, WidensArithmeticAndCoalescesChecks) {
+  auto context = llvm::LLVMContext{};
+  auto module = run_passes(&context, arithmetic_with(""), "function(gallium-coalesce-checks)");
+  auto shape = shape_of(*module->getFunction("arith"));
+
+  // `a * b + c` is done in i64, leaving `d + e` as the only intrinsic. all three checks end up as one branch
+  EXPECT_EQ(shape.overflow_calls, 1);
+  EXPECT_EQ(shape.checks, 1);
+}
+
+TEST(passes, KeepsChecksApartAroundSideEffects) {
+  auto context = llvm::LLVMContext{};
+  auto ir = arithmetic_with("store i32 %add.value, i32* %out");
+  auto module = run_passes(&context, ir, "function(gallium-coalesce-checks)");
+  auto shape = shape_of(*module->getFunction("arith"));
+
+  // the store can't happen if `a * b + c` overflowed, so that check has to stay in front of it
+  EXPECT_EQ(shape.overflow_calls, 1);
+  EXPECT_EQ(shape.checks, 2);
+}
+
+TEST(passes, KeepsIntermediateOverflow) {
+  // `65536 * 32768 + -1` fits in an i32, but `65536 * 32768` doesn't. that still has to panic at the
+  // multiply's site, exactly like it does without optimizations
+  auto ir = arithmetic_with("") + R"(
+    define i32 @call() {
+      %result = call i32 @arith(i32 65536, i32 32768, i32 -1, i32 0, i32 0, i32* null)
+      ret i32 %result
+    })";
+  auto context = llvm::LLVMContext{};
+  auto pipeline = "function(gallium-coalesce-checks),cgscc(inline),function(instcombine,simplifycfg)";
+  auto module = run_passes(&context, ir, pipeline);
+  auto* site = static_cast<llvm::Value*>(nullptr);
+
+  for (auto& inst : llvm::instructions(*module->getFunction("call"))) {
+    auto* call = llvm::dyn_cast<llvm::CallInst>(&inst);
+
+    if (call != nullptr && call->getCalledFunction() == module->getFunction("panic")) {
+      site = call->getArgOperand(0);
+    }
+  }
+
+  ASSERT_NE(site, nullptr);
+  ASSERT_TRUE(llvm::isa<llvm::ConstantInt>(site));
+  EXPECT_TRUE(llvm::cast<llvm::ConstantInt>(site)->isZero());
+}
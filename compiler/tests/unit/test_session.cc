@@ -0,0 +1,234 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "src/core/session.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace {
+  constexpr auto valid = "fn main() -> i32 {\n    0\n}\n";
+
+  std::unique_ptr<gal::CompilerSession> session(gal::OutputFormat emit) noexcept {
+    auto options = gal::SessionOptions{};
+    options.emit = emit;
+
+    auto created = gal::CompilerSession::create(std::move(options));
+
+    return std::move(std::get<std::unique_ptr<gal::CompilerSession>>(created));
+  }
+} // namespace
+
+TEST(session, CompilesToIR) {
+  auto result = session(gal::OutputFormat::llvm_ir)->compile(valid);
+
+  EXPECT_TRUE(result.succeeded);
+  EXPECT_TRUE(result.diagnostics.empty());
+  EXPECT_NE(result.output.find("define"), std::string::npos);
+}
+
+TEST(session, ReportsDiagnostics) {
+  auto result = session(gal::OutputFormat::object_code)->compile("fn main() -> i32 {\n    x\n}\n", "bad.gal");
+
+  EXPECT_FALSE(result.succeeded);
+  EXPECT_FALSE(result.diagnostics.empty());
+  EXPECT_TRUE(result.output.empty());
+}
+
+TEST(session, RejectsFileOutputs) {
+  auto options = gal::SessionOptions{};
+  options.emit = gal::OutputFormat::exe;
+
+  EXPECT_TRUE(std::holds_alternative<std::string>(gal::CompilerSession::create(std::move(options))));
+}
+
+TEST(session, IndependentAcrossThreads) {
+  auto reference = session(gal::OutputFormat::llvm_ir)->compile(valid).output;
+  auto outputs = std::vector<std::string>(4);
+  auto threads = std::vector<std::thread>{};
+
+  for (auto& output : outputs) {
+    threads.emplace_back([&output] {
+      auto compiler = session(gal::OutputFormat::llvm_ir);
+
+      for (auto i = 0; i < 16; ++i) {
+        output = compiler->compile(valid).output;
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (auto& output : outputs) {
+    EXPECT_EQ(output, reference);
+  }
+}
+
+TEST(session, ChecksShareOneSiteTable) {
+  constexpr auto checked = "fn add(x: i32, y: i32) -> i32 {\n    x + y\n}\n\n"
+                           "fn sub(x: i32, y: i32) -> i32 {\n    x - y\n}\n";
+  auto result = session(gal::OutputFormat::llvm_ir)->compile(checked);
+
+  EXPECT_TRUE(result.succeeded);
+  EXPECT_NE(result.output.find("@__gallium_panic_sites = internal unnamed_addr constant [2 x"), std::string::npos);
+  EXPECT_NE(result.output.find("overflowed in addition"), std::string::npos);
+  EXPECT_EQ(result.output.find("insertvalue %__GalliumSourceInfo"), std::string::npos);
+}
+
+TEST(session, AbortingChecksHaveNoMessages) {
+  constexpr auto checked = "fn add(x: i32, y: i32) -> i32 {\n    x + y\n}\n";
+  auto options = gal::SessionOptions{};
+  options.emit = gal::OutputFormat::llvm_ir;
+  options.panic = gal::PanicMode::abort;
+
+  auto created = gal::CompilerSession::create(std::move(options));
+  auto result = std::get<std::unique_ptr<gal::CompilerSession>>(created)->compile(checked);
+
+  EXPECT_TRUE(result.succeeded);
+
+  // `__gallium_trap` is always inlined, so the check may end up calling `llvm.trap` directly
+  auto start = result.output.find("@_GF3add");
+
+  ASSERT_NE(start, std::string::npos);
+
+  auto body = result.output.substr(start, result.output.find("\n}\n", start) - start);
+
+  EXPECT_NE(body.find("trap()"), std::string::npos);
+  EXPECT_EQ(result.output.find("__gallium_panic_sites"), std::string::npos);
+  EXPECT_EQ(result.output.find("overflowed in addition"), std::string::npos);
+}
+
+TEST(session, RejectsOverlappingSubslices) {
+  // `dest` is `noalias`, but both slices point into `values`
+  constexpr auto overlapping = "fn copy(dest: [mut i64], source: [i64]) -> void {\n"
+                               "    for i := 0 to source.size {\n"
+                               "        dest[i] := source[i]\n"
+                               "    }\n"
+                               "}\n\n"
+                               "fn main() -> i32 {\n"
+                               "    mut values = [1, 2, 3, 4, 5, 6]\n"
+                               "    copy(values[0..4], values[2..6])\n"
+                               "    0\n"
+                               "}\n";
+  auto result = session(gal::OutputFormat::llvm_ir)->compile(overlapping);
+
+  EXPECT_FALSE(result.succeeded);
+  ASSERT_EQ(result.diagnostics.size(), 1);
+  EXPECT_NE(result.diagnostics.front().find("[E#0063]"), std::string::npos);
+}
+
+TEST(session, RejectsOverlappingElements) {
+  // whether `i` is `0` isn't something the type checker can know
+  constexpr auto overlapping = "fn swap(a: &mut i64, b: &mut i64) -> void {\n"
+                               "    let temp = *a\n"
+                               "    *a := *b\n"
+                               "    *b := temp\n"
+                               "}\n\n"
+                               "fn main() -> i32 {\n"
+                               "    mut values = [1, 2]\n"
+                               "    let i = 0 as isize\n"
+                               "    swap(&mut values[0], &mut values[i])\n"
+                               "    0\n"
+                               "}\n";
+  auto result = session(gal::OutputFormat::llvm_ir)->compile(overlapping);
+
+  EXPECT_FALSE(result.succeeded);
+  ASSERT_EQ(result.diagnostics.size(), 1);
+  EXPECT_NE(result.diagnostics.front().find("[E#0063]"), std::string::npos);
+}
+
+TEST(session, RejectsOverlappingFields) {
+  // distinct fields don't overlap, but the check only looks at which local is borrowed
+  constexpr auto overlapping = "struct Pair {\n"
+                               "    a: i64\n"
+                               "    b: i64\n"
+                               "}\n\n"
+                               "fn swap(a: &mut i64, b: &mut i64) -> void {\n"
+                               "    let temp = *a\n"
+                               "    *a := *b\n"
+                               "    *b := temp\n"
+                               "}\n\n"
+                               "fn main() -> i32 {\n"
+                               "    mut pair = Pair { a: 1, b: 2 }\n"
+                               "    swap(&mut pair.a, &mut pair.b)\n"
+                               "    0\n"
+                               "}\n";
+  auto result = session(gal::OutputFormat::llvm_ir)->compile(overlapping);
+
+  EXPECT_FALSE(result.succeeded);
+  ASSERT_EQ(result.diagnostics.size(), 1);
+  EXPECT_NE(result.diagnostics.front().find("[E#0063]"), std::string::npos);
+}
+
+TEST(session, RejectsPointerIntoExclusiveArgument) {
+  // `b` isn't exclusive itself, but it points into what `a` has exclusive access to
+  constexpr auto overlapping = "fn store(a: &mut i64, b: *mut i64) -> void {\n"
+                               "    *a := 1\n"
+                               "}\n\n"
+                               "fn main() -> i32 {\n"
+                               "    mut x = 0\n"
+                               "    store(&mut x, (&mut x) as *mut i64)\n"
+                               "    0\n"
+                               "}\n";
+  auto result = session(gal::OutputFormat::llvm_ir)->compile(overlapping);
+
+  EXPECT_FALSE(result.succeeded);
+  ASSERT_EQ(result.diagnostics.size(), 1);
+  EXPECT_NE(result.diagnostics.front().find("[E#0063]"), std::string::npos);
+}
+
+TEST(session, RejectsOverlappingThroughFnPointer) {
+  // `swap` is still defined with `noalias` parameters when it's called indirectly
+  constexpr auto overlapping = "fn swap(a: &mut i64, b: &mut i64) -> void {\n"
+                               "    let temp = *a\n"
+                               "    *a := *b\n"
+                               "    *b := temp\n"
+                               "}\n\n"
+                               "fn main() -> i32 {\n"
+                               "    mut x = 1\n"
+                               "    let f = swap\n"
+                               "    f(&mut x, &mut x)\n"
+                               "    0\n"
+                               "}\n";
+  auto result = session(gal::OutputFormat::llvm_ir)->compile(overlapping);
+
+  EXPECT_FALSE(result.succeeded);
+  ASSERT_EQ(result.diagnostics.size(), 1);
+  EXPECT_NE(result.diagnostics.front().find("[E#0063]"), std::string::npos);
+}
+
+TEST(session, AcceptsFieldAndElementConditions) {
+  constexpr auto conditions = "struct Particle {\n"
+                              "    alive: bool\n"
+                              "}\n\n"
+                              "fn count(particles: [Particle]) -> i64 {\n"
+                              "    mut k = 0\n\n"
+                              "    for i := 0 to particles.size {\n"
+                              "        if particles[i].alive {\n"
+                              "            k += 1\n"
+                              "        }\n"
+                              "    }\n\n"
+                              "    k\n"
+                              "}\n\n"
+                              "fn first(flags: [bool]) -> i64 {\n"
+                              "    while flags[0 as isize] {\n"
+                              "        break\n"
+                              "    }\n\n"
+                              "    if flags[0 as isize] then 1 else 0\n"
+                              "}\n";
+  auto result = session(gal::OutputFormat::llvm_ir)->compile(conditions);
+
+  EXPECT_TRUE(result.succeeded);
+  EXPECT_TRUE(result.diagnostics.empty());
+}
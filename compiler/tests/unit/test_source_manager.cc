@@ -0,0 +1,96 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "src/ast/source_loc.h"
+#include "src/utility/source_manager.h"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <variant>
+
+namespace ast = gal::ast;
+
+TEST(source_manager, LineAndColumn) {
+  auto manager = gal::SourceManager{};
+  auto id = manager.add("a.gal", "fn main() {\n  x\n\n}");
+
+  EXPECT_EQ(manager.line_of(id, 0), 1);
+  EXPECT_EQ(manager.column_of(id, 0), 1);
+  EXPECT_EQ(manager.line_of(id, 11), 1);
+  EXPECT_EQ(manager.line_of(id, 14), 2);
+  EXPECT_EQ(manager.column_of(id, 14), 3);
+  EXPECT_EQ(manager.line_of(id, 16), 3);
+  EXPECT_EQ(manager.line_of(id, 17), 4);
+  EXPECT_EQ(manager.column_of(id, 17), 1);
+}
+
+TEST(source_manager, LineText) {
+  auto manager = gal::SourceManager{};
+  auto id = manager.add("a.gal", "first\r\nsecond\n\nlast");
+
+  EXPECT_EQ(manager.line(id, 1), "first");
+  EXPECT_EQ(manager.line(id, 2), "second");
+  EXPECT_EQ(manager.line(id, 3), "");
+  EXPECT_EQ(manager.line(id, 4), "last");
+  EXPECT_EQ(manager.line(id, 5), "");
+}
+
+TEST(source_manager, Locations) {
+  auto id = gal::sources().add("loc.gal", "let x = 5;\nlet y = x;");
+  auto loc = ast::SourceLoc(id, 15, 1);
+
+  EXPECT_EQ(loc.raw_text(), "y");
+  EXPECT_EQ(loc.line(), 2);
+  EXPECT_EQ(loc.column(), 5);
+  EXPECT_EQ(loc.file(), "loc.gal");
+  EXPECT_EQ(ast::SourceLoc::nonexistent().raw_text(), "");
+}
+
+TEST(source_manager, LoadFromDisk) {
+  auto path = std::filesystem::temp_directory_path() / "gallium_test_source_manager.gal";
+  auto text = std::string(64 * 1024, 'a') + "\nfn main() {}\n"; // big enough to get mapped
+
+  {
+    auto out = std::ofstream(path, std::ios::binary);
+    out << text;
+  }
+
+  auto manager = gal::SourceManager{};
+  auto loaded = manager.load(path);
+
+  ASSERT_TRUE(std::holds_alternative<gal::FileID>(loaded));
+
+  auto id = std::get<gal::FileID>(loaded);
+  EXPECT_EQ(manager.contents(id), text);
+  EXPECT_EQ(manager.line(id, 2), "fn main() {}");
+  EXPECT_EQ(manager.path(id), path);
+
+  std::filesystem::remove(path);
+}
+
+TEST(source_manager, LoadMissing) {
+  auto manager = gal::SourceManager{};
+  auto loaded = manager.load("this/file/does/not/exist.gal");
+
+  EXPECT_TRUE(std::holds_alternative<std::error_code>(loaded));
+}
+
+TEST(source_manager, Release) {
+  auto manager = gal::SourceManager{};
+  auto first = manager.add("a.gal", "fn a() {}");
+  auto second = manager.add("b.gal", "fn b() {}");
+
+  manager.release(first);
+
+  EXPECT_EQ(manager.contents(first), "");
+  EXPECT_EQ(manager.path(first), "");
+  EXPECT_EQ(manager.contents(second), "fn b() {}");
+  EXPECT_NE(manager.add("c.gal", ""), first);
+}
@@ -110,6 +110,10 @@ std::unique_ptr<ast::Type> tests::float_of(ast::FloatWidth width) noexcept {
   return std::make_unique<ast::BuiltinFloatType>(ast::SourceLoc::nonexistent(), width);
 }
 
+std::unique_ptr<ast::Type> tests::vector_of(std::uint64_t lanes, std::unique_ptr<ast::Type> type) noexcept {
+  return std::make_unique<ast::VectorType>(ast::SourceLoc::nonexistent(), lanes, std::move(type));
+}
+
 std::unique_ptr<ast::Type> tests::char_type() noexcept {
   return std::make_unique<ast::BuiltinCharType>(ast::SourceLoc::nonexistent());
 }
@@ -55,6 +55,8 @@ namespace tests {
 
   std::unique_ptr<ast::Type> float_of(ast::FloatWidth width) noexcept;
 
+  std::unique_ptr<ast::Type> vector_of(std::uint64_t lanes, std::unique_ptr<ast::Type> type) noexcept;
+
   std::unique_ptr<ast::Type> char_type() noexcept;
 
   std::unique_ptr<ast::Type> bool_type() noexcept;
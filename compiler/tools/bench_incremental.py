@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+
+##======---------------------------------------------------------------======##
+#                                                                             #
+# Copyright 2021 Evan Cox <evanacox00@gmail.com>                              #
+#                                                                             #
+# Use of this source code is governed by a BSD-style license that can be      #
+# found in the LICENSE.txt file at the root of this project, or at the        #
+# following link: https://opensource.org/licenses/BSD-3-Clause                #
+#                                                                             #
+##======---------------------------------------------------------------======##
+
+# Measures how much `--incremental` saves when one function in a large file
+# is edited, compared to compiling the file from scratch.
+#
+# usage: bench_incremental.py <path to gallium> [functions] [runs] [opt]
+
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def generate(functions: int, edited: int, value: int) -> str:
+    source = []
+
+    for i in range(functions):
+        constant = value if i == edited else i
+
+        source.append(f"""fn work{i}(n: i64) -> i64 {{
+    mut accum = 0
+
+    for i := 0 to n {{
+        accum += i * {constant} + (accum / (i + 1))
+    }}
+
+    accum
+}}
+""")
+
+    calls = "\n".join(f"    total += work{i}(10)" for i in range(functions))
+    source.append(f"""fn main() -> i32 {{
+    mut total = 0
+
+{calls}
+
+    (total % 2) as i32
+}}
+""")
+
+    return "\n".join(source)
+
+
+def time_compile(compiler: str, file: str, out: str, extra: list) -> float:
+    start = time.perf_counter()
+    result = subprocess.run([compiler, "--emit", "obj", "--out", out, file, *extra], capture_output=True)
+    elapsed = time.perf_counter() - start
+
+    if result.returncode != 0:
+        print(result.stderr.decode("UTF-8"))
+        sys.exit(1)
+
+    return elapsed * 1000
+
+
+def report(name: str, times: list):
+    print(f"{name:>22}: median {statistics.median(times):9.2f}ms, "
+          f"min {min(times):9.2f}ms, max {max(times):9.2f}ms ({len(times)} runs)")
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: bench_incremental.py <path to gallium> [functions] [runs] [opt]")
+        sys.exit(1)
+
+    compiler = os.path.abspath(sys.argv[1])
+    functions = int(sys.argv[2]) if len(sys.argv) > 2 else 2000
+    runs = int(sys.argv[3]) if len(sys.argv) > 3 else 5
+    opt = sys.argv[4] if len(sys.argv) > 4 else "none"
+    edited = functions // 2
+
+    with tempfile.TemporaryDirectory() as tmp:
+        file = os.path.join(tmp, "large.gal")
+        out = os.path.join(tmp, "large")
+        cache = ["--incremental", "--cache_dir", os.path.join(tmp, "cache"), "--opt", opt]
+        scratch, unchanged, edit = [], [], []
+
+        for run in range(runs):
+            with open(file, "w") as f:
+                f.write(generate(functions, edited, 100000 + run * 2))
+
+            scratch.append(time_compile(compiler, file, out, ["--opt", opt]))
+
+            # first compile with the cache fills it, the second one should hit for the entire file
+            time_compile(compiler, file, out, cache)
+            unchanged.append(time_compile(compiler, file, out, cache))
+
+            # only the edited function should need to go through codegen again
+            with open(file, "w") as f:
+                f.write(generate(functions, edited, 100000 + run * 2 + 1))
+
+            edit.append(time_compile(compiler, file, out, cache))
+
+        print(f"{functions} functions, --opt {opt}")
+        report("from scratch", scratch)
+        report("cached, no changes", unchanged)
+        report("cached, one fn edited", edit)
+
+        # show the hit/miss counts for one last edit
+        with open(file, "w") as f:
+            f.write(generate(functions, edited, 1))
+
+        result = subprocess.run([compiler, "--emit", "obj", "--out", out, file, "--time_report", *cache],
+                                capture_output=True)
+        stats = result.stderr.decode("UTF-8")
+        print(stats[stats.find("===---------------------- incremental cache"):], end="")
+
+
+if __name__ == "__main__":
+    main()
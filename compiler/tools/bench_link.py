@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+
+##======---------------------------------------------------------------======##
+#                                                                             #
+# Copyright 2021 Evan Cox <evanacox00@gmail.com>                              #
+#                                                                             #
+# Use of this source code is governed by a BSD-style license that can be      #
+# found in the LICENSE.txt file at the root of this project, or at the        #
+# following link: https://opensource.org/licenses/BSD-3-Clause                #
+#                                                                             #
+##======---------------------------------------------------------------======##
+
+# Measures end-to-end `--emit exe` latency with the built-in linker
+# versus shelling out to `$CC`.
+#
+# usage: bench_link.py <path to gallium> [file.gal] [runs]
+
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def time_compile(compiler: str, file: str, out: str, extra: list) -> float:
+    start = time.perf_counter()
+    result = subprocess.run([compiler, "--emit", "exe", "--out", out, file, *extra], capture_output=True)
+    elapsed = time.perf_counter() - start
+
+    if result.returncode != 0:
+        print(result.stderr.decode("UTF-8"))
+        sys.exit(1)
+
+    return elapsed * 1000
+
+
+def bench(compiler: str, file: str, runs: int, extra: list) -> list:
+    with tempfile.TemporaryDirectory() as tmp:
+        out = os.path.join(tmp, "bench")
+
+        # the first run with the built-in linker fills the link-command cache
+        time_compile(compiler, file, out, extra)
+
+        return [time_compile(compiler, file, out, extra) for _ in range(runs)]
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: bench_link.py <path to gallium> [file.gal] [runs]")
+        sys.exit(1)
+
+    compiler = os.path.abspath(sys.argv[1])
+    default = os.path.join(os.path.dirname(os.path.realpath(__file__)), "../tests/compiler/nop.gal")
+    file = sys.argv[2] if len(sys.argv) > 2 else default
+    runs = int(sys.argv[3]) if len(sys.argv) > 3 else 20
+
+    for name, extra in [("built-in", []), ("$CC", ["--system_linker"])]:
+        times = bench(compiler, file, runs, extra)
+
+        print(f"{name:>10}: median {statistics.median(times):8.2f}ms, "
+              f"min {min(times):8.2f}ms, max {max(times):8.2f}ms ({runs} runs)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+
+##======---------------------------------------------------------------======##
+#                                                                             #
+# Copyright 2021 Evan Cox <evanacox00@gmail.com>                              #
+#                                                                             #
+# Use of this source code is governed by a BSD-style license that can be      #
+# found in the LICENSE.txt file at the root of this project, or at the        #
+# following link: https://opensource.org/licenses/BSD-3-Clause                #
+#                                                                             #
+##======---------------------------------------------------------------======##
+
+# Measures per-request latency of `gallium-client` talking to a warm
+# `gallium --serve` server, versus a cold `gallium` process every time.
+#
+# usage: bench_serve.py <path to gallium> <path to gallium-client> [file.gal] [runs]
+
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def time_compile(command: list, file: str, out: str, env: dict) -> float:
+    start = time.perf_counter()
+    result = subprocess.run([*command, "--emit", "obj", "--out", out, file], capture_output=True, env=env)
+    elapsed = time.perf_counter() - start
+
+    if result.returncode != 0:
+        print(result.stderr.decode("UTF-8"))
+        sys.exit(1)
+
+    return elapsed * 1000
+
+
+def wait_for(path: str, server: subprocess.Popen):
+    while not os.path.exists(path):
+        if server.poll() is not None:
+            print("server exited before it started listening")
+            sys.exit(1)
+
+        time.sleep(0.01)
+
+
+def main():
+    if len(sys.argv) < 3:
+        print("usage: bench_serve.py <path to gallium> <path to gallium-client> [file.gal] [runs]")
+        sys.exit(1)
+
+    compiler = os.path.abspath(sys.argv[1])
+    client = os.path.abspath(sys.argv[2])
+    default = os.path.join(os.path.dirname(os.path.realpath(__file__)), "../tests/compiler/nop.gal")
+    file = os.path.abspath(sys.argv[3]) if len(sys.argv) > 3 else default
+    runs = int(sys.argv[4]) if len(sys.argv) > 4 else 20
+
+    with tempfile.TemporaryDirectory() as tmp:
+        out = os.path.join(tmp, "bench")
+        env = dict(os.environ, GALLIUM_SOCKET=os.path.join(tmp, "gallium.sock"))
+        results = [("cold", [time_compile([compiler], file, out, env) for _ in range(runs)])]
+        server = subprocess.Popen([compiler, "--serve"], env=env, stdout=subprocess.DEVNULL)
+
+        try:
+            wait_for(env["GALLIUM_SOCKET"], server)
+            results.append(("served", [time_compile([client], file, out, env) for _ in range(runs)]))
+        finally:
+            server.terminate()
+            server.wait()
+
+    for name, times in results:
+        print(f"{name:>10}: median {statistics.median(times):8.2f}ms, "
+              f"min {min(times):8.2f}ms, max {max(times):8.2f}ms ({runs} runs)")
+
+
+if __name__ == "__main__":
+    main()
@@ -14,5 +14,13 @@ int main(int argc, char** argv) {
   gal::runtime::argc = argc;
   gal::runtime::argv = argv;
 
-  return gal::runtime::__gallium_user_main();
+  auto result = gal::runtime::__gallium_user_main();
+
+  // instrumented programs write their profile as soon as main returns, rather than leaving it
+  // up to an exit handler that runs after static destructors (or never, if anything calls `_exit`)
+  if (gal::runtime::__llvm_profile_dump != nullptr) {
+    gal::runtime::__llvm_profile_dump();
+  }
+
+  return result;
 }
\ No newline at end of file
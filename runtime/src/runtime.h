@@ -50,4 +50,11 @@ namespace gal::runtime {
   /// This function **does not exist** in this object file, it is defined
   /// as a weak symbol in every LLVM module emitted by the compiler
   extern "C" [[noreturn]] GAL_WEAK_SYMBOL void __gallium_trap() noexcept;
+
+  /// Writes the profile of a program built with `--profile_generate`, and marks it as
+  /// written so that the profile runtime's own exit handler doesn't write it again.
+  ///
+  /// This is part of LLVM's profile runtime, so it's only non-null when the program
+  /// was linked against it
+  extern "C" GAL_WEAK_SYMBOL int __llvm_profile_dump() noexcept;
 } // namespace gal::runtime
\ No newline at end of file